@@ -926,6 +926,8 @@ def run():
     parser.add_argument("--qr-threshold", type=int, default=200)
     parser.add_argument("--qr-operation", type=str, default="mult")
     parser.add_argument("--qr-collisions", type=int, default=4)
+    # shared library of the fused quotient-remainder embedding bag op
+    parser.add_argument("--qr-native-lib", type=str, default="")
     # activations and loss
     parser.add_argument("--activation-function", type=str, default="relu")
     parser.add_argument("--loss-function", type=str, default="mse")  # or bce or wbce
@@ -1039,6 +1041,9 @@ def run():
             key=mlperf_logger.constants.INIT_START, log_all_ranks=True
         )
 
+    if args.qr_flag and args.qr_native_lib:
+        torch.ops.load_library(args.qr_native_lib)
+
     if args.weighted_pooling is not None:
         if args.qr_flag:
             sys.exit("ERROR: quotient remainder with weighted pooling is not supported")
@@ -22,6 +22,18 @@ import torch.nn as nn
 import torch.nn.functional as F
 from torch.nn.parameter import Parameter
 
+_OPERATIONS = {"concat": 0, "add": 1, "mult": 2}
+_MODES = {"sum": 0, "mean": 1}
+
+
+def _native_op_available():
+    # The fused op is built with torchrec (torchrec/csrc/embedding) and loaded
+    # by torch.ops.load_library.
+    try:
+        return hasattr(torch.ops.compressed_embedding, "qr_embedding_bag")
+    except RuntimeError:
+        return False
+
 
 class QREmbeddingBag(nn.Module):
     r"""Computes sums or means over two 'bags' of embeddings, one using the quotient
@@ -189,7 +201,39 @@ class QREmbeddingBag(nn.Module):
         nn.init.uniform_(self.weight_q, np.sqrt(1 / self.num_categories))
         nn.init.uniform_(self.weight_r, np.sqrt(1 / self.num_categories))
 
+    def _use_native_op(self, input, offsets):
+        return (
+            input.device.type == "cpu"
+            and input.dim() == 1
+            and offsets is not None
+            and self.weight_q.dtype == torch.float32
+            and self.max_norm is None
+            and not self.scale_grad_by_freq
+            and self.mode in _MODES
+            and _native_op_available()
+        )
+
+    def _native_forward(self, input, offsets, per_sample_weights):
+        # nn.EmbeddingBag offsets are the bag starts, the op also takes the end.
+        offsets = torch.cat(
+            [offsets.long(), torch.tensor([input.numel()], dtype=torch.long)]
+        )
+        return torch.ops.compressed_embedding.qr_embedding_bag(
+            self.weight_q,
+            self.weight_r,
+            input.long(),
+            offsets,
+            per_sample_weights,
+            self.num_collisions,
+            _OPERATIONS[self.operation],
+            _MODES[self.mode],
+            self.sparse,
+        )
+
     def forward(self, input, offsets=None, per_sample_weights=None):
+        if self._use_native_op(input, offsets):
+            return self._native_forward(input, offsets, per_sample_weights)
+
         input_q = (input / self.num_collisions).long()
         input_r = torch.remainder(input, self.num_collisions).long()
 
@@ -103,6 +103,20 @@ at::Tensor replace_last_n_with_jagged_meta(
     const at::Tensor& lengths_right,
     const at::Tensor& values_right);
 
+std::tuple<at::Tensor, at::Tensor> fused_concat_1d_jagged_cpu(
+    const std::vector<at::Tensor>& lengths,
+    const std::vector<at::Tensor>& values,
+    const std::string& mode,
+    const int64_t max_len,
+    const double padding_value);
+
+std::tuple<at::Tensor, at::Tensor> fused_concat_1d_jagged_meta(
+    const std::vector<at::Tensor>& lengths,
+    const std::vector<at::Tensor>& values,
+    const std::string& mode,
+    const c10::SymInt max_len,
+    const double padding_value);
+
 DLL_PUBLIC std::tuple<at::Tensor, at::Tensor> sort_kv_pairs_meta(
     const at::Tensor& keys,
     const at::Tensor& values,
@@ -134,6 +148,8 @@ TORCH_LIBRARY_FRAGMENT(hstu, m) {
   m.def(
       "replace_last_n_with_jagged(Tensor lengths_left, Tensor values_left, Tensor lengths_right, Tensor values_right) -> Tensor");
   m.def("complete_cumsum(Tensor values) -> Tensor");
+  m.def(
+      "fused_concat_1d_jagged(Tensor[] lengths, Tensor[] values, str mode, SymInt max_len=0, float padding_value=0) -> (Tensor, Tensor)");
   m.def(
       "sort_kv_pairs(Tensor keys, Tensor values, int? end_bit=None, bool descending=False) -> (Tensor, Tensor)");
 }
@@ -144,6 +160,7 @@ TORCH_LIBRARY_IMPL(hstu, CPU, m) {
   m.impl("split_1d_jagged_jagged", hstu::split_1d_jagged_jagged_cpu);
   m.impl("replace_last_n_with_jagged", hstu::replace_last_n_with_jagged_cpu);
   m.impl("complete_cumsum", hstu::complete_cumsum_cpu);
+  m.impl("fused_concat_1d_jagged", hstu::fused_concat_1d_jagged_cpu);
 }
 
 TORCH_LIBRARY_IMPL(hstu, CUDA, m) {
@@ -164,6 +181,7 @@ TORCH_LIBRARY_IMPL(hstu, Meta, m) {
   m.impl("split_1d_jagged_jagged", hstu::split_1d_jagged_jagged_meta);
   m.impl("replace_last_n_with_jagged", hstu::replace_last_n_with_jagged_meta);
   m.impl("complete_cumsum", hstu::complete_cumsum_meta);
+  m.impl("fused_concat_1d_jagged", hstu::fused_concat_1d_jagged_meta);
   m.impl(
       "sort_kv_pairs",
       torch::dispatch(
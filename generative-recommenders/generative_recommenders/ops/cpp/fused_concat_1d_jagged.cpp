@@ -0,0 +1,241 @@
+/* Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ATen/ATen.h>
+#include <ATen/Dispatch.h>
+#include <ATen/Parallel.h>
+#include <ATen/core/op_registration/op_registration.h>
+#include <torch/extension.h>
+#include <torch/library.h>
+
+namespace hstu {
+
+namespace {
+
+// The layout of the combined rows in the output values.
+enum class FusedJaggedMode {
+  // concatenated jagged values, as `concat_1d_jagged_jagged`.
+  kJagged,
+  // [B, max_len], truncated and padded with `padding_value`.
+  kDense,
+  // [B, max_len], truncated and padded with the last value of the row, or 0
+  // for an empty row, as `expand_1d_jagged_to_dense`.
+  kExpand,
+};
+
+FusedJaggedMode parse_mode(const std::string& mode) {
+  if (mode == "jagged") {
+    return FusedJaggedMode::kJagged;
+  }
+  if (mode == "dense") {
+    return FusedJaggedMode::kDense;
+  }
+  TORCH_CHECK(mode == "expand", "unknown mode ", mode);
+  return FusedJaggedMode::kExpand;
+}
+
+// rows per task, and the granularity of the chunk offsets.
+constexpr int64_t kRowsPerChunk = 1024;
+
+template <typename index_t, typename val_t>
+void fused_concat_1d_jagged_cpu_kernel_(
+    FusedJaggedMode mode,
+    int64_t B,
+    int64_t max_len,
+    val_t padding_value,
+    const std::vector<const index_t*>& lengths,
+    const std::vector<const val_t*>& values,
+    const std::vector<int64_t>& numels,
+    index_t* offsets,
+    val_t* output) {
+  const auto K = static_cast<int64_t>(lengths.size());
+  const int64_t num_chunks = (B + kRowsPerChunk - 1) / kRowsPerChunk;
+  // The start of each chunk in the values of each input, instead of the
+  // complete offsets of every input.
+  std::vector<int64_t> chunk_starts((num_chunks + 1) * K, 0);
+  at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (auto c : c10::irange(begin, end)) {
+      const int64_t row_end = std::min(B, (c + 1) * kRowsPerChunk);
+      for (auto k : c10::irange(K)) {
+        int64_t sum = 0;
+        for (int64_t b = c * kRowsPerChunk; b < row_end; ++b) {
+          TORCH_CHECK(lengths[k][b] >= 0, "negative length of input ", k);
+          sum += lengths[k][b];
+        }
+        chunk_starts[(c + 1) * K + k] = sum;
+      }
+    }
+  });
+  int64_t total = 0;
+  for (auto c : c10::irange(num_chunks)) {
+    for (auto k : c10::irange(K)) {
+      chunk_starts[(c + 1) * K + k] += chunk_starts[c * K + k];
+    }
+  }
+  for (auto k : c10::irange(K)) {
+    TORCH_CHECK(
+        chunk_starts[num_chunks * K + k] == numels[k],
+        "the lengths of input ",
+        k,
+        " do not sum up to its number of values");
+    total += numels[k];
+  }
+  TORCH_CHECK(total <= std::numeric_limits<index_t>::max());
+
+  offsets[0] = 0;
+  at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    std::vector<int64_t> starts(K);
+    for (auto c : c10::irange(begin, end)) {
+      int64_t combined_start = 0;
+      for (auto k : c10::irange(K)) {
+        starts[k] = chunk_starts[c * K + k];
+        combined_start += starts[k];
+      }
+      const int64_t row_end = std::min(B, (c + 1) * kRowsPerChunk);
+      for (int64_t b = c * kRowsPerChunk; b < row_end; ++b) {
+        int64_t len = 0;
+        val_t* row = mode == FusedJaggedMode::kJagged
+            ? output + combined_start
+            : output + b * max_len;
+        const val_t* last = nullptr;
+        for (auto k : c10::irange(K)) {
+          const int64_t input_len = lengths[k][b];
+          const val_t* src = values[k] + starts[k];
+          if (mode == FusedJaggedMode::kJagged) {
+            std::copy(src, src + input_len, row + len);
+          } else if (len < max_len) {
+            std::copy(src, src + std::min(input_len, max_len - len), row + len);
+          }
+          if (input_len > 0) {
+            last = src + input_len - 1;
+          }
+          len += input_len;
+          starts[k] += input_len;
+        }
+        if (mode == FusedJaggedMode::kDense) {
+          std::fill(row + std::min(len, max_len), row + max_len, padding_value);
+        } else if (mode == FusedJaggedMode::kExpand) {
+          std::fill(
+              row + std::min(len, max_len),
+              row + max_len,
+              last == nullptr ? val_t(0) : *last);
+        }
+        combined_start += len;
+        offsets[b + 1] = static_cast<index_t>(combined_start);
+      }
+    }
+  });
+}
+
+} // namespace
+
+/*
+ * Concatenates the rows of several 1D jagged inputs in a single pass, and
+ * returns the offsets of the combined rows with the combined values laid out
+ * by `mode`:
+ * - "jagged": the concatenated values, as `concat_1d_jagged_jagged`.
+ * - "dense": [B, max_len], truncated and padded with `padding_value`.
+ * - "expand": [B, max_len], truncated and padded with the last value of each
+ *   row, as `expand_1d_jagged_to_dense`.
+ *
+ * The offsets are of the combined lengths before truncation, so that a single
+ * input gives `complete_cumsum` of its lengths. The input offsets are never
+ * materialized: the lengths are summed by chunk of rows, and each chunk then
+ * locates its rows from the prefix of the chunk sums.
+ */
+std::tuple<at::Tensor, at::Tensor> fused_concat_1d_jagged_cpu(
+    const std::vector<at::Tensor>& lengths,
+    const std::vector<at::Tensor>& values,
+    const std::string& mode,
+    const int64_t max_len,
+    const double padding_value) {
+  TORCH_CHECK(!lengths.empty(), "at least one input is required");
+  TORCH_CHECK(lengths.size() == values.size());
+  const auto parsed_mode = parse_mode(mode);
+  TORCH_CHECK(parsed_mode == FusedJaggedMode::kJagged || max_len >= 0);
+  const auto B = lengths[0].numel();
+  std::vector<at::Tensor> lengths_contig;
+  std::vector<at::Tensor> values_contig;
+  std::vector<int64_t> numels;
+  int64_t L = 0;
+  for (auto k : c10::irange(lengths.size())) {
+    TORCH_INTERNAL_ASSERT(lengths[k].device().type() == at::DeviceType::CPU);
+    TORCH_INTERNAL_ASSERT(values[k].device().type() == at::DeviceType::CPU);
+    TORCH_CHECK(lengths[k].numel() == B);
+    TORCH_CHECK(lengths[k].scalar_type() == lengths[0].scalar_type());
+    TORCH_CHECK(values[k].dim() == 1);
+    TORCH_CHECK(values[k].scalar_type() == values[0].scalar_type());
+    lengths_contig.emplace_back(lengths[k].view({-1}).contiguous());
+    values_contig.emplace_back(values[k].contiguous());
+    numels.emplace_back(values[k].numel());
+    L += values[k].numel();
+  }
+  auto offsets = at::empty({B + 1}, lengths[0].options());
+  auto output = parsed_mode == FusedJaggedMode::kJagged
+      ? at::empty({L}, values[0].options())
+      : at::empty({B, max_len}, values[0].options());
+  AT_DISPATCH_INTEGRAL_TYPES(
+      lengths[0].scalar_type(), "fused_concat_1d_jagged_cpu_input1", [&] {
+        using index_t = scalar_t;
+        AT_DISPATCH_ALL_TYPES_AND2(
+            at::ScalarType::BFloat16,
+            at::ScalarType::Half,
+            values[0].scalar_type(),
+            "fused_concat_1d_jagged_cpu_input2",
+            [&] {
+              using val_t = scalar_t;
+              std::vector<const index_t*> lengths_ptrs;
+              std::vector<const val_t*> values_ptrs;
+              for (auto k : c10::irange(lengths.size())) {
+                lengths_ptrs.emplace_back(
+                    lengths_contig[k].template data_ptr<index_t>());
+                values_ptrs.emplace_back(
+                    values_contig[k].template data_ptr<val_t>());
+              }
+              fused_concat_1d_jagged_cpu_kernel_<index_t, val_t>(
+                  parsed_mode,
+                  B,
+                  max_len,
+                  static_cast<val_t>(padding_value),
+                  lengths_ptrs,
+                  values_ptrs,
+                  numels,
+                  offsets.data_ptr<index_t>(),
+                  output.data_ptr<val_t>());
+            });
+      });
+  return {offsets, output};
+}
+
+std::tuple<at::Tensor, at::Tensor> fused_concat_1d_jagged_meta(
+    const std::vector<at::Tensor>& lengths,
+    const std::vector<at::Tensor>& values,
+    const std::string& mode,
+    const c10::SymInt max_len,
+    const double padding_value) {
+  TORCH_CHECK(!lengths.empty(), "at least one input is required");
+  auto B = lengths[0].sym_numel();
+  auto offsets = at::empty_symint({B + 1}, lengths[0].options());
+  if (parse_mode(mode) != FusedJaggedMode::kJagged) {
+    return {offsets, at::empty_symint({B, max_len}, values[0].options())};
+  }
+  c10::SymInt L = 0;
+  for (const auto& v : values) {
+    L += v.sym_numel();
+  }
+  return {offsets, at::empty_symint({L}, values[0].options())};
+}
+
+} // namespace hstu
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+
+# pyre-strict
+
+import unittest
+from typing import List
+
+import torch
+
+from hypothesis import given, settings, strategies as st, Verbosity
+
+# buck2 test @mode/opt fbcode//generative_recommenders/ops/cpp/tests:fused_concat_1d_jagged_test
+
+torch.ops.load_library("//generative_recommenders/ops/cpp:cpp_ops")
+torch.ops.load_library("//deeplearning/fbgemm/fbgemm_gpu:sparse_ops")
+torch.ops.load_library("//deeplearning/fbgemm/fbgemm_gpu:sparse_ops_cpu")
+
+
+def _random_jagged(
+    batch_size: int, max_seq_len: int, val_dtype: torch.dtype
+) -> List[torch.Tensor]:
+    lengths = torch.randint(0, max_seq_len + 1, (batch_size,), dtype=torch.int32)
+    values = torch.randint(0, 1000, (int(lengths.sum().item()),)).to(val_dtype)
+    return [lengths, values]
+
+
+def _rows(lengths: torch.Tensor, values: torch.Tensor) -> List[torch.Tensor]:
+    return list(torch.split(values, lengths.tolist()))
+
+
+class OpsTest(unittest.TestCase):
+    # pyre-ignore
+    @given(
+        batch_size=st.integers(0, 3000),
+        num_inputs=st.integers(1, 3),
+        max_seq_len=st.integers(0, 20),
+        max_len=st.integers(0, 30),
+        val_dtype=st.sampled_from([torch.float32, torch.bfloat16, torch.int64]),
+    )
+    @settings(
+        verbosity=Verbosity.verbose,
+        max_examples=50,
+        deadline=None,
+    )
+    def test_fused_concat_1d_jagged(
+        self,
+        batch_size: int,
+        num_inputs: int,
+        max_seq_len: int,
+        max_len: int,
+        val_dtype: torch.dtype,
+    ) -> None:
+        inputs = [
+            _random_jagged(batch_size, max_seq_len, val_dtype)
+            for _ in range(num_inputs)
+        ]
+        lengths = [lengths for lengths, _ in inputs]
+        values = [values for _, values in inputs]
+        rows = [
+            torch.cat(row)
+            for row in zip(*[_rows(lengths, values) for lengths, values in inputs])
+        ]
+        combined_lengths = torch.stack(lengths).sum(dim=0).to(torch.int32)
+        expected_offsets = torch.ops.hstu.complete_cumsum(combined_lengths)
+
+        offsets, jagged = torch.ops.hstu.fused_concat_1d_jagged(
+            lengths, values, "jagged"
+        )
+        torch.testing.assert_close(offsets, expected_offsets)
+        torch.testing.assert_close(
+            jagged, torch.cat(rows) if rows else torch.empty(0, dtype=val_dtype)
+        )
+
+        offsets, dense = torch.ops.hstu.fused_concat_1d_jagged(
+            lengths, values, "dense", max_len=max_len, padding_value=-1
+        )
+        torch.testing.assert_close(offsets, expected_offsets)
+        expected_dense = torch.full((batch_size, max_len), -1, dtype=val_dtype)
+        for b, row in enumerate(rows):
+            n = min(row.numel(), max_len)
+            expected_dense[b, :n] = row[:n]
+        torch.testing.assert_close(dense, expected_dense)
+
+    def test_special_cases(self) -> None:
+        torch.manual_seed(42)
+        lengths_left, values_left = _random_jagged(100, 50, torch.float32)
+        lengths_right, values_right = _random_jagged(100, 30, torch.float32)
+        _, concat = torch.ops.hstu.fused_concat_1d_jagged(
+            [lengths_left, lengths_right], [values_left, values_right], "jagged"
+        )
+        torch.testing.assert_close(
+            concat,
+            torch.ops.hstu.concat_1d_jagged_jagged(
+                lengths_left=lengths_left,
+                values_left=values_left,
+                lengths_right=lengths_right,
+                values_right=values_right,
+            ),
+        )
+
+        offsets, expanded = torch.ops.hstu.fused_concat_1d_jagged(
+            [lengths_left], [values_left], "expand", max_len=40
+        )
+        torch.testing.assert_close(
+            offsets, torch.ops.hstu.complete_cumsum(lengths_left)
+        )
+        torch.testing.assert_close(
+            expanded,
+            torch.ops.hstu.expand_1d_jagged_to_dense(
+                values=values_left, offsets=offsets, max_len=40
+            ),
+        )
+
+    def test_mismatched_lengths(self) -> None:
+        with self.assertRaises(RuntimeError):
+            torch.ops.hstu.fused_concat_1d_jagged(
+                [torch.tensor([1, 2], dtype=torch.int32)],
+                [torch.rand(2)],
+                "jagged",
+            )
@@ -8,7 +8,9 @@
 
 #include <benchmark/benchmark.h>
 #include <torch/torch.h>
+#include <torchrec/csrc/dynamic_embedding/details/id_transformer.h>
 #include <torchrec/csrc/dynamic_embedding/details/mixed_lfu_lru_strategy.h>
+#include <numeric>
 
 namespace torchrec {
 
@@ -62,6 +64,21 @@ class RandomizeMixedLXUSet {
     return {records_.begin(), records_.end()};
   }
 
+  void Export(const chunk_visitor_t& visitor, size_t chunk_size) const {
+    std::vector<int64_t> global_ids(chunk_size);
+    std::vector<int64_t> cache_ids(chunk_size);
+    for (size_t i = 0; i < records_.size(); i += chunk_size) {
+      size_t n = std::min(chunk_size, records_.size() - i);
+      std::iota(global_ids.begin(), global_ids.begin() + n, i);
+      visitor(record_chunk_t{
+          .global_ids = std::span{global_ids.data(), n},
+          .cache_ids = std::span{cache_ids.data(), n},
+          .lxu_records = std::span{
+              reinterpret_cast<const lxu_record_t*>(records_.data() + i), n},
+      });
+    }
+  }
+
  private:
   std::vector<MixedLFULRUStrategy::Record> records_;
 };
@@ -82,4 +99,25 @@ BENCHMARK(BM_MixedLFULRUStrategyEvict)
         3000,
         5000000,
     });
+
+void BM_MixedLFULRUStrategyEvictChunks(benchmark::State& state) {
+  RandomizeMixedLXUSet lxuSet(state.range(0), state.range(1), state.range(2));
+  MixedLFULRUStrategy strategy;
+  for (auto _ : state) {
+    strategy.evict_chunks(
+        [&](const chunk_visitor_t& visitor) {
+          lxuSet.Export(visitor, IDTransformer::k_export_chunk_size);
+        },
+        state.range(3));
+  }
+}
+
+BENCHMARK(BM_MixedLFULRUStrategyEvictChunks)
+    ->ArgNames({"total", "max_freq", "max_time", "num_to_evict"})
+    ->Args({
+        300000000 * 2,
+        12,
+        3000,
+        5000000,
+    });
 } // namespace torchrec
@@ -12,8 +12,10 @@
 
 namespace torchrec {
 
-static void BM_NaiveIDTransformer(benchmark::State& state) {
-  NaiveIDTransformer transformer(2e8);
+static void BM_NaiveIDTransformer(
+    benchmark::State& state,
+    std::string_view memory_policy) {
+  NaiveIDTransformer transformer(2e8, parse_memory_policy(memory_policy));
   torch::Tensor global_ids = torch::empty({1024, 1024}, torch::kLong);
   torch::Tensor cache_ids = torch::empty_like(global_ids);
   for (auto _ : state) {
@@ -30,11 +32,19 @@ static void BM_NaiveIDTransformer(benchmark::State& state) {
   }
 }
 
-BENCHMARK(BM_NaiveIDTransformer)
-    ->Iterations(100)
-    ->Unit(benchmark::kMillisecond)
-    ->ArgNames({"rand_from", "rand_to"})
-    ->Args({static_cast<long long>(1e10), static_cast<long long>(2e10)})
-    ->Args({static_cast<long long>(1e6), static_cast<long long>(2e6)});
+#define NAIVE_ID_TRANSFORMER_BENCHMARK(name, memory_policy)               \
+  BENCHMARK_CAPTURE(BM_NaiveIDTransformer, name, memory_policy)            \
+      ->Iterations(100)                                                    \
+      ->Unit(benchmark::kMillisecond)                                      \
+      ->ArgNames({"rand_from", "rand_to"})                                 \
+      ->Args({static_cast<long long>(1e10), static_cast<long long>(2e10)}) \
+      ->Args({static_cast<long long>(1e6), static_cast<long long>(2e6)})
+
+NAIVE_ID_TRANSFORMER_BENCHMARK(default, "");
+NAIVE_ID_TRANSFORMER_BENCHMARK(hugepage_2m, "hugepage=2m");
+NAIVE_ID_TRANSFORMER_BENCHMARK(hugepage_1g, "hugepage=1g");
+NAIVE_ID_TRANSFORMER_BENCHMARK(
+    hugepage_2m_interleave,
+    "hugepage=2m&&numa=interleave&&first_touch_threads=16");
 
 } // namespace torchrec
@@ -7,6 +7,7 @@
  */
 
 #pragma once
+#include <sys/mman.h>
 #include <torch/torch.h>
 #include <algorithm>
 #include <vector>
@@ -15,6 +16,13 @@
 namespace tde::details {
 
 static void* alignMalloc(size_t align, size_t size) {
+  // Large tables are aligned to huge pages and advised to be backed by
+  // transparent huge pages, to reduce TLB misses of random probes.
+  static constexpr size_t huge_page_size = 2UL << 20;
+  bool use_huge_page = size >= huge_page_size;
+  if (use_huge_page) {
+    align = std::max(align, huge_page_size);
+  }
   void* result;
   TORCH_CHECK(
       posix_memalign(&result, align, size) == 0,
@@ -22,6 +30,9 @@ static void* alignMalloc(size_t align, size_t size) {
       errno,
       ": ",
       strerror(errno));
+  if (use_huge_page) {
+    madvise(result, size / huge_page_size * huge_page_size, MADV_HUGEPAGE);
+  }
   return result;
 }
 
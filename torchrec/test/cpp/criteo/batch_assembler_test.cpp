@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/criteo/batch_assembler.h>
+#include <unistd.h>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+namespace torchrec::criteo {
+
+template <typename T>
+static void save_npy(
+    const std::string& path,
+    std::vector<int64_t> shape,
+    const std::vector<T>& values) {
+  std::ofstream out(path, std::ios::binary);
+  out << npy_header(npy_descr<T>(), shape);
+  out.write(
+      reinterpret_cast<const char*>(values.data()),
+      values.size() * sizeof(T));
+}
+
+TEST(BatchAssemblerTest, Assemble) {
+  auto dir = std::filesystem::temp_directory_path() /
+      ("criteo_batch_assembler_test_" + std::to_string(getpid()));
+  std::filesystem::create_directories(dir);
+
+  // Two files of 3 and 4 rows, 2 dense and 3 sparse columns. Row r has
+  // dense values {r, r + 0.5}, sparse ids {r, 10 + r, 20 + r} and label r.
+  std::vector<std::string> dense_paths, sparse_paths, labels_paths;
+  int64_t row = 0;
+  for (int64_t num_rows : {3, 4}) {
+    std::vector<float> dense;
+    std::vector<int64_t> sparse;
+    std::vector<int32_t> labels;
+    for (int64_t i = 0; i < num_rows; ++i, ++row) {
+      dense.insert(dense.end(), {float(row), row + 0.5f});
+      sparse.insert(sparse.end(), {row, 10 + row, 20 + row});
+      labels.emplace_back(row);
+    }
+    auto prefix = (dir / std::to_string(dense_paths.size())).string();
+    dense_paths.emplace_back(prefix + "_dense.npy");
+    sparse_paths.emplace_back(prefix + "_sparse.npy");
+    labels_paths.emplace_back(prefix + "_labels.npy");
+    save_npy<float>(dense_paths.back(), {num_rows, 2}, dense);
+    save_npy<int64_t>(sparse_paths.back(), {num_rows, 3}, sparse);
+    save_npy<int32_t>(labels_paths.back(), {num_rows, 1}, labels);
+  }
+
+  // Skip the first row of the first file, so the rows in use are 1..6.
+  auto batches = torch::tensor({0, 2, 2, 3, 5, 1}, torch::kLong).view({3, 2});
+  for (int64_t num_prefetch : {1, 2, 4}) {
+    BatchAssembler assembler(
+        dense_paths,
+        sparse_paths,
+        labels_paths,
+        {1, 0},
+        {3, 4},
+        batches,
+        {1000, 1000, 16},
+        num_prefetch,
+        2,
+        false);
+    ASSERT_EQ(assembler.size(), 3);
+
+    for (int64_t b = 0; b < 3; ++b) {
+      auto result = assembler.next();
+      ASSERT_EQ(result.size(), 3);
+      auto& dense = result[0];
+      auto& values = result[1];
+      auto& labels = result[2];
+      int64_t first = batches[b][0].item<int64_t>() + 1;
+      int64_t n = batches[b][1].item<int64_t>();
+      ASSERT_EQ(dense.sizes(), (std::vector<int64_t>{n, 2}));
+      ASSERT_EQ(values.sizes(), (std::vector<int64_t>{3 * n}));
+      ASSERT_EQ(values.scalar_type(), torch::kLong);
+      ASSERT_EQ(labels.sizes(), (std::vector<int64_t>{n}));
+      for (int64_t i = 0; i < n; ++i) {
+        int64_t r = first + i;
+        ASSERT_EQ(dense[i][0].item<float>(), float(r));
+        ASSERT_EQ(dense[i][1].item<float>(), r + 0.5f);
+        ASSERT_EQ(labels[i].item<int32_t>(), r);
+        ASSERT_EQ(values[i].item<int64_t>(), r);
+        ASSERT_EQ(values[n + i].item<int64_t>(), 10 + r);
+        ASSERT_EQ(values[2 * n + i].item<int64_t>(), (20 + r) % 16);
+      }
+    }
+    ASSERT_TRUE(assembler.next().empty());
+  }
+
+  std::filesystem::remove_all(dir);
+}
+
+TEST(BatchAssemblerTest, HashOutOfSparseRange) {
+  auto dir = std::filesystem::temp_directory_path() /
+      ("criteo_batch_assembler_hash_test_" + std::to_string(getpid()));
+  std::filesystem::create_directories(dir);
+  auto prefix = (dir / "0").string();
+  save_npy<float>(prefix + "_dense.npy", {2, 1}, {0, 1});
+  save_npy<int32_t>(prefix + "_sparse.npy", {2, 1}, {-1, 1});
+  save_npy<int32_t>(prefix + "_labels.npy", {2, 1}, {0, 1});
+
+  auto batches = torch::tensor({0, 2}, torch::kLong).view({1, 2});
+  auto make = [&](int64_t hash) {
+    return BatchAssembler(
+        {prefix + "_dense.npy"},
+        {prefix + "_sparse.npy"},
+        {prefix + "_labels.npy"},
+        {0},
+        {2},
+        batches,
+        {hash},
+        1,
+        1,
+        false);
+  };
+  // -1 modulo 2^32 does not fit in the int32 ids.
+  ASSERT_ANY_THROW(make(int64_t(1) << 32));
+  ASSERT_ANY_THROW(make(0));
+  int32_t max_hash = std::numeric_limits<int32_t>::max();
+  auto values = make(max_hash).next()[1];
+  ASSERT_EQ(values[0].item<int32_t>(), max_hash - 1);
+  ASSERT_EQ(values[1].item<int32_t>(), 1);
+
+  std::filesystem::remove_all(dir);
+}
+
+} // namespace torchrec::criteo
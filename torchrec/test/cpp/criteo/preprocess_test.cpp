@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/criteo/details/mapped_file.h>
+#include <torchrec/csrc/criteo/details/npy.h>
+#include <torchrec/csrc/criteo/preprocess.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace torchrec::criteo {
+
+class PreprocessTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() /
+        ("criteo_preprocess_test_" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir_);
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(dir_);
+  }
+
+  std::string path(const std::string& name) const {
+    return (dir_ / name).string();
+  }
+
+  template <typename T>
+  std::vector<T> load(const std::string& name, std::vector<int64_t> shape) {
+    MappedFile file(path(name));
+    std::string_view bytes(
+        reinterpret_cast<const char*>(file.data()), file.size());
+    auto header = parse_npy_header(bytes);
+    EXPECT_EQ(header.descr, npy_descr<T>());
+    EXPECT_EQ(header.shape, shape);
+    EXPECT_EQ(
+        bytes.substr(0, header.data_offset), npy_header(header.descr, shape));
+    std::vector<T> values(header.numel());
+    memcpy(
+        values.data(),
+        file.data() + header.data_offset,
+        values.size() * sizeof(T));
+    return values;
+  }
+
+  template <typename T>
+  void save(
+      const std::string& name,
+      std::vector<int64_t> shape,
+      const std::vector<T>& values) {
+    std::ofstream out(path(name), std::ios::binary);
+    out << npy_header(npy_descr<T>(), shape);
+    out.write(
+        reinterpret_cast<const char*>(values.data()),
+        values.size() * sizeof(T));
+  }
+
+  std::filesystem::path dir_;
+};
+
+TEST(NpyTest, HeaderMatchesNumpy) {
+  std::vector<int64_t> shape{3, 26};
+  auto header = npy_header("<i8", shape);
+  ASSERT_EQ(header.size(), 128);
+  ASSERT_EQ(header.substr(0, 6), "\x93NUMPY");
+  ASSERT_EQ(header[6], 1);
+  ASSERT_EQ(header[7], 0);
+  ASSERT_EQ(header[8], 118);
+  ASSERT_EQ(header[9], 0);
+  ASSERT_EQ(
+      header.substr(10, 60),
+      "{'descr': '<i8', 'fortran_order': False, 'shape': (3, 26), }");
+  ASSERT_EQ(header.back(), '\n');
+
+  std::vector<int64_t> vector_shape{5};
+  ASSERT_NE(npy_header("<f4", vector_shape).find("'shape': (5,), }"), -1);
+
+  auto parsed = parse_npy_header(header);
+  ASSERT_EQ(parsed.descr, "<i8");
+  ASSERT_EQ(parsed.shape, shape);
+  ASSERT_EQ(parsed.data_offset, 128);
+}
+
+TEST_F(PreprocessTest, TsvToNpys) {
+  {
+    std::ofstream tsv(path("day_0"));
+    // label, 13 dense and 26 sparse values.
+    tsv << "1\t-1";
+    for (int i = 1; i < k_int_feature_count; ++i) {
+      tsv << "\t" << i;
+    }
+    for (int i = 0; i < k_cat_feature_count; ++i) {
+      tsv << "\t" << "a" << i;
+    }
+    tsv << "\n\n0" << std::string(k_int_feature_count, '\t')
+        << std::string(k_cat_feature_count, '\t') << "\n";
+  }
+  for (int64_t num_threads : {1, 4}) {
+    tsv_to_npys(
+        path("day_0"),
+        path("dense.npy"),
+        path("sparse.npy"),
+        path("labels.npy"),
+        false,
+        num_threads);
+
+    auto labels = load<int32_t>("labels.npy", {2, 1});
+    ASSERT_EQ(labels, (std::vector<int32_t>{1, 0}));
+
+    auto dense = load<float>("dense.npy", {2, k_int_feature_count});
+    // min is -1, so dense = log(value + 3).
+    ASSERT_FLOAT_EQ(dense[0], std::log(2.0f));
+    for (int i = 1; i < k_int_feature_count; ++i) {
+      ASSERT_FLOAT_EQ(dense[i], std::log(i + 3.0f));
+      ASSERT_FLOAT_EQ(dense[k_int_feature_count + i], std::log(3.0f));
+    }
+
+    auto sparse = load<int64_t>("sparse.npy", {2, k_cat_feature_count});
+    for (int i = 0; i < k_cat_feature_count; ++i) {
+      ASSERT_EQ(sparse[i], std::stoll("a" + std::to_string(i), nullptr, 16));
+      ASSERT_EQ(sparse[k_cat_feature_count + i], 0);
+    }
+  }
+}
+
+TEST_F(PreprocessTest, TsvToNpysFakeLabel) {
+  {
+    std::ofstream tsv(path("test.txt"));
+    tsv << "5" << std::string(k_int_feature_count - 1, '\t')
+        << std::string(k_cat_feature_count, '\t') << "\r\n";
+  }
+  tsv_to_npys(
+      path("test.txt"),
+      path("dense.npy"),
+      path("sparse.npy"),
+      path("labels.npy"),
+      true);
+  ASSERT_EQ(load<int32_t>("labels.npy", {1, 1}), std::vector<int32_t>{-1});
+  auto dense = load<float>("dense.npy", {1, k_int_feature_count});
+  ASSERT_FLOAT_EQ(dense[0], std::log(7.0f));
+  ASSERT_FLOAT_EQ(dense[1], std::log(2.0f));
+}
+
+TEST_F(PreprocessTest, SparseToContiguous) {
+  // The example in the docstring of `BinaryCriteoUtils.sparse_to_contiguous`,
+  // with an extra column kept as it is.
+  save<int64_t>("day_0_sparse.npy", {2, 3}, {10, 30, 7, 20, 30, 8});
+  save<int64_t>("day_1_sparse.npy", {2, 3}, {20, 40, 9, 50, 30, 6});
+  std::vector<std::string> in_files{
+      path("day_0_sparse.npy"), path("day_1_sparse.npy")};
+
+  for (int64_t num_threads : {1, 3}) {
+    sparse_to_contiguous(
+        in_files, dir_.string(), 2, 2, "_contig_freq.npy", num_threads);
+    ASSERT_EQ(
+        load<int64_t>("day_0_sparse_contig_freq.npy", {2, 3}),
+        (std::vector<int64_t>{1, 2, 7, 2, 2, 8}));
+    ASSERT_EQ(
+        load<int64_t>("day_1_sparse_contig_freq.npy", {2, 3}),
+        (std::vector<int64_t>{2, 1, 9, 1, 2, 6}));
+  }
+
+  sparse_to_contiguous(in_files, dir_.string(), 1, 2, "_contig.npy", 2);
+  ASSERT_EQ(
+      load<int64_t>("day_0_sparse_contig.npy", {2, 3}),
+      (std::vector<int64_t>{2, 2, 7, 3, 2, 8}));
+  ASSERT_EQ(
+      load<int64_t>("day_1_sparse_contig.npy", {2, 3}),
+      (std::vector<int64_t>{3, 3, 9, 4, 2, 6}));
+}
+
+TEST_F(PreprocessTest, Shuffle) {
+  // Row r of the training days is identified by label r, and has dense
+  // values {r, -r} and sparse ids {r, 2r, 3r}.
+  std::vector<int64_t> rows_per_day{5, 7, 2};
+  int64_t first_row = 0;
+  for (int64_t d = 0; d < 3; ++d) {
+    int64_t n = rows_per_day[d];
+    std::vector<float> dense;
+    std::vector<int64_t> sparse;
+    std::vector<int32_t> labels;
+    for (int64_t r = first_row; r < first_row + n; ++r) {
+      dense.insert(dense.end(), {float(r), -float(r)});
+      sparse.insert(sparse.end(), {r, 2 * r, 3 * r});
+      labels.emplace_back(r);
+    }
+    std::string day = "day_" + std::to_string(d);
+    save<float>(day + "_dense.npy", {n, 2}, dense);
+    save<int32_t>(day + "_labels.npy", {n, 1}, labels);
+    if (d == 1) {
+      save<int32_t>(
+          day + "_sparse.npy",
+          {n, 3},
+          std::vector<int32_t>(sparse.begin(), sparse.end()));
+    } else {
+      save<int64_t>(day + "_sparse.npy", {n, 3}, sparse);
+    }
+    first_row += n;
+  }
+
+  auto out_dir = dir_ / "out";
+  std::filesystem::create_directories(out_dir);
+  std::vector<int32_t> expected_labels;
+  for (int64_t num_buckets : {1, 4, 16}) {
+    shuffle(
+        dir_.string(),
+        dir_.string(),
+        out_dir.string(),
+        dir_.string(),
+        3,
+        2,
+        3,
+        42,
+        "",
+        num_buckets,
+        3);
+
+    std::vector<int32_t> all_labels;
+    for (int64_t d = 0; d < 2; ++d) {
+      int64_t n = rows_per_day[d];
+      std::string day = "out/day_" + std::to_string(d);
+      auto dense = load<float>(day + "_dense.npy", {n, 2});
+      auto sparse = load<int32_t>(day + "_sparse.npy", {n, 3});
+      auto labels = load<int32_t>(day + "_labels.npy", {n, 1});
+      for (int64_t i = 0; i < n; ++i) {
+        int32_t r = labels[i];
+        ASSERT_EQ(dense[i * 2], r);
+        ASSERT_EQ(dense[i * 2 + 1], -r);
+        ASSERT_EQ(sparse[i * 3], r);
+        ASSERT_EQ(sparse[i * 3 + 1], 2 * r);
+        ASSERT_EQ(sparse[i * 3 + 2], 3 * r);
+      }
+      all_labels.insert(all_labels.end(), labels.begin(), labels.end());
+    }
+    // The order only depends on the seed.
+    if (expected_labels.empty()) {
+      expected_labels = all_labels;
+    }
+    ASSERT_EQ(all_labels, expected_labels);
+    std::sort(all_labels.begin(), all_labels.end());
+    for (int32_t r = 0; r < 12; ++r) {
+      ASSERT_EQ(all_labels[r], r);
+    }
+    // The last day is copied.
+    ASSERT_EQ(
+        load<int32_t>("out/day_2_labels.npy", {2, 1}),
+        (std::vector<int32_t>{12, 13}));
+
+    auto full = load<float>("full.npy", {12, 6});
+    for (int64_t r = 0; r < 12; ++r) {
+      ASSERT_EQ(
+          std::vector<float>(full.begin() + r * 6, full.begin() + r * 6 + 6),
+          (std::vector<float>{
+              float(r), -float(r), float(r), 2.0f * r, 3.0f * r, float(r)}));
+    }
+  }
+  std::vector<int32_t> sorted(12);
+  std::iota(sorted.begin(), sorted.end(), 0);
+  ASSERT_NE(expected_labels, sorted);
+}
+
+TEST_F(PreprocessTest, ShuffleManyBuckets) {
+  // Row r of the training day has label r, dense value r and sparse id r.
+  int64_t n = 300;
+  std::vector<float> dense(n);
+  std::vector<int32_t> ids(n);
+  std::iota(dense.begin(), dense.end(), 0.0f);
+  std::iota(ids.begin(), ids.end(), 0);
+  save<float>("day_0_dense.npy", {n, 1}, dense);
+  save<int32_t>("day_0_sparse.npy", {n, 1}, ids);
+  save<int32_t>("day_0_labels.npy", {n, 1}, ids);
+  save<float>("day_1_dense.npy", {1, 1}, {0.0f});
+  save<int32_t>("day_1_sparse.npy", {1, 1}, {0});
+  save<int32_t>("day_1_labels.npy", {1, 1}, {0});
+
+  // Far more buckets than files that can be open at once.
+  rlimit limit{};
+  ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &limit), 0);
+  rlimit lowered = limit;
+  lowered.rlim_cur = 64;
+  ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &lowered), 0);
+  auto out_dir = dir_ / "out";
+  std::filesystem::create_directories(out_dir);
+  EXPECT_NO_THROW(shuffle(
+      dir_.string(),
+      dir_.string(),
+      out_dir.string(),
+      "",
+      2,
+      1,
+      1,
+      42,
+      "",
+      1000,
+      4));
+  ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &limit), 0);
+
+  auto dense_out = load<float>("out/day_0_dense.npy", {n, 1});
+  auto labels = load<int32_t>("out/day_0_labels.npy", {n, 1});
+  for (int64_t i = 0; i < n; ++i) {
+    ASSERT_EQ(dense_out[i], labels[i]);
+  }
+  std::sort(labels.begin(), labels.end());
+  ASSERT_EQ(labels, ids);
+  // The buckets are removed.
+  for (auto& entry : std::filesystem::directory_iterator(out_dir)) {
+    ASSERT_EQ(entry.path().filename().string().rfind("day_", 0), 0)
+        << entry.path();
+  }
+}
+
+} // namespace torchrec::criteo
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/dynamic_embedding/fetch_coalescer.h>
+#include <torchrec/csrc/dynamic_embedding/ps.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace torchrec {
+
+/**
+ * A v2 provider that counts its round trips. It finds the global ids below
+ * 100, whose values are `row_value`. Requests complete before they return.
+ */
+struct CountingIO {
+  // The (table, number of ids) of the requests of each round trip.
+  std::vector<std::vector<std::pair<std::string, uint32_t>>> round_trips;
+
+  static inline CountingIO* last = nullptr;
+
+  static float row_value(const std::string& table, int64_t global_id, int k) {
+    return (table.back() - '0') * 1000 + global_id + 0.25f * k;
+  }
+
+  static void* initialize(const char*) {
+    last = new CountingIO();
+    return last;
+  }
+
+  static void finalize(void* instance) {
+    delete reinterpret_cast<CountingIO*>(instance);
+  }
+
+  static void fetch_v2(void* instance, IOFetchParameterV2 cfg) {
+    auto* self = reinterpret_cast<CountingIO*>(instance);
+    auto& round_trip = self->round_trips.emplace_back();
+    for (uint32_t r = 0; r < cfg.num_requests; ++r) {
+      auto& request = cfg.requests[r];
+      std::string table = request.table_name;
+      round_trip.emplace_back(table, request.num_global_ids);
+      auto* dst = reinterpret_cast<float*>(request.dst);
+      uint32_t num_values = request.row_bytes / sizeof(float);
+      for (uint32_t i = 0; i < request.num_global_ids; ++i) {
+        int64_t global_id = request.global_ids[i];
+        if (global_id >= 100) {
+          continue;
+        }
+        for (uint32_t k = 0; k < request.num_optimizer_states; ++k) {
+          float* row =
+              dst + (i * request.num_optimizer_states + k) * num_values;
+          std::fill(row, row + num_values, row_value(table, global_id, k));
+        }
+        io_set_bit(request.found, i);
+      }
+    }
+    cfg.on_complete(cfg.on_complete_context, k_io_ok);
+  }
+
+  static void push_v2(void*, IOPushParameterV2 cfg) {
+    cfg.on_complete(cfg.on_complete_context, k_io_ok);
+  }
+};
+
+static CountingIO& counting_io(const std::string& config) {
+  static bool registered = [] {
+    IORegistry::Instance().register_provider(IOProvider{
+        .type = "counting",
+        .initialize = CountingIO::initialize,
+        .finalize = CountingIO::finalize,
+        .fetch_v2 = CountingIO::fetch_v2,
+        .push_v2 = CountingIO::push_v2,
+    });
+    return true;
+  }();
+  (void)registered;
+  // created here so that the test can inspect it, the tables share it.
+  static std::vector<std::shared_ptr<IO>> ios;
+  ios.emplace_back(IO::get(config));
+  return *CountingIO::last;
+}
+
+constexpr int64_t k_col_size = 2;
+constexpr int64_t k_num_os = 2;
+constexpr int64_t k_num_rows = 8;
+
+// A table of one shard, and the tensors of the shard.
+struct Table {
+  std::string name;
+  std::vector<torch::Tensor> tensors;
+  c10::intrusive_ptr<PS> ps;
+
+  Table(const std::string& name, const std::string& io_config) : name(name) {
+    for (int64_t k = 0; k < k_num_os; ++k) {
+      tensors.emplace_back(
+          torch::zeros({k_num_rows, k_col_size}, torch::kFloat));
+    }
+    auto shards = c10::make_intrusive<LocalShardList>();
+    shards->emplace_back(0, 0, k_num_rows, k_col_size, tensors);
+    ps = c10::make_intrusive<PS>(
+        name, shards, k_col_size, k_num_os, io_config, 1024);
+  }
+};
+
+// pairs of global id and cache id.
+static torch::Tensor ids_of(std::initializer_list<int64_t> ids) {
+  return torch::tensor(ids, torch::kLong).view({-1, 2});
+}
+
+static void fetch(
+    const c10::intrusive_ptr<FetchCoalescer>& coalescer,
+    const Table& table,
+    const torch::Tensor& ids) {
+  table.ps->stage_fetch(coalescer, ids, 0, false, 0, 0);
+}
+
+// Check that the rows of `table` hold the values fetched for it.
+static void expect_fetched(const Table& table, const torch::Tensor& ids) {
+  for (int64_t i = 0; i < ids.size(0); ++i) {
+    int64_t global_id = ids[i][0].item<int64_t>();
+    int64_t cache_id = ids[i][1].item<int64_t>();
+    for (int64_t k = 0; k < k_num_os; ++k) {
+      for (int64_t c = 0; c < k_col_size; ++c) {
+        EXPECT_EQ(
+            table.tensors[k][cache_id][c].item<float>(),
+            CountingIO::row_value(table.name, global_id, k))
+            << table.name << " global id " << global_id;
+      }
+    }
+  }
+}
+
+TEST(tde, FetchCoalescer_OneRoundTripPerIO) {
+  auto& io_x = counting_io("counting://x");
+  auto& io_y = counting_io("counting://y");
+  Table t0("t0", "counting://x");
+  Table t1("t1", "counting://x");
+  Table t2("t2", "counting://y");
+  auto coalescer = c10::make_intrusive<FetchCoalescer>(1 << 20);
+
+  auto ids0 = ids_of({1, 0, 2, 1});
+  auto ids1 = ids_of({1, 3, 5, 4, 7, 5});
+  auto ids2 = ids_of({9, 2});
+  fetch(coalescer, t0, ids0);
+  fetch(coalescer, t1, ids1);
+  fetch(coalescer, t2, ids2);
+  // nothing is issued before the flush.
+  ASSERT_TRUE(io_x.round_trips.empty());
+  ASSERT_TRUE(io_y.round_trips.empty());
+
+  coalescer->flush()->wait();
+  // the tables sharing an IO go in one round trip, in the staged order.
+  ASSERT_EQ(io_x.round_trips.size(), 1);
+  ASSERT_EQ(
+      io_x.round_trips[0],
+      (std::vector<std::pair<std::string, uint32_t>>{{"t0", 2}, {"t1", 3}}));
+  ASSERT_EQ(io_y.round_trips.size(), 1);
+  ASSERT_EQ(
+      io_y.round_trips[0],
+      (std::vector<std::pair<std::string, uint32_t>>{{"t2", 1}}));
+
+  // each table gets the rows of its own request.
+  expect_fetched(t0, ids0);
+  expect_fetched(t1, ids1);
+  expect_fetched(t2, ids2);
+
+  // an empty flush issues nothing.
+  coalescer->flush()->wait();
+  ASSERT_EQ(io_x.round_trips.size(), 1);
+}
+
+TEST(tde, FetchCoalescer_MaxIdsPerRequest) {
+  auto& io = counting_io("counting://max_ids");
+  Table t0("t0", "counting://max_ids");
+  Table t1("t1", "counting://max_ids");
+  Table t2("t2", "counting://max_ids");
+  auto coalescer = c10::make_intrusive<FetchCoalescer>(4);
+
+  // t0 and t1 fit in one request, t2 is larger than the limit but is not
+  // split.
+  auto ids2 = ids_of({1, 0, 2, 1, 3, 2, 4, 3, 5, 4});
+  fetch(coalescer, t0, ids_of({1, 0, 2, 1}));
+  fetch(coalescer, t1, ids_of({1, 0}));
+  fetch(coalescer, t2, ids2);
+  coalescer->flush()->wait();
+  ASSERT_EQ(io.round_trips.size(), 2);
+  ASSERT_EQ(
+      io.round_trips[0],
+      (std::vector<std::pair<std::string, uint32_t>>{{"t0", 2}, {"t1", 1}}));
+  ASSERT_EQ(
+      io.round_trips[1],
+      (std::vector<std::pair<std::string, uint32_t>>{{"t2", 5}}));
+  expect_fetched(t2, ids2);
+}
+
+TEST(tde, FetchCoalescer_WaitFlushes) {
+  auto& io = counting_io("counting://wait");
+  Table t0("t0", "counting://wait");
+  auto coalescer = c10::make_intrusive<FetchCoalescer>(1 << 20);
+
+  auto ids = ids_of({3, 1});
+  auto handle = t0.ps->stage_fetch(coalescer, ids, 0, false, 0, 0);
+  // waiting on a table issues the staged fetches of its coalescer.
+  handle->wait();
+  ASSERT_EQ(io.round_trips.size(), 1);
+  expect_fetched(t0, ids);
+}
+
+TEST(tde, FetchCoalescer_ReleaseFlushes) {
+  auto& io = counting_io("counting://release");
+  Table t0("t0", "counting://release");
+  Table t1("t1", "counting://release");
+  auto coalescer = c10::make_intrusive<FetchCoalescer>(1 << 20);
+
+  auto ids0 = ids_of({4, 0});
+  auto ids1 = ids_of({5, 0});
+  fetch(coalescer, t0, ids0);
+  fetch(coalescer, t1, ids1);
+  // the tables still hold weak references to the coalescer.
+  coalescer.reset();
+  ASSERT_EQ(io.round_trips.size(), 1);
+  t0.ps->synchronize_fetch();
+  t1.ps->synchronize_fetch();
+  expect_fetched(t0, ids0);
+  expect_fetched(t1, ids1);
+}
+
+TEST(tde, FetchCoalescer_SynchronizeFlushesAllCoalescers) {
+  auto& io = counting_io("counting://sync");
+  Table t0("t0", "counting://sync");
+  auto first = c10::make_intrusive<FetchCoalescer>(1 << 20);
+  auto second = c10::make_intrusive<FetchCoalescer>(1 << 20);
+
+  // a table staging in two coalescers before synchronizing waits on both.
+  auto ids_first = ids_of({1, 0});
+  auto ids_second = ids_of({2, 1});
+  fetch(first, t0, ids_first);
+  fetch(second, t0, ids_second);
+  t0.ps->synchronize_fetch();
+  ASSERT_EQ(io.round_trips.size(), 2);
+  expect_fetched(t0, ids_first);
+  expect_fetched(t0, ids_second);
+
+  // both are flushed, so they have nothing left.
+  first->flush()->wait();
+  second->flush()->wait();
+  ASSERT_EQ(io.round_trips.size(), 2);
+}
+
+} // namespace torchrec
@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/dynamic_embedding/details/io.h>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace torchrec {
+
+// (table, global id, col id, optimizer state) -> row
+using MockKey = std::tuple<std::string, int64_t, int64_t, uint32_t>;
+
+/**
+ * An in-memory v1 provider. Requests complete before they return.
+ */
+struct MockV1 {
+  std::map<MockKey, std::vector<uint8_t>> rows;
+  int num_fetches = 0;
+  int num_pushes = 0;
+
+  // the instance created last, which the test inspects.
+  static inline MockV1* last = nullptr;
+
+  static void* initialize(const char*) {
+    last = new MockV1();
+    return last;
+  }
+
+  static void finalize(void* instance) {
+    delete reinterpret_cast<MockV1*>(instance);
+  }
+
+  static void fetch(void* instance, IOFetchParameter cfg) {
+    auto* self = reinterpret_cast<MockV1*>(instance);
+    ++self->num_fetches;
+    uint32_t num_cols = std::max(cfg.num_cols, 1U);
+    for (uint32_t i = 0; i < cfg.num_global_ids; ++i) {
+      for (uint32_t j = 0; j < num_cols; ++j) {
+        int64_t col_id = cfg.num_cols == 0 ? -1 : cfg.col_ids[j];
+        for (uint32_t k = 0; k < cfg.num_optimizer_states; ++k) {
+          auto it = self->rows.find(
+              {cfg.table_name, cfg.global_ids[i], col_id, k});
+          uint32_t offset = i * num_cols + j;
+          if (it == self->rows.end()) {
+            cfg.on_global_id_fetched(
+                cfg.on_complete_context, offset, k, nullptr, 0);
+          } else {
+            cfg.on_global_id_fetched(
+                cfg.on_complete_context,
+                offset,
+                k,
+                it->second.data(),
+                it->second.size());
+          }
+        }
+      }
+    }
+    cfg.on_all_fetched(cfg.on_complete_context);
+  }
+
+  static void push(void* instance, IOPushParameter cfg) {
+    auto* self = reinterpret_cast<MockV1*>(instance);
+    ++self->num_pushes;
+    auto* data = reinterpret_cast<const uint8_t*>(cfg.data);
+    uint32_t num_cols = std::max(cfg.num_cols, 1U);
+    for (uint32_t i = 0; i < cfg.num_global_ids; ++i) {
+      for (uint32_t j = 0; j < num_cols; ++j) {
+        int64_t col_id = cfg.num_cols == 0 ? -1 : cfg.col_ids[j];
+        for (uint32_t k = 0; k < cfg.num_optimizer_states; ++k) {
+          uint32_t x = (i * num_cols + j) * cfg.num_optimizer_states + k;
+          self->rows[{cfg.table_name,
+                      cfg.global_ids[i],
+                      col_id,
+                      cfg.optimizer_state_ids[k]}] =
+              std::vector<uint8_t>(
+                  data + cfg.offsets[x], data + cfg.offsets[x + 1]);
+        }
+      }
+    }
+    cfg.on_push_complete(cfg.on_complete_context);
+  }
+};
+
+/**
+ * A v2 provider that records the requests. A fetch finds the even global ids,
+ * whose rows are filled with the global id.
+ */
+struct MockV2 {
+  int num_fetches = 0;
+  int num_pushes = 0;
+  std::vector<std::string> tables;
+
+  // the instance created last, which the test inspects.
+  static inline MockV2* last = nullptr;
+
+  static void* initialize(const char*) {
+    last = new MockV2();
+    return last;
+  }
+
+  static void finalize(void* instance) {
+    delete reinterpret_cast<MockV2*>(instance);
+  }
+
+  static void fetch_v2(void* instance, IOFetchParameterV2 cfg) {
+    auto* self = reinterpret_cast<MockV2*>(instance);
+    ++self->num_fetches;
+    for (uint32_t r = 0; r < cfg.num_requests; ++r) {
+      auto& request = cfg.requests[r];
+      self->tables.emplace_back(request.table_name);
+      uint32_t num_cols = std::max(request.num_cols, 1U);
+      uint64_t row_group_bytes =
+          uint64_t(request.num_optimizer_states) * request.row_bytes;
+      for (uint32_t i = 0; i < request.num_global_ids; ++i) {
+        if (request.global_ids[i] % 2 != 0) {
+          continue;
+        }
+        for (uint32_t j = 0; j < num_cols; ++j) {
+          uint32_t row = i * num_cols + j;
+          memset(
+              reinterpret_cast<uint8_t*>(request.dst) + row * row_group_bytes,
+              static_cast<int>(request.global_ids[i]),
+              row_group_bytes);
+          io_set_bit(request.found, row);
+        }
+      }
+    }
+    cfg.on_complete(cfg.on_complete_context, k_io_ok);
+  }
+
+  static void push_v2(void* instance, IOPushParameterV2 cfg) {
+    auto* self = reinterpret_cast<MockV2*>(instance);
+    ++self->num_pushes;
+    for (uint32_t r = 0; r < cfg.num_requests; ++r) {
+      self->tables.emplace_back(cfg.requests[r].table_name);
+    }
+    // reports a failure, which is passed through as is.
+    cfg.on_complete(cfg.on_complete_context, k_io_error);
+  }
+
+  static void stats(void* instance, void* ctx, IOStatCallback on_stat) {
+    auto* self = reinterpret_cast<MockV2*>(instance);
+    on_stat(ctx, "num_fetches", self->num_fetches);
+  }
+};
+
+static void register_mocks() {
+  static bool registered = [] {
+    IORegistry::Instance().register_provider(IOProvider{
+        .type = "mock_v1",
+        .initialize = MockV1::initialize,
+        .fetch = MockV1::fetch,
+        .push = MockV1::push,
+        .finalize = MockV1::finalize,
+    });
+    IORegistry::Instance().register_provider(IOProvider{
+        .type = "mock_v2",
+        .initialize = MockV2::initialize,
+        .finalize = MockV2::finalize,
+        .fetch_v2 = MockV2::fetch_v2,
+        .push_v2 = MockV2::push_v2,
+        .stats = MockV2::stats,
+    });
+    return true;
+  }();
+  (void)registered;
+}
+
+static std::vector<uint8_t> row_of(uint8_t value, uint32_t row_bytes) {
+  return std::vector<uint8_t>(row_bytes, value);
+}
+
+TEST(tde, IO_RegisterProvider) {
+  auto& registry = IORegistry::Instance();
+  // either version of fetch and push is required.
+  EXPECT_ANY_THROW(registry.register_provider(IOProvider{
+      .type = "mock_no_fetch",
+      .initialize = MockV1::initialize,
+      .push = MockV1::push,
+      .finalize = MockV1::finalize,
+  }));
+  EXPECT_ANY_THROW(registry.register_provider(IOProvider{
+      .type = "mock_no_push",
+      .initialize = MockV1::initialize,
+      .fetch = MockV1::fetch,
+      .finalize = MockV1::finalize,
+  }));
+  EXPECT_ANY_THROW((void)registry.resolve("mock_no_fetch"));
+  EXPECT_ANY_THROW(IO("mock_no_push://"));
+}
+
+TEST(tde, IO_FetchV2ThroughV1) {
+  register_mocks();
+  IO io("mock_v1://");
+  auto& mock = *MockV1::last;
+  constexpr uint32_t row_bytes = 4;
+  // table a has 2 columns and 2 optimizer states, table b none of both.
+  mock.rows[{"a", 10, 0, 0}] = row_of(1, row_bytes);
+  mock.rows[{"a", 10, 0, 1}] = row_of(2, row_bytes);
+  mock.rows[{"a", 10, 1, 0}] = row_of(3, row_bytes);
+  mock.rows[{"a", 10, 1, 1}] = row_of(4, row_bytes);
+  // only one of the optimizer states of id 11 column 1.
+  mock.rows[{"a", 11, 1, 0}] = row_of(5, row_bytes);
+  mock.rows[{"b", 20, -1, 0}] = row_of(6, row_bytes);
+
+  int64_t a_ids[] = {10, 11};
+  int64_t a_cols[] = {0, 1};
+  int64_t b_ids[] = {21, 20};
+  std::vector<uint8_t> a_dst(2 * 2 * 2 * row_bytes);
+  std::vector<uint8_t> b_dst(2 * row_bytes);
+  uint64_t a_found = 0;
+  uint64_t b_found = 0;
+  IOFetchRequestV2 requests[] = {
+      {
+          .table_name = "a",
+          .num_global_ids = 2,
+          .global_ids = a_ids,
+          .num_cols = 2,
+          .col_ids = a_cols,
+          .num_optimizer_states = 2,
+          .row_bytes = row_bytes,
+          .dst = a_dst.data(),
+          .found = &a_found,
+      },
+      {
+          .table_name = "b",
+          .num_global_ids = 2,
+          .global_ids = b_ids,
+          .num_optimizer_states = 1,
+          .row_bytes = row_bytes,
+          .dst = b_dst.data(),
+          .found = &b_found,
+      },
+  };
+  int32_t status = -1;
+  io.fetch_v2(requests, [&](int32_t s) { status = s; });
+  ASSERT_EQ(status, k_io_ok);
+  // one v1 fetch per request.
+  ASSERT_EQ(mock.num_fetches, 2);
+
+  // the rows of a are (id, col, os) ordered, only those of id 10 are found.
+  ASSERT_EQ(a_found, 0b0011);
+  for (uint8_t x = 0; x < 4; ++x) {
+    auto row = std::vector<uint8_t>(
+        a_dst.begin() + x * row_bytes, a_dst.begin() + (x + 1) * row_bytes);
+    ASSERT_EQ(row, row_of(x + 1, row_bytes));
+  }
+  ASSERT_EQ(b_found, 0b10);
+  ASSERT_EQ(
+      std::vector<uint8_t>(b_dst.begin() + row_bytes, b_dst.end()),
+      row_of(6, row_bytes));
+}
+
+TEST(tde, IO_FetchV2ThroughV1RowSizeMismatch) {
+  register_mocks();
+  IO io("mock_v1://");
+  auto& mock = *MockV1::last;
+  mock.rows[{"a", 1, -1, 0}] = row_of(1, 4);
+  mock.rows[{"a", 2, -1, 0}] = row_of(2, 8);
+
+  int64_t ids[] = {1, 2};
+  std::vector<uint8_t> dst(2 * 4);
+  uint64_t found = 0;
+  IOFetchRequestV2 request{
+      .table_name = "a",
+      .num_global_ids = 2,
+      .global_ids = ids,
+      .num_optimizer_states = 1,
+      .row_bytes = 4,
+      .dst = dst.data(),
+      .found = &found,
+  };
+  int32_t status = -1;
+  io.fetch_v2({&request, 1}, [&](int32_t s) { status = s; });
+  // the row that does not fit is not found.
+  ASSERT_EQ(status, k_io_error);
+  ASSERT_EQ(found, 0b01);
+}
+
+TEST(tde, IO_PushV2ThroughV1) {
+  register_mocks();
+  IO io("mock_v1://");
+  auto& mock = *MockV1::last;
+  constexpr uint32_t row_bytes = 2;
+  int64_t ids[] = {7, 8};
+  int64_t cols[] = {3};
+  // only the second optimizer state is pushed.
+  uint32_t os_ids[] = {1};
+  std::vector<uint8_t> src{1, 1, 2, 2};
+  uint64_t pushed = 0;
+  IOPushRequestV2 request{
+      .table_name = "a",
+      .num_global_ids = 2,
+      .global_ids = ids,
+      .num_cols = 1,
+      .col_ids = cols,
+      .num_optimizer_states = 1,
+      .optimizer_state_ids = os_ids,
+      .row_bytes = row_bytes,
+      .src = src.data(),
+      .pushed = &pushed,
+  };
+  int32_t status = -1;
+  io.push_v2({&request, 1}, [&](int32_t s) { status = s; });
+  ASSERT_EQ(status, k_io_ok);
+  ASSERT_EQ(mock.num_pushes, 1);
+  ASSERT_EQ(pushed, 0b11);
+  ASSERT_EQ(mock.rows.size(), 2);
+  ASSERT_EQ((mock.rows[{"a", 7, 3, 1}]), row_of(1, row_bytes));
+  ASSERT_EQ((mock.rows[{"a", 8, 3, 1}]), row_of(2, row_bytes));
+
+  // empty requests complete without pushing.
+  status = -1;
+  request.num_global_ids = 0;
+  io.push_v2({&request, 1}, [&](int32_t s) { status = s; });
+  ASSERT_EQ(status, k_io_ok);
+  ASSERT_EQ(mock.num_pushes, 1);
+}
+
+TEST(tde, IO_V2Dispatch) {
+  register_mocks();
+  IO io("mock_v2://");
+  auto& mock = *MockV2::last;
+
+  int64_t a_ids[] = {2, 3};
+  int64_t b_ids[] = {4};
+  std::vector<uint8_t> a_dst(2 * 2);
+  std::vector<uint8_t> b_dst(2);
+  uint64_t a_found = 0;
+  uint64_t b_found = 0;
+  IOFetchRequestV2 requests[] = {
+      {
+          .table_name = "a",
+          .num_global_ids = 2,
+          .global_ids = a_ids,
+          .num_optimizer_states = 1,
+          .row_bytes = 2,
+          .dst = a_dst.data(),
+          .found = &a_found,
+      },
+      {
+          .table_name = "b",
+          .num_global_ids = 1,
+          .global_ids = b_ids,
+          .num_optimizer_states = 1,
+          .row_bytes = 2,
+          .dst = b_dst.data(),
+          .found = &b_found,
+      },
+  };
+  int32_t status = -1;
+  io.fetch_v2(requests, [&](int32_t s) { status = s; });
+  // all the requests go to the provider at once.
+  ASSERT_EQ(status, k_io_ok);
+  ASSERT_EQ(mock.num_fetches, 1);
+  ASSERT_EQ(mock.tables, (std::vector<std::string>{"a", "b"}));
+  ASSERT_EQ(a_found, 0b01);
+  ASSERT_EQ(a_dst, (std::vector<uint8_t>{2, 2, 0, 0}));
+  ASSERT_EQ(b_found, 0b1);
+  ASSERT_EQ(b_dst, row_of(4, 2));
+
+  uint32_t os_ids[] = {0};
+  IOPushRequestV2 push{
+      .table_name = "c",
+      .num_global_ids = 1,
+      .global_ids = b_ids,
+      .num_optimizer_states = 1,
+      .optimizer_state_ids = os_ids,
+      .row_bytes = 2,
+      .src = b_dst.data(),
+  };
+  status = -1;
+  io.push_v2({&push, 1}, [&](int32_t s) { status = s; });
+  ASSERT_EQ(status, k_io_error);
+  ASSERT_EQ(mock.num_pushes, 1);
+
+  // a v2 provider has no v1 API.
+  EXPECT_ANY_THROW(io.fetch(
+      "a", {a_ids, 2}, {}, 1, torch::kFloat, [](std::vector<torch::Tensor>) {
+      }));
+  EXPECT_ANY_THROW(io.push("a", {a_ids, 2}, {}, {}, {}, {}, [] {}));
+}
+
+TEST(tde, IO_Stats) {
+  register_mocks();
+  IO v1("mock_v1://");
+  ASSERT_TRUE(v1.stats().empty());
+
+  IO v2("mock_v2://");
+  int64_t ids[] = {2};
+  std::vector<uint8_t> dst(2);
+  IOFetchRequestV2 request{
+      .table_name = "a",
+      .num_global_ids = 1,
+      .global_ids = ids,
+      .num_optimizer_states = 1,
+      .row_bytes = 2,
+      .dst = dst.data(),
+  };
+  uint64_t found = 0;
+  request.found = &found;
+  v2.fetch_v2({&request, 1}, [](int32_t) {});
+  auto stats = v2.stats();
+  ASSERT_EQ(stats.size(), 1);
+  ASSERT_EQ(stats.at("num_fetches"), 1);
+}
+
+} // namespace torchrec
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/dynamic_embedding/details/memory_policy.h>
+#include <torchrec/csrc/dynamic_embedding/details/naive_id_transformer.h>
+
+namespace torchrec {
+
+TEST(tde, MemoryPolicy_Parse) {
+  auto policy = parse_memory_policy("");
+  ASSERT_TRUE(policy.is_default());
+
+  policy = parse_memory_policy("hugepage=2m&&numa=interleave");
+  ASSERT_EQ(policy.huge_page, MemoryPolicy::HugePage::k2MB);
+  ASSERT_EQ(policy.numa, MemoryPolicy::Numa::kInterleave);
+  ASSERT_EQ(policy.first_touch_threads, 1);
+
+  policy = parse_memory_policy("hugepage=1g&&numa=1&&first_touch_threads=8");
+  ASSERT_EQ(policy.huge_page, MemoryPolicy::HugePage::k1GB);
+  ASSERT_EQ(policy.numa, MemoryPolicy::Numa::kBind);
+  ASSERT_EQ(policy.numa_node, 1);
+  ASSERT_EQ(policy.first_touch_threads, 8);
+
+  ASSERT_ANY_THROW(parse_memory_policy("hugepage=3m"));
+  ASSERT_ANY_THROW(parse_memory_policy("unknown=1"));
+}
+
+TEST(tde, MemoryPolicy_Allocate) {
+  MemoryPolicy policy = parse_memory_policy(
+      "hugepage=2m&&numa=interleave&&first_touch_threads=4");
+  for (size_t size : {16UL, 3UL << 20, 64UL << 20}) {
+    auto* ptr = reinterpret_cast<uint8_t*>(policy_allocate(policy, size));
+    ASSERT_NE(ptr, nullptr);
+    ptr[0] = 1;
+    ptr[size - 1] = 1;
+    policy_deallocate(policy, ptr, size);
+  }
+}
+
+TEST(tde, MemoryPolicy_NaiveIDTransformer) {
+  MemoryPolicy policy =
+      parse_memory_policy("hugepage=2m&&first_touch_threads=4");
+  NaiveIDTransformer<Bitmap<uint32_t>> transformer(1 << 20, policy);
+  std::vector<int64_t> global_ids(1 << 20);
+  std::vector<int64_t> cache_ids(1 << 20);
+  for (size_t i = 0; i < global_ids.size(); ++i) {
+    global_ids[i] = static_cast<int64_t>(i) * 31;
+  }
+  ASSERT_TRUE(transformer.transform(global_ids, cache_ids));
+  for (size_t i = 0; i < cache_ids.size(); ++i) {
+    ASSERT_EQ(cache_ids[i], static_cast<int64_t>(i));
+  }
+  const int64_t new_global_id[1] = {-1};
+  int64_t new_cache_id[1];
+  ASSERT_FALSE(transformer.transform(new_global_id, new_cache_id));
+}
+
+} // namespace torchrec
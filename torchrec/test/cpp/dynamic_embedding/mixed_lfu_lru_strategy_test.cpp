@@ -8,6 +8,7 @@
 
 #include <gtest/gtest.h>
 #include <torchrec/csrc/dynamic_embedding/details/mixed_lfu_lru_strategy.h>
+#include <random>
 
 namespace torchrec {
 TEST(TDE, order) {
@@ -68,6 +69,64 @@ TEST(TDE, MixedLFULRUStrategy_Evict) {
   ASSERT_EQ(ids[2], 1);
 }
 
+TEST(TDE, MixedLFULRUStrategy_EvictChunks) {
+  constexpr static size_t n = 10000;
+  std::vector<int64_t> global_ids(n);
+  std::vector<int64_t> cache_ids(n);
+  std::vector<lxu_record_t> lxu_records(n);
+  std::mt19937 engine(0);
+  for (size_t i = 0; i < n; ++i) {
+    global_ids[i] = static_cast<int64_t>(i);
+    MixedLFULRUStrategy::Record record{};
+    record.time = engine() % 100;
+    record.freq_power = engine() % 10 + 5;
+    lxu_records[i] = *reinterpret_cast<lxu_record_t*>(&record);
+  }
+
+  MixedLFULRUStrategy strategy;
+  ASSERT_TRUE(strategy.evict_chunks([](auto&&) {}, 0).empty());
+  for (uint64_t num_to_evict : {1, 7, 500, 4999, 20000}) {
+    size_t offset = 0;
+    auto expected = strategy.evict(
+        [&]() -> std::optional<record_t> {
+          if (offset == n) {
+            return std::nullopt;
+          }
+          auto record = record_t{
+              .global_id = global_ids[offset],
+              .cache_id = cache_ids[offset],
+              .lxu_record = lxu_records[offset],
+          };
+          ++offset;
+          return record;
+        },
+        num_to_evict);
+    auto ids = strategy.evict_chunks(
+        [&](const chunk_visitor_t& visitor) {
+          for (size_t i = 0; i < n; i += 300) {
+            size_t size = std::min<size_t>(300, n - i);
+            visitor(record_chunk_t{
+                .global_ids = std::span{global_ids.data() + i, size},
+                .cache_ids = std::span{cache_ids.data() + i, size},
+                .lxu_records = std::span{lxu_records.data() + i, size},
+            });
+          }
+        },
+        num_to_evict);
+
+    // The order of records with the same value is unspecified, compare the
+    // records instead of the ids.
+    ASSERT_EQ(ids.size(), expected.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+      auto* a = reinterpret_cast<MixedLFULRUStrategy::Record*>(
+          &lxu_records[ids[i]]);
+      auto* b = reinterpret_cast<MixedLFULRUStrategy::Record*>(
+          &lxu_records[expected[i]]);
+      ASSERT_EQ(a->ToUint32(), b->ToUint32());
+    }
+  }
+}
+
 TEST(TDE, MixedLFULRUStrategy_Transform) {
   constexpr static size_t n_iter = 1000000;
   MixedLFULRUStrategy strategy;
@@ -8,6 +8,8 @@
 
 #include <gtest/gtest.h>
 #include <torchrec/csrc/dynamic_embedding/details/naive_id_transformer.h>
+#include <map>
+#include <vector>
 
 namespace torchrec {
 
@@ -34,6 +36,47 @@ TEST(tde, NaiveThreadedIDTransformer_Full) {
   }
 }
 
+TEST(tde, NaiveThreadedIDTransformer_FallbackRows) {
+  // 4 cache rows, of which the last 2 are fallback rows.
+  NaiveIDTransformer<Bitmap<uint8_t>> transformer(4, {}, 2);
+  const int64_t global_ids[5] = {100, 101, 102, 103, 100};
+  int64_t cache_ids[5];
+  std::vector<int64_t> fetched;
+  ASSERT_TRUE(transformer.transform(
+      global_ids,
+      cache_ids,
+      transform_default::no_update,
+      [&](int64_t global_id, int64_t cache_id) {
+        fetched.emplace_back(global_id);
+      }));
+  EXPECT_EQ(cache_ids[0], 0);
+  EXPECT_EQ(cache_ids[1], 1);
+  EXPECT_EQ(cache_ids[4], 0);
+  for (size_t i = 2; i < 4; i++) {
+    EXPECT_GE(cache_ids[i], 2);
+    EXPECT_LT(cache_ids[i], 4);
+  }
+  // The fallback ids are neither fetched nor inserted.
+  EXPECT_EQ(fetched, (std::vector<int64_t>{100, 101}));
+  EXPECT_EQ(transformer.num_fallback_ids(), 2);
+
+  // An evicted row is given to the next new id.
+  const int64_t evict_global_ids[1] = {100};
+  transformer.evict(evict_global_ids);
+  const int64_t new_global_ids[1] = {102};
+  int64_t new_cache_ids[1];
+  ASSERT_TRUE(transformer.transform(new_global_ids, new_cache_ids));
+  EXPECT_EQ(new_cache_ids[0], 0);
+  EXPECT_EQ(transformer.num_fallback_ids(), 2);
+}
+
+TEST(tde, NaiveThreadedIDTransformer_InvalidFallbackRows) {
+  using Transformer = NaiveIDTransformer<Bitmap<uint8_t>>;
+  EXPECT_ANY_THROW(Transformer(4, {}, -1));
+  EXPECT_ANY_THROW(Transformer(4, {}, 4));
+  EXPECT_ANY_THROW(Transformer(4, {}, 5));
+}
+
 TEST(tde, NaiveThreadedIDTransformer_Evict) {
   NaiveIDTransformer<Bitmap<uint8_t>> transformer(4);
   const int64_t global_ids[5] = {100, 101, 102, 103, 104};
@@ -70,4 +113,37 @@ TEST(tde, NaiveThreadedIDTransformer_Iterator) {
   EXPECT_TRUE(!iterator().has_value());
 }
 
+TEST(tde, NaiveThreadedIDTransformer_ExportRecords) {
+  NaiveIDTransformer<Bitmap<uint8_t>> transformer(16);
+  const int64_t global_ids[5] = {100, 101, 100, 102, 103};
+  int64_t cache_ids[5];
+  ASSERT_TRUE(transformer.transform(
+      global_ids,
+      cache_ids,
+      [](int64_t global_id, int64_t cache_id, std::optional<lxu_record_t>) {
+        return static_cast<lxu_record_t>(global_id + 1);
+      }));
+
+  std::vector<size_t> chunk_sizes;
+  std::map<int64_t, std::pair<int64_t, lxu_record_t>> records;
+  transformer.export_records(
+      [&](const record_chunk_t& chunk) {
+        chunk_sizes.emplace_back(chunk.size());
+        ASSERT_EQ(chunk.cache_ids.size(), chunk.size());
+        ASSERT_EQ(chunk.lxu_records.size(), chunk.size());
+        for (size_t i = 0; i < chunk.size(); ++i) {
+          records[chunk.global_ids[i]] = {
+              chunk.cache_ids[i], chunk.lxu_records[i]};
+        }
+      },
+      3);
+
+  ASSERT_EQ(chunk_sizes, (std::vector<size_t>{3, 1}));
+  ASSERT_EQ(records.size(), 4);
+  for (size_t i = 0; i < 5; i++) {
+    EXPECT_EQ(records[global_ids[i]].first, cache_ids[i]);
+    EXPECT_EQ(records[global_ids[i]].second, global_ids[i] + 1);
+  }
+}
+
 } // namespace torchrec
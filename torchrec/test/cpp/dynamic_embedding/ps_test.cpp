@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/dynamic_embedding/ps.h>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace torchrec {
+
+/**
+ * An in-memory v2 provider of a single table, which records the pushed ids.
+ * Requests complete before they return.
+ */
+struct StoreIO {
+  // (global id, optimizer state) -> row
+  std::map<std::pair<int64_t, uint32_t>, std::vector<uint8_t>> rows;
+  std::vector<int64_t> pushed_ids;
+
+  static inline StoreIO* last = nullptr;
+  static inline int num_instances = 0;
+
+  static void* initialize(const char*) {
+    last = new StoreIO();
+    ++num_instances;
+    return last;
+  }
+
+  static void finalize(void* instance) {
+    delete reinterpret_cast<StoreIO*>(instance);
+    --num_instances;
+  }
+
+  static void fetch_v2(void* instance, IOFetchParameterV2 cfg) {
+    auto* self = reinterpret_cast<StoreIO*>(instance);
+    for (uint32_t r = 0; r < cfg.num_requests; ++r) {
+      auto& request = cfg.requests[r];
+      auto* dst = reinterpret_cast<uint8_t*>(request.dst);
+      for (uint32_t i = 0; i < request.num_global_ids; ++i) {
+        uint32_t num_found = 0;
+        for (uint32_t k = 0; k < request.num_optimizer_states; ++k) {
+          auto it = self->rows.find({request.global_ids[i], k});
+          if (it == self->rows.end()) {
+            continue;
+          }
+          ++num_found;
+          memcpy(
+              dst + (i * request.num_optimizer_states + k) * request.row_bytes,
+              it->second.data(),
+              request.row_bytes);
+        }
+        if (num_found == request.num_optimizer_states) {
+          io_set_bit(request.found, i);
+        }
+      }
+    }
+    cfg.on_complete(cfg.on_complete_context, k_io_ok);
+  }
+
+  static void push_v2(void* instance, IOPushParameterV2 cfg) {
+    auto* self = reinterpret_cast<StoreIO*>(instance);
+    for (uint32_t r = 0; r < cfg.num_requests; ++r) {
+      auto& request = cfg.requests[r];
+      auto* src = reinterpret_cast<const uint8_t*>(request.src);
+      for (uint32_t i = 0; i < request.num_global_ids; ++i) {
+        self->pushed_ids.emplace_back(request.global_ids[i]);
+        for (uint32_t k = 0; k < request.num_optimizer_states; ++k) {
+          const uint8_t* row = src +
+              (i * request.num_optimizer_states + k) * request.row_bytes;
+          self->rows[{request.global_ids[i],
+                      request.optimizer_state_ids[k]}] =
+              std::vector<uint8_t>(row, row + request.row_bytes);
+        }
+        io_set_bit(request.pushed, i);
+      }
+    }
+    cfg.on_complete(cfg.on_complete_context, k_io_ok);
+  }
+};
+
+static void register_store() {
+  static bool registered = [] {
+    IORegistry::Instance().register_provider(IOProvider{
+        .type = "store",
+        .initialize = StoreIO::initialize,
+        .finalize = StoreIO::finalize,
+        .fetch_v2 = StoreIO::fetch_v2,
+        .push_v2 = StoreIO::push_v2,
+    });
+    return true;
+  }();
+  (void)registered;
+}
+
+constexpr int64_t k_col_size = 2;
+constexpr int64_t k_num_os = 2;
+constexpr int64_t k_num_rows = 8;
+
+static c10::intrusive_ptr<LocalShardList> make_shards(
+    std::vector<torch::Tensor>& tensors) {
+  for (int64_t k = 0; k < k_num_os; ++k) {
+    tensors.emplace_back(torch::zeros({k_num_rows, k_col_size}, torch::kFloat));
+  }
+  auto shards = c10::make_intrusive<LocalShardList>();
+  shards->emplace_back(0, 0, k_num_rows, k_col_size, tensors);
+  return shards;
+}
+
+static std::vector<uint8_t> row_of(float value) {
+  std::vector<float> values(k_col_size, value);
+  std::vector<uint8_t> row(sizeof(float) * k_col_size);
+  memcpy(row.data(), values.data(), row.size());
+  return row;
+}
+
+TEST(tde, PS_EvictOnlyModifiedRows) {
+  register_store();
+  std::vector<torch::Tensor> tensors;
+  auto shards = make_shards(tensors);
+  // 2 ids per chunk, so that the rows to push are compacted in each chunk.
+  auto ps = c10::make_intrusive<PS>(
+      "t", shards, k_col_size, k_num_os, "store://", 2 * k_col_size * k_num_os);
+  auto& store = *StoreIO::last;
+  for (int64_t global_id : {1, 2, 3, 4}) {
+    for (uint32_t k = 0; k < k_num_os; ++k) {
+      store.rows[{global_id, k}] = row_of(global_id + 0.5f * k);
+    }
+  }
+
+  // pairs of global id and cache id. 5 is not in PS, it is re-initialized
+  // and has no fingerprint.
+  auto ids =
+      torch::tensor({1, 0, 2, 1, 3, 2, 4, 3, 5, 4}, torch::kLong).view({5, 2});
+  ps->fetch(ids, 0, true, 7, 7)->wait();
+  ASSERT_EQ(tensors[0][4][0].item<float>(), 7);
+
+  // the parameter of 2 and an optimizer state of 4 are updated.
+  tensors[0][1].fill_(20);
+  tensors[1][3].fill_(40);
+  ps->evict(ids);
+  ASSERT_EQ(store.pushed_ids, (std::vector<int64_t>{2, 4, 5}));
+  ASSERT_EQ((store.rows[{2, 0}]), row_of(20));
+  ASSERT_EQ((store.rows[{2, 1}]), row_of(2.5));
+  ASSERT_EQ((store.rows[{4, 0}]), row_of(4));
+  ASSERT_EQ((store.rows[{4, 1}]), row_of(40));
+  ASSERT_EQ((store.rows[{5, 0}]), row_of(7));
+  ASSERT_EQ((store.rows[{5, 1}]), row_of(0));
+  // the unmodified rows are untouched.
+  ASSERT_EQ((store.rows[{1, 0}]), row_of(1));
+  ASSERT_EQ((store.rows[{3, 1}]), row_of(3.5));
+
+  // The fingerprints of the evicted slots are released. A slot given to
+  // another id without fetching it from PS is always pushed, even if its
+  // content happens to be unchanged.
+  store.pushed_ids.clear();
+  auto reused = torch::tensor({6, 0, 7, 2}, torch::kLong).view({2, 2});
+  ps->evict(reused);
+  ASSERT_EQ(store.pushed_ids, (std::vector<int64_t>{6, 7}));
+  ASSERT_EQ((store.rows[{6, 0}]), row_of(1));
+  ASSERT_EQ((store.rows[{7, 1}]), row_of(3.5));
+}
+
+TEST(tde, PS_SharedIO) {
+  register_store();
+  std::vector<torch::Tensor> tensors;
+  auto shards = make_shards(tensors);
+  auto make_ps = [&](const std::string& table, const std::string& config) {
+    return c10::make_intrusive<PS>(
+        table, shards, k_col_size, k_num_os, config, 1024);
+  };
+
+  // The tables of the same config share one IO instance.
+  auto a = make_ps("a", "store://shared");
+  auto* shared = StoreIO::last;
+  auto b = make_ps("b", "store://shared");
+  ASSERT_EQ(StoreIO::num_instances, 1);
+  ASSERT_EQ(StoreIO::last, shared);
+  auto c = make_ps("c", "store://other");
+  ASSERT_EQ(StoreIO::num_instances, 2);
+
+  // both tables push through the shared instance.
+  auto ids = torch::tensor({1, 0}, torch::kLong).view({1, 2});
+  a->evict(ids);
+  b->evict(ids);
+  ASSERT_EQ(shared->pushed_ids, (std::vector<int64_t>{1, 1}));
+
+  // The instance is released with the last table using it, and a new
+  // one is created for the next table.
+  a.reset();
+  ASSERT_EQ(StoreIO::num_instances, 2);
+  b.reset();
+  ASSERT_EQ(StoreIO::num_instances, 1);
+  auto d = make_ps("d", "store://shared");
+  ASSERT_EQ(StoreIO::num_instances, 2);
+}
+
+} // namespace torchrec
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/dynamic_embedding/details/redis/chunk_controller.h>
+
+namespace torchrec::redis {
+
+static RoundStats round_of(uint64_t num_keys, uint64_t latency_us) {
+  // every key is 128 bytes.
+  return RoundStats{
+      .num_jobs = 1,
+      .num_keys = num_keys,
+      .num_bytes = num_keys * 128,
+      .latency_us = latency_us,
+  };
+}
+
+TEST(TDE, ChunkController_SlowStart) {
+  ChunkController controller({
+      .initial_chunk_size = 100,
+      .min_chunk_size = 10,
+      .max_chunk_size = 1000,
+      .target_latency_us = 1000,
+  });
+  ASSERT_TRUE(controller.in_slow_start());
+  // latency grows slower than the chunk, so does the throughput.
+  controller.on_round(round_of(100, 100));
+  ASSERT_EQ(controller.chunk_size(), 200);
+  controller.on_round(round_of(200, 120));
+  ASSERT_EQ(controller.chunk_size(), 400);
+  controller.on_round(round_of(400, 150));
+  ASSERT_EQ(controller.chunk_size(), 800);
+  controller.on_round(round_of(800, 200));
+  // bounded by max_chunk_size
+  ASSERT_EQ(controller.chunk_size(), 1000);
+  ASSERT_GT(controller.throughput(), 0);
+}
+
+TEST(TDE, ChunkController_DecreaseOverTarget) {
+  ChunkController controller({
+      .initial_chunk_size = 400,
+      .min_chunk_size = 100,
+      .max_chunk_size = 1000,
+      .initial_pipeline_jobs = 4,
+      .target_latency_us = 1000,
+  });
+  controller.on_round(round_of(400, 2000));
+  ASSERT_FALSE(controller.in_slow_start());
+  ASSERT_EQ(controller.chunk_size(), 200);
+  ASSERT_EQ(controller.pipeline_jobs(), 3);
+  controller.on_round(round_of(200, 2000));
+  controller.on_round(round_of(200, 2000));
+  // bounded by min_chunk_size
+  ASSERT_EQ(controller.chunk_size(), 100);
+  ASSERT_EQ(controller.pipeline_jobs(), 1);
+
+  // congestion avoidance increases additively.
+  controller.on_round(round_of(100, 500));
+  ASSERT_EQ(controller.chunk_size(), 200);
+  controller.on_round(round_of(200, 500));
+  ASSERT_EQ(controller.chunk_size(), 300);
+}
+
+TEST(TDE, ChunkController_PlateauAndPipeline) {
+  ChunkController controller({
+      .initial_chunk_size = 100,
+      .min_chunk_size = 100,
+      .max_chunk_size = 400,
+      .initial_pipeline_jobs = 1,
+      .max_pipeline_jobs = 2,
+      .target_latency_us = 100000,
+  });
+  // the latency grows with the chunk, the throughput does not.
+  for (uint64_t chunk = 100; controller.in_slow_start();) {
+    controller.on_round(round_of(chunk, chunk * 10));
+    chunk = controller.chunk_size();
+  }
+  ASSERT_EQ(controller.chunk_size(), 400);
+  controller.on_round(round_of(400, 4000));
+  ASSERT_EQ(controller.pipeline_jobs(), 2);
+  controller.on_round(round_of(400, 4000));
+  ASSERT_EQ(controller.pipeline_jobs(), 2);
+}
+
+TEST(TDE, ChunkController_HoldAtTargetThroughput) {
+  ChunkController controller({
+      .initial_chunk_size = 100,
+      .min_chunk_size = 10,
+      .max_chunk_size = 1000,
+      .target_latency_us = 1000,
+      .target_throughput = 200,
+  });
+  controller.on_round(round_of(100, 100));
+  controller.on_round(round_of(200, 100));
+  controller.on_round(round_of(400, 100));
+  ASSERT_EQ(controller.chunk_size(), 800);
+  // the average throughput reaches 200 bytes/us.
+  controller.on_round(round_of(800, 100));
+  ASSERT_GE(controller.throughput(), 200);
+  ASSERT_FALSE(controller.in_slow_start());
+  ASSERT_EQ(controller.chunk_size(), 800);
+  ASSERT_EQ(controller.pipeline_jobs(), 4);
+  // still decreases over the target latency.
+  controller.on_round(round_of(800, 2000));
+  ASSERT_EQ(controller.chunk_size(), 400);
+}
+
+TEST(TDE, ChunkController_IgnoreTail) {
+  ChunkController controller({.initial_chunk_size = 100});
+  controller.on_round(round_of(10, 100000));
+  ASSERT_EQ(controller.chunk_size(), 100);
+  ASSERT_TRUE(controller.in_slow_start());
+}
+
+TEST(TDE, ChunkController_InvalidOption) {
+  ASSERT_ANY_THROW(ChunkController({.min_chunk_size = 0}));
+  ASSERT_ANY_THROW(
+      ChunkController({.min_chunk_size = 100, .max_chunk_size = 10}));
+}
+
+} // namespace torchrec::redis
@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <torchrec/csrc/dynamic_embedding/details/notification.h>
+#include <torchrec/csrc/dynamic_embedding/details/redis/cluster.h>
+#include <torchrec/csrc/dynamic_embedding/details/redis/redis_io.h>
+#include <unistd.h>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace torchrec::redis {
+
+TEST(TDE, Cluster_KeySlot) {
+  // The examples of the redis cluster specification.
+  ASSERT_EQ(key_slot("123456789"), 0x31C3);
+  ASSERT_EQ(key_slot("foo"), 12182);
+  ASSERT_EQ(key_slot("{user1000}.following"), key_slot("user1000"));
+  ASSERT_EQ(key_slot("{user1000}.followers"), key_slot("user1000"));
+  // an empty hash tag hashes the whole key.
+  ASSERT_NE(key_slot("foo{}{bar}"), key_slot("bar"));
+  ASSERT_EQ(key_slot("foo{{bar}}zap"), key_slot("{bar"));
+  ASSERT_EQ(key_slot("foo{bar}{zap}"), key_slot("bar"));
+  ASSERT_EQ(key_slot("m_table_{emb}_gid_1"), key_slot("m_table_{emb}_gid_2"));
+}
+
+TEST(TDE, Cluster_CommandKey) {
+  ASSERT_EQ(command_key("*2\r\n$3\r\nGET\r\n$5\r\nkey_1\r\n"), "key_1");
+  std::string set("*3\r\n$3\r\nSET\r\n$3\r\nabc\r\n$4\r\n\r\n\0\1\r\n", 32);
+  ASSERT_EQ(command_key(set), "abc");
+  ASSERT_EQ(command_key("*1\r\n$4\r\nPING\r\n"), "");
+  ASSERT_EQ(command_key("*2\r\n$3\r\nGET\r\n$9\r\nkey\r\n"), "");
+  ASSERT_EQ(command_key("GET key"), "");
+}
+
+TEST(TDE, Cluster_SlotMap) {
+  SlotMap slots;
+  ASSERT_EQ(slots.node_of(0), -1);
+  slots.assign(0, 5460, {"127.0.0.1", 30001});
+  slots.assign(5461, 10922, {"127.0.0.1", 30002});
+  slots.assign(10923, 16383, {"127.0.0.1", 30003});
+  slots.assign(100, 100, {"127.0.0.1", 30003});
+  ASSERT_EQ(slots.nodes().size(), 3);
+  ASSERT_EQ(slots.node_of(0), 0);
+  ASSERT_EQ(slots.node_of(100), 2);
+  ASSERT_EQ(slots.node_of(5461), 1);
+  ASSERT_EQ(slots.node_of(16383), 2);
+  ASSERT_EQ(slots.nodes()[1], (NodeAddress{"127.0.0.1", 30002}));
+}
+
+TEST(TDE, Cluster_ParseRedirect) {
+  auto moved = parse_redirect("MOVED 3999 127.0.0.1:6381");
+  ASSERT_TRUE(moved.has_value());
+  ASSERT_EQ(moved->kind, RedirectKind::kMoved);
+  ASSERT_EQ(moved->slot, 3999);
+  ASSERT_EQ(moved->address, (NodeAddress{"127.0.0.1", 6381}));
+
+  auto ask = parse_redirect("ASK 12182 ::1:30002");
+  ASSERT_TRUE(ask.has_value());
+  ASSERT_EQ(ask->kind, RedirectKind::kAsk);
+  ASSERT_EQ(ask->address, (NodeAddress{"::1", 30002}));
+
+  ASSERT_FALSE(parse_redirect("ERR unknown command").has_value());
+  ASSERT_FALSE(parse_redirect("MOVED 16384 127.0.0.1:6381").has_value());
+  ASSERT_FALSE(parse_redirect("MOVED 1 127.0.0.1").has_value());
+  ASSERT_FALSE(parse_redirect("MOVED x 127.0.0.1:1").has_value());
+}
+
+namespace {
+
+/**
+ * A redis cluster of nodes on localhost, which serve one key space. A node
+ * redirects the commands of the slots it does not own, like a real cluster,
+ * and CLUSTER SLOTS replies the published slot map, which may be stale.
+ */
+class FakeCluster {
+ public:
+  explicit FakeCluster(int num_nodes)
+      : owners_(k_num_slots, 0), published_(k_num_slots, 0) {
+    for (int i = 0; i < num_nodes; ++i) {
+      auto& node = nodes_.emplace_back();
+      node.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in addr{};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      socklen_t len = sizeof(addr);
+      TORCH_CHECK(
+          bind(node.listen_fd, reinterpret_cast<sockaddr*>(&addr), len) == 0);
+      TORCH_CHECK(listen(node.listen_fd, 16) == 0);
+      getsockname(node.listen_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+      node.port = ntohs(addr.sin_port);
+    }
+    for (int i = 0; i < num_nodes; ++i) {
+      nodes_[i].acceptor = std::thread([this, i] { accept_loop(i); });
+    }
+  }
+
+  ~FakeCluster() {
+    for (auto& node : nodes_) {
+      shutdown(node.listen_fd, SHUT_RDWR);
+      node.acceptor.join();
+      close(node.listen_fd);
+    }
+    {
+      std::lock_guard<std::mutex> guard(mu_);
+      for (int fd : client_fds_) {
+        shutdown(fd, SHUT_RDWR);
+      }
+    }
+    for (auto& th : client_threads_) {
+      th.join();
+    }
+  }
+
+  uint16_t port(int node) const {
+    return nodes_[node].port;
+  }
+
+  /**
+   * Move the slots [begin, end] to `node`, and publish it in the slot map
+   * if `publish`.
+   */
+  void assign(uint16_t begin, uint16_t end, int node, bool publish = true) {
+    std::lock_guard<std::mutex> guard(mu_);
+    for (uint32_t slot = begin; slot <= end; ++slot) {
+      owners_[slot] = node;
+      published_[slot] = publish ? node : -1;
+    }
+  }
+
+  void publish() {
+    std::lock_guard<std::mutex> guard(mu_);
+    published_ = owners_;
+  }
+
+  /**
+   * `slot` is migrating to `node`, which serves its commands after ASKING.
+   */
+  void migrate(uint16_t slot, int node) {
+    std::lock_guard<std::mutex> guard(mu_);
+    migrating_[slot] = node;
+  }
+
+  uint32_t num_slot_queries() {
+    std::lock_guard<std::mutex> guard(mu_);
+    return num_slot_queries_;
+  }
+
+  uint32_t num_redirects() {
+    std::lock_guard<std::mutex> guard(mu_);
+    return num_redirects_;
+  }
+
+ private:
+  struct Node {
+    int listen_fd{-1};
+    uint16_t port{0};
+    std::thread acceptor;
+  };
+
+  void accept_loop(int node) {
+    while (true) {
+      int fd = accept(nodes_[node].listen_fd, nullptr, nullptr);
+      if (fd < 0) {
+        return;
+      }
+      std::lock_guard<std::mutex> guard(mu_);
+      client_fds_.push_back(fd);
+      client_threads_.emplace_back([this, node, fd] {
+        serve(node, fd);
+        close(fd);
+      });
+    }
+  }
+
+  void serve(int node, int fd) {
+    std::string buffer;
+    bool asking = false;
+    while (true) {
+      std::vector<std::string> args;
+      size_t pos = 0;
+      while (!parse_command(buffer, pos, args)) {
+        char chunk[4096];
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0) {
+          return;
+        }
+        buffer.append(chunk, n);
+        pos = 0;
+        args.clear();
+      }
+      buffer.erase(0, pos);
+      auto reply = execute(node, args, asking);
+      for (size_t off = 0; off < reply.size();) {
+        ssize_t n = write(fd, reply.data() + off, reply.size() - off);
+        if (n <= 0) {
+          return;
+        }
+        off += n;
+      }
+    }
+  }
+
+  static bool parse_command(
+      const std::string& buffer,
+      size_t& pos,
+      std::vector<std::string>& args) {
+    auto read_line = [&](char type, size_t& value) {
+      auto end = buffer.find("\r\n", pos);
+      if (end == std::string::npos || buffer[pos] != type) {
+        return false;
+      }
+      value = std::stoul(buffer.substr(pos + 1, end - pos - 1));
+      pos = end + 2;
+      return true;
+    };
+    size_t num_args;
+    if (!read_line('*', num_args)) {
+      return false;
+    }
+    for (size_t i = 0; i < num_args; ++i) {
+      size_t len;
+      if (!read_line('$', len) || buffer.size() < pos + len + 2) {
+        return false;
+      }
+      args.emplace_back(buffer.substr(pos, len));
+      pos += len + 2;
+    }
+    return true;
+  }
+
+  std::string address_of(int node) const {
+    return "127.0.0.1:" + std::to_string(nodes_[node].port);
+  }
+
+  std::string execute(
+      int node,
+      const std::vector<std::string>& args,
+      bool& asking) {
+    std::lock_guard<std::mutex> guard(mu_);
+    bool was_asking = std::exchange(asking, false);
+    const auto& name = args[0];
+    if (name == "PING") {
+      return "+PONG\r\n";
+    }
+    if (name == "ASKING") {
+      asking = true;
+      return "+OK\r\n";
+    }
+    if (name == "CLUSTER") {
+      ++num_slot_queries_;
+      return slots_reply();
+    }
+    uint16_t slot = key_slot(args[1]);
+    auto migrating = migrating_.find(slot);
+    if (migrating != migrating_.end() && owners_[slot] == node) {
+      ++num_redirects_;
+      return "-ASK " + std::to_string(slot) + " " +
+          address_of(migrating->second) + "\r\n";
+    }
+    bool imported = was_asking && migrating != migrating_.end() &&
+        migrating->second == node;
+    if (owners_[slot] != node && !imported) {
+      ++num_redirects_;
+      return "-MOVED " + std::to_string(slot) + " " +
+          address_of(owners_[slot]) + "\r\n";
+    }
+    if (name == "SET") {
+      data_[args[1]] = args[2];
+      return "+OK\r\n";
+    }
+    auto it = data_.find(args[1]);
+    if (it == data_.end()) {
+      return "$-1\r\n";
+    }
+    return "$" + std::to_string(it->second.size()) + "\r\n" + it->second +
+        "\r\n";
+  }
+
+  // [begin, end, [host, port]] of each range of slots of a node.
+  std::string slots_reply() const {
+    std::string ranges;
+    uint32_t num_ranges = 0;
+    for (uint32_t begin = 0; begin < k_num_slots;) {
+      uint32_t end = begin;
+      while (end + 1 < k_num_slots &&
+             published_[end + 1] == published_[begin]) {
+        ++end;
+      }
+      if (published_[begin] >= 0) {
+        ++num_ranges;
+        ranges += "*3\r\n:" + std::to_string(begin) + "\r\n:" +
+            std::to_string(end) + "\r\n*2\r\n$9\r\n127.0.0.1\r\n:" +
+            std::to_string(nodes_[published_[begin]].port) + "\r\n";
+      }
+      begin = end + 1;
+    }
+    return "*" + std::to_string(num_ranges) + "\r\n" + ranges;
+  }
+
+  std::vector<Node> nodes_;
+  std::mutex mu_;
+  std::vector<int> owners_;
+  std::vector<int> published_;
+  std::map<uint16_t, int> migrating_;
+  std::map<std::string, std::string> data_;
+  uint32_t num_slot_queries_{0};
+  uint32_t num_redirects_{0};
+  std::vector<int> client_fds_;
+  std::vector<std::thread> client_threads_;
+};
+
+constexpr uint32_t k_num_ids = 256;
+constexpr uint32_t k_dim = 2;
+
+/**
+ * Push `k_num_ids` rows, then fetch and check them, in one round each.
+ */
+void push_and_fetch(Redis& redis) {
+  std::vector<int64_t> global_ids(k_num_ids);
+  std::vector<float> params(k_num_ids * k_dim);
+  std::vector<uint64_t> offsets(k_num_ids + 1);
+  for (uint32_t i = 0; i < k_num_ids; ++i) {
+    global_ids[i] = i;
+    params[i * k_dim] = i;
+    params[i * k_dim + 1] = -float(i);
+    offsets[i + 1] = (i + 1) * k_dim * sizeof(float);
+  }
+  constexpr static uint32_t os_ids[] = {0};
+
+  Notification notification;
+  redis.push(IOPushParameter{
+      .table_name = "table",
+      .num_global_ids = k_num_ids,
+      .global_ids = global_ids.data(),
+      .num_optimizer_states = 1,
+      .optimizer_state_ids = os_ids,
+      .num_offsets = k_num_ids + 1,
+      .offsets = offsets.data(),
+      .data = params.data(),
+      .on_complete_context = &notification,
+      .on_push_complete =
+          +[](void* ctx) { reinterpret_cast<Notification*>(ctx)->done(); },
+  });
+  notification.wait();
+
+  struct FetchContext {
+    Notification notification;
+    std::vector<float> fetched;
+  } ctx;
+  ctx.fetched.resize(params.size(), 0);
+  redis.fetch(IOFetchParameter{
+      .table_name = "table",
+      .num_global_ids = k_num_ids,
+      .global_ids = global_ids.data(),
+      .num_optimizer_states = 1,
+      .on_complete_context = &ctx,
+      .on_global_id_fetched =
+          +[](void* ctx,
+              uint32_t offset,
+              uint32_t os_id,
+              void* data,
+              uint32_t len) {
+            auto& fetched = reinterpret_cast<FetchContext*>(ctx)->fetched;
+            ASSERT_EQ(len, k_dim * sizeof(float));
+            memcpy(&fetched[offset * k_dim], data, len);
+          },
+      .on_all_fetched =
+          +[](void* ctx) {
+            reinterpret_cast<FetchContext*>(ctx)->notification.done();
+          },
+  });
+  ctx.notification.wait();
+  ASSERT_EQ(ctx.fetched, params);
+}
+
+Option cluster_option(const FakeCluster& cluster) {
+  auto opt = parse_option(
+      "127.0.0.1/?cluster=true&&chunk_size=100000&&num_threads=1");
+  opt.port = cluster.port(0);
+  return opt;
+}
+
+} // namespace
+
+TEST(TDE, Cluster_MovedWithPendingCommands) {
+  FakeCluster cluster(2);
+  Redis redis(cluster_option(cluster));
+  ASSERT_EQ(cluster.num_slot_queries(), 1);
+
+  // A resharding the client does not know yet: the commands of half of the
+  // slots, pipelined to node 0, are moved.
+  cluster.assign(8192, 16383, 1);
+  push_and_fetch(redis);
+  ASSERT_GT(cluster.num_redirects(), 1);
+  // reloaded once for the push round, and fetched without redirects.
+  ASSERT_EQ(cluster.num_slot_queries(), 2);
+}
+
+TEST(TDE, Cluster_AskWithPendingCommands) {
+  FakeCluster cluster(2);
+  Redis redis(cluster_option(cluster));
+  // the slots of a few of the keys.
+  for (int64_t gid : {3, 100, 200}) {
+    cluster.migrate(
+        key_slot("_table_table_gid_" + std::to_string(gid) + "_cid_-1_osid_0"),
+        1);
+  }
+  push_and_fetch(redis);
+  ASSERT_EQ(cluster.num_redirects(), 6);
+  // an ASK redirect leaves the slot map as is.
+  ASSERT_EQ(cluster.num_slot_queries(), 1);
+}
+
+TEST(TDE, Cluster_UnservedSlotWithPendingCommands) {
+  FakeCluster cluster(2);
+  // node 1 is not known to the client.
+  cluster.assign(8192, 16383, 1, /* publish */ false);
+  Redis redis(cluster_option(cluster));
+  cluster.publish();
+  // The map is reloaded while commands are pipelined to node 0, which must
+  // not read their replies.
+  push_and_fetch(redis);
+  ASSERT_EQ(cluster.num_redirects(), 0);
+  ASSERT_EQ(cluster.num_slot_queries(), 2);
+}
+
+} // namespace torchrec::redis
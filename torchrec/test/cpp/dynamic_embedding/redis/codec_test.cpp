@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/dynamic_embedding/details/redis/codec.h>
+#include <cstring>
+#include <numeric>
+
+namespace torchrec::redis {
+
+static std::vector<uint8_t> as_bytes(const std::vector<float>& values) {
+  std::vector<uint8_t> bytes(values.size() * sizeof(float));
+  memcpy(bytes.data(), values.data(), bytes.size());
+  return bytes;
+}
+
+TEST(TDE, Codec_Parse) {
+  ASSERT_EQ(parse_codec("none"), Codec::kNone);
+  ASSERT_EQ(parse_codec("lz4"), Codec::kLZ4);
+  ASSERT_EQ(parse_codec("shuffle_lz4"), Codec::kShuffleLZ4);
+  ASSERT_ANY_THROW(parse_codec("zstd"));
+}
+
+TEST(TDE, Codec_ByteShuffle) {
+  // 3 elements of 4 bytes and 2 trailing bytes.
+  std::vector<uint8_t> src(14);
+  std::iota(src.begin(), src.end(), 0);
+  std::vector<uint8_t> shuffled(src.size());
+  byte_shuffle(src.data(), shuffled.data(), src.size(), 4);
+  std::vector<uint8_t> expected{0, 4, 8, 1, 5, 9, 2, 6, 10, 3, 7, 11, 12, 13};
+  ASSERT_EQ(shuffled, expected);
+
+  std::vector<uint8_t> unshuffled(src.size());
+  byte_unshuffle(shuffled.data(), unshuffled.data(), src.size(), 4);
+  ASSERT_EQ(unshuffled, src);
+}
+
+TEST(TDE, Codec_RoundTrip) {
+  // a row of small optimizer states, which compresses well.
+  std::vector<float> row(128, 0.0f);
+  row[3] = 1.5f;
+  row[77] = -2.25f;
+  auto raw = as_bytes(row);
+
+  for (auto codec : {Codec::kLZ4, Codec::kShuffleLZ4}) {
+    std::vector<uint8_t> encoded;
+    ASSERT_TRUE(encode_value(codec, sizeof(float), raw, encoded));
+    ASSERT_LT(encoded.size(), raw.size());
+
+    std::vector<uint8_t> scratch;
+    auto decoded = decode_value(encoded, scratch);
+    ASSERT_EQ(std::vector<uint8_t>(decoded.begin(), decoded.end()), raw);
+  }
+}
+
+TEST(TDE, Codec_Incompressible) {
+  std::vector<uint8_t> raw(64);
+  for (size_t i = 0; i < raw.size(); ++i) {
+    raw[i] = static_cast<uint8_t>(i * 37 + 1);
+  }
+  std::vector<uint8_t> encoded;
+  // stored as is, without header.
+  ASSERT_FALSE(encode_value(Codec::kLZ4, 1, raw, encoded));
+  ASSERT_TRUE(encoded.empty());
+  std::vector<uint8_t> scratch;
+  auto decoded = decode_value(raw, scratch);
+  ASSERT_EQ(decoded.data(), raw.data());
+  ASSERT_EQ(decoded.size(), raw.size());
+
+  // unless it starts with the magic, then it is stored after the header.
+  const uint8_t magic[] = {0xC7, 0xDE, 0x5A, 0x91};
+  memcpy(raw.data(), magic, sizeof(magic));
+  ASSERT_TRUE(encode_value(Codec::kLZ4, 1, raw, encoded));
+  ASSERT_EQ(encoded.size(), raw.size() + k_codec_header_size);
+  decoded = decode_value(encoded, scratch);
+  ASSERT_EQ(std::vector<uint8_t>(decoded.begin(), decoded.end()), raw);
+}
+
+TEST(TDE, Codec_DecodeRaw) {
+  // values pushed without codec are returned as is.
+  auto raw = as_bytes({1.0f, 2.0f, 3.0f});
+  std::vector<uint8_t> scratch;
+  auto decoded = decode_value(raw, scratch);
+  ASSERT_EQ(decoded.data(), raw.data());
+  ASSERT_EQ(decoded.size(), raw.size());
+}
+
+TEST(TDE, Codec_DecodeRawWithMagic) {
+  // a raw value that starts with the magic and a plausible header of an lz4
+  // value, but not with its checksum.
+  std::vector<uint8_t> raw{0xC7, 0xDE, 0x5A, 0x91, 1, 4, 0, 0, 32, 0, 0, 0};
+  raw.resize(48, 0);
+  std::vector<uint8_t> scratch;
+  auto decoded = decode_value(raw, scratch);
+  ASSERT_EQ(decoded.data(), raw.data());
+  ASSERT_EQ(decoded.size(), raw.size());
+
+  // an encoded value whose payload is altered is returned as is as well.
+  std::vector<float> row(64, 0.0f);
+  std::vector<uint8_t> encoded;
+  encode_value(Codec::kLZ4, sizeof(float), as_bytes(row), encoded);
+  encoded.back() ^= 1;
+  decoded = decode_value(encoded, scratch);
+  ASSERT_EQ(decoded.data(), encoded.data());
+  ASSERT_EQ(decoded.size(), encoded.size());
+}
+
+TEST(TDE, Codec_Stats) {
+  CodecCounters counters;
+  counters.add_encode(400, 100, 10);
+  counters.add_decode(5);
+  auto stats = counters.stats();
+  ASSERT_EQ(stats.raw_bytes, 400);
+  ASSERT_EQ(stats.encode_ns, 10);
+  ASSERT_EQ(stats.decode_ns, 5);
+  ASSERT_DOUBLE_EQ(stats.ratio(), 4.0);
+}
+
+} // namespace torchrec::redis
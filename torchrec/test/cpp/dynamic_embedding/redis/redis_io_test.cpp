@@ -9,6 +9,11 @@
 #include <gtest/gtest.h>
 #include <torchrec/csrc/dynamic_embedding/details/notification.h>
 #include <torchrec/csrc/dynamic_embedding/details/redis/redis_io.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <numeric>
 
 namespace torchrec::redis {
 
@@ -24,6 +29,39 @@ TEST(TDE, redis_Option) {
   ASSERT_TRUE(opt.prefix.empty());
 }
 
+TEST(TDE, redis_Option_Adaptive) {
+  auto opt = parse_option(
+      "127.0.0.1/?adaptive=true&&min_chunk_size=50&&max_chunk_size=5000"
+      "&&max_pipeline_jobs=8&&target_latency=2ms&&target_throughput=500");
+  ASSERT_TRUE(opt.adaptive);
+  ASSERT_EQ(opt.min_chunk_size, 50);
+  ASSERT_EQ(opt.max_chunk_size, 5000);
+  ASSERT_EQ(opt.max_pipeline_jobs, 8);
+  ASSERT_EQ(opt.target_latency_ms, 2);
+  ASSERT_EQ(opt.target_throughput_mbps, 500);
+  ASSERT_FALSE(parse_option("127.0.0.1/?adaptive=0").adaptive);
+  ASSERT_ANY_THROW(parse_option("127.0.0.1/?adaptive=yes"));
+}
+
+TEST(TDE, redis_Option_Codec) {
+  auto opt = parse_option(
+      "127.0.0.1/?codec=lz4&&table_codec=emb:1:shuffle_lz4"
+      "&&codec_element_size=2");
+  ASSERT_EQ(opt.codec, Codec::kLZ4);
+  ASSERT_EQ(opt.table_codecs.at("emb:1"), Codec::kShuffleLZ4);
+  ASSERT_EQ(opt.codec_element_size, 2);
+  ASSERT_ANY_THROW(parse_option("127.0.0.1/?codec=gzip"));
+  ASSERT_ANY_THROW(parse_option("127.0.0.1/?table_codec=emb"));
+}
+
+TEST(TDE, redis_Option_Cluster) {
+  auto opt = parse_option("127.0.0.1:30001/?cluster=true&&hash_tag=1");
+  ASSERT_TRUE(opt.cluster);
+  ASSERT_TRUE(opt.hash_tag);
+  ASSERT_FALSE(parse_option("127.0.0.1").cluster);
+  ASSERT_ANY_THROW(Redis(parse_option("127.0.0.1/?cluster=true&&db=3")));
+}
+
 TEST(TDE, redis_Option_ParseError) {
   ASSERT_ANY_THROW(
       parse_option("192.168.3.1:3948/?db=3&&no_opt=3000&&num_threads=2"));
@@ -113,4 +151,316 @@ TEST(TDE, redis_push_fetch) {
   redis.fetch(fetch);
   notification.wait();
 }
+
+struct CompleteContext {
+  Notification notification;
+  int32_t status{-1};
+};
+
+static void on_complete(void* ctx, int32_t status) {
+  auto* c = reinterpret_cast<CompleteContext*>(ctx);
+  c->status = status;
+  c->notification.done();
+}
+
+TEST(TDE, redis_push_fetch_v2) {
+  Redis redis(parse_option(
+      "127.0.0.1:6379/?chunk_size=4&&num_threads=2&&codec=lz4"));
+
+  // table a is sharded by 2 columns and has 2 optimizer states, table b has
+  // 1 optimizer state. Rows are 3 floats, row r is {r, r + 0.5, 0}.
+  constexpr uint32_t row_bytes = 3 * sizeof(float);
+  auto make_rows = [](uint32_t num_rows, float base) {
+    std::vector<float> rows;
+    for (uint32_t r = 0; r < num_rows; ++r) {
+      rows.insert(rows.end(), {base + r, base + r + 0.5f, 0});
+    }
+    return rows;
+  };
+  std::vector<int64_t> a_ids{10, 11, 12, 13, 14};
+  std::vector<int64_t> a_cols{0, 1};
+  std::vector<uint32_t> a_os{0, 1};
+  auto a_rows = make_rows(5 * 2 * 2, 100);
+  std::vector<int64_t> b_ids{20, 21};
+  std::vector<uint32_t> b_os{0};
+  auto b_rows = make_rows(2, 200);
+
+  std::vector<uint64_t> a_pushed(1, 0), b_pushed(1, 0);
+  std::vector<IOPushRequestV2> pushes{
+      {.table_name = "v2_a",
+       .num_global_ids = 5,
+       .global_ids = a_ids.data(),
+       .num_cols = 2,
+       .col_ids = a_cols.data(),
+       .num_optimizer_states = 2,
+       .optimizer_state_ids = a_os.data(),
+       .row_bytes = row_bytes,
+       .src = a_rows.data(),
+       .pushed = a_pushed.data()},
+      {.table_name = "v2_b",
+       .num_global_ids = 2,
+       .global_ids = b_ids.data(),
+       .num_optimizer_states = 1,
+       .optimizer_state_ids = b_os.data(),
+       .row_bytes = row_bytes,
+       .src = b_rows.data(),
+       .pushed = b_pushed.data()},
+  };
+  CompleteContext push_ctx;
+  redis.push_v2(IOPushParameterV2{
+      .num_requests = 2,
+      .requests = pushes.data(),
+      .on_complete_context = &push_ctx,
+      .on_complete = on_complete,
+  });
+  push_ctx.notification.wait();
+  ASSERT_EQ(push_ctx.status, k_io_ok);
+  ASSERT_EQ(a_pushed[0], (1U << 10) - 1);
+  ASSERT_EQ(b_pushed[0], 3U);
+
+  // fetch both tables in one request, with an id that was never pushed.
+  std::vector<int64_t> b_fetch_ids{21, 99, 20};
+  std::vector<float> a_dst(a_rows.size(), -1), b_dst(3 * 3, -1);
+  std::vector<uint64_t> a_found(1, 0), b_found(1, 0);
+  std::vector<IOFetchRequestV2> fetches{
+      {.table_name = "v2_a",
+       .num_global_ids = 5,
+       .global_ids = a_ids.data(),
+       .num_cols = 2,
+       .col_ids = a_cols.data(),
+       .num_optimizer_states = 2,
+       .row_bytes = row_bytes,
+       .dst = a_dst.data(),
+       .found = a_found.data()},
+      {.table_name = "v2_b",
+       .num_global_ids = 3,
+       .global_ids = b_fetch_ids.data(),
+       .num_optimizer_states = 1,
+       .row_bytes = row_bytes,
+       .dst = b_dst.data(),
+       .found = b_found.data()},
+  };
+  CompleteContext fetch_ctx;
+  redis.fetch_v2(IOFetchParameterV2{
+      .num_requests = 2,
+      .requests = fetches.data(),
+      .on_complete_context = &fetch_ctx,
+      .on_complete = on_complete,
+  });
+  fetch_ctx.notification.wait();
+  ASSERT_EQ(fetch_ctx.status, k_io_ok);
+  ASSERT_EQ(a_found[0], (1U << 10) - 1);
+  ASSERT_EQ(a_dst, a_rows);
+  ASSERT_EQ(b_found[0], 0b101U);
+  ASSERT_TRUE(std::equal(b_dst.begin(), b_dst.begin() + 3, b_rows.begin() + 3));
+  ASSERT_TRUE(std::equal(b_dst.begin() + 6, b_dst.end(), b_rows.begin()));
+
+  // a row of another size fails the fetch.
+  std::vector<float> wide_dst(4 * 2 * 2);
+  a_found[0] = 0;
+  fetches[0].num_global_ids = 1;
+  fetches[0].row_bytes = 4 * sizeof(float);
+  fetches[0].dst = wide_dst.data();
+  CompleteContext error_ctx;
+  redis.fetch_v2(IOFetchParameterV2{
+      .num_requests = 1,
+      .requests = fetches.data(),
+      .on_complete_context = &error_ctx,
+      .on_complete = on_complete,
+  });
+  error_ctx.notification.wait();
+  ASSERT_EQ(error_ctx.status, k_io_error);
+  ASSERT_EQ(a_found[0], 0);
+}
+
+TEST(TDE, redis_push_v1_fetch_v2) {
+  // v1 and v2 use the same keys.
+  Redis redis(parse_option("127.0.0.1:6379"));
+  constexpr static int64_t global_ids[] = {7};
+  constexpr static uint32_t os_ids[] = {0};
+  constexpr static float params[] = {1.5, 2.5};
+  constexpr static uint64_t offsets[] = {0, sizeof(params)};
+  Notification notification;
+  redis.push(IOPushParameter{
+      .table_name = "v1_table",
+      .num_global_ids = 1,
+      .global_ids = global_ids,
+      .num_optimizer_states = 1,
+      .optimizer_state_ids = os_ids,
+      .num_offsets = 2,
+      .offsets = offsets,
+      .data = params,
+      .on_complete_context = &notification,
+      .on_push_complete =
+          +[](void* ctx) { reinterpret_cast<Notification*>(ctx)->done(); },
+  });
+  notification.wait();
+
+  float dst[2];
+  uint64_t found = 0;
+  IOFetchRequestV2 request{
+      .table_name = "v1_table",
+      .num_global_ids = 1,
+      .global_ids = global_ids,
+      .num_optimizer_states = 1,
+      .row_bytes = sizeof(params),
+      .dst = dst,
+      .found = &found,
+  };
+  CompleteContext ctx;
+  redis.fetch_v2(IOFetchParameterV2{
+      .num_requests = 1,
+      .requests = &request,
+      .on_complete_context = &ctx,
+      .on_complete = on_complete,
+  });
+  ctx.notification.wait();
+  ASSERT_EQ(ctx.status, k_io_ok);
+  ASSERT_EQ(found, 1);
+  ASSERT_EQ(dst[0], 1.5);
+  ASSERT_EQ(dst[1], 2.5);
+}
+
+// Records the order in which the fetches of the tables complete.
+struct OrderContext {
+  std::string table_name;
+  std::mutex* mu;
+  std::vector<std::string>* completed;
+  Notification notification;
+};
+
+TEST(TDE, redis_FairAcrossTables) {
+  // One io thread running one job per round, so that the jobs run in the
+  // order they are popped.
+  Redis redis(parse_option(
+      "127.0.0.1:6379/?num_threads=1&&chunk_size=1&&pipeline_jobs=1"));
+  std::vector<int64_t> large_ids(32);
+  std::iota(large_ids.begin(), large_ids.end(), 0);
+  std::vector<int64_t> small_ids{0};
+  std::mutex mu;
+  std::vector<std::string> completed;
+  std::vector<OrderContext> contexts(2);
+  std::vector<std::vector<float>> dsts(2);
+  std::vector<std::vector<uint64_t>> founds(2);
+  std::vector<IOFetchRequestV2> requests;
+  for (auto& ids : {std::cref(large_ids), std::cref(small_ids)}) {
+    size_t i = requests.size();
+    contexts[i].table_name = i == 0 ? "fair_large" : "fair_small";
+    contexts[i].mu = &mu;
+    contexts[i].completed = &completed;
+    dsts[i].resize(ids.get().size());
+    founds[i].resize(io_num_bitmap_words(ids.get().size()));
+    requests.emplace_back(IOFetchRequestV2{
+        .table_name = contexts[i].table_name.c_str(),
+        .num_global_ids = static_cast<uint32_t>(ids.get().size()),
+        .global_ids = ids.get().data(),
+        .num_optimizer_states = 1,
+        .row_bytes = sizeof(float),
+        .dst = dsts[i].data(),
+        .found = founds[i].data(),
+    });
+  }
+  // The 32 jobs of the large table are queued before the job of the small
+  // table, which still runs after at most one job of the large table per
+  // round.
+  for (size_t i = 0; i < 2; ++i) {
+    redis.fetch_v2(IOFetchParameterV2{
+        .num_requests = 1,
+        .requests = &requests[i],
+        .on_complete_context = &contexts[i],
+        .on_complete =
+            +[](void* ctx, int32_t) {
+              auto* c = reinterpret_cast<OrderContext*>(ctx);
+              {
+                std::lock_guard<std::mutex> guard(*c->mu);
+                c->completed->emplace_back(c->table_name);
+              }
+              c->notification.done();
+            },
+    });
+  }
+  for (auto& ctx : contexts) {
+    ctx.notification.wait();
+  }
+  ASSERT_EQ(completed, (std::vector<std::string>{"fair_small", "fair_large"}));
+}
+
+TEST(TDE, redis_CodecStats) {
+  void* redis = IO_Initialize("127.0.0.1:6379/?codec=lz4");
+
+  // a row that compresses and one that does not.
+  constexpr static int64_t global_ids[] = {1, 2};
+  constexpr static uint32_t os_ids[] = {0};
+  std::vector<uint8_t> rows(256, 0);
+  for (size_t i = 128; i < rows.size(); ++i) {
+    rows[i] = static_cast<uint8_t>(i * 37 + 1);
+  }
+  constexpr static uint64_t offsets[] = {0, 128, 256};
+
+  Notification notification;
+  IO_Push(
+      redis,
+      IOPushParameter{
+          .table_name = "codec_table",
+          .num_global_ids = 2,
+          .global_ids = global_ids,
+          .num_optimizer_states = 1,
+          .optimizer_state_ids = os_ids,
+          .num_offsets = 3,
+          .offsets = offsets,
+          .data = rows.data(),
+          .on_complete_context = &notification,
+          .on_push_complete =
+              +[](void* ctx) {
+                reinterpret_cast<Notification*>(ctx)->done();
+              },
+      });
+  notification.wait();
+  notification.clear();
+
+  FetchContext ctx{
+      .notification_ = &notification,
+      .on_data_ =
+          [&](uint32_t offset, uint32_t os_id, void* data, uint32_t len) {
+            ASSERT_EQ(len, 128);
+            ASSERT_EQ(memcmp(data, rows.data() + offset * 128, len), 0);
+          }};
+  IO_Fetch(
+      redis,
+      IOFetchParameter{
+          .table_name = "codec_table",
+          .num_global_ids = 2,
+          .global_ids = global_ids,
+          .num_optimizer_states = 1,
+          .on_complete_context = &ctx,
+          .on_global_id_fetched =
+              +[](void* ctx,
+                  uint32_t offset,
+                  uint32_t os_id,
+                  void* data,
+                  uint32_t len) {
+                reinterpret_cast<FetchContext*>(ctx)->on_data_(
+                    offset, os_id, data, len);
+              },
+          .on_all_fetched =
+              +[](void* ctx) {
+                reinterpret_cast<FetchContext*>(ctx)->notification_->done();
+              }});
+  notification.wait();
+
+  std::map<std::string, double> stats;
+  IO_Stats(
+      redis, &stats, +[](void* ctx, const char* name, double value) {
+        (*reinterpret_cast<std::map<std::string, double>*>(ctx))[name] = value;
+      });
+  ASSERT_EQ(stats.at("codec_raw_bytes"), 256);
+  // the row that does not compress is stored as is, without header.
+  ASSERT_LT(stats.at("codec_encoded_bytes"), 256);
+  ASSERT_GT(stats.at("codec_encoded_bytes"), 128);
+  ASSERT_DOUBLE_EQ(
+      stats.at("codec_ratio"), 256 / stats.at("codec_encoded_bytes"));
+  ASSERT_GT(stats.at("codec_encode_seconds"), 0);
+  ASSERT_GE(stats.at("codec_decode_seconds"), 0);
+  IO_Finalize(redis);
+}
 } // namespace torchrec::redis
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/dynamic_embedding/details/static_id_transformer.h>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace torchrec {
+
+TEST(tde, StaticIDTransformer_Find) {
+  const int64_t global_ids[4] = {100, 101, -7, 103};
+  const int64_t cache_ids[4] = {3, 0, 2, 1};
+  StaticIDTransformer transformer(global_ids, cache_ids);
+  ASSERT_EQ(transformer.size(), 4);
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_EQ(transformer.find(global_ids[i]), cache_ids[i]);
+  }
+  EXPECT_EQ(transformer.find(102), -1);
+  EXPECT_EQ(transformer.find(std::numeric_limits<int64_t>::min()), -1);
+}
+
+TEST(tde, StaticIDTransformer_Fallback) {
+  const int64_t global_ids[2] = {100, std::numeric_limits<int64_t>::min()};
+  const int64_t cache_ids[2] = {0, 1};
+  StaticIDTransformer transformer(
+      global_ids, cache_ids, FallbackRows{.begin = 10, .size = 4});
+
+  const int64_t query[5] = {
+      100, 200, 300, 200, std::numeric_limits<int64_t>::min()};
+  int64_t result[5];
+  ASSERT_EQ(transformer.transform(query, result), 3);
+  EXPECT_EQ(result[0], 0);
+  EXPECT_EQ(result[4], 1);
+  for (size_t i = 1; i < 4; i++) {
+    EXPECT_GE(result[i], 10);
+    EXPECT_LT(result[i], 14);
+  }
+  // The same unknown id always goes to the same fallback row.
+  EXPECT_EQ(result[1], result[3]);
+}
+
+TEST(tde, StaticIDTransformer_Large) {
+  constexpr int64_t n = 100000;
+  std::vector<int64_t> global_ids(n);
+  std::vector<int64_t> cache_ids(n);
+  for (int64_t i = 0; i < n; ++i) {
+    global_ids[i] = i * 7919 + 13;
+    cache_ids[i] = i;
+  }
+  StaticIDTransformer transformer(global_ids, cache_ids);
+  ASSERT_EQ(transformer.size(), n);
+
+  std::vector<std::thread> threads;
+  std::vector<int64_t> num_fallbacks(4);
+  for (size_t t = 0; t < num_fallbacks.size(); ++t) {
+    threads.emplace_back([&, t] {
+      std::vector<int64_t> result(n);
+      num_fallbacks[t] = transformer.transform(global_ids, result);
+      for (int64_t i = 0; i < n; ++i) {
+        EXPECT_EQ(result[i], i);
+      }
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+  for (auto num_fallback : num_fallbacks) {
+    EXPECT_EQ(num_fallback, 0);
+  }
+}
+
+} // namespace torchrec
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/dynamic_embedding/static_id_transformer_wrapper.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace torchrec {
+
+static int64_t transform_one(
+    StaticIDTransformerWrapper& wrapper,
+    int64_t global_id) {
+  auto cache_ids = torch::empty({1}, torch::kLong);
+  wrapper.transform({torch::tensor({global_id}, torch::kLong)}, {cache_ids});
+  return cache_ids.item<int64_t>();
+}
+
+TEST(tde, StaticIDTransformerWrapper_Load) {
+  StaticIDTransformerWrapper wrapper(10, 1);
+  EXPECT_EQ(transform_one(wrapper, 100), 10);
+  wrapper.load(torch::tensor({100, 3, 101, 4}, torch::kLong).view({2, 2}));
+  // the snapshot of this thread is outdated by the load.
+  EXPECT_EQ(transform_one(wrapper, 100), 3);
+  EXPECT_EQ(wrapper.size(), 2);
+  wrapper.load(torch::tensor({100, 5}, torch::kLong).view({1, 2}));
+  EXPECT_EQ(transform_one(wrapper, 100), 5);
+  EXPECT_EQ(transform_one(wrapper, 101), 10);
+}
+
+TEST(tde, StaticIDTransformerWrapper_ReleasedWrapper) {
+  auto wrapper = std::make_unique<StaticIDTransformerWrapper>(10, 1);
+  wrapper->load(torch::tensor({100, 3}, torch::kLong).view({1, 2}));
+  EXPECT_EQ(transform_one(*wrapper, 100), 3);
+  wrapper.reset();
+  // likely at the address of the released wrapper, never sees its snapshot.
+  wrapper = std::make_unique<StaticIDTransformerWrapper>(10, 1);
+  EXPECT_EQ(transform_one(*wrapper, 100), 10);
+}
+
+TEST(tde, StaticIDTransformerWrapper_InvalidIds) {
+  StaticIDTransformerWrapper wrapper(10, 1);
+  auto cache_ids = torch::empty({2}, torch::kLong);
+  EXPECT_ANY_THROW(wrapper.transform(
+      {torch::tensor({1, 2}, torch::kInt)}, {cache_ids}));
+  EXPECT_ANY_THROW(wrapper.transform(
+      {torch::tensor({1, 2}, torch::kLong)},
+      {torch::empty({2}, torch::kInt)}));
+  auto strided = torch::arange(4, torch::kLong).slice(0, 0, 4, 2);
+  EXPECT_ANY_THROW(wrapper.transform({strided}, {cache_ids}));
+  EXPECT_ANY_THROW(wrapper.transform(
+      {torch::tensor({1, 2}, torch::kLong)},
+      {torch::empty({4}, torch::kLong).slice(0, 0, 4, 2)}));
+}
+
+TEST(tde, StaticIDTransformerWrapper_ConcurrentLoad) {
+  StaticIDTransformerWrapper wrapper(1000, 1);
+  // every mapping sends global id i to cache id i + version.
+  auto mapping = [](int64_t version) {
+    auto ids = torch::empty({100, 2}, torch::kLong);
+    ids.select(1, 0).copy_(torch::arange(100, torch::kLong));
+    ids.select(1, 1).copy_(torch::arange(100, torch::kLong) + version);
+    return ids;
+  };
+  wrapper.load(mapping(0));
+
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&] {
+      auto global_ids = torch::arange(100, torch::kLong);
+      auto cache_ids = torch::empty({100}, torch::kLong);
+      while (!stop.load()) {
+        wrapper.transform({global_ids}, {cache_ids});
+        // a transform sees a single mapping, never a mix of two.
+        auto version = cache_ids[0].item<int64_t>();
+        ASSERT_TRUE(cache_ids.equal(global_ids + version));
+      }
+    });
+  }
+  for (int64_t version = 1; version <= 100; ++version) {
+    wrapper.load(mapping(version));
+  }
+  stop.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(transform_one(wrapper, 0), 100);
+}
+
+} // namespace torchrec
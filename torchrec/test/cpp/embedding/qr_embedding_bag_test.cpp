@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/embedding/qr_embedding_bag.h>
+
+namespace torchrec::embedding {
+
+static torch::Tensor qr_sum(
+    const torch::Tensor& indices,
+    const torch::Tensor& offsets) {
+  // 6 categories with 3 collisions.
+  auto weight_q = torch::ones({2, 2});
+  auto weight_r = torch::ones({3, 2});
+  return qr_embedding_bag(
+      weight_q, weight_r, indices, offsets, std::nullopt, 3, 0, 0, false);
+}
+
+TEST(QREmbeddingBagTest, Offsets) {
+  auto indices = torch::tensor({0, 4, 5}, torch::kLong);
+  auto out = qr_sum(indices, torch::tensor({0, 2, 2, 3}, torch::kLong));
+  ASSERT_EQ(out.sizes(), (std::vector<int64_t>{3, 4}));
+  EXPECT_TRUE(out[0].equal(torch::full({4}, 2.0f)));
+  EXPECT_TRUE(out[1].equal(torch::zeros({4})));
+}
+
+TEST(QREmbeddingBagTest, InvalidOffsets) {
+  auto indices = torch::tensor({0, 4, 5}, torch::kLong);
+  // would read the bag [0, 100) of 3 indices.
+  EXPECT_ANY_THROW(qr_sum(indices, torch::tensor({0, 100, 3}, torch::kLong)));
+  EXPECT_ANY_THROW(qr_sum(indices, torch::tensor({0, 2, 1, 3}, torch::kLong)));
+  EXPECT_ANY_THROW(qr_sum(indices, torch::tensor({1, 3}, torch::kLong)));
+  EXPECT_ANY_THROW(qr_sum(indices, torch::tensor({0, 2}, torch::kLong)));
+}
+
+} // namespace torchrec::embedding
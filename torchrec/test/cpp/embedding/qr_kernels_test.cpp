@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/embedding/details/qr_kernels.h>
+#include <vector>
+
+namespace torchrec::embedding {
+
+class QRKernelsTest : public ::testing::Test {
+ protected:
+  // 6 categories with 3 collisions: q has 2 rows, r has 3 rows, both 2D.
+  std::vector<float> q_{1, 2, 3, 4};
+  std::vector<float> r_{1, 0, 0, 1, 2, 2};
+  QRTables tables_{
+      .q = q_.data(),
+      .q_dim = 2,
+      .r = r_.data(),
+      .r_dim = 2,
+      .num_collisions = 3};
+  // bags: [0, 4], [], [5]
+  std::vector<int64_t> indices_{0, 4, 5};
+  std::vector<int64_t> offsets_{0, 2, 2, 3};
+  Bags bags_{
+      .indices = indices_.data(),
+      .offsets = offsets_.data(),
+      .per_sample_weights = nullptr,
+      .num_bags = 3};
+
+  std::vector<float> forward(PoolingMode mode, QROperation op) {
+    pooled_q_.assign(bags_.num_bags * tables_.q_dim, -1);
+    pooled_r_.assign(bags_.num_bags * tables_.r_dim, -1);
+    std::vector<float> out(bags_.num_bags * tables_.out_dim(op), -1);
+    qr_forward(
+        tables_,
+        bags_,
+        mode,
+        op,
+        0,
+        bags_.num_bags,
+        pooled_q_.data(),
+        pooled_r_.data(),
+        out.data());
+    return out;
+  }
+
+  std::vector<float> pooled_q_;
+  std::vector<float> pooled_r_;
+};
+
+TEST_F(QRKernelsTest, ForwardConcat) {
+  // index 0: q[0] = (1, 2), r[0] = (1, 0)
+  // index 4: q[1] = (3, 4), r[1] = (0, 1)
+  // index 5: q[1] = (3, 4), r[2] = (2, 2)
+  auto out = forward(PoolingMode::kSum, QROperation::kConcat);
+  EXPECT_EQ(
+      out, (std::vector<float>{4, 6, 1, 1, 0, 0, 0, 0, 3, 4, 2, 2}));
+}
+
+TEST_F(QRKernelsTest, ForwardMeanMult) {
+  auto out = forward(PoolingMode::kMean, QROperation::kMult);
+  // bag 0: q = (2, 3), r = (0.5, 0.5)
+  EXPECT_EQ(out, (std::vector<float>{1, 1.5, 0, 0, 6, 8}));
+}
+
+TEST_F(QRKernelsTest, ForwardWeightedAdd) {
+  std::vector<float> weights{2, 1, 0.5};
+  bags_.per_sample_weights = weights.data();
+  auto out = forward(PoolingMode::kSum, QROperation::kAdd);
+  // bag 0: q = (5, 8), r = (2, 1)
+  EXPECT_EQ(out, (std::vector<float>{7, 9, 0, 0, 2.5, 3}));
+}
+
+TEST_F(QRKernelsTest, BackwardMult) {
+  forward(PoolingMode::kSum, QROperation::kMult);
+  std::vector<float> grad_out(bags_.num_bags * 2, 1);
+  std::vector<float> grad_pooled_q(pooled_q_.size());
+  std::vector<float> grad_pooled_r(pooled_r_.size());
+  qr_backward_pooled(
+      tables_,
+      QROperation::kMult,
+      grad_out.data(),
+      pooled_q_.data(),
+      pooled_r_.data(),
+      0,
+      bags_.num_bags,
+      grad_pooled_q.data(),
+      grad_pooled_r.data());
+  // d(q * r)/dq = r
+  EXPECT_EQ(grad_pooled_q, (std::vector<float>{1, 1, 0, 0, 2, 2}));
+  EXPECT_EQ(grad_pooled_r, (std::vector<float>{4, 6, 0, 0, 3, 4}));
+
+  std::vector<float> grad_q(q_.size(), 0);
+  std::vector<float> grad_r(r_.size(), 0);
+  // accumulate the columns separately, as parallel tasks would.
+  for (int64_t col = 0; col < 2; ++col) {
+    qr_backward_table(
+        tables_,
+        bags_,
+        PoolingMode::kSum,
+        true,
+        grad_pooled_q.data(),
+        col,
+        col + 1,
+        grad_q.data());
+    qr_backward_table(
+        tables_,
+        bags_,
+        PoolingMode::kSum,
+        false,
+        grad_pooled_r.data(),
+        col,
+        col + 1,
+        grad_r.data());
+  }
+  // q[1] is looked up by bag 0 and bag 2.
+  EXPECT_EQ(grad_q, (std::vector<float>{1, 1, 3, 3}));
+  EXPECT_EQ(grad_r, (std::vector<float>{4, 6, 4, 6, 3, 4}));
+}
+
+TEST_F(QRKernelsTest, BackwardSparseMean) {
+  std::vector<float> grad_pooled{2, 4, 0, 0, 1, 1};
+  std::vector<int64_t> rows(indices_.size());
+  std::vector<float> values(indices_.size() * 2);
+  qr_backward_sparse(
+      tables_,
+      bags_,
+      PoolingMode::kMean,
+      false,
+      grad_pooled.data(),
+      0,
+      bags_.num_bags,
+      rows.data(),
+      values.data());
+  EXPECT_EQ(rows, (std::vector<int64_t>{0, 1, 2}));
+  EXPECT_EQ(values, (std::vector<float>{1, 2, 1, 2, 1, 1}));
+}
+
+TEST_F(QRKernelsTest, BackwardSampleWeights) {
+  std::vector<float> grad_pooled_q{1, 2, 0, 0, 1, 1};
+  std::vector<float> grad_pooled_r{1, 1, 0, 0, 2, 0};
+  std::vector<float> grad_weights(indices_.size(), -1);
+  qr_backward_sample_weights(
+      tables_,
+      bags_,
+      grad_pooled_q.data(),
+      grad_pooled_r.data(),
+      0,
+      bags_.num_bags,
+      grad_weights.data());
+  // index 4: q[1] . (1, 2) + r[1] . (1, 1)
+  EXPECT_EQ(grad_weights, (std::vector<float>{6, 12, 11}));
+}
+
+} // namespace torchrec::embedding
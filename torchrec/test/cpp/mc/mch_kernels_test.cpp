@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/mc/details/mch_kernels.h>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace torchrec::mc {
+
+static constexpr int64_t k_max = std::numeric_limits<int64_t>::max();
+
+TEST(MCH, BatchLowerBound) {
+  std::vector<int64_t> sorted{1, 3, 3, 5, 9, 12, 20};
+  std::vector<int64_t> values{0, 1, 2, 3, 4, 5, 6, 9, 10, 12, 19, 20, 21};
+  std::vector<int64_t> positions(values.size());
+  batch_lower_bound(sorted, values, positions);
+  for (size_t i = 0; i < values.size(); ++i) {
+    auto expected =
+        std::lower_bound(sorted.begin(), sorted.end(), values[i]) -
+        sorted.begin();
+    ASSERT_EQ(positions[i], expected) << "value " << values[i];
+  }
+
+  std::vector<int64_t> empty;
+  batch_lower_bound(empty, values, positions);
+  ASSERT_TRUE(std::all_of(
+      positions.begin(), positions.end(), [](int64_t p) { return p == 0; }));
+}
+
+TEST(MCH, Remap) {
+  // the last element is reserved.
+  std::vector<int64_t> sorted_raw_ids{2, 4, 8, k_max};
+  std::vector<int64_t> remapped_ids{11, 12, 10, 13};
+  std::vector<int64_t> values{4, 5, 8, 2, 100, 1};
+  std::vector<int64_t> output(values.size());
+  remap(sorted_raw_ids, remapped_ids, values, 13, output);
+  ASSERT_EQ(output, (std::vector<int64_t>{12, 13, 10, 11, 13, 13}));
+}
+
+// the reference: a stable descending argsort over all the scores.
+template <typename Score>
+static EvictionResult select_by_argsort(
+    const std::vector<Score>& scores,
+    int64_t pivot) {
+  std::vector<int64_t> order(scores.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int64_t a, int64_t b) {
+    return scores[a] > scores[b];
+  });
+  EvictionResult result;
+  for (int64_t i = 0; i < static_cast<int64_t>(order.size()); ++i) {
+    if (i < pivot && order[i] >= pivot) {
+      result.selected_new_indices.emplace_back(order[i] - pivot);
+    } else if (i >= pivot && order[i] < pivot) {
+      result.evicted_indices.emplace_back(order[i]);
+    }
+  }
+  return result;
+}
+
+TEST(MCH, SelectReplacements) {
+  std::mt19937 gen(7);
+  // few distinct values, to have many ties.
+  std::uniform_int_distribution<int64_t> dist(0, 5);
+  for (int64_t pivot : {1, 8, 64}) {
+    for (int64_t num_new : {0, 1, 10, 100}) {
+      std::vector<int64_t> scores(pivot + num_new);
+      for (auto& s : scores) {
+        s = dist(gen);
+      }
+      auto result = select_replacements<int64_t>(scores, pivot);
+      auto expected = select_by_argsort(scores, pivot);
+      ASSERT_EQ(result.evicted_indices, expected.evicted_indices);
+      ASSERT_EQ(result.selected_new_indices, expected.selected_new_indices);
+    }
+  }
+}
+
+TEST(MCH, UpdateAndEvictLFU) {
+  std::vector<int64_t> counts{5, 1, 3, 0};
+  // history sorted by counts, the id with count 4 is in the table at 2.
+  std::vector<int64_t> history_counts{7, 4, 2, 1};
+  bool matching[] = {false, true, false, false};
+  std::vector<int64_t> matched_indices{2};
+  auto result = update_and_evict({
+      .policy = EvictionPolicy::kLFU,
+      .current_iter = 10,
+      .decay_exponent = 1.0,
+      .history_counts = history_counts,
+      .matching = matching,
+      .matched_indices = matched_indices,
+      .counts = counts,
+  });
+  // scores: table {5, 1, 7, max}, new {7, 2, 1}
+  ASSERT_EQ(result.evicted_indices, (std::vector<int64_t>{1}));
+  ASSERT_EQ(result.selected_new_indices, (std::vector<int64_t>{0}));
+  ASSERT_EQ(counts, (std::vector<int64_t>{5, 7, 7, k_max}));
+}
+
+TEST(MCH, UpdateAndEvictDistanceLFU) {
+  std::vector<int64_t> counts{4, 4, 0};
+  std::vector<int64_t> last_access{10, 2, 0};
+  std::vector<int64_t> history_counts{3, 1};
+  std::vector<int64_t> history_last_access{10, 10};
+  bool matching[] = {false, false};
+  std::vector<int64_t> matched_indices;
+  auto result = update_and_evict({
+      .policy = EvictionPolicy::kDistanceLFU,
+      .current_iter = 10,
+      .decay_exponent = 1.0,
+      .history_counts = history_counts,
+      .matching = matching,
+      .matched_indices = matched_indices,
+      .history_last_access = history_last_access,
+      .counts = counts,
+      .last_access = last_access,
+  });
+  // scores: table {4, 4 / 9, max}, new {3, 1}
+  ASSERT_EQ(result.evicted_indices, (std::vector<int64_t>{1}));
+  ASSERT_EQ(result.selected_new_indices, (std::vector<int64_t>{0}));
+  ASSERT_EQ(counts, (std::vector<int64_t>{4, 3, k_max}));
+  ASSERT_EQ(last_access, (std::vector<int64_t>{10, 10, 10}));
+}
+
+TEST(MCH, UpdateAndEvictLRU) {
+  std::vector<int64_t> last_access{3, 9, 1, 0};
+  std::vector<int64_t> history_counts{5, 2};
+  std::vector<int64_t> history_last_access{8, 10};
+  bool matching[] = {true, false};
+  std::vector<int64_t> matched_indices{2};
+  auto result = update_and_evict({
+      .policy = EvictionPolicy::kLRU,
+      .current_iter = 10,
+      .decay_exponent = 2.0,
+      .history_counts = history_counts,
+      .matching = matching,
+      .matched_indices = matched_indices,
+      .history_last_access = history_last_access,
+      .last_access = last_access,
+  });
+  // last access: table {3, 9, 8, 10}, new {10}
+  ASSERT_EQ(result.evicted_indices, (std::vector<int64_t>{0}));
+  ASSERT_EQ(result.selected_new_indices, (std::vector<int64_t>{0}));
+  ASSERT_EQ(last_access, (std::vector<int64_t>{10, 9, 8, 10}));
+}
+
+TEST(MCH, CoalesceHistory) {
+  std::vector<int64_t> ids{5, 3, 5, 9, 3, 5};
+  std::vector<int64_t> last_access{1, 2, 3, 4, 1, 2};
+  std::span<const int64_t> metadata[] = {last_access};
+  auto result = coalesce_history(ids, metadata);
+  ASSERT_EQ(result.unique_ids, (std::vector<int64_t>{3, 5, 9}));
+  ASSERT_EQ(result.counts, (std::vector<int64_t>{2, 3, 1}));
+  ASSERT_EQ(result.metadata_max[0], (std::vector<int64_t>{2, 3, 4}));
+}
+
+} // namespace torchrec::mc
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/metrics/auc_kernels.h>
+#include <algorithm>
+#include <cmath>
+
+namespace torchrec::metrics {
+
+// The exact AUC of all the examples, as one group.
+static torch::Tensor exact_auc(
+    const torch::Tensor& predictions,
+    const torch::Tensor& labels,
+    const torch::Tensor& weights) {
+  return grouped_auc(
+      predictions,
+      labels,
+      weights,
+      torch::zeros({predictions.size(1)}, torch::kLong));
+}
+
+TEST(AucKernelsTest, Histogram) {
+  // Out of range predictions are clamped into the first and last bins.
+  auto predictions =
+      torch::tensor({0.0, 0.3, 0.5, 0.99, 1.0, -0.1, 1.5}, torch::kFloat)
+          .view({1, 7});
+  auto labels =
+      torch::tensor({0.0, 1.0, 0.25, 1.0, 0.0, 1.0, 1.0}, torch::kFloat)
+          .view({1, 7});
+  auto weights =
+      torch::tensor({1.0, 2.0, 4.0, 1.0, 1.0, 1.0, 0.5}, torch::kFloat)
+          .view({1, 7});
+  auto histogram = binned_histogram(predictions, labels, weights, 4);
+  ASSERT_EQ(histogram.sizes(), (std::vector<int64_t>{1, 2, 4}));
+  ASSERT_EQ(histogram.scalar_type(), torch::kDouble);
+  auto expected = torch::tensor(
+                      {1.0, 0.0, 3.0, 1.0, 1.0, 2.0, 1.0, 1.5},
+                      torch::kDouble)
+                      .view({1, 2, 4});
+  EXPECT_TRUE(torch::allclose(histogram, expected));
+
+  EXPECT_ANY_THROW(binned_histogram(predictions, labels, weights, 0));
+  EXPECT_ANY_THROW(
+      binned_histogram(predictions, labels.view({7}), weights, 4));
+}
+
+TEST(AucKernelsTest, HistogramIsMergeable) {
+  torch::manual_seed(0);
+  auto predictions = torch::rand({3, 1000});
+  auto labels = torch::rand({3, 1000});
+  auto weights = torch::rand({3, 1000});
+  auto full = binned_histogram(predictions, labels, weights, 64);
+  // The histograms of the batches, or the ranks, add up.
+  auto merged = torch::zeros_like(full);
+  for (int64_t begin = 0; begin < 1000; begin += 300) {
+    int64_t end = std::min<int64_t>(begin + 300, 1000);
+    merged += binned_histogram(
+        predictions.slice(1, begin, end),
+        labels.slice(1, begin, end),
+        weights.slice(1, begin, end),
+        64);
+  }
+  EXPECT_TRUE(torch::allclose(full, merged));
+}
+
+TEST(AucKernelsTest, HistogramCurves) {
+  // Negative weights {1, 0, 1, 0} and positive weights {0, 0, 1, 2} per bin,
+  // and a task without positives.
+  auto histogram =
+      torch::tensor(
+          {1.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0, 2.0, 1.0, 1.0, 0.0, 0.0,
+           0.0, 0.0, 0.0, 0.0},
+          torch::kDouble)
+          .view({2, 2, 4});
+
+  auto auc = histogram_auc(histogram);
+  ASSERT_EQ(auc.scalar_type(), torch::kFloat);
+  // 5 of the 6 pairs are ordered, 1 is tied in bin 2.
+  EXPECT_NEAR(auc[0].item<float>(), 5.5 / 6, 1e-6);
+  EXPECT_FLOAT_EQ(auc[1].item<float>(), 0.5);
+
+  auto bound = histogram_auc_error_bound(histogram);
+  EXPECT_NEAR(bound[0].item<float>(), 0.5 / 6, 1e-6);
+  EXPECT_FLOAT_EQ(bound[1].item<float>(), 0);
+
+  // Precision 1 up to recall 2/3 from bin 3, then 3/4 up to recall 1 from
+  // bin 2. The empty bin 1 and bin 0 do not add any recall.
+  auto auprc = histogram_auprc(histogram);
+  EXPECT_NEAR(auprc[0].item<float>(), 2.0 / 3 + 0.75 / 3, 1e-6);
+  EXPECT_FLOAT_EQ(auprc[1].item<float>(), 0);
+
+  EXPECT_ANY_THROW(histogram_auc(histogram.view({4, 4})));
+  EXPECT_ANY_THROW(histogram_auprc(histogram.view({1, 4, 4})));
+}
+
+TEST(AucKernelsTest, BinnedAucWithoutTies) {
+  // No bin holds both a negative and a positive, so the binned AUC is exact.
+  auto predictions =
+      torch::tensor({0.05, 0.15, 0.35, 0.55, 0.65, 0.95}, torch::kFloat)
+          .view({1, 6});
+  auto labels =
+      torch::tensor({0.0, 1.0, 0.0, 1.0, 0.0, 1.0}, torch::kFloat)
+          .view({1, 6});
+  auto weights =
+      torch::tensor({1.0, 2.0, 1.0, 0.5, 3.0, 1.0}, torch::kFloat)
+          .view({1, 6});
+  auto histogram = binned_histogram(predictions, labels, weights, 10);
+  EXPECT_NEAR(
+      histogram_auc(histogram)[0].item<float>(),
+      exact_auc(predictions, labels, weights)[0].item<float>(),
+      1e-6);
+  EXPECT_FLOAT_EQ(histogram_auc_error_bound(histogram)[0].item<float>(), 0);
+}
+
+TEST(AucKernelsTest, BinnedAucErrorBound) {
+  torch::manual_seed(0);
+  auto predictions = torch::rand({4, 2000});
+  auto labels = (torch::rand({4, 2000}) < predictions).to(torch::kFloat);
+  auto weights = torch::rand({4, 2000});
+  auto exact = exact_auc(predictions, labels, weights);
+  double prev_bound = 1;
+  for (int64_t num_bins : {1, 4, 16, 64, 256}) {
+    auto histogram = binned_histogram(predictions, labels, weights, num_bins);
+    auto binned = histogram_auc(histogram);
+    auto bound = histogram_auc_error_bound(histogram);
+    for (int64_t task = 0; task < 4; ++task) {
+      EXPECT_LE(
+          std::abs(binned[task].item<float>() - exact[task].item<float>()),
+          bound[task].item<float>() + 1e-5)
+          << "num_bins " << num_bins << " task " << task;
+    }
+    // Finer bins tie fewer pairs.
+    double max_bound = bound.max().item<float>();
+    EXPECT_LE(max_bound, prev_bound);
+    prev_bound = max_bound;
+  }
+}
+
+TEST(AucKernelsTest, GroupedAuc) {
+  // Group 7 ties a positive before a negative, group 3 is ordered and group
+  // 5 is inverted.
+  auto predictions =
+      torch::tensor({0.5, 0.5, 0.1, 0.9, 0.9, 0.1}, torch::kFloat)
+          .view({1, 6});
+  auto labels =
+      torch::tensor({1.0, 0.0, 0.0, 1.0, 0.0, 1.0}, torch::kFloat)
+          .view({1, 6});
+  auto weights = torch::ones({1, 6});
+  auto keys = torch::tensor({7, 7, 3, 3, 5, 5}, torch::kLong);
+  auto auc = grouped_auc(predictions, labels, weights, keys);
+  // The tied examples stay in their original order.
+  EXPECT_NEAR(auc[0].item<float>(), 2.0 / 3, 1e-6);
+
+  EXPECT_ANY_THROW(grouped_auc(predictions, labels, weights, keys.slice(0, 1)));
+}
+
+} // namespace torchrec::metrics
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/planner/details/search.h>
+#include <limits>
+#include <random>
+#include <thread>
+
+namespace torchrec::planner {
+
+/**
+ * `DynamicProgrammingProposer.feedback` as written in python.
+ */
+static std::vector<std::vector<int64_t>> reference_dp(
+    const std::vector<std::vector<double>>& hbm,
+    const std::vector<std::vector<double>>& perf,
+    int64_t bin_count) {
+  constexpr double inf = std::numeric_limits<double>::infinity();
+  size_t table_count = hbm.size();
+  size_t option_count = 0;
+  for (auto& h : hbm) {
+    option_count = std::max(option_count, h.size());
+  }
+  auto at = [&](const std::vector<std::vector<double>>& v, size_t t, size_t j) {
+    return j < v[t].size() ? v[t][j] : inf;
+  };
+  using State = std::pair<double, double>;
+  std::vector<std::vector<State>> dp(
+      table_count, std::vector<State>(bin_count, {inf, inf}));
+  std::vector<std::vector<std::pair<int64_t, int64_t>>> backtrack(
+      table_count,
+      std::vector<std::pair<int64_t, int64_t>>(bin_count, {-1, -1}));
+  auto bins = static_cast<double>(bin_count);
+  for (size_t j = 0; j < option_count; ++j) {
+    if (at(hbm, 0, j) < bins) {
+      auto i = static_cast<int64_t>(at(hbm, 0, j));
+      if (dp[0][i].first > at(perf, 0, j)) {
+        dp[0][i] = {at(perf, 0, j), at(hbm, 0, j)};
+        backtrack[0][i] = {j, -1};
+      }
+    }
+  }
+  for (size_t t = 1; t < table_count; ++t) {
+    for (size_t j = 0; j < option_count; ++j) {
+      for (int64_t h = 0; h < bin_count; ++h) {
+        auto [prev_perf, prev_hbm] = dp[t - 1][h];
+        if (prev_perf < inf) {
+          double new_hbm = prev_hbm + at(hbm, t, j);
+          if (new_hbm < bins) {
+            auto i = static_cast<int64_t>(new_hbm);
+            double new_perf = prev_perf + at(perf, t, j);
+            if (dp[t][i].first > new_perf) {
+              dp[t][i] = {new_perf, new_hbm};
+              backtrack[t][i] = {j, h};
+            }
+          }
+        }
+      }
+    }
+  }
+  std::vector<std::vector<int64_t>> proposals;
+  for (int64_t c = bin_count - 1; c >= 0; --c) {
+    auto [option, bin] = backtrack[table_count - 1][c];
+    if (option >= 0) {
+      std::vector<int64_t> proposal(table_count, -1);
+      proposal[table_count - 1] = option;
+      for (int64_t t = static_cast<int64_t>(table_count) - 2; t >= 0; --t) {
+        std::tie(proposal[t], bin) = backtrack[t][bin];
+      }
+      proposals.emplace_back(std::move(proposal));
+    }
+  }
+  return proposals;
+}
+
+// runs the ranges in reverse, each in its own thread.
+static void threaded_for(
+    int64_t n,
+    const std::function<void(int64_t, int64_t)>& fn) {
+  std::vector<std::thread> threads;
+  for (int64_t i = n - 1; i >= 0; --i) {
+    threads.emplace_back([&fn, i] { fn(i, i + 1); });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+TEST(Planner, DPMatchesReference) {
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> hbm_dist(0.0, 6.0);
+  // coarse perfs so that there are ties.
+  std::uniform_int_distribution<int> perf_dist(1, 5);
+  std::uniform_int_distribution<int> num_options_dist(1, 7);
+  for (int round = 0; round < 20; ++round) {
+    std::vector<std::vector<double>> hbm(12), perf(12);
+    std::vector<int64_t> offsets{0};
+    std::vector<double> flat_hbm, flat_perf;
+    for (size_t t = 0; t < hbm.size(); ++t) {
+      int n = num_options_dist(gen);
+      for (int j = 0; j < n; ++j) {
+        hbm[t].emplace_back(hbm_dist(gen));
+      }
+      std::sort(hbm[t].begin(), hbm[t].end());
+      for (int j = 0; j < n; ++j) {
+        perf[t].emplace_back(perf_dist(gen));
+      }
+      flat_hbm.insert(flat_hbm.end(), hbm[t].begin(), hbm[t].end());
+      flat_perf.insert(flat_perf.end(), perf[t].begin(), perf[t].end());
+      offsets.emplace_back(static_cast<int64_t>(flat_hbm.size()));
+    }
+    int64_t bin_count = 40;
+    auto expected = reference_dp(hbm, perf, bin_count);
+    DPInput input{offsets, flat_hbm, flat_perf, bin_count};
+    ASSERT_EQ(dp_search(input, 1), expected);
+    ASSERT_EQ(dp_search(input, 3, threaded_for), expected);
+  }
+}
+
+TEST(Planner, DPNothingFits) {
+  std::vector<int64_t> offsets{0, 1, 2};
+  std::vector<double> hbm{3.0, 3.5};
+  std::vector<double> perf{1.0, 1.0};
+  ASSERT_TRUE(dp_search({offsets, hbm, perf, 6}, 2).empty());
+  auto proposals = dp_search({offsets, hbm, perf, 7}, 2);
+  ASSERT_EQ(proposals, (std::vector<std::vector<int64_t>>{{0, 0}}));
+}
+
+static Perf perf_of(double fwd_compute) {
+  return Perf{.fwd_compute = fwd_compute};
+}
+
+// Options: 0 uniform over 2 devices, 1 to 3 single shard, 4 two shards.
+static PlanSpace make_space() {
+  PlanSpace space;
+  space.partition_by = {
+      PartitionBy::kUniform,
+      PartitionBy::kDevice,
+      PartitionBy::kDevice,
+      PartitionBy::kDevice,
+      PartitionBy::kDevice,
+  };
+  space.shard_offsets = {0, 2, 3, 4, 5, 7};
+  space.shard_perf = {
+      perf_of(1), perf_of(1), perf_of(4), perf_of(2), perf_of(3), perf_of(1),
+      perf_of(1)};
+  space.shard_storage = {
+      {10, 0}, {10, 0}, {30, 0}, {50, 0}, {20, 0}, {20, 0}, {20, 0}};
+  space.option_perf = {2, 4, 2, 3, 2};
+  space.option_storage = {{20, 0}, {30, 0}, {50, 0}, {20, 0}, {40, 0}};
+  space.param_count = {-1, -1, -1, -1, -1};
+  space.devices = {{{100, 0}, {}}, {{100, 0}, {}}};
+  space.local_world_size = 2;
+  space.sort_by_perf = false;
+  space.balance_modules = false;
+  return space;
+}
+
+TEST(Planner, GreedyPartitionByStorage) {
+  auto space = make_space();
+  std::vector<int64_t> proposal{0, 1, 2, 3};
+  std::vector<int64_t> shard_devices(num_shards(space, proposal));
+  ASSERT_TRUE(greedy_partition(space, proposal, shard_devices));
+  // uniform first, then by storage: option 2 (50) on device 0, option 1 (30)
+  // on device 1 (perf 1 < 3), option 3 (20) on device 0 (perf 3 < 5).
+  ASSERT_EQ(shard_devices, (std::vector<int64_t>{0, 1, 1, 0, 0}));
+  ASSERT_DOUBLE_EQ(rate(space, proposal, shard_devices), 6.0);
+}
+
+TEST(Planner, GreedyPartitionByPerf) {
+  auto space = make_space();
+  space.sort_by_perf = true;
+  std::vector<int64_t> proposal{1, 2, 3};
+  std::vector<int64_t> shard_devices(num_shards(space, proposal));
+  ASSERT_TRUE(greedy_partition(space, proposal, shard_devices));
+  // option 1 (4) on device 0, option 3 (3) on device 1, option 2 (2) on
+  // device 1 (perf 3 < 4).
+  ASSERT_EQ(shard_devices, (std::vector<int64_t>{0, 1, 1}));
+  ASSERT_DOUBLE_EQ(rate(space, proposal, shard_devices), 5.0);
+}
+
+TEST(Planner, GreedyPartitionSkipsFullDevices) {
+  auto space = make_space();
+  space.devices[0].storage.hbm = 40;
+  std::vector<int64_t> proposal{2, 4};
+  std::vector<int64_t> shard_devices(num_shards(space, proposal));
+  ASSERT_TRUE(greedy_partition(space, proposal, shard_devices));
+  // option 2 fits on device 1 only, then device 0 has the lower perf.
+  ASSERT_EQ(shard_devices, (std::vector<int64_t>{1, 0, 0}));
+
+  space.devices[1].storage.hbm = 40;
+  ASSERT_FALSE(greedy_partition(space, proposal, shard_devices));
+}
+
+TEST(Planner, EvaluateProposals) {
+  auto space = make_space();
+  space.devices[0].storage.hbm = 60;
+  space.devices[1].storage.hbm = 40;
+  std::vector<int64_t> proposals{0, 1, 0, 2, 2, 2};
+  auto ratings = evaluate_proposals(space, proposals, 3, threaded_for);
+  ASSERT_EQ(ratings.size(), 3);
+  ASSERT_DOUBLE_EQ(ratings[0], 5.0);
+  ASSERT_DOUBLE_EQ(ratings[1], 3.0);
+  ASSERT_EQ(ratings[2], std::numeric_limits<double>::infinity());
+}
+
+} // namespace torchrec::planner
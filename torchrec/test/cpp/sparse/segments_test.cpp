@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <torchrec/csrc/sparse/details/segments.h>
+
+namespace torchrec::sparse {
+
+TEST(SegmentsTest, Permute) {
+  // segments: [0, 1], [], [2, 3, 4]
+  std::vector<int64_t> sizes{2, 0, 3};
+  std::vector<int32_t> src{0, 1, 2, 3, 4};
+  std::vector<int64_t> indices{2, 1, 0};
+  auto plan = plan_segments(sizes, indices);
+  ASSERT_EQ(plan.dst_size(), 5);
+  std::vector<int32_t> dst(plan.dst_size());
+  copy_segments(
+      plan, src.data(), dst.data(), sizeof(int32_t), 0, plan.num_segments());
+  EXPECT_EQ(dst, (std::vector<int32_t>{2, 3, 4, 0, 1}));
+}
+
+TEST(SegmentsTest, RepeatedIndices) {
+  std::vector<int64_t> sizes{1, 2};
+  std::vector<float> src{1, 2, 3};
+  std::vector<int64_t> indices{1, 0, 1};
+  auto plan = plan_segments(sizes, indices);
+  ASSERT_EQ(plan.dst_size(), 5);
+  std::vector<float> dst(plan.dst_size());
+  // copy in two ranges, as parallel tasks would.
+  copy_segments(plan, src.data(), dst.data(), sizeof(float), 0, 1);
+  copy_segments(plan, src.data(), dst.data(), sizeof(float), 1, 3);
+  EXPECT_EQ(dst, (std::vector<float>{2, 3, 1, 2, 3}));
+}
+
+TEST(SegmentsTest, Empty) {
+  std::vector<int64_t> sizes{3};
+  std::vector<int64_t> indices;
+  auto plan = plan_segments(sizes, indices);
+  EXPECT_EQ(plan.num_segments(), 0);
+  EXPECT_EQ(plan.dst_size(), 0);
+}
+
+TEST(SegmentsTest, OutOfRange) {
+  std::vector<int64_t> sizes{1, 2};
+  std::vector<int64_t> indices{2};
+  EXPECT_ANY_THROW(plan_segments(sizes, indices));
+}
+
+} // namespace torchrec::sparse
@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <torchrec/csrc/criteo/batch_assembler.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace torchrec::criteo {
+
+// Rows transposed at a time, so that the source rows stay in cache while
+// all the columns are visited.
+static constexpr int64_t k_transpose_tile_rows = 256;
+
+namespace {
+
+template <typename T>
+void transpose_sparse(
+    const T* src,
+    int64_t num_rows,
+    int64_t num_columns,
+    const std::vector<int64_t>& hashes,
+    T* dst,
+    int64_t dst_stride) {
+  for (int64_t tile = 0; tile < num_rows; tile += k_transpose_tile_rows) {
+    int64_t tile_end = std::min(tile + k_transpose_tile_rows, num_rows);
+    for (int64_t j = 0; j < num_columns; ++j) {
+      T* out = dst + j * dst_stride;
+      const T* in = src + j;
+      if (hashes.empty()) {
+        for (int64_t r = tile; r < tile_end; ++r) {
+          out[r] = in[r * num_columns];
+        }
+      } else {
+        // floor modulo, the same as numpy.
+        auto hash = static_cast<T>(hashes[j]);
+        for (int64_t r = tile; r < tile_end; ++r) {
+          T value = in[r * num_columns] % hash;
+          out[r] = value < 0 ? value + hash : value;
+        }
+      }
+    }
+  }
+}
+
+} // namespace
+
+BatchAssembler::BatchAssembler(
+    std::vector<std::string> dense_paths,
+    std::vector<std::string> sparse_paths,
+    std::vector<std::string> labels_paths,
+    std::vector<int64_t> file_row_begins,
+    std::vector<int64_t> file_row_ends,
+    torch::Tensor batches,
+    std::vector<int64_t> hashes,
+    int64_t num_prefetch,
+    int64_t num_threads,
+    bool pin_memory)
+    : hashes_(std::move(hashes)), pin_memory_(pin_memory) {
+  size_t num_files = dense_paths.size();
+  TORCH_CHECK(num_files > 0, "no npy files");
+  TORCH_CHECK(
+      sparse_paths.size() == num_files && labels_paths.size() == num_files &&
+          file_row_begins.size() == num_files &&
+          file_row_ends.size() == num_files,
+      "the numbers of dense, sparse, labels files and row ranges mismatch");
+  TORCH_CHECK(num_prefetch > 0, "num_prefetch should be positive");
+  TORCH_CHECK(num_threads > 0, "num_threads should be positive");
+
+  file_offsets_.emplace_back(0);
+  for (size_t i = 0; i < num_files; ++i) {
+    File file{
+        .dense = map_npy(dense_paths[i]),
+        .sparse = map_npy(sparse_paths[i]),
+        .labels = map_npy(labels_paths[i]),
+        .row_begin = file_row_begins[i],
+    };
+    auto& dense_shape = file.dense.header.shape;
+    auto& sparse_shape = file.sparse.header.shape;
+    int64_t rows = file.dense.rows();
+    TORCH_CHECK(
+        file.dense.header.descr == npy_descr<float>() &&
+            dense_shape.size() == 2,
+        dense_paths[i],
+        " should be a 2-d float32 array");
+    TORCH_CHECK(
+        (file.sparse.header.descr == npy_descr<int32_t>() ||
+         file.sparse.header.descr == npy_descr<int64_t>()) &&
+            sparse_shape.size() == 2 && sparse_shape[0] == rows,
+        sparse_paths[i],
+        " should be a 2-d int32 or int64 array of ",
+        rows,
+        " rows");
+    TORCH_CHECK(
+        file.labels.header.descr == npy_descr<int32_t>() &&
+            file.labels.header.numel() == rows,
+        labels_paths[i],
+        " should be an int32 array of ",
+        rows,
+        " rows");
+    TORCH_CHECK(
+        0 <= file_row_begins[i] && file_row_begins[i] <= file_row_ends[i] &&
+            file_row_ends[i] <= rows,
+        "invalid row range of ",
+        dense_paths[i]);
+
+    auto sparse_dtype = file.sparse.header.descr == npy_descr<int32_t>()
+        ? torch::kInt
+        : torch::kLong;
+    if (i == 0) {
+      num_dense_columns_ = dense_shape[1];
+      num_sparse_columns_ = sparse_shape[1];
+      sparse_dtype_ = sparse_dtype;
+    }
+    TORCH_CHECK(
+        dense_shape[1] == num_dense_columns_ &&
+            sparse_shape[1] == num_sparse_columns_ &&
+            sparse_dtype == sparse_dtype_,
+        "all files should have the same columns and dtypes");
+
+    file_offsets_.emplace_back(
+        file_offsets_.back() + file_row_ends[i] - file_row_begins[i]);
+    files_.emplace_back(std::move(file));
+  }
+  TORCH_CHECK(
+      hashes_.empty() ||
+          static_cast<int64_t>(hashes_.size()) == num_sparse_columns_,
+      "hashes should have one value per sparse column");
+  // The ids keep the dtype of the file, so the hashes have to fit in it, or
+  // the modulo of negative ids would not either.
+  int64_t max_hash = sparse_dtype_ == torch::kInt
+      ? std::numeric_limits<int32_t>::max()
+      : std::numeric_limits<int64_t>::max();
+  for (int64_t hash : hashes_) {
+    TORCH_CHECK(
+        0 < hash && hash <= max_hash,
+        "hash ",
+        hash,
+        " is out of the range of the ",
+        sparse_dtype_,
+        " sparse ids");
+  }
+
+  TORCH_CHECK(
+      batches.dim() == 2 && batches.size(1) == 2,
+      "batches should be of shape [num_batches, 2]");
+  batches = batches.to(torch::kLong).contiguous();
+  auto accessor = batches.accessor<int64_t, 2>();
+  for (int64_t i = 0; i < batches.size(0); ++i) {
+    int64_t first_row = accessor[i][0];
+    int64_t num_rows = accessor[i][1];
+    TORCH_CHECK(
+        first_row >= 0 && num_rows > 0 &&
+            first_row + num_rows <= file_offsets_.back(),
+        "batch ",
+        i,
+        " is out of range");
+    batches_.emplace_back(first_row, num_rows);
+  }
+
+  slots_.resize(num_prefetch);
+  for (int64_t i = 0; i < num_threads; ++i) {
+    threads_.emplace_back([this] { work(); });
+  }
+}
+
+BatchAssembler::~BatchAssembler() {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    stopped_ = true;
+  }
+  slot_free_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void BatchAssembler::work() {
+  auto num_slots = static_cast<int64_t>(slots_.size());
+  while (true) {
+    int64_t batch_idx;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      slot_free_.wait(lock, [&] {
+        return stopped_ || next_to_assemble_ >= size() ||
+            next_to_assemble_ < next_to_return_ + num_slots;
+      });
+      if (stopped_ || next_to_assemble_ >= size()) {
+        return;
+      }
+      batch_idx = next_to_assemble_++;
+    }
+
+    Slot slot;
+    try {
+      slot.batch = assemble(batch_idx);
+    } catch (...) {
+      slot.error = std::current_exception();
+    }
+    {
+      std::lock_guard<std::mutex> guard(mu_);
+      slots_[batch_idx % num_slots] = std::move(slot);
+    }
+    batch_ready_.notify_all();
+  }
+}
+
+std::vector<torch::Tensor> BatchAssembler::next() {
+  Slot slot;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (next_to_return_ >= size()) {
+      return {};
+    }
+    auto& ready = slots_[next_to_return_ % slots_.size()];
+    batch_ready_.wait(
+        lock, [&] { return ready.batch.has_value() || ready.error; });
+    slot = std::exchange(ready, Slot{});
+    ++next_to_return_;
+  }
+  slot_free_.notify_all();
+  if (slot.error) {
+    std::rethrow_exception(slot.error);
+  }
+  return std::move(*slot.batch);
+}
+
+std::vector<torch::Tensor> BatchAssembler::assemble(int64_t batch_idx) const {
+  auto [first_row, num_rows] = batches_[batch_idx];
+  auto options = torch::TensorOptions().pinned_memory(pin_memory_);
+  auto dense = torch::empty(
+      {num_rows, num_dense_columns_}, options.dtype(torch::kFloat));
+  auto values = torch::empty(
+      {num_sparse_columns_ * num_rows}, options.dtype(sparse_dtype_));
+  auto labels = torch::empty({num_rows}, options.dtype(torch::kInt));
+
+  auto f = std::upper_bound(
+               file_offsets_.begin(), file_offsets_.end(), first_row) -
+      file_offsets_.begin() - 1;
+  for (int64_t out_row = 0; out_row < num_rows; ++f) {
+    auto& file = files_[f];
+    int64_t row = first_row + out_row;
+    int64_t n = std::min(num_rows - out_row, file_offsets_[f + 1] - row);
+    int64_t src_row = file.row_begin + row - file_offsets_[f];
+
+    memcpy(
+        dense.data_ptr<float>() + out_row * num_dense_columns_,
+        file.dense.data<float>() + src_row * num_dense_columns_,
+        n * num_dense_columns_ * sizeof(float));
+    memcpy(
+        labels.data_ptr<int32_t>() + out_row,
+        file.labels.data<int32_t>() + src_row,
+        n * sizeof(int32_t));
+    if (sparse_dtype_ == torch::kInt) {
+      transpose_sparse(
+          file.sparse.data<int32_t>() + src_row * num_sparse_columns_,
+          n,
+          num_sparse_columns_,
+          hashes_,
+          values.data_ptr<int32_t>() + out_row,
+          num_rows);
+    } else {
+      transpose_sparse(
+          file.sparse.data<int64_t>() + src_row * num_sparse_columns_,
+          n,
+          num_sparse_columns_,
+          hashes_,
+          values.data_ptr<int64_t>() + out_row,
+          num_rows);
+    }
+    out_row += n;
+  }
+  return {dense, values, labels};
+}
+
+} // namespace torchrec::criteo
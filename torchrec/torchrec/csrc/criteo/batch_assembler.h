@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <torch/custom_class.h>
+#include <torch/torch.h>
+#include <torchrec/csrc/criteo/details/npy.h>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace torchrec::criteo {
+
+/**
+ * BatchAssembler
+ *
+ * Assembles the batches of `InMemoryBinaryCriteoIterDataPipe` from the
+ * memory-mapped npy files. The next `num_prefetch` batches are assembled by
+ * background threads while the current one is being consumed, and the
+ * threads never touch python objects, so they run without the GIL.
+ *
+ * A batch is `[dense, values, labels]`:
+ * - dense: float32 of shape [batch_size, num_dense_columns].
+ * - values: the sparse ids in KJT order, i.e. key major, of shape
+ *   [num_sparse_columns * batch_size] and the dtype of the sparse files.
+ * - labels: int32 of shape [batch_size].
+ */
+class BatchAssembler : public torch::CustomClassHolder {
+ public:
+  /**
+   * @param file_row_begins, file_row_ends the rows of each file to read.
+   * The rows of all files are concatenated in order.
+   * @param batches int64 tensor of shape [num_batches, 2], the first row and
+   * the number of rows of each batch to assemble, in the concatenated rows.
+   * @param hashes if not empty, sparse ids of column i are taken modulo
+   * `hashes[i]`, which should be positive and fit in the sparse dtype.
+   * @param pin_memory assemble into pinned memory for async H2D copies.
+   */
+  BatchAssembler(
+      std::vector<std::string> dense_paths,
+      std::vector<std::string> sparse_paths,
+      std::vector<std::string> labels_paths,
+      std::vector<int64_t> file_row_begins,
+      std::vector<int64_t> file_row_ends,
+      torch::Tensor batches,
+      std::vector<int64_t> hashes,
+      int64_t num_prefetch,
+      int64_t num_threads,
+      bool pin_memory);
+
+  BatchAssembler(const BatchAssembler&) = delete;
+  BatchAssembler& operator=(const BatchAssembler&) = delete;
+  ~BatchAssembler() override;
+
+  /**
+   * Returns the next batch, or an empty list after the last batch.
+   */
+  std::vector<torch::Tensor> next();
+
+  [[nodiscard]] int64_t size() const {
+    return static_cast<int64_t>(batches_.size());
+  }
+
+ private:
+  struct File {
+    NpyArray dense;
+    NpyArray sparse;
+    NpyArray labels;
+    int64_t row_begin;
+  };
+
+  struct Slot {
+    std::optional<std::vector<torch::Tensor>> batch;
+    std::exception_ptr error;
+  };
+
+  void work();
+  std::vector<torch::Tensor> assemble(int64_t batch_idx) const;
+
+  std::vector<File> files_;
+  // first row of each file in the concatenated rows, and the total rows.
+  std::vector<int64_t> file_offsets_;
+  std::vector<std::pair<int64_t, int64_t>> batches_;
+  std::vector<int64_t> hashes_;
+  int64_t num_dense_columns_;
+  int64_t num_sparse_columns_;
+  torch::ScalarType sparse_dtype_;
+  bool pin_memory_;
+
+  // batch `i` is assembled into `slots_[i % slots_.size()]`.
+  std::vector<Slot> slots_;
+  int64_t next_to_assemble_{0};
+  int64_t next_to_return_{0};
+  bool stopped_{false};
+  std::mutex mu_;
+  std::condition_variable slot_free_;
+  std::condition_variable batch_ready_;
+  std::vector<std::thread> threads_;
+};
+
+} // namespace torchrec::criteo
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <torch/torch.h>
+
+#include <torchrec/csrc/criteo/batch_assembler.h>
+#include <torchrec/csrc/criteo/preprocess.h>
+
+namespace torchrec::criteo {
+
+// `num_threads <= 0` means all the hardware threads.
+static int64_t resolve_num_threads(int64_t num_threads) {
+  return num_threads > 0 ? num_threads : default_num_threads();
+}
+
+TORCH_LIBRARY(criteo, m) {
+  m.class_<BatchAssembler>("BatchAssembler")
+      .def(torch::init<
+           std::vector<std::string>,
+           std::vector<std::string>,
+           std::vector<std::string>,
+           std::vector<int64_t>,
+           std::vector<int64_t>,
+           torch::Tensor,
+           std::vector<int64_t>,
+           int64_t,
+           int64_t,
+           bool>())
+      .def("next", &BatchAssembler::next)
+      .def("size", &BatchAssembler::size);
+
+  m.def(
+      "tsv_to_npys(str in_file, str out_dense_file, str out_sparse_file, "
+      "str out_labels_file, bool fake_label=False, int num_threads=0) -> ()",
+      [](const std::string& in_file,
+         const std::string& out_dense_file,
+         const std::string& out_sparse_file,
+         const std::string& out_labels_file,
+         bool fake_label,
+         int64_t num_threads) {
+        tsv_to_npys(
+            in_file,
+            out_dense_file,
+            out_sparse_file,
+            out_labels_file,
+            fake_label,
+            resolve_num_threads(num_threads));
+      });
+
+  m.def(
+      "sparse_to_contiguous(str[] in_files, str output_dir, "
+      "int frequency_threshold=3, int columns=26, "
+      "str output_file_suffix=\"_contig_freq.npy\", int num_threads=0) -> ()",
+      [](std::vector<std::string> in_files,
+         const std::string& output_dir,
+         int64_t frequency_threshold,
+         int64_t columns,
+         const std::string& output_file_suffix,
+         int64_t num_threads) {
+        sparse_to_contiguous(
+            in_files,
+            output_dir,
+            frequency_threshold,
+            columns,
+            output_file_suffix,
+            resolve_num_threads(num_threads));
+      });
+
+  m.def(
+      "shuffle(str input_dir_labels_and_dense, str input_dir_sparse, "
+      "str output_dir_shuffled, str output_dir_full_set=\"\", "
+      "int days=24, int int_columns=13, int sparse_columns=26, "
+      "int random_seed=0, str temp_dir=\"\", int num_buckets=0, "
+      "int num_threads=0) -> ()",
+      [](const std::string& input_dir_labels_and_dense,
+         const std::string& input_dir_sparse,
+         const std::string& output_dir_shuffled,
+         const std::string& output_dir_full_set,
+         int64_t days,
+         int64_t int_columns,
+         int64_t sparse_columns,
+         int64_t random_seed,
+         const std::string& temp_dir,
+         int64_t num_buckets,
+         int64_t num_threads) {
+        shuffle(
+            input_dir_labels_and_dense,
+            input_dir_sparse,
+            output_dir_shuffled,
+            output_dir_full_set,
+            days,
+            int_columns,
+            sparse_columns,
+            random_seed,
+            temp_dir,
+            num_buckets,
+            resolve_num_threads(num_threads));
+      });
+}
+
+} // namespace torchrec::criteo
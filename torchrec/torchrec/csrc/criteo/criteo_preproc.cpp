@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Command line tool of the native Criteo preprocessing, e.g.
+//
+//   criteo_preproc tsv_to_npys day_0 day_0_dense.npy day_0_sparse.npy
+//       day_0_labels.npy
+//   criteo_preproc sparse_to_contiguous --frequency_threshold 3
+//       out_dir day_0_sparse.npy day_1_sparse.npy ...
+//   criteo_preproc shuffle --random_seed 0 labels_and_dense_dir sparse_dir
+//       out_dir
+
+#include <torchrec/csrc/criteo/preprocess.h>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+void print_usage() {
+  std::cerr
+      << "usage:\n"
+      << "  criteo_preproc tsv_to_npys [--fake_label] [--num_threads N]\n"
+      << "      <in_file> <out_dense_file> <out_sparse_file> "
+         "<out_labels_file>\n"
+      << "  criteo_preproc sparse_to_contiguous [--frequency_threshold N]\n"
+      << "      [--columns N] [--output_file_suffix S] [--num_threads N]\n"
+      << "      <output_dir> <in_files>...\n"
+      << "  criteo_preproc shuffle [--output_dir_full_set DIR] [--days N]\n"
+      << "      [--int_columns N] [--sparse_columns N] [--random_seed N]\n"
+      << "      [--temp_dir DIR] [--num_buckets N] [--num_threads N]\n"
+      << "      <input_dir_labels_and_dense> <input_dir_sparse> "
+         "<output_dir_shuffled>\n";
+}
+
+struct Args {
+  bool fake_label{false};
+  int64_t num_threads{torchrec::criteo::default_num_threads()};
+  int64_t frequency_threshold{torchrec::criteo::k_frequency_threshold};
+  int64_t columns{torchrec::criteo::k_cat_feature_count};
+  std::string output_file_suffix{"_contig_freq.npy"};
+  std::string output_dir_full_set;
+  int64_t days{torchrec::criteo::k_days};
+  int64_t int_columns{torchrec::criteo::k_int_feature_count};
+  int64_t sparse_columns{torchrec::criteo::k_cat_feature_count};
+  int64_t random_seed{0};
+  std::string temp_dir;
+  int64_t num_buckets{0};
+  std::vector<std::string> positional;
+};
+
+Args parse_args(int argc, char** argv) {
+  Args args;
+  for (int i = 2; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) {
+        throw std::invalid_argument("missing value of " + std::string(arg));
+      }
+      return argv[++i];
+    };
+    if (arg == "--fake_label") {
+      args.fake_label = true;
+    } else if (arg == "--num_threads") {
+      args.num_threads = std::stoll(value());
+    } else if (arg == "--frequency_threshold") {
+      args.frequency_threshold = std::stoll(value());
+    } else if (arg == "--columns") {
+      args.columns = std::stoll(value());
+    } else if (arg == "--output_file_suffix") {
+      args.output_file_suffix = value();
+    } else if (arg == "--output_dir_full_set") {
+      args.output_dir_full_set = value();
+    } else if (arg == "--days") {
+      args.days = std::stoll(value());
+    } else if (arg == "--int_columns") {
+      args.int_columns = std::stoll(value());
+    } else if (arg == "--sparse_columns") {
+      args.sparse_columns = std::stoll(value());
+    } else if (arg == "--random_seed") {
+      args.random_seed = std::stoll(value());
+    } else if (arg == "--temp_dir") {
+      args.temp_dir = value();
+    } else if (arg == "--num_buckets") {
+      args.num_buckets = std::stoll(value());
+    } else if (arg.starts_with("--")) {
+      throw std::invalid_argument("unknown option " + std::string(arg));
+    } else {
+      args.positional.emplace_back(arg);
+    }
+  }
+  return args;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    print_usage();
+    return 1;
+  }
+  std::string_view command = argv[1];
+  try {
+    auto args = parse_args(argc, argv);
+    if (command == "tsv_to_npys" && args.positional.size() == 4) {
+      torchrec::criteo::tsv_to_npys(
+          args.positional[0],
+          args.positional[1],
+          args.positional[2],
+          args.positional[3],
+          args.fake_label,
+          args.num_threads);
+    } else if (
+        command == "sparse_to_contiguous" && args.positional.size() >= 2) {
+      torchrec::criteo::sparse_to_contiguous(
+          std::vector<std::string>(
+              args.positional.begin() + 1, args.positional.end()),
+          args.positional[0],
+          args.frequency_threshold,
+          args.columns,
+          args.output_file_suffix,
+          args.num_threads);
+    } else if (command == "shuffle" && args.positional.size() == 3) {
+      torchrec::criteo::shuffle(
+          args.positional[0],
+          args.positional[1],
+          args.positional[2],
+          args.output_dir_full_set,
+          args.days,
+          args.int_columns,
+          args.sparse_columns,
+          args.random_seed,
+          args.temp_dir,
+          args.num_buckets,
+          args.num_threads);
+    } else {
+      print_usage();
+      return 1;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
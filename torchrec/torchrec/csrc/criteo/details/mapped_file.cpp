@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <c10/util/Exception.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <torchrec/csrc/criteo/details/mapped_file.h>
+#include <unistd.h>
+#include <utility>
+
+namespace torchrec::criteo {
+
+MappedFile::MappedFile(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  TORCH_CHECK(fd >= 0, "cannot open ", path, ", errno ", errno);
+  struct stat st {};
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    TORCH_CHECK(false, "cannot stat ", path, ", errno ", errno);
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  bool mapped = map(fd, false);
+  close(fd);
+  TORCH_CHECK(mapped, "cannot mmap ", path, ", errno ", errno);
+  if (data_ != nullptr) {
+    madvise(data_, size_, MADV_SEQUENTIAL);
+  }
+}
+
+MappedFile::MappedFile(const std::string& path, size_t size) : size_(size) {
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  TORCH_CHECK(fd >= 0, "cannot create ", path, ", errno ", errno);
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    close(fd);
+    TORCH_CHECK(false, "cannot resize ", path, ", errno ", errno);
+  }
+  bool mapped = map(fd, true);
+  close(fd);
+  TORCH_CHECK(mapped, "cannot mmap ", path, ", errno ", errno);
+}
+
+bool MappedFile::map(int fd, bool writable) {
+  if (size_ == 0) {
+    return true;
+  }
+  int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void* ptr = mmap(nullptr, size_, prot, MAP_SHARED, fd, 0);
+  if (ptr == MAP_FAILED) {
+    return false;
+  }
+  data_ = reinterpret_cast<uint8_t*>(ptr);
+  return true;
+}
+
+MappedFile::MappedFile(MappedFile&& o) noexcept
+    : data_(std::exchange(o.data_, nullptr)),
+      size_(std::exchange(o.size_, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& o) noexcept {
+  if (this != &o) {
+    reset();
+    data_ = std::exchange(o.data_, nullptr);
+    size_ = std::exchange(o.size_, 0);
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  reset();
+}
+
+void MappedFile::reset() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+} // namespace torchrec::criteo
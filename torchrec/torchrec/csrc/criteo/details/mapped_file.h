@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace torchrec::criteo {
+
+/**
+ * MappedFile
+ *
+ * A whole file mapped into memory. Preprocessing reads and writes the
+ * dataset through the page cache instead of copying it through buffers, so
+ * that the threads can work on disjoint parts of one file.
+ */
+class MappedFile {
+ public:
+  MappedFile() = default;
+
+  /**
+   * Map an existing file read only.
+   */
+  explicit MappedFile(const std::string& path);
+
+  /**
+   * Create (or truncate) a file of `size` bytes and map it writable.
+   */
+  MappedFile(const std::string& path, size_t size);
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& o) noexcept;
+  MappedFile& operator=(MappedFile&& o) noexcept;
+  ~MappedFile();
+
+  [[nodiscard]] const uint8_t* data() const {
+    return data_;
+  }
+  [[nodiscard]] uint8_t* data() {
+    return data_;
+  }
+  [[nodiscard]] size_t size() const {
+    return size_;
+  }
+
+ private:
+  bool map(int fd, bool writable);
+  void reset();
+
+  uint8_t* data_{nullptr};
+  size_t size_{0};
+};
+
+} // namespace torchrec::criteo
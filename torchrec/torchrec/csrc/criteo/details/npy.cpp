@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <c10/util/Exception.h>
+#include <torchrec/csrc/criteo/details/npy.h>
+#include <charconv>
+#include <string>
+
+namespace torchrec::criteo {
+
+static constexpr std::string_view k_magic = "\x93NUMPY";
+// the same alignment as `numpy.lib.format.ARRAY_ALIGN`.
+static constexpr size_t k_array_align = 64;
+
+int64_t NpyHeader::numel() const {
+  int64_t n = 1;
+  for (auto dim : shape) {
+    n *= dim;
+  }
+  return n;
+}
+
+std::string npy_header(std::string_view descr, std::span<const int64_t> shape) {
+  std::string dict = "{'descr': '";
+  dict += descr;
+  dict += "', 'fortran_order': False, 'shape': (";
+  for (size_t i = 0; i < shape.size(); ++i) {
+    if (i != 0) {
+      dict += ", ";
+    }
+    dict += std::to_string(shape[i]);
+  }
+  if (shape.size() == 1) {
+    dict += ",";
+  }
+  dict += "), }";
+
+  // magic, version and the 2 bytes header length.
+  size_t prefix_len = k_magic.size() + 4;
+  size_t unaligned = (prefix_len + dict.size() + 1) % k_array_align;
+  size_t padding = (k_array_align - unaligned) % k_array_align;
+  dict.append(padding, ' ');
+  dict += '\n';
+  TORCH_CHECK(dict.size() <= UINT16_MAX, "npy header too long");
+
+  std::string header(k_magic);
+  header += '\x01';
+  header += '\x00';
+  header += static_cast<char>(dict.size() & 0xFF);
+  header += static_cast<char>(dict.size() >> 8);
+  header += dict;
+  return header;
+}
+
+// Returns the value of `'key': ` in the header dict.
+static std::string_view find_value(
+    std::string_view dict,
+    std::string_view key) {
+  std::string quoted = "'" + std::string(key) + "':";
+  auto pos = dict.find(quoted);
+  TORCH_CHECK(pos != std::string_view::npos, "npy header misses ", key);
+  auto value = dict.substr(pos + quoted.size());
+  while (!value.empty() && value.front() == ' ') {
+    value.remove_prefix(1);
+  }
+  return value;
+}
+
+NpyHeader parse_npy_header(std::string_view bytes) {
+  TORCH_CHECK(
+      bytes.size() >= k_magic.size() + 4 && bytes.starts_with(k_magic),
+      "not a npy file");
+  auto major = static_cast<uint8_t>(bytes[k_magic.size()]);
+  auto* len_bytes =
+      reinterpret_cast<const uint8_t*>(bytes.data() + k_magic.size() + 2);
+  size_t prefix_len;
+  size_t dict_len;
+  if (major == 1) {
+    prefix_len = k_magic.size() + 4;
+    dict_len = len_bytes[0] | (len_bytes[1] << 8);
+  } else {
+    TORCH_CHECK(major == 2 || major == 3, "unknown npy version ", major);
+    TORCH_CHECK(bytes.size() >= k_magic.size() + 6, "truncated npy header");
+    prefix_len = k_magic.size() + 6;
+    dict_len = len_bytes[0] | (len_bytes[1] << 8) | (len_bytes[2] << 16) |
+        (static_cast<size_t>(len_bytes[3]) << 24);
+  }
+  TORCH_CHECK(bytes.size() >= prefix_len + dict_len, "truncated npy header");
+  auto dict = bytes.substr(prefix_len, dict_len);
+
+  NpyHeader header;
+  header.data_offset = prefix_len + dict_len;
+
+  auto descr = find_value(dict, "descr");
+  TORCH_CHECK(descr.starts_with('\''), "unsupported npy descr");
+  header.descr = std::string(descr.substr(1, descr.find('\'', 1) - 1));
+
+  TORCH_CHECK(
+      find_value(dict, "fortran_order").starts_with("False"),
+      "fortran ordered npy is not supported");
+
+  auto shape = find_value(dict, "shape");
+  TORCH_CHECK(shape.starts_with('('), "invalid npy shape");
+  shape = shape.substr(1, shape.find(')') - 1);
+  while (!shape.empty()) {
+    while (!shape.empty() && (shape.front() == ' ' || shape.front() == ',')) {
+      shape.remove_prefix(1);
+    }
+    if (shape.empty()) {
+      break;
+    }
+    int64_t dim = 0;
+    auto [ptr, ec] =
+        std::from_chars(shape.data(), shape.data() + shape.size(), dim);
+    TORCH_CHECK(ec == std::errc(), "invalid npy shape");
+    header.shape.emplace_back(dim);
+    shape.remove_prefix(ptr - shape.data());
+  }
+  return header;
+}
+
+NpyArray map_npy(const std::string& path) {
+  NpyArray array{.file = MappedFile(path)};
+  array.header = parse_npy_header(std::string_view(
+      reinterpret_cast<const char*>(array.file.data()), array.file.size()));
+  auto item_size = std::stoul(array.header.descr.substr(2));
+  TORCH_CHECK(
+      array.file.size() >=
+          array.header.data_offset + array.header.numel() * item_size,
+      path,
+      " is truncated");
+  return array;
+}
+
+} // namespace torchrec::criteo
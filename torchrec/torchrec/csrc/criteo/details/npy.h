@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <torchrec/csrc/criteo/details/mapped_file.h>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace torchrec::criteo {
+
+/**
+ * The header of a C ordered npy array.
+ */
+struct NpyHeader {
+  // numpy dtype descr, e.g. "<i8" or "<f4".
+  std::string descr;
+  std::vector<int64_t> shape;
+  // offset of the array data from the beginning of the file.
+  size_t data_offset{0};
+
+  [[nodiscard]] int64_t numel() const;
+};
+
+template <typename T>
+constexpr std::string_view npy_descr();
+template <>
+constexpr std::string_view npy_descr<int32_t>() {
+  return "<i4";
+}
+template <>
+constexpr std::string_view npy_descr<int64_t>() {
+  return "<i8";
+}
+template <>
+constexpr std::string_view npy_descr<float>() {
+  return "<f4";
+}
+
+/**
+ * Returns the header bytes `np.save` writes for an array of `descr` and
+ * `shape`, i.e. npy format 1.0 padded to 64 bytes, so that the files are
+ * byte-identical to the ones written from python.
+ */
+std::string npy_header(std::string_view descr, std::span<const int64_t> shape);
+
+/**
+ * Parse the header at the beginning of npy `bytes`. Only C ordered arrays
+ * are supported.
+ */
+NpyHeader parse_npy_header(std::string_view bytes);
+
+/**
+ * A npy file mapped into memory.
+ */
+struct NpyArray {
+  MappedFile file;
+  NpyHeader header;
+
+  template <typename T>
+  [[nodiscard]] const T* data() const {
+    return reinterpret_cast<const T*>(file.data() + header.data_offset);
+  }
+
+  [[nodiscard]] int64_t rows() const {
+    return header.shape.empty() ? 1 : header.shape[0];
+  }
+};
+
+/**
+ * Map the npy file at `path` read only, and check that it holds the whole
+ * array.
+ */
+NpyArray map_npy(const std::string& path);
+
+} // namespace torchrec::criteo
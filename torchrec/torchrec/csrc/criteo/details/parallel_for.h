@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace torchrec::criteo {
+
+/**
+ * Call `fn(i)` for every `i` in `[0, n)` on at most `num_threads` threads.
+ * Tasks are handed out one by one, so uneven tasks still balance. The first
+ * exception thrown by a task is rethrown after all threads finish.
+ */
+template <typename F>
+void parallel_for(int64_t n, int64_t num_threads, F&& fn) {
+  num_threads = std::clamp<int64_t>(num_threads, 1, std::max<int64_t>(n, 1));
+  if (num_threads == 1) {
+    for (int64_t i = 0; i < n; ++i) {
+      fn(i);
+    }
+    return;
+  }
+
+  std::atomic<int64_t> next{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto worker = [&] {
+    try {
+      for (int64_t i = next++; i < n; i = next++) {
+        fn(i);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> guard(error_mutex);
+      if (error == nullptr) {
+        error = std::current_exception();
+      }
+      next = n;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (int64_t t = 1; t < num_threads; ++t) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+} // namespace torchrec::criteo
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <c10/util/Exception.h>
+#include <c10/util/flat_hash_map.h>
+#include <torchrec/csrc/criteo/details/mapped_file.h>
+#include <torchrec/csrc/criteo/details/npy.h>
+#include <torchrec/csrc/criteo/details/parallel_for.h>
+#include <torchrec/csrc/criteo/preprocess.h>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+namespace torchrec::criteo {
+
+// Each thread parses several ranges of the tsv file, so that a range of
+// long lines does not hold back the others.
+static constexpr int64_t k_ranges_per_thread = 4;
+// Number of dense values converted by one task.
+static constexpr int64_t k_dense_task_size = 1 << 20;
+
+namespace {
+
+// Iterate the non-empty lines in `text[begin, end)`, without line breaks.
+template <typename Callback>
+void for_each_line(
+    std::string_view text,
+    size_t begin,
+    size_t end,
+    Callback&& callback) {
+  while (begin < end) {
+    auto* nl = reinterpret_cast<const char*>(
+        memchr(text.data() + begin, '\n', end - begin));
+    size_t line_end = nl == nullptr ? end : nl - text.data();
+    auto line = text.substr(begin, line_end - begin);
+    if (line.ends_with('\r')) {
+      line.remove_suffix(1);
+    }
+    if (!line.empty()) {
+      callback(line);
+    }
+    begin = line_end + 1;
+  }
+}
+
+/**
+ * Splits a tsv line into fields.
+ */
+class FieldReader {
+ public:
+  explicit FieldReader(std::string_view line)
+      : ptr_(line.data()), end_(line.data() + line.size()) {}
+
+  std::string_view next() {
+    TORCH_CHECK(ptr_ <= end_, "too few columns in criteo tsv line");
+    auto* tab =
+        reinterpret_cast<const char*>(memchr(ptr_, '\t', end_ - ptr_));
+    auto* field_end = tab == nullptr ? end_ : tab;
+    std::string_view field(ptr_, field_end - ptr_);
+    ptr_ = field_end + 1;
+    return field;
+  }
+
+ private:
+  const char* ptr_;
+  const char* end_;
+};
+
+// Missing values are mapped to zero, the same as the python row mapper.
+template <typename T>
+T parse_field(std::string_view field, int base = 10) {
+  T value = 0;
+  if (field.empty()) {
+    return value;
+  }
+  auto [ptr, ec] =
+      std::from_chars(field.data(), field.data() + field.size(), value, base);
+  TORCH_CHECK(
+      ec == std::errc() && ptr == field.data() + field.size(),
+      "invalid criteo value ",
+      field);
+  return value;
+}
+
+std::string file_stem(const std::string& path) {
+  auto slash = path.find_last_of('/');
+  auto name = slash == std::string::npos ? path : path.substr(slash + 1);
+  return name.substr(0, name.find('.'));
+}
+
+} // namespace
+
+void tsv_to_npys(
+    const std::string& in_file,
+    const std::string& out_dense_file,
+    const std::string& out_sparse_file,
+    const std::string& out_labels_file,
+    bool fake_label,
+    int64_t num_threads) {
+  MappedFile in(in_file);
+  std::string_view text(reinterpret_cast<const char*>(in.data()), in.size());
+
+  // Split the file into ranges of whole lines.
+  int64_t num_ranges = std::max<int64_t>(num_threads, 1) * k_ranges_per_thread;
+  std::vector<size_t> bounds(num_ranges + 1, text.size());
+  bounds[0] = 0;
+  for (int64_t i = 1; i < num_ranges; ++i) {
+    size_t pos = std::max(text.size() * i / num_ranges, bounds[i - 1]);
+    auto nl = text.find('\n', pos);
+    bounds[i] = nl == std::string_view::npos ? text.size() : nl + 1;
+  }
+
+  std::vector<int64_t> row_offsets(num_ranges + 1, 0);
+  parallel_for(num_ranges, num_threads, [&](int64_t i) {
+    int64_t num_rows = 0;
+    for_each_line(
+        text, bounds[i], bounds[i + 1], [&](std::string_view) { ++num_rows; });
+    row_offsets[i + 1] = num_rows;
+  });
+  for (int64_t i = 0; i < num_ranges; ++i) {
+    row_offsets[i + 1] += row_offsets[i];
+  }
+  int64_t num_rows = row_offsets.back();
+
+  std::vector<int64_t> dense_shape{num_rows, k_int_feature_count};
+  std::vector<int64_t> sparse_shape{num_rows, k_cat_feature_count};
+  std::vector<int64_t> labels_shape{num_rows, 1};
+  auto dense_header = npy_header(npy_descr<float>(), dense_shape);
+  auto sparse_header = npy_header(npy_descr<int64_t>(), sparse_shape);
+  auto labels_header = npy_header(npy_descr<int32_t>(), labels_shape);
+  MappedFile dense_out(
+      out_dense_file,
+      dense_header.size() + num_rows * k_int_feature_count * sizeof(float));
+  MappedFile sparse_out(
+      out_sparse_file,
+      sparse_header.size() +
+          num_rows * k_cat_feature_count * sizeof(int64_t));
+  MappedFile labels_out(
+      out_labels_file, labels_header.size() + num_rows * sizeof(int32_t));
+  memcpy(dense_out.data(), dense_header.data(), dense_header.size());
+  memcpy(sparse_out.data(), sparse_header.data(), sparse_header.size());
+  memcpy(labels_out.data(), labels_header.data(), labels_header.size());
+
+  // The raw dense values are first stored as int32 in place of the floats,
+  // and converted once the minimum of the whole file is known.
+  auto* dense = reinterpret_cast<int32_t*>(
+      dense_out.data() + dense_header.size());
+  auto* sparse = reinterpret_cast<int64_t*>(
+      sparse_out.data() + sparse_header.size());
+  auto* labels = reinterpret_cast<int32_t*>(
+      labels_out.data() + labels_header.size());
+
+  std::vector<int32_t> range_min(
+      num_ranges, std::numeric_limits<int32_t>::max());
+  parallel_for(num_ranges, num_threads, [&](int64_t i) {
+    int64_t row = row_offsets[i];
+    int32_t min_value = std::numeric_limits<int32_t>::max();
+    for_each_line(
+        text, bounds[i], bounds[i + 1], [&](std::string_view line) {
+          FieldReader reader(line);
+          labels[row] = fake_label ? -1 : parse_field<int32_t>(reader.next());
+          int32_t* dense_row = dense + row * k_int_feature_count;
+          for (int64_t j = 0; j < k_int_feature_count; ++j) {
+            dense_row[j] = parse_field<int32_t>(reader.next());
+            min_value = std::min(min_value, dense_row[j]);
+          }
+          int64_t* sparse_row = sparse + row * k_cat_feature_count;
+          for (int64_t j = 0; j < k_cat_feature_count; ++j) {
+            sparse_row[j] =
+                static_cast<int64_t>(parse_field<uint64_t>(reader.next(), 16));
+          }
+          ++row;
+        });
+    range_min[i] = min_value;
+  });
+
+  if (num_rows == 0) {
+    return;
+  }
+
+  // dense = log(dense - min + 2), with the int32 wrap around of numpy.
+  int32_t min_value = *std::min_element(range_min.begin(), range_min.end());
+  auto shift = static_cast<uint32_t>(min_value) - 2U;
+  int64_t num_dense = num_rows * k_int_feature_count;
+  int64_t num_tasks = (num_dense + k_dense_task_size - 1) / k_dense_task_size;
+  parallel_for(num_tasks, num_threads, [&](int64_t task) {
+    int64_t begin = task * k_dense_task_size;
+    int64_t end = std::min(begin + k_dense_task_size, num_dense);
+    auto* dense_float = reinterpret_cast<float*>(dense);
+    for (int64_t i = begin; i < end; ++i) {
+      auto value =
+          static_cast<int32_t>(static_cast<uint32_t>(dense[i]) - shift);
+      dense_float[i] = std::log(static_cast<float>(value));
+    }
+  });
+}
+
+void sparse_to_contiguous(
+    const std::vector<std::string>& in_files,
+    const std::string& output_dir,
+    int64_t frequency_threshold,
+    int64_t columns,
+    const std::string& output_file_suffix,
+    int64_t num_threads) {
+  struct File {
+    NpyArray in;
+    MappedFile out;
+    const int64_t* in_data;
+    int64_t* out_data;
+    int64_t num_rows;
+    int64_t num_columns;
+  };
+
+  std::vector<File> files;
+  files.reserve(in_files.size());
+  int64_t max_columns = 0;
+  for (auto& in_file : in_files) {
+    auto in = map_npy(in_file);
+    auto& shape = in.header.shape;
+    TORCH_CHECK(
+        in.header.descr == npy_descr<int64_t>(),
+        in_file,
+        " is not an int64 npy file");
+    TORCH_CHECK(shape.size() == 2, in_file, " is not a 2-d array");
+    TORCH_CHECK(
+        shape[1] >= columns, in_file, " has only ", shape[1], " columns");
+
+    auto out_header = npy_header(npy_descr<int64_t>(), shape);
+    MappedFile out(
+        output_dir + "/" + file_stem(in_file) + output_file_suffix,
+        out_header.size() + in.header.numel() * sizeof(int64_t));
+    memcpy(out.data(), out_header.data(), out_header.size());
+
+    File file{
+        .in_data = in.data<int64_t>(),
+        .out_data = reinterpret_cast<int64_t*>(out.data() + out_header.size()),
+        .num_rows = shape[0],
+        .num_columns = shape[1],
+    };
+    file.in = std::move(in);
+    file.out = std::move(out);
+    max_columns = std::max(max_columns, file.num_columns);
+    files.emplace_back(std::move(file));
+  }
+
+  // Visit column `col` of all files in order.
+  auto for_each_value = [&](int64_t col, auto&& callback) {
+    for (auto& file : files) {
+      if (col >= file.num_columns) {
+        continue;
+      }
+      const int64_t* in = file.in_data + col;
+      int64_t* out = file.out_data + col;
+      for (int64_t row = 0; row < file.num_rows; ++row) {
+        callback(in[row * file.num_columns], out[row * file.num_columns]);
+      }
+    }
+  };
+
+  parallel_for(max_columns, num_threads, [&](int64_t col) {
+    if (col >= columns) {
+      for_each_value(col, [](int64_t value, int64_t& out) { out = value; });
+      return;
+    }
+
+    // The contiguous ids start at 2, so that infrequent ids can be 1.
+    int64_t next_id = 2;
+    ska::flat_hash_map<int64_t, int64_t> ids;
+    if (frequency_threshold <= 1) {
+      for_each_value(col, [&](int64_t value, int64_t& out) {
+        auto [it, inserted] = ids.try_emplace(value, next_id);
+        next_id += inserted;
+        out = it->second;
+      });
+      return;
+    }
+
+    // Count the frequencies and remember the order of first appearance,
+    // which decides the contiguous ids.
+    std::vector<int64_t> order;
+    for_each_value(col, [&](int64_t value, int64_t&) {
+      auto [it, inserted] = ids.try_emplace(value, 0);
+      if (inserted) {
+        order.emplace_back(value);
+      }
+      ++it->second;
+    });
+    for (auto value : order) {
+      auto& id = ids[value];
+      id = id < frequency_threshold ? 1 : next_id++;
+    }
+    for_each_value(col, [&](int64_t value, int64_t& out) {
+      out = ids.find(value)->second;
+    });
+  });
+}
+
+} // namespace torchrec::criteo
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace torchrec::criteo {
+
+static constexpr int64_t k_int_feature_count = 13;
+static constexpr int64_t k_cat_feature_count = 26;
+static constexpr int64_t k_frequency_threshold = 3;
+static constexpr int64_t k_days = 24;
+
+inline int64_t default_num_threads() {
+  return std::max<int64_t>(std::thread::hardware_concurrency(), 1);
+}
+
+/**
+ * Native version of `BinaryCriteoUtils.tsv_to_npys`.
+ *
+ * Convert one Criteo tsv file to the dense (float32), sparse (int64) and
+ * labels (int32) npy files. The file is mapped into memory, split into one
+ * range of lines per thread, and parsed straight into the mapped output
+ * files.
+ *
+ * @param fake_label the file has no label column and all labels are -1,
+ * e.g. the test set of criteo_kaggle.
+ */
+void tsv_to_npys(
+    const std::string& in_file,
+    const std::string& out_dense_file,
+    const std::string& out_sparse_file,
+    const std::string& out_labels_file,
+    bool fake_label = false,
+    int64_t num_threads = default_num_threads());
+
+/**
+ * Native version of `BinaryCriteoUtils.sparse_to_contiguous`.
+ *
+ * Remap the ids of each of the first `columns` columns of the sparse npy
+ * files to contiguous ids starting at 2, in the order they first appear.
+ * Ids appearing less than `frequency_threshold` times are mapped to 1. The
+ * outputs are written to `output_dir/<name><output_file_suffix>`, and are
+ * byte-identical to the ones of the python version.
+ *
+ * Columns are independent, so each thread owns whole columns and its own
+ * hash maps, and no locking is needed.
+ */
+void sparse_to_contiguous(
+    const std::vector<std::string>& in_files,
+    const std::string& output_dir,
+    int64_t frequency_threshold = k_frequency_threshold,
+    int64_t columns = k_cat_feature_count,
+    const std::string& output_file_suffix = "_contig_freq.npy",
+    int64_t num_threads = default_num_threads());
+
+/**
+ * Native, out-of-core version of `BinaryCriteoUtils.shuffle`.
+ *
+ * Shuffle the rows of the first `days - 1` days, and copy the last day as it
+ * is. Every row gets a random key from `random_seed` and its global row
+ * index. Rows are first scattered by key range into `num_buckets` temporary
+ * files under `temp_dir`. Each bucket is then sorted by key and written to
+ * its place in the output day files. Sorting by random keys is a uniform
+ * shuffle, and the memory needed is only `num_threads` buckets, and up to
+ * 512 MB of rows waiting to be appended to the bucket files. Only the bucket
+ * being appended to is open, so any number of buckets can be used.
+ *
+ * The inputs are `day_{d}_{dense,labels}.npy` in `input_dir_labels_and_dense`
+ * and `day_{d}_sparse.npy` (int32 or int64) in `input_dir_sparse`. The
+ * outputs have the same names and the dtypes of the python version, i.e.
+ * float32 dense, int32 sparse and int32 labels. The sparse ids are copied
+ * exactly instead of going through float32.
+ *
+ * @param output_dir_full_set if not empty, also write the unshuffled
+ * training days to `full.npy` as float32, as the python version does.
+ * @param temp_dir directory of the buckets, `output_dir_shuffled` if empty.
+ * @param num_buckets number of buckets, chosen by the dataset size if 0.
+ */
+void shuffle(
+    const std::string& input_dir_labels_and_dense,
+    const std::string& input_dir_sparse,
+    const std::string& output_dir_shuffled,
+    const std::string& output_dir_full_set = "",
+    int64_t days = k_days,
+    int64_t int_columns = k_int_feature_count,
+    int64_t sparse_columns = k_cat_feature_count,
+    int64_t random_seed = 0,
+    const std::string& temp_dir = "",
+    int64_t num_buckets = 0,
+    int64_t num_threads = default_num_threads());
+
+} // namespace torchrec::criteo
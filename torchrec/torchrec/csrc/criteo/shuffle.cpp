@@ -0,0 +1,453 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <c10/util/Exception.h>
+#include <fcntl.h>
+#include <torchrec/csrc/criteo/details/mapped_file.h>
+#include <torchrec/csrc/criteo/details/npy.h>
+#include <torchrec/csrc/criteo/details/parallel_for.h>
+#include <torchrec/csrc/criteo/preprocess.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+
+namespace torchrec::criteo {
+
+// Size of a bucket when `num_buckets` is not given. Every thread loads one
+// bucket into memory at a time.
+static constexpr int64_t k_bucket_bytes = 256L << 20;
+// Number of rows scattered to the buckets by one task.
+static constexpr int64_t k_scatter_task_rows = 1 << 18;
+// Memory of the rows waiting to be appended to all the buckets. A bucket is
+// only opened to append its waiting rows, so the number of open files does
+// not grow with the number of buckets.
+static constexpr int64_t k_bucket_buffer_bytes = 512L << 20;
+static constexpr int64_t k_max_bucket_append_bytes = 4L << 20;
+
+namespace {
+
+uint64_t splitmix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/**
+ * A row in a bucket file: the random key of the row, followed by the dense
+ * values, the sparse ids and the label, 4 bytes each.
+ */
+struct RowLayout {
+  int64_t int_columns;
+  int64_t sparse_columns;
+
+  [[nodiscard]] size_t bytes() const {
+    return sizeof(uint64_t) + (int_columns + sparse_columns + 1) * 4;
+  }
+  [[nodiscard]] size_t dense_offset() const {
+    return sizeof(uint64_t);
+  }
+  [[nodiscard]] size_t sparse_offset() const {
+    return dense_offset() + int_columns * sizeof(float);
+  }
+  [[nodiscard]] size_t label_offset() const {
+    return sparse_offset() + sparse_columns * sizeof(int32_t);
+  }
+};
+
+struct InputDay {
+  NpyArray dense;
+  NpyArray sparse;
+  NpyArray labels;
+  // global index of the first row of the day.
+  int64_t first_row;
+};
+
+struct OutputDay {
+  MappedFile dense_file;
+  MappedFile sparse_file;
+  MappedFile labels_file;
+  float* dense;
+  int32_t* sparse;
+  int32_t* labels;
+};
+
+std::string day_file(
+    const std::string& dir,
+    int64_t day,
+    const std::string& part) {
+  return dir + "/day_" + std::to_string(day) + "_" + part + ".npy";
+}
+
+class FileDescriptor {
+ public:
+  FileDescriptor(const std::string& path, int flags)
+      : fd_(open(path.c_str(), flags, 0644)) {
+    TORCH_CHECK(fd_ >= 0, "cannot open ", path, ", errno ", errno);
+  }
+
+  FileDescriptor(const FileDescriptor&) = delete;
+  FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+  ~FileDescriptor() {
+    close(fd_);
+  }
+
+  [[nodiscard]] int get() const {
+    return fd_;
+  }
+
+ private:
+  int fd_;
+};
+
+/**
+ * Removes the temporary files that are left, including when the shuffle
+ * throws.
+ */
+class TempFiles {
+ public:
+  TempFiles() = default;
+  TempFiles(const TempFiles&) = delete;
+  TempFiles& operator=(const TempFiles&) = delete;
+
+  ~TempFiles() {
+    for (auto& path : paths_) {
+      std::error_code ec;
+      std::filesystem::remove(path, ec);
+    }
+  }
+
+  void add(std::string path) {
+    paths_.emplace_back(std::move(path));
+  }
+
+  [[nodiscard]] const std::string& operator[](size_t i) const {
+    return paths_[i];
+  }
+
+ private:
+  std::vector<std::string> paths_;
+};
+
+/**
+ * The rows scattered to a bucket file, which are appended to it once they
+ * reach `append_bytes`.
+ */
+struct Bucket {
+  std::mutex mutex;
+  std::vector<uint8_t> pending;
+  int64_t rows = 0;
+};
+
+void write_all(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    auto written = write(fd, data, size);
+    TORCH_CHECK(written > 0, "cannot write bucket, errno ", errno);
+    data += written;
+    size -= written;
+  }
+}
+
+void append_pending(Bucket& bucket, const std::string& path) {
+  if (bucket.pending.empty()) {
+    return;
+  }
+  FileDescriptor fd(path, O_WRONLY | O_APPEND);
+  write_all(fd.get(), bucket.pending.data(), bucket.pending.size());
+  bucket.pending.clear();
+}
+
+// Create an npy file of `shape` and return the pointer to its data.
+template <typename T>
+T* create_npy(
+    MappedFile& file,
+    const std::string& path,
+    const std::vector<int64_t>& shape) {
+  auto header = npy_header(npy_descr<T>(), shape);
+  int64_t numel = 1;
+  for (auto dim : shape) {
+    numel *= dim;
+  }
+  file = MappedFile(path, header.size() + numel * sizeof(T));
+  memcpy(file.data(), header.data(), header.size());
+  return reinterpret_cast<T*>(file.data() + header.size());
+}
+
+} // namespace
+
+void shuffle(
+    const std::string& input_dir_labels_and_dense,
+    const std::string& input_dir_sparse,
+    const std::string& output_dir_shuffled,
+    const std::string& output_dir_full_set,
+    int64_t days,
+    int64_t int_columns,
+    int64_t sparse_columns,
+    int64_t random_seed,
+    const std::string& temp_dir,
+    int64_t num_buckets,
+    int64_t num_threads) {
+  TORCH_CHECK(days >= 1, "need at least one day");
+  RowLayout layout{
+      .int_columns = int_columns, .sparse_columns = sparse_columns};
+
+  std::vector<InputDay> inputs;
+  int64_t total_rows = 0;
+  for (int64_t d = 0; d < days - 1; ++d) {
+    InputDay day{
+        .dense = map_npy(day_file(input_dir_labels_and_dense, d, "dense")),
+        .sparse = map_npy(day_file(input_dir_sparse, d, "sparse")),
+        .labels = map_npy(day_file(input_dir_labels_and_dense, d, "labels")),
+        .first_row = total_rows,
+    };
+    int64_t rows = day.dense.rows();
+    TORCH_CHECK(
+        day.dense.header.descr == npy_descr<float>() &&
+            day.dense.header.numel() == rows * int_columns,
+        "day ",
+        d,
+        " dense should be float32 of ",
+        int_columns,
+        " columns");
+    TORCH_CHECK(
+        (day.sparse.header.descr == npy_descr<int64_t>() ||
+         day.sparse.header.descr == npy_descr<int32_t>()) &&
+            day.sparse.rows() == rows &&
+            day.sparse.header.numel() == rows * sparse_columns,
+        "day ",
+        d,
+        " sparse should be int32 or int64 of ",
+        sparse_columns,
+        " columns");
+    TORCH_CHECK(
+        day.labels.header.descr == npy_descr<int32_t>() &&
+            day.labels.header.numel() == rows,
+        "day ",
+        d,
+        " labels should be int32 of one column");
+    total_rows += rows;
+    inputs.emplace_back(std::move(day));
+  }
+
+  if (num_buckets <= 0) {
+    num_buckets = 1 +
+        total_rows * static_cast<int64_t>(layout.bytes()) / k_bucket_bytes;
+  }
+  auto bucket_dir = temp_dir.empty() ? output_dir_shuffled : temp_dir;
+  TempFiles bucket_paths;
+  for (int64_t b = 0; b < num_buckets; ++b) {
+    bucket_paths.add(
+        bucket_dir + "/shuffle_bucket_" + std::to_string(b) + ".bin");
+    // Created empty, the rows are appended during the scatter.
+    FileDescriptor(bucket_paths[b], O_WRONLY | O_CREAT | O_TRUNC);
+  }
+  std::vector<Bucket> buckets(num_buckets);
+  size_t append_bytes = std::clamp<int64_t>(
+      k_bucket_buffer_bytes / num_buckets,
+      layout.bytes(),
+      k_max_bucket_append_bytes);
+
+  int64_t full_columns = int_columns + sparse_columns + 1;
+  MappedFile full_file;
+  float* full = nullptr;
+  if (!output_dir_full_set.empty()) {
+    full = create_npy<float>(
+        full_file,
+        output_dir_full_set + "/full.npy",
+        {total_rows, full_columns});
+  }
+
+  // Scatter: keys are unique since splitmix64 is a bijection, and a bucket
+  // holds a range of keys, so concatenating the sorted buckets sorts all
+  // the rows by key.
+  uint64_t seed = splitmix64(static_cast<uint64_t>(random_seed));
+  auto key_of = [seed](int64_t row) {
+    return splitmix64(seed + static_cast<uint64_t>(row));
+  };
+  auto bucket_of = [num_buckets](uint64_t key) {
+    return static_cast<int64_t>(
+        (static_cast<unsigned __int128>(key) * num_buckets) >> 64);
+  };
+
+  std::vector<std::pair<int64_t, int64_t>> scatter_tasks;
+  for (int64_t d = 0; d < static_cast<int64_t>(inputs.size()); ++d) {
+    for (int64_t begin = 0; begin < inputs[d].dense.rows();
+         begin += k_scatter_task_rows) {
+      scatter_tasks.emplace_back(d, begin);
+    }
+  }
+
+  parallel_for(scatter_tasks.size(), num_threads, [&](int64_t task) {
+    auto [d, begin] = scatter_tasks[task];
+    auto& day = inputs[d];
+    int64_t n = std::min(k_scatter_task_rows, day.dense.rows() - begin);
+    bool sparse_int64 = day.sparse.header.descr == npy_descr<int64_t>();
+
+    // Counting sort the rows by bucket, so that a bucket is written at once.
+    std::vector<int64_t> row_buckets(n);
+    std::vector<int64_t> offsets(num_buckets + 1, 0);
+    for (int64_t i = 0; i < n; ++i) {
+      row_buckets[i] = bucket_of(key_of(day.first_row + begin + i));
+      ++offsets[row_buckets[i] + 1];
+    }
+    for (int64_t b = 0; b < num_buckets; ++b) {
+      offsets[b + 1] += offsets[b];
+    }
+    std::vector<int64_t> cursors(offsets.begin(), offsets.end() - 1);
+
+    std::vector<uint8_t> buffer(n * layout.bytes());
+    for (int64_t i = 0; i < n; ++i) {
+      int64_t row = begin + i;
+      uint8_t* dst =
+          buffer.data() + cursors[row_buckets[i]]++ * layout.bytes();
+      uint64_t key = key_of(day.first_row + row);
+      memcpy(dst, &key, sizeof(key));
+
+      const float* dense = day.dense.data<float>() + row * int_columns;
+      memcpy(dst + layout.dense_offset(), dense, int_columns * sizeof(float));
+      auto* sparse = reinterpret_cast<int32_t*>(dst + layout.sparse_offset());
+      if (sparse_int64) {
+        const int64_t* src =
+            day.sparse.data<int64_t>() + row * sparse_columns;
+        for (int64_t j = 0; j < sparse_columns; ++j) {
+          sparse[j] = static_cast<int32_t>(src[j]);
+        }
+      } else {
+        memcpy(
+            sparse,
+            day.sparse.data<int32_t>() + row * sparse_columns,
+            sparse_columns * sizeof(int32_t));
+      }
+      int32_t label = day.labels.data<int32_t>()[row];
+      memcpy(dst + layout.label_offset(), &label, sizeof(label));
+
+      if (full != nullptr) {
+        float* full_row = full + (day.first_row + row) * full_columns;
+        std::copy_n(dense, int_columns, full_row);
+        for (int64_t j = 0; j < sparse_columns; ++j) {
+          full_row[int_columns + j] = static_cast<float>(sparse[j]);
+        }
+        full_row[full_columns - 1] = static_cast<float>(label);
+      }
+    }
+
+    for (int64_t b = 0; b < num_buckets; ++b) {
+      int64_t count = offsets[b + 1] - offsets[b];
+      if (count == 0) {
+        continue;
+      }
+      auto& bucket = buckets[b];
+      const uint8_t* rows = buffer.data() + offsets[b] * layout.bytes();
+      std::lock_guard<std::mutex> guard(bucket.mutex);
+      bucket.pending.insert(
+          bucket.pending.end(), rows, rows + count * layout.bytes());
+      bucket.rows += count;
+      if (bucket.pending.size() >= append_bytes) {
+        append_pending(bucket, bucket_paths[b]);
+      }
+    }
+  });
+  parallel_for(num_buckets, num_threads, [&](int64_t b) {
+    append_pending(buckets[b], bucket_paths[b]);
+    buckets[b].pending = std::vector<uint8_t>();
+  });
+  full_file = MappedFile();
+
+  std::vector<OutputDay> outputs(inputs.size());
+  std::vector<int64_t> day_first_rows;
+  for (size_t d = 0; d < inputs.size(); ++d) {
+    auto& out = outputs[d];
+    int64_t rows = inputs[d].dense.rows();
+    out.dense = create_npy<float>(
+        out.dense_file,
+        day_file(output_dir_shuffled, d, "dense"),
+        {rows, int_columns});
+    out.sparse = create_npy<int32_t>(
+        out.sparse_file,
+        day_file(output_dir_shuffled, d, "sparse"),
+        {rows, sparse_columns});
+    out.labels = create_npy<int32_t>(
+        out.labels_file,
+        day_file(output_dir_shuffled, d, "labels"),
+        {rows, 1});
+    day_first_rows.emplace_back(inputs[d].first_row);
+  }
+  day_first_rows.emplace_back(total_rows);
+  // Release the inputs, which may share the page cache with the outputs.
+  inputs.clear();
+
+  std::vector<int64_t> bucket_offsets(num_buckets + 1, 0);
+  for (int64_t b = 0; b < num_buckets; ++b) {
+    bucket_offsets[b + 1] = bucket_offsets[b] + buckets[b].rows;
+  }
+
+  // Gather: sort each bucket by key and write the rows to their positions.
+  parallel_for(num_buckets, num_threads, [&](int64_t b) {
+    {
+      MappedFile bucket(bucket_paths[b]);
+      int64_t n = buckets[b].rows;
+      TORCH_CHECK(
+          bucket.size() == static_cast<size_t>(n) * layout.bytes(),
+          "bucket ",
+          b,
+          " is corrupted");
+      std::vector<std::pair<uint64_t, int64_t>> order(n);
+      for (int64_t i = 0; i < n; ++i) {
+        memcpy(
+            &order[i].first,
+            bucket.data() + i * layout.bytes(),
+            sizeof(uint64_t));
+        order[i].second = i;
+      }
+      std::sort(order.begin(), order.end());
+
+      int64_t pos = bucket_offsets[b];
+      auto d = std::upper_bound(
+                   day_first_rows.begin(), day_first_rows.end(), pos) -
+          day_first_rows.begin() - 1;
+      for (auto& [key, i] : order) {
+        while (pos >= day_first_rows[d + 1]) {
+          ++d;
+        }
+        auto& out = outputs[d];
+        int64_t row = pos - day_first_rows[d];
+        const uint8_t* src = bucket.data() + i * layout.bytes();
+        memcpy(
+            out.dense + row * int_columns,
+            src + layout.dense_offset(),
+            int_columns * sizeof(float));
+        memcpy(
+            out.sparse + row * sparse_columns,
+            src + layout.sparse_offset(),
+            sparse_columns * sizeof(int32_t));
+        memcpy(
+            out.labels + row,
+            src + layout.label_offset(),
+            sizeof(int32_t));
+        ++pos;
+      }
+    }
+    std::filesystem::remove(bucket_paths[b]);
+  });
+
+  // The last day is the validation and test set, and is kept as it is.
+  for (auto [part, input_dir] :
+       {std::pair<std::string, std::string>{"sparse", input_dir_sparse},
+        {"dense", input_dir_labels_and_dense},
+        {"labels", input_dir_labels_and_dense}}) {
+    std::filesystem::copy_file(
+        day_file(input_dir, days - 1, part),
+        day_file(output_dir_shuffled, days - 1, part),
+        std::filesystem::copy_options::overwrite_existing);
+  }
+}
+
+} // namespace torchrec::criteo
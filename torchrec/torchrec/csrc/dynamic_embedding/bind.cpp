@@ -9,8 +9,10 @@
 #include <torch/torch.h>
 
 #include <torchrec/csrc/dynamic_embedding/details/io_registry.h>
+#include <torchrec/csrc/dynamic_embedding/fetch_coalescer.h>
 #include <torchrec/csrc/dynamic_embedding/id_transformer_wrapper.h>
 #include <torchrec/csrc/dynamic_embedding/ps.h>
+#include <torchrec/csrc/dynamic_embedding/static_id_transformer_wrapper.h>
 
 namespace torchrec {
 TORCH_LIBRARY(tde, m) {
@@ -20,20 +22,44 @@ TORCH_LIBRARY(tde, m) {
 
   m.class_<TransformResult>("TransformResult")
       .def_readonly("success", &TransformResult::success)
-      .def_readonly("ids_to_fetch", &TransformResult::ids_to_fetch);
+      .def_readonly("ids_to_fetch", &TransformResult::ids_to_fetch)
+      .def_readonly("num_fallback", &TransformResult::num_fallback);
 
   m.class_<IDTransformerWrapper>("IDTransformer")
-      .def(torch::init<int64_t, std::string, std::string, int64_t>())
+      .def(
+          torch::init<int64_t, std::string, std::string, int64_t, int64_t>(),
+          "",
+          {torch::arg("num_embedding"),
+           torch::arg("id_transformer_type"),
+           torch::arg("lxu_strategy_type"),
+           torch::arg("min_used_freq_power") = 5,
+           torch::arg("num_fallback_rows") = 0})
       .def("transform", &IDTransformerWrapper::transform)
       .def("evict", &IDTransformerWrapper::evict)
       .def("save", &IDTransformerWrapper::save);
 
+  m.class_<StaticIDTransformerWrapper>("StaticIDTransformer")
+      .def(torch::init<int64_t, int64_t>())
+      .def("load", &StaticIDTransformerWrapper::load)
+      .def("transform", &StaticIDTransformerWrapper::transform)
+      .def("size", &StaticIDTransformerWrapper::size);
+
   m.class_<LocalShardList>("LocalShardList")
       .def(torch::init([]() { return c10::make_intrusive<LocalShardList>(); }))
       .def("append", &LocalShardList::emplace_back);
 
   m.class_<FetchHandle>("FetchHandle").def("wait", &FetchHandle::wait);
 
+  m.class_<StepFetchHandle>("StepFetchHandle")
+      .def("wait", &StepFetchHandle::wait);
+
+  m.class_<FetchCoalescer>("FetchCoalescer")
+      .def(
+          torch::init<int64_t>(),
+          "",
+          {torch::arg("max_ids_per_request") = 1 << 20})
+      .def("flush", &FetchCoalescer::flush);
+
   m.class_<PS>("PS")
       .def(torch::init<
            std::string,
@@ -43,6 +69,8 @@ TORCH_LIBRARY(tde, m) {
            std::string,
            int64_t>())
       .def("fetch", &PS::fetch)
-      .def("evict", &PS::evict);
+      .def("stage_fetch", &PS::stage_fetch)
+      .def("evict", &PS::evict)
+      .def("io_stats", &PS::io_stats);
 }
 } // namespace torchrec
@@ -8,6 +8,7 @@
 
 #pragma once
 #include <stdint.h>
+#include <torchrec/csrc/dynamic_embedding/details/memory_policy.h>
 #include <memory>
 
 namespace torchrec {
@@ -20,7 +21,7 @@ namespace torchrec {
  */
 template <typename T = uint32_t>
 struct Bitmap {
-  explicit Bitmap(int64_t num_bits);
+  explicit Bitmap(int64_t num_bits, const MemoryPolicy& policy = {});
   Bitmap(const Bitmap&) = delete;
   Bitmap(Bitmap&&) noexcept = default;
 
@@ -44,7 +45,7 @@ struct Bitmap {
 
   const int64_t num_total_bits_;
   const int64_t num_values_;
-  std::unique_ptr<T[]> values_;
+  policy_unique_ptr<T> values_;
 
   int64_t next_free_bit_;
 };
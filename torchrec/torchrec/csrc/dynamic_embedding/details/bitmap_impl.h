@@ -13,10 +13,10 @@
 namespace torchrec {
 
 template <typename T>
-inline Bitmap<T>::Bitmap(int64_t num_bits)
+inline Bitmap<T>::Bitmap(int64_t num_bits, const MemoryPolicy& policy)
     : num_total_bits_(num_bits),
       num_values_((num_bits + num_bits_per_value - 1) / num_bits_per_value),
-      values_(new T[num_values_]),
+      values_(make_policy_unique<T>(policy, num_values_)),
       next_free_bit_(0) {
   std::fill(values_.get(), values_.get() + num_values_, -1);
 }
@@ -28,12 +28,11 @@ inline int64_t Bitmap<T>::next_free_bit() {
   T value = values_[offset];
   // set the last 1 bit to zero
   values_[offset] = value & (value - 1);
-  while (values_[offset] == 0 && offset < num_values_) {
+  while (offset < num_values_ && values_[offset] == 0) {
     offset++;
   }
-  value = values_[offset];
-  if (C10_LIKELY(value)) {
-    next_free_bit_ = offset * num_bits_per_value + ctz(value);
+  if (C10_LIKELY(offset < num_values_)) {
+    next_free_bit_ = offset * num_bits_per_value + ctz(values_[offset]);
   } else {
     next_free_bit_ = num_total_bits_;
   }
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stdint.h>
+
+namespace torchrec {
+
+// murmur3 finalizer
+inline uint64_t mix_global_id(int64_t global_id) {
+  auto x = static_cast<uint64_t>(global_id);
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+/**
+ * The cache rows used for global ids that have no cache row of their own.
+ * Such a global id is mapped to `begin + hash(global_id) % size`, so
+ * `size == 1` means a single default row.
+ */
+struct FallbackRows {
+  int64_t begin{0};
+  int64_t size{1};
+
+  [[nodiscard]] int64_t row_of(int64_t global_id) const {
+    return begin +
+        static_cast<int64_t>(
+               mix_global_id(global_id) % static_cast<uint64_t>(size));
+  }
+};
+
+} // namespace torchrec
@@ -11,6 +11,7 @@
 #include <functional>
 #include <span>
 #include <type_traits>
+#include <vector>
 
 namespace torchrec {
 
@@ -68,6 +69,55 @@ class IDTransformer {
    * @return the iterator created.
    */
   virtual iterator_t iterator() const = 0;
+
+  /**
+   * The number of global ids mapped to the fallback rows by `transform` so
+   * far, instead of rows of their own. Zero if the transformer has no
+   * fallback rows.
+   */
+  [[nodiscard]] virtual int64_t num_fallback_ids() const {
+    return 0;
+  }
+
+  /**
+   * Export all records in chunks of struct-of-arrays layout. Compared to
+   * `iterator`, it costs one indirect call per chunk instead of per record.
+   *
+   * @param visitor called on every chunk, the chunk is only valid during the
+   * call.
+   * @param chunk_size max number of records per chunk.
+   */
+  virtual void export_records(
+      const chunk_visitor_t& visitor,
+      size_t chunk_size = k_export_chunk_size) const {
+    std::vector<int64_t> global_ids;
+    std::vector<int64_t> cache_ids;
+    std::vector<lxu_record_t> lxu_records;
+    auto flush = [&] {
+      visitor(record_chunk_t{
+          .global_ids = global_ids,
+          .cache_ids = cache_ids,
+          .lxu_records = lxu_records,
+      });
+      global_ids.clear();
+      cache_ids.clear();
+      lxu_records.clear();
+    };
+    auto iter = iterator();
+    for (auto record = iter(); record.has_value(); record = iter()) {
+      global_ids.emplace_back(record->global_id);
+      cache_ids.emplace_back(record->cache_id);
+      lxu_records.emplace_back(record->lxu_record);
+      if (global_ids.size() == chunk_size) {
+        flush();
+      }
+    }
+    if (!global_ids.empty()) {
+      flush();
+    }
+  }
+
+  static constexpr size_t k_export_chunk_size = 4096;
 };
 
 } // namespace torchrec
@@ -6,7 +6,10 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <c10/util/flat_hash_map.h>
 #include <torchrec/csrc/dynamic_embedding/details/io.h>
+#include <atomic>
+#include <mutex>
 
 namespace torchrec {
 
@@ -25,6 +28,28 @@ IO::IO(const std::string& config) {
   instance_ = provider_.initialize(rest_cfg.c_str());
 }
 
+std::shared_ptr<IO> IO::get(const std::string& config) {
+  static std::mutex mu;
+  static ska::flat_hash_map<std::string, std::weak_ptr<IO>> instances;
+  std::lock_guard<std::mutex> guard(mu);
+  // Drop the configs whose instance was released, so that the map does not
+  // grow with every config ever used.
+  for (auto it = instances.begin(); it != instances.end();) {
+    if (it->second.expired()) {
+      it = instances.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  auto& instance = instances[config];
+  auto io = instance.lock();
+  if (io == nullptr) {
+    io = std::make_shared<IO>(config);
+    instance = io;
+  }
+  return io;
+}
+
 IO::~IO() {
   if (instance_ == nullptr) {
     return;
@@ -84,6 +109,11 @@ void IO::fetch(
     uint32_t num_optimizer_states,
     torch::ScalarType type,
     std::function<void(std::vector<torch::Tensor>)> on_fetch_complete) {
+  TORCH_CHECK(
+      provider_.fetch != nullptr,
+      "IO provider ",
+      provider_.type,
+      " only supports fetch_v2");
   std::unique_ptr<FetchContext> ctx(new FetchContext{
       .on_complete = std::move(on_fetch_complete),
       .scalar_type = type,
@@ -125,6 +155,11 @@ void IO::push(
     std::span<const uint8_t> data,
     std::span<const uint64_t> offsets,
     std::function<void()> on_push_complete) {
+  TORCH_CHECK(
+      provider_.push != nullptr,
+      "IO provider ",
+      provider_.type,
+      " only supports push_v2");
   std::unique_ptr<PushContext> ctx(new PushContext{
       .on_push_complete_ = std::move(on_push_complete),
   });
@@ -145,4 +180,330 @@ void IO::push(
   provider_.push(instance_, param);
 }
 
+/**
+ * The context of a v2 request. The handle returned to the caller points to it.
+ */
+struct RequestContextV2 {
+  enum State : uint8_t {
+    k_running,
+    k_cancelled,
+    k_finished,
+  };
+
+  RequestContextV2(std::function<void(int32_t)> on_complete, bool adapted)
+      : on_complete(std::move(on_complete)), adapted(adapted) {}
+  virtual ~RequestContextV2() = default;
+
+  // Claims a running request for the cancellation. Fails once it finishes.
+  bool try_cancel() {
+    State expected = k_running;
+    return state.compare_exchange_strong(expected, k_cancelled);
+  }
+
+  // Claims the request for the completion, returns whether it was cancelled.
+  bool claim_completion() {
+    return state.exchange(k_finished) == k_cancelled;
+  }
+
+  bool cancelled() const {
+    return state == k_cancelled;
+  }
+
+  std::function<void(int32_t)> on_complete;
+  // whether the request is emulated by the v1 API of the provider.
+  bool adapted;
+  std::atomic<State> state{k_running};
+};
+
+static void on_complete_v2(void* ctx, int32_t status) {
+  auto* c = reinterpret_cast<RequestContextV2*>(ctx);
+  c->on_complete(status);
+  delete c;
+}
+
+template <typename Request>
+static uint32_t num_rows_of(const Request& request) {
+  return request.num_global_ids * std::max(request.num_cols, 1U);
+}
+
+template <typename Adapter>
+struct AdaptedRequest {
+  Adapter* adapter;
+  uint32_t index;
+};
+
+/**
+ * Emulates a v2 fetch by one v1 fetch per request.
+ */
+struct FetchAdapter : RequestContextV2 {
+  using RequestContextV2::RequestContextV2;
+
+  std::vector<IOFetchRequestV2> requests;
+  std::vector<AdaptedRequest<FetchAdapter>> contexts;
+  // the number of optimizer states found of each row of each request.
+  std::vector<std::unique_ptr<std::atomic<uint32_t>[]>> num_found;
+  std::atomic<uint32_t> num_pending{0};
+  // whether a row of another size than `row_bytes` was fetched.
+  std::atomic<bool> failed{false};
+
+  void finish() {
+    for (size_t i = 0; i < requests.size(); ++i) {
+      auto& request = requests[i];
+      uint32_t num_rows = num_rows_of(request);
+      for (uint32_t row = 0; row < num_rows; ++row) {
+        if (num_found[i][row] == request.num_optimizer_states) {
+          io_set_bit(request.found, row);
+        }
+      }
+    }
+    bool was_cancelled = claim_completion();
+    on_complete_v2(
+        static_cast<RequestContextV2*>(this),
+        was_cancelled ? k_io_cancelled
+            : failed  ? k_io_error
+                      : k_io_ok);
+  }
+};
+
+static void on_global_id_fetched_v2(
+    void* ctx,
+    uint32_t offset,
+    uint32_t optimizer_state,
+    void* data,
+    uint32_t data_len) {
+  auto* c = reinterpret_cast<AdaptedRequest<FetchAdapter>*>(ctx);
+  auto& request = c->adapter->requests[c->index];
+  if (c->adapter->cancelled() || data_len == 0) {
+    return;
+  }
+  // The row is left not found, as it cannot be copied into `dst`.
+  if (data_len != request.row_bytes) {
+    c->adapter->failed = true;
+    return;
+  }
+  uint64_t row = static_cast<uint64_t>(offset) * request.num_optimizer_states +
+      optimizer_state;
+  memcpy(
+      reinterpret_cast<uint8_t*>(request.dst) + row * request.row_bytes,
+      data,
+      data_len);
+  ++c->adapter->num_found[c->index][offset];
+}
+
+static void on_all_fetched_v2(void* ctx) {
+  auto* c = reinterpret_cast<AdaptedRequest<FetchAdapter>*>(ctx);
+  if (--c->adapter->num_pending == 0) {
+    c->adapter->finish();
+  }
+}
+
+/**
+ * Emulates a v2 push by one v1 push per request.
+ */
+struct PushAdapter : RequestContextV2 {
+  using RequestContextV2::RequestContextV2;
+
+  // The v2 ids are only valid during `push_v2`, but a v1 push reads them
+  // until it completes.
+  struct Ids {
+    std::string table_name;
+    std::vector<int64_t> global_ids;
+    std::vector<int64_t> col_ids;
+    std::vector<uint32_t> optimizer_state_ids;
+  };
+
+  std::vector<IOPushRequestV2> requests;
+  std::vector<Ids> ids;
+  std::vector<AdaptedRequest<PushAdapter>> contexts;
+  // the v1 offsets of each request, which are uniform.
+  std::vector<std::vector<uint64_t>> offsets;
+  std::atomic<uint32_t> num_pending{0};
+
+  void finish() {
+    // v1 does not report failures, all rows are considered pushed.
+    for (auto& request : requests) {
+      if (request.pushed == nullptr) {
+        continue;
+      }
+      uint32_t num_rows = num_rows_of(request);
+      for (uint32_t row = 0; row < num_rows; ++row) {
+        io_set_bit(request.pushed, row);
+      }
+    }
+    // The v1 pushes cannot be stopped, so a cancelled push still completes.
+    claim_completion();
+    on_complete_v2(static_cast<RequestContextV2*>(this), k_io_ok);
+  }
+};
+
+static void on_push_complete_v2(void* ctx) {
+  auto* c = reinterpret_cast<AdaptedRequest<PushAdapter>*>(ctx);
+  if (--c->adapter->num_pending == 0) {
+    c->adapter->finish();
+  }
+}
+
+IORequestHandle IO::fetch_v2(
+    std::span<const IOFetchRequestV2> requests,
+    std::function<void(int32_t)> on_complete) {
+  if (provider_.fetch_v2 != nullptr) {
+    auto* ctx = new RequestContextV2(std::move(on_complete), false);
+    provider_.fetch_v2(
+        instance_,
+        IOFetchParameterV2{
+            .num_requests = static_cast<uint32_t>(requests.size()),
+            .requests = requests.data(),
+            .on_complete_context = ctx,
+            .on_complete = on_complete_v2,
+        });
+    return ctx;
+  }
+
+  auto* adapter = new FetchAdapter(std::move(on_complete), true);
+  for (auto& request : requests) {
+    if (request.num_global_ids == 0) {
+      continue;
+    }
+    uint32_t index = adapter->requests.size();
+    adapter->requests.emplace_back(request);
+    adapter->contexts.push_back({adapter, index});
+    uint32_t num_rows = num_rows_of(request);
+    adapter->num_found.emplace_back(new std::atomic<uint32_t>[num_rows]);
+    for (uint32_t row = 0; row < num_rows; ++row) {
+      adapter->num_found.back()[row] = 0;
+    }
+  }
+  if (adapter->requests.empty()) {
+    adapter->finish();
+    return nullptr;
+  }
+  // All the contexts are created before the first fetch, as a fetch may
+  // complete before it returns. The adapter is deleted once the last fetch
+  // completes, so it is not touched after issuing the last fetch.
+  uint32_t num_requests = adapter->requests.size();
+  adapter->num_pending = num_requests;
+  IOFetchRequestV2* adapted_requests = adapter->requests.data();
+  AdaptedRequest<FetchAdapter>* contexts = adapter->contexts.data();
+  for (uint32_t i = 0; i < num_requests; ++i) {
+    auto& request = adapted_requests[i];
+    provider_.fetch(
+        instance_,
+        IOFetchParameter{
+            .table_name = request.table_name,
+            .num_cols = request.num_cols,
+            .num_global_ids = request.num_global_ids,
+            .col_ids = request.col_ids,
+            .global_ids = request.global_ids,
+            .num_optimizer_states = request.num_optimizer_states,
+            .on_complete_context = &contexts[i],
+            .on_global_id_fetched = on_global_id_fetched_v2,
+            .on_all_fetched = on_all_fetched_v2,
+        });
+  }
+  return static_cast<RequestContextV2*>(adapter);
+}
+
+IORequestHandle IO::push_v2(
+    std::span<const IOPushRequestV2> requests,
+    std::function<void(int32_t)> on_complete) {
+  if (provider_.push_v2 != nullptr) {
+    auto* ctx = new RequestContextV2(std::move(on_complete), false);
+    provider_.push_v2(
+        instance_,
+        IOPushParameterV2{
+            .num_requests = static_cast<uint32_t>(requests.size()),
+            .requests = requests.data(),
+            .on_complete_context = ctx,
+            .on_complete = on_complete_v2,
+        });
+    return ctx;
+  }
+
+  auto* adapter = new PushAdapter(std::move(on_complete), true);
+  for (auto& request : requests) {
+    if (request.num_global_ids == 0) {
+      continue;
+    }
+    uint32_t index = adapter->requests.size();
+    adapter->requests.emplace_back(request);
+    adapter->ids.push_back(PushAdapter::Ids{
+        .table_name = request.table_name,
+        .global_ids = std::vector<int64_t>(
+            request.global_ids, request.global_ids + request.num_global_ids),
+        .col_ids = std::vector<int64_t>(
+            request.col_ids, request.col_ids + request.num_cols),
+        .optimizer_state_ids = std::vector<uint32_t>(
+            request.optimizer_state_ids,
+            request.optimizer_state_ids + request.num_optimizer_states),
+    });
+    adapter->contexts.push_back({adapter, index});
+    auto& offsets = adapter->offsets.emplace_back(
+        num_rows_of(request) * request.num_optimizer_states + 1);
+    for (size_t j = 0; j < offsets.size(); ++j) {
+      offsets[j] = j * request.row_bytes;
+    }
+  }
+  if (adapter->requests.empty()) {
+    adapter->finish();
+    return nullptr;
+  }
+  uint32_t num_requests = adapter->requests.size();
+  adapter->num_pending = num_requests;
+  IOPushRequestV2* adapted_requests = adapter->requests.data();
+  AdaptedRequest<PushAdapter>* contexts = adapter->contexts.data();
+  std::vector<uint64_t>* offsets_of = adapter->offsets.data();
+  PushAdapter::Ids* ids_of = adapter->ids.data();
+  for (uint32_t i = 0; i < num_requests; ++i) {
+    auto& request = adapted_requests[i];
+    auto& offsets = offsets_of[i];
+    auto& ids = ids_of[i];
+    provider_.push(
+        instance_,
+        IOPushParameter{
+            .table_name = ids.table_name.c_str(),
+            .num_cols = request.num_cols,
+            .num_global_ids = request.num_global_ids,
+            .col_ids = ids.col_ids.data(),
+            .global_ids = ids.global_ids.data(),
+            .num_optimizer_states = request.num_optimizer_states,
+            .optimizer_state_ids = ids.optimizer_state_ids.data(),
+            .num_offsets = static_cast<uint32_t>(offsets.size()),
+            .offsets = offsets.data(),
+            .data = request.src,
+            .on_complete_context = &contexts[i],
+            .on_push_complete = on_push_complete_v2,
+        });
+  }
+  return static_cast<RequestContextV2*>(adapter);
+}
+
+void IO::cancel(IORequestHandle handle) {
+  if (handle == nullptr) {
+    return;
+  }
+  auto* ctx = static_cast<RequestContextV2*>(handle);
+  if (!ctx->adapted) {
+    if (provider_.cancel_v2 != nullptr) {
+      provider_.cancel_v2(instance_, ctx);
+    }
+    return;
+  }
+  // The v1 requests cannot be stopped, but the rows of a cancelled fetch are
+  // no longer copied. Does nothing if the request is already finishing.
+  ctx->try_cancel();
+}
+
+c10::Dict<std::string, double> IO::stats() const {
+  c10::Dict<std::string, double> result;
+  if (provider_.stats == nullptr) {
+    return result;
+  }
+  provider_.stats(
+      instance_, &result, +[](void* ctx, const char* name, double value) {
+        auto* stats = reinterpret_cast<c10::Dict<std::string, double>*>(ctx);
+        stats->insert_or_assign(name, value);
+      });
+  return result;
+}
+
 } // namespace torchrec
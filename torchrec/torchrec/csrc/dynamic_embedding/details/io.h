@@ -10,15 +10,28 @@
 #include <torch/torch.h>
 #include <torchrec/csrc/dynamic_embedding/details/io_registry.h>
 #include <cstdint>
+#include <memory>
 #include <span>
 
 namespace torchrec {
 
+/**
+ * Handle of an in-flight v2 request, for `IO::cancel`.
+ */
+using IORequestHandle = void*;
+
 class IO {
  public:
   explicit IO(const std::string& config);
   ~IO();
 
+  /**
+   * Returns the IO instance of `config`, shared by all the tables using the
+   * same config in this process, so that they share the connections and
+   * threads of the provider. The instance is released when no table uses it.
+   */
+  static std::shared_ptr<IO> get(const std::string& config);
+
   IO(const IO&) = delete;
   IO& operator=(const IO&) = delete;
   IO(IO&&) noexcept = delete;
@@ -84,6 +97,49 @@ class IO {
       std::span<const uint64_t> offsets,
       std::function<void()> on_push_complete);
 
+  /**
+   * Fetch the rows of several tables directly into caller-owned memory. See
+   * `IOFetchRequestV2` for the layout of `dst` and the `found` bitmap.
+   *
+   * The requests go to the v2 API of the provider. For a v1 provider, each
+   * request is issued as a v1 fetch and the rows are copied into `dst`.
+   *
+   * @param requests The requests, they and their ids are copied inside. The
+   * `dst` and `found` of every request must stay valid until `on_complete`.
+   * @param on_complete Called once with an `IOStatus` when all the requests
+   * finish.
+   * @return The handle to cancel the fetch, valid until `on_complete`.
+   */
+  IORequestHandle fetch_v2(
+      std::span<const IOFetchRequestV2> requests,
+      std::function<void(int32_t)> on_complete);
+
+  /**
+   * Push the rows of several tables from caller-owned memory. See
+   * `IOPushRequestV2` for the layout of `src`.
+   *
+   * @param requests The requests, they and their ids are copied inside. The
+   * `src` and `pushed` of every request must stay valid until `on_complete`.
+   * @param on_complete Called once with an `IOStatus` when all the requests
+   * finish.
+   * @return The handle to cancel the push, valid until `on_complete`.
+   */
+  IORequestHandle push_v2(
+      std::span<const IOPushRequestV2> requests,
+      std::function<void(int32_t)> on_complete);
+
+  /**
+   * Best-effort cancellation of a `fetch_v2`/`push_v2`. `on_complete` is still
+   * called, with `k_io_cancelled` if the request is actually cancelled.
+   */
+  void cancel(IORequestHandle handle);
+
+  /**
+   * The statistics of the provider instance by name, empty if the provider
+   * reports none.
+   */
+  c10::Dict<std::string, double> stats() const;
+
  private:
   IOProvider provider_{};
   void* instance_{};
@@ -6,6 +6,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#pragma once
 #include <stdint.h>
 
 namespace torchrec {
@@ -44,4 +45,97 @@ struct IOPushParameter {
   void (*on_push_complete)(void* ctx);
 };
 
+/*
+ * IO provider API v2
+ *
+ * A v2 request is vectored: it carries any number of tables, each with rows
+ * of a fixed size. The provider writes the fetched rows directly into the
+ * caller's memory, records per id whether it succeeded in a bitmap, and calls
+ * the completion callback exactly once per request.
+ *
+ * The request descriptors and the id arrays are only valid during the
+ * `IO_Fetch_v2`/`IO_Push_v2` call. The `dst`/`src` buffers and the bitmaps
+ * stay valid until the completion callback.
+ *
+ * A row is the value of one (global id, col id, optimizer state). The row of
+ * `global_ids[i]`, `col_ids[j]` and the k-th optimizer state is at
+ * `((i * num_cols + j) * num_optimizer_states + k) * row_bytes`, where
+ * `num_cols` is counted as 1 if the table is not sharded by column. Bit
+ * `i * num_cols + j` of a bitmap is the status of all the optimizer states
+ * of `global_ids[i]` and `col_ids[j]`; it is `bitmap[b / 64] >> (b % 64)`.
+ */
+
+enum IOStatus : int32_t {
+  k_io_ok = 0,
+  // some ids failed, see the bitmaps for which.
+  k_io_error = 1,
+  // the request was cancelled before all ids were done.
+  k_io_cancelled = 2,
+};
+
+using IOCompleteCallback = void (*)(void* ctx, int32_t status);
+
+struct IOFetchRequestV2 {
+  const char* table_name;
+  uint32_t num_global_ids;
+  const int64_t* global_ids;
+  uint32_t num_cols;
+  const int64_t* col_ids;
+  uint32_t num_optimizer_states;
+  uint32_t row_bytes;
+  // caller-owned memory for all the rows of the request.
+  void* dst;
+  // zero-initialized by the caller; the provider sets the bit of every id
+  // whose optimizer states are all found. The rows of the other ids in `dst`
+  // are unspecified.
+  uint64_t* found;
+};
+
+struct IOFetchParameterV2 {
+  uint32_t num_requests;
+  const IOFetchRequestV2* requests;
+  void* on_complete_context;
+  IOCompleteCallback on_complete;
+};
+
+struct IOPushRequestV2 {
+  const char* table_name;
+  uint32_t num_global_ids;
+  const int64_t* global_ids;
+  uint32_t num_cols;
+  const int64_t* col_ids;
+  uint32_t num_optimizer_states;
+  const uint32_t* optimizer_state_ids;
+  uint32_t row_bytes;
+  const void* src;
+  // zero-initialized by the caller, or nullptr; the provider sets the bit of
+  // every id whose optimizer states are all stored.
+  uint64_t* pushed;
+};
+
+struct IOPushParameterV2 {
+  uint32_t num_requests;
+  const IOPushRequestV2* requests;
+  void* on_complete_context;
+  IOCompleteCallback on_complete;
+};
+
+/**
+ * Reports one statistic of a provider instance by its name, e.g. the
+ * compression ratio of the values it stores. See `IO_Stats`.
+ */
+using IOStatCallback = void (*)(void* ctx, const char* name, double value);
+
+inline uint32_t io_num_bitmap_words(uint32_t num_bits) {
+  return (num_bits + 63) / 64;
+}
+
+inline void io_set_bit(uint64_t* bitmap, uint32_t bit) {
+  bitmap[bit / 64] |= uint64_t{1} << (bit % 64);
+}
+
+inline bool io_test_bit(const uint64_t* bitmap, uint32_t bit) {
+  return (bitmap[bit / 64] >> (bit % 64)) & 1;
+}
+
 } // namespace torchrec
@@ -14,6 +14,16 @@ namespace torchrec {
 
 void IORegistry::register_provider(IOProvider provider) {
   std::string type = provider.type;
+  TORCH_CHECK(
+      provider.fetch != nullptr || provider.fetch_v2 != nullptr,
+      "IO provider ",
+      type,
+      " implements neither fetch nor fetch_v2");
+  TORCH_CHECK(
+      provider.push != nullptr || provider.push_v2 != nullptr,
+      "IO provider ",
+      type,
+      " implements neither push nor push_v2");
   auto it = providers_.find(type);
   if (it != providers_.end()) {
     TORCH_WARN("IO provider ", type, " already registered. Ignored this time.");
@@ -41,13 +51,19 @@ void IORegistry::register_plugin(const char* filename) {
   provider.finalize =
       reinterpret_cast<decltype(provider.finalize)>(finalize_ptr);
 
-  auto fetch_ptr = dlsym(ptr.get(), "IO_Fetch");
-  TORCH_CHECK(fetch_ptr != nullptr, "cannot find IO_Fetch symbol");
-  provider.fetch = reinterpret_cast<decltype(provider.fetch)>(fetch_ptr);
-
-  auto push_ptr = dlsym(ptr.get(), "IO_Push");
-  TORCH_CHECK(push_ptr != nullptr, "cannot find IO_Push symbol");
-  provider.push = reinterpret_cast<decltype(provider.push)>(push_ptr);
+  // Either version of fetch/push is enough, register_provider checks it.
+  provider.fetch =
+      reinterpret_cast<decltype(provider.fetch)>(dlsym(ptr.get(), "IO_Fetch"));
+  provider.push =
+      reinterpret_cast<decltype(provider.push)>(dlsym(ptr.get(), "IO_Push"));
+  provider.fetch_v2 = reinterpret_cast<decltype(provider.fetch_v2)>(
+      dlsym(ptr.get(), "IO_Fetch_v2"));
+  provider.push_v2 = reinterpret_cast<decltype(provider.push_v2)>(
+      dlsym(ptr.get(), "IO_Push_v2"));
+  provider.cancel_v2 = reinterpret_cast<decltype(provider.cancel_v2)>(
+      dlsym(ptr.get(), "IO_Cancel_v2"));
+  provider.stats =
+      reinterpret_cast<decltype(provider.stats)>(dlsym(ptr.get(), "IO_Stats"));
 
   register_provider(provider);
   dls_.emplace_back(std::move(ptr));
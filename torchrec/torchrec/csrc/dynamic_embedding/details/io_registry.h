@@ -17,12 +17,28 @@
 
 namespace torchrec {
 
+/**
+ * The functions of an IO provider. A provider implements the v1 API
+ * (`fetch`/`push`), the v2 API (`fetch_v2`/`push_v2`), or both. The functions
+ * it does not implement are nullptr.
+ *
+ * `cancel_v2` is optional. It cancels the in-flight v2 request of
+ * `on_complete_context`, whose completion is then reported with
+ * `k_io_cancelled`. It is a no-op if the request has already finished.
+ *
+ * `stats` is optional. It calls `on_stat` for every statistic of `instance`
+ * before returning.
+ */
 struct IOProvider {
   const char* type;
   void* (*initialize)(const char* cfg);
   void (*fetch)(void* instance, IOFetchParameter cfg);
   void (*push)(void* instance, IOPushParameter cfg);
   void (*finalize)(void*);
+  void (*fetch_v2)(void* instance, IOFetchParameterV2 cfg);
+  void (*push_v2)(void* instance, IOPushParameterV2 cfg);
+  void (*cancel_v2)(void* instance, void* on_complete_context);
+  void (*stats)(void* instance, void* ctx, IOStatCallback on_stat);
 };
 
 class IORegistry {
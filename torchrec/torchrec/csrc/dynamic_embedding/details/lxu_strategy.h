@@ -9,6 +9,7 @@
 #pragma once
 #include <torchrec/csrc/dynamic_embedding/details/types.h>
 #include <optional>
+#include <vector>
 
 namespace torchrec {
 
@@ -36,6 +37,17 @@ class LXUStrategy {
   virtual std::vector<int64_t> evict(
       iterator_t iterator,
       uint64_t num_to_evict) = 0;
+
+  /**
+   * Same as `evict`, but consumes the records in chunks.
+   * @param exporter Calls its argument on every chunk of records, e.g.
+   * `IDTransformer::export_records`.
+   * @param num_to_evict
+   * @return
+   */
+  virtual std::vector<int64_t> evict_chunks(
+      const exporter_t& exporter,
+      uint64_t num_to_evict) = 0;
 };
 
 } // namespace torchrec
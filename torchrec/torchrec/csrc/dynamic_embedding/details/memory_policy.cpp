@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <c10/util/Exception.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <torchrec/csrc/dynamic_embedding/details/memory_policy.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace torchrec {
+
+static constexpr size_t k_page_size_4k = 4UL << 10;
+static constexpr size_t k_page_size_2m = 2UL << 20;
+static constexpr size_t k_page_size_1g = 1UL << 30;
+// Allocations smaller than this always use `operator new`.
+static constexpr size_t k_min_policy_allocation = 1UL << 20;
+
+// from linux/mempolicy.h
+static constexpr int k_mpol_bind = 2;
+static constexpr int k_mpol_interleave = 3;
+// from linux/mman.h
+static constexpr int k_map_huge_shift = 26;
+
+MemoryPolicy parse_memory_policy(std::string_view params) {
+  MemoryPolicy policy;
+  while (!params.empty()) {
+    auto and_pos = params.find("&&");
+    std::string_view param;
+    if (and_pos != std::string_view::npos) {
+      param = params.substr(0, and_pos);
+      params = params.substr(and_pos + 2);
+    } else {
+      param = params;
+      params = "";
+    }
+
+    if (param.starts_with("hugepage=")) {
+      auto value = param.substr(std::string_view("hugepage=").size());
+      if (value == "none") {
+        policy.huge_page = MemoryPolicy::HugePage::kNone;
+      } else if (value == "2m") {
+        policy.huge_page = MemoryPolicy::HugePage::k2MB;
+      } else if (value == "1g") {
+        policy.huge_page = MemoryPolicy::HugePage::k1GB;
+      } else {
+        TORCH_CHECK(false, "unknown hugepage size: ", std::string(value));
+      }
+    } else if (param.starts_with("numa=")) {
+      auto value = param.substr(std::string_view("numa=").size());
+      if (value == "interleave") {
+        policy.numa = MemoryPolicy::Numa::kInterleave;
+      } else {
+        policy.numa = MemoryPolicy::Numa::kBind;
+        policy.numa_node = std::stoi(std::string(value));
+        TORCH_CHECK(policy.numa_node >= 0, "invalid numa node");
+      }
+    } else if (param.starts_with("first_touch_threads=")) {
+      policy.first_touch_threads = std::stoi(std::string(
+          param.substr(std::string_view("first_touch_threads=").size())));
+    } else {
+      TORCH_CHECK(false, "unknown memory policy param: ", std::string(param));
+    }
+  }
+  return policy;
+}
+
+static size_t page_size_of(const MemoryPolicy& policy) {
+  switch (policy.huge_page) {
+    case MemoryPolicy::HugePage::k2MB:
+      return k_page_size_2m;
+    case MemoryPolicy::HugePage::k1GB:
+      return k_page_size_1g;
+    default:
+      return k_page_size_4k;
+  }
+}
+
+static bool use_operator_new(const MemoryPolicy& policy, size_t size) {
+  return policy.is_default() || size < k_min_policy_allocation;
+}
+
+static size_t mapped_size_of(const MemoryPolicy& policy, size_t size) {
+  size_t page_size = page_size_of(policy);
+  return (size + page_size - 1) / page_size * page_size;
+}
+
+/**
+ * mmap `size` bytes aligned to `align`, by trimming an over-sized mapping.
+ */
+static void* mmap_aligned(size_t size, size_t align) {
+  size_t mapped = size + align;
+  void* ptr = mmap(
+      nullptr,
+      mapped,
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+      -1,
+      0);
+  TORCH_CHECK(ptr != MAP_FAILED, "mmap error, errno ", errno);
+  auto begin = reinterpret_cast<uintptr_t>(ptr);
+  auto aligned = (begin + align - 1) / align * align;
+  if (aligned != begin) {
+    munmap(ptr, aligned - begin);
+  }
+  size_t tail = begin + mapped - (aligned + size);
+  if (tail != 0) {
+    munmap(reinterpret_cast<void*>(aligned + size), tail);
+  }
+  return reinterpret_cast<void*>(aligned);
+}
+
+static void* mmap_huge_pages(const MemoryPolicy& policy, size_t size) {
+  if (policy.huge_page == MemoryPolicy::HugePage::kNone) {
+    return mmap_aligned(size, k_page_size_4k);
+  }
+  size_t page_size = page_size_of(policy);
+  int log2_page_size = __builtin_ctzl(page_size);
+  void* ptr = mmap(
+      nullptr,
+      size,
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+          (log2_page_size << k_map_huge_shift),
+      -1,
+      0);
+  if (ptr != MAP_FAILED) {
+    return ptr;
+  }
+  // No reserved huge pages, fall back to transparent huge pages.
+  ptr = mmap_aligned(size, k_page_size_2m);
+  madvise(ptr, size, MADV_HUGEPAGE);
+  return ptr;
+}
+
+static std::vector<int32_t> online_numa_nodes() {
+  std::vector<int32_t> nodes;
+  std::ifstream file("/sys/devices/system/node/online");
+  std::string ranges;
+  if (!(file >> ranges)) {
+    return nodes;
+  }
+  // e.g. 0-3,5
+  size_t pos = 0;
+  while (pos < ranges.size()) {
+    size_t end = ranges.find(',', pos);
+    if (end == std::string::npos) {
+      end = ranges.size();
+    }
+    auto range = ranges.substr(pos, end - pos);
+    auto dash = range.find('-');
+    int32_t first = std::stoi(range.substr(0, dash));
+    int32_t last =
+        dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+    for (int32_t node = first; node <= last; ++node) {
+      nodes.emplace_back(node);
+    }
+    pos = end + 1;
+  }
+  return nodes;
+}
+
+static void bind_numa(const MemoryPolicy& policy, void* ptr, size_t size) {
+  if (policy.numa == MemoryPolicy::Numa::kDefault) {
+    return;
+  }
+  std::vector<int32_t> nodes;
+  int mode;
+  if (policy.numa == MemoryPolicy::Numa::kBind) {
+    nodes.emplace_back(policy.numa_node);
+    mode = k_mpol_bind;
+  } else {
+    nodes = online_numa_nodes();
+    mode = k_mpol_interleave;
+  }
+  if (nodes.empty()) {
+    TORCH_WARN("cannot find online numa nodes, numa policy is ignored.");
+    return;
+  }
+  int32_t max_node = *std::max_element(nodes.begin(), nodes.end());
+  constexpr int32_t k_bits_per_mask = 8 * sizeof(unsigned long);
+  // mbind reads `maxnode - 1` bits of the mask, so the mask keeps one bit
+  // beyond max_node and its whole size is passed as `maxnode`.
+  std::vector<unsigned long> mask((max_node + 1) / k_bits_per_mask + 1);
+  for (int32_t node : nodes) {
+    mask[node / k_bits_per_mask] |= 1UL << (node % k_bits_per_mask);
+  }
+  long ret = syscall(
+      SYS_mbind,
+      ptr,
+      size,
+      mode,
+      mask.data(),
+      static_cast<unsigned long>(mask.size() * k_bits_per_mask),
+      0);
+  if (ret != 0) {
+    TORCH_WARN("mbind error, errno ", errno, ", numa policy is ignored.");
+  }
+}
+
+/**
+ * Touch every page with multiple threads, so that the page faults (and the
+ * placement on numa nodes) happen in parallel instead of in the thread that
+ * first uses the memory.
+ */
+static void first_touch(const MemoryPolicy& policy, void* ptr, size_t size) {
+  uint32_t num_threads = policy.first_touch_threads;
+  if (num_threads <= 1) {
+    return;
+  }
+  // split by huge pages, so that a huge page is touched by one thread.
+  size_t page_size = page_size_of(policy);
+  size_t num_pages = (size + page_size - 1) / page_size;
+  size_t bytes_per_thread =
+      (num_pages + num_threads - 1) / num_threads * page_size;
+  auto* bytes = reinterpret_cast<volatile uint8_t*>(ptr);
+  std::vector<std::thread> threads;
+  for (size_t begin = 0; begin < size; begin += bytes_per_thread) {
+    size_t end = std::min(size, begin + bytes_per_thread);
+    threads.emplace_back([=] {
+      // mmap-ed memory is zeroed, writing zero only faults the page in.
+      for (size_t offset = begin; offset < end; offset += k_page_size_4k) {
+        bytes[offset] = 0;
+      }
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+}
+
+void* policy_allocate(const MemoryPolicy& policy, size_t size) {
+  if (use_operator_new(policy, size)) {
+    return ::operator new(size);
+  }
+  size_t mapped = mapped_size_of(policy, size);
+  void* ptr = mmap_huge_pages(policy, mapped);
+  bind_numa(policy, ptr, mapped);
+  first_touch(policy, ptr, size);
+  return ptr;
+}
+
+void policy_deallocate(const MemoryPolicy& policy, void* ptr, size_t size) {
+  if (use_operator_new(policy, size)) {
+    ::operator delete(ptr);
+    return;
+  }
+  munmap(ptr, mapped_size_of(policy, size));
+}
+
+} // namespace torchrec
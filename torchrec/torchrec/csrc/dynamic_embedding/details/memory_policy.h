@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+
+namespace torchrec {
+
+/**
+ * MemoryPolicy
+ *
+ * How the large index structures (hash maps, bitmaps) of dynamic embedding
+ * allocate their memory.
+ */
+struct MemoryPolicy {
+  enum class HugePage {
+    kNone,
+    k2MB,
+    k1GB,
+  };
+  enum class Numa {
+    kDefault,
+    // bind to `numa_node`
+    kBind,
+    // interleave across all online nodes
+    kInterleave,
+  };
+
+  HugePage huge_page{HugePage::kNone};
+  Numa numa{Numa::kDefault};
+  int32_t numa_node{0};
+  // number of threads to touch the pages right after allocation.
+  uint32_t first_touch_threads{1};
+
+  [[nodiscard]] bool is_default() const {
+    return huge_page == HugePage::kNone && numa == Numa::kDefault &&
+        first_touch_threads <= 1;
+  }
+};
+
+/**
+ * Parse the memory policy from `&&` separated params, e.g.
+ * `hugepage=2m&&numa=interleave&&first_touch_threads=8`.
+ *
+ * - hugepage: none, 2m or 1g.
+ * - numa: interleave, or the node id to bind to.
+ * - first_touch_threads: number of threads to initialize the memory.
+ */
+MemoryPolicy parse_memory_policy(std::string_view params);
+
+/**
+ * Allocate `size` bytes by `policy`.
+ *
+ * Huge pages are first requested from hugetlbfs by `MAP_HUGETLB`, and fall
+ * back to transparent huge pages by `madvise(MADV_HUGEPAGE)`. Small
+ * allocations and the default policy use `operator new`.
+ */
+void* policy_allocate(const MemoryPolicy& policy, size_t size);
+
+/**
+ * Release the memory from `policy_allocate` with the same `policy` and `size`.
+ */
+void policy_deallocate(const MemoryPolicy& policy, void* ptr, size_t size);
+
+/**
+ * Deleter for `std::unique_ptr<T[]>` allocated by `policy_allocate`.
+ */
+template <typename T>
+struct PolicyDeleter {
+  MemoryPolicy policy;
+  size_t size{0};
+
+  void operator()(T* ptr) const {
+    if (ptr != nullptr) {
+      policy_deallocate(policy, ptr, size * sizeof(T));
+    }
+  }
+};
+
+template <typename T>
+using policy_unique_ptr = std::unique_ptr<T[], PolicyDeleter<T>>;
+
+template <typename T>
+policy_unique_ptr<T> make_policy_unique(const MemoryPolicy& policy, size_t n) {
+  static_assert(std::is_trivially_destructible_v<T>);
+  return policy_unique_ptr<T>(
+      reinterpret_cast<T*>(policy_allocate(policy, n * sizeof(T))),
+      PolicyDeleter<T>{.policy = policy, .size = n});
+}
+
+/**
+ * STL allocator by a `MemoryPolicy`.
+ */
+template <typename T>
+class PolicyAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  using is_always_equal = std::false_type;
+
+  PolicyAllocator() = default;
+  explicit PolicyAllocator(MemoryPolicy policy) : policy_(policy) {}
+
+  template <typename U>
+  PolicyAllocator(const PolicyAllocator<U>& o) : policy_(o.policy()) {}
+
+  T* allocate(size_t n) {
+    return reinterpret_cast<T*>(policy_allocate(policy_, n * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    policy_deallocate(policy_, ptr, n * sizeof(T));
+  }
+
+  [[nodiscard]] const MemoryPolicy& policy() const {
+    return policy_;
+  }
+
+  template <typename U>
+  bool operator==(const PolicyAllocator<U>& o) const {
+    return policy_.huge_page == o.policy().huge_page &&
+        policy_.numa == o.policy().numa &&
+        policy_.numa_node == o.policy().numa_node &&
+        policy_.first_touch_threads == o.policy().first_touch_threads;
+  }
+
+  template <typename U>
+  bool operator!=(const PolicyAllocator<U>& o) const {
+    return !(*this == o);
+  }
+
+ private:
+  MemoryPolicy policy_;
+};
+
+} // namespace torchrec
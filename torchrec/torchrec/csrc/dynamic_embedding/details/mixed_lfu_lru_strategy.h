@@ -10,7 +10,9 @@
 #include <torch/torch.h>
 #include <torchrec/csrc/dynamic_embedding/details/lxu_strategy.h>
 #include <torchrec/csrc/dynamic_embedding/details/random_bits_generator.h>
+#include <algorithm>
 #include <atomic>
+#include <limits>
 #include <optional>
 #include <queue>
 #include <string_view>
@@ -120,6 +122,57 @@ class MixedLFULRUStrategy : public LXUStrategy {
     return result;
   }
 
+  /**
+   * Select the `num_to_evict` smallest records in chunks.
+   *
+   * Instead of a heap, it keeps a buffer of candidates. Once the buffer
+   * reaches twice of `num_to_evict`, it is shrunk to the `num_to_evict`
+   * smallest ones, whose max becomes the threshold to reject following
+   * records with a single comparison.
+   */
+  std::vector<int64_t> evict_chunks(
+      const exporter_t& exporter,
+      uint64_t num_to_evict) override {
+    if (num_to_evict == 0) {
+      return {};
+    }
+    std::vector<EvictItem> items;
+    // larger than any record before the first shrink.
+    uint64_t threshold = uint64_t(std::numeric_limits<uint32_t>::max()) + 1;
+    auto shrink = [&] {
+      std::nth_element(
+          items.begin(), items.begin() + (num_to_evict - 1), items.end());
+      items.resize(num_to_evict);
+      threshold = items.back().record;
+    };
+    exporter([&](const record_chunk_t& chunk) {
+      for (size_t i = 0; i < chunk.size(); ++i) {
+        uint32_t record =
+            reinterpret_cast<const Record*>(&chunk.lxu_records[i])->ToUint32();
+        if (record >= threshold) {
+          continue;
+        }
+        items.emplace_back(EvictItem{
+            .global_id = chunk.global_ids[i],
+            .record = record,
+        });
+        if (items.size() == 2 * num_to_evict) [[unlikely]] {
+          shrink();
+        }
+      }
+    });
+    if (items.size() > num_to_evict) {
+      shrink();
+    }
+    std::sort(items.begin(), items.end());
+    std::vector<int64_t> result;
+    result.reserve(items.size());
+    for (auto& item : items) {
+      result.emplace_back(item.global_id);
+    }
+    return result;
+  }
+
   // Record should only be used in unittest or internally.
   struct Record {
     uint32_t time : 27;
@@ -7,9 +7,12 @@
  */
 
 #pragma once
+#include <c10/util/Exception.h>
 #include <c10/util/flat_hash_map.h>
 #include <torchrec/csrc/dynamic_embedding/details/bitmap.h>
+#include <torchrec/csrc/dynamic_embedding/details/fallback_rows.h>
 #include <torchrec/csrc/dynamic_embedding/details/id_transformer.h>
+#include <torchrec/csrc/dynamic_embedding/details/memory_policy.h>
 #include <memory>
 #include <optional>
 #include <span>
@@ -20,13 +23,23 @@ namespace torchrec {
  * NaiveIDTransformer
  *
  * transform GlobalID to CacheID by naive flat hash map
+ * The memory of the hash map and the bitmap is allocated by `MemoryPolicy`.
+ *
+ * If `num_fallback_rows` is positive, the last `num_fallback_rows` cache ids
+ * are reserved as hashed fallback rows. When the transformer is full, a new
+ * global id is mapped to one of them without being inserted or fetched, so
+ * `transform` always succeeds in one pass. The global ids sharing a fallback
+ * row share its embedding until they are admitted after an eviction.
  * @tparam LXURecord The extension type used for eviction strategy.
  * @tparam Bitmap The bitmap class to record the free cache ids.
  */
 template <typename Bitmap = Bitmap<uint32_t>>
 class NaiveIDTransformer : public IDTransformer {
  public:
-  explicit NaiveIDTransformer(int64_t num_embedding);
+  explicit NaiveIDTransformer(
+      int64_t num_embedding,
+      const MemoryPolicy& policy = {},
+      int64_t num_fallback_rows = 0);
   NaiveIDTransformer(const NaiveIDTransformer<Bitmap>&) = delete;
   NaiveIDTransformer(NaiveIDTransformer<Bitmap>&&) noexcept = default;
 
@@ -40,14 +53,35 @@ class NaiveIDTransformer : public IDTransformer {
 
   iterator_t iterator() const override;
 
+  [[nodiscard]] int64_t num_fallback_ids() const override {
+    return num_fallback_ids_;
+  }
+
+  void export_records(
+      const chunk_visitor_t& visitor,
+      size_t chunk_size = k_export_chunk_size) const override;
+
  private:
+  // Checks num_fallback_rows before the bitmap is sized from it.
+  static int64_t num_bitmap_rows(
+      int64_t num_embedding,
+      int64_t num_fallback_rows);
+
   struct CacheValue {
     int64_t cache_id;
     lxu_record_t lxu_record;
   };
 
-  ska::flat_hash_map<int64_t, CacheValue> global_id2cache_value_;
+  ska::flat_hash_map<
+      int64_t,
+      CacheValue,
+      std::hash<int64_t>,
+      std::equal_to<int64_t>,
+      PolicyAllocator<std::pair<int64_t, CacheValue>>>
+      global_id2cache_value_;
   Bitmap bitmap_;
+  std::optional<FallbackRows> fallback_;
+  int64_t num_fallback_ids_{0};
 };
 
 } // namespace torchrec
@@ -12,9 +12,34 @@
 namespace torchrec {
 
 template <typename T>
-NaiveIDTransformer<T>::NaiveIDTransformer(int64_t num_embedding)
-    : bitmap_(num_embedding) {
-  global_id2cache_value_.reserve(num_embedding);
+int64_t NaiveIDTransformer<T>::num_bitmap_rows(
+    int64_t num_embedding,
+    int64_t num_fallback_rows) {
+  TORCH_CHECK(
+      num_fallback_rows >= 0 && num_fallback_rows < num_embedding,
+      "num_fallback_rows should be in [0, num_embedding)");
+  return num_embedding - num_fallback_rows;
+}
+
+template <typename T>
+NaiveIDTransformer<T>::NaiveIDTransformer(
+    int64_t num_embedding,
+    const MemoryPolicy& policy,
+    int64_t num_fallback_rows)
+    : global_id2cache_value_(
+          0,
+          std::hash<int64_t>(),
+          std::equal_to<int64_t>(),
+          PolicyAllocator<std::pair<int64_t, CacheValue>>(policy)),
+      bitmap_(num_bitmap_rows(num_embedding, num_fallback_rows), policy) {
+  if (num_fallback_rows > 0) {
+    // The fallback rows are the last cache ids, which the bitmap never hands
+    // out.
+    fallback_ = FallbackRows{
+        .begin = num_embedding - num_fallback_rows,
+        .size = num_fallback_rows};
+  }
+  global_id2cache_value_.reserve(num_embedding - num_fallback_rows);
 }
 
 template <typename T>
@@ -35,7 +60,12 @@ bool NaiveIDTransformer<T>::transform(
     } else {
       // The transformer is full.
       if (bitmap_.full()) [[unlikely]] {
-        return false;
+        if (!fallback_.has_value()) {
+          return false;
+        }
+        cache_ids[i] = fallback_->row_of(global_id);
+        ++num_fallback_ids_;
+        continue;
       }
       auto stored_cache_id = bitmap_.next_free_bit();
       cache_id = stored_cache_id;
@@ -80,4 +110,33 @@ iterator_t NaiveIDTransformer<T>::iterator() const {
   };
 }
 
+template <typename T>
+void NaiveIDTransformer<T>::export_records(
+    const chunk_visitor_t& visitor,
+    size_t chunk_size) const {
+  std::vector<int64_t> global_ids(chunk_size);
+  std::vector<int64_t> cache_ids(chunk_size);
+  std::vector<lxu_record_t> lxu_records(chunk_size);
+  size_t n = 0;
+  auto flush = [&] {
+    visitor(record_chunk_t{
+        .global_ids = std::span{global_ids.data(), n},
+        .cache_ids = std::span{cache_ids.data(), n},
+        .lxu_records = std::span{lxu_records.data(), n},
+    });
+    n = 0;
+  };
+  for (auto& [global_id, value] : global_id2cache_value_) {
+    global_ids[n] = global_id;
+    cache_ids[n] = value.cache_id;
+    lxu_records[n] = value.lxu_record;
+    if (++n == chunk_size) [[unlikely]] {
+      flush();
+    }
+  }
+  if (n != 0) {
+    flush();
+  }
+}
+
 } // namespace torchrec
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <c10/util/Exception.h>
+#include <torchrec/csrc/dynamic_embedding/details/redis/chunk_controller.h>
+#include <algorithm>
+
+namespace torchrec::redis {
+
+ChunkController::ChunkController(ChunkControllerOption opt) : opt_(opt) {
+  TORCH_CHECK(opt_.min_chunk_size > 0, "min_chunk_size must be positive");
+  TORCH_CHECK(
+      opt_.min_chunk_size <= opt_.max_chunk_size,
+      "min_chunk_size ",
+      opt_.min_chunk_size,
+      " is larger than max_chunk_size ",
+      opt_.max_chunk_size);
+  TORCH_CHECK(opt_.max_pipeline_jobs > 0, "max_pipeline_jobs must be positive");
+  TORCH_CHECK(opt_.target_latency_us > 0, "target latency must be positive");
+  chunk_size_ = std::clamp(
+      opt_.initial_chunk_size, opt_.min_chunk_size, opt_.max_chunk_size);
+  pipeline_jobs_ =
+      std::clamp(opt_.initial_pipeline_jobs, 1U, opt_.max_pipeline_jobs);
+}
+
+void ChunkController::on_round(const RoundStats& stats) {
+  std::lock_guard<std::mutex> guard(mu_);
+  if (stats.num_keys < chunk_size_) {
+    return;
+  }
+  double throughput = static_cast<double>(stats.num_bytes) /
+      static_cast<double>(std::max<uint64_t>(stats.latency_us, 1));
+  throughput_ =
+      throughput_ == 0 ? throughput : 0.875 * throughput_ + 0.125 * throughput;
+
+  if (stats.latency_us > opt_.target_latency_us) {
+    slow_start_ = false;
+    chunk_size_ = std::max(chunk_size_ / 2, opt_.min_chunk_size);
+    pipeline_jobs_ = std::max(pipeline_jobs_ - 1, 1U);
+    return;
+  }
+
+  if (opt_.target_throughput > 0 && throughput_ >= opt_.target_throughput) {
+    slow_start_ = false;
+    return;
+  }
+
+  if (slow_start_) {
+    if (throughput > max_throughput_ * 1.25) {
+      max_throughput_ = throughput;
+      num_plateau_rounds_ = 0;
+    } else if (++num_plateau_rounds_ >= k_num_plateau_rounds) {
+      slow_start_ = false;
+    }
+    if (slow_start_) {
+      chunk_size_ = std::min(chunk_size_ * 2, opt_.max_chunk_size);
+      return;
+    }
+  }
+
+  if (chunk_size_ < opt_.max_chunk_size) {
+    chunk_size_ =
+        std::min(chunk_size_ + opt_.min_chunk_size, opt_.max_chunk_size);
+  } else {
+    pipeline_jobs_ = std::min(pipeline_jobs_ + 1, opt_.max_pipeline_jobs);
+  }
+}
+
+uint32_t ChunkController::chunk_size() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return chunk_size_;
+}
+
+uint32_t ChunkController::pipeline_jobs() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return pipeline_jobs_;
+}
+
+bool ChunkController::in_slow_start() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return slow_start_;
+}
+
+double ChunkController::throughput() const {
+  std::lock_guard<std::mutex> guard(mu_);
+  return throughput_;
+}
+
+} // namespace torchrec::redis
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <mutex>
+
+namespace torchrec::redis {
+
+struct ChunkControllerOption {
+  // number of keys (global id x col x optimizer state) in a chunk.
+  uint32_t initial_chunk_size{100};
+  uint32_t min_chunk_size{10};
+  uint32_t max_chunk_size{10000};
+  // number of chunks sent in one pipeline round.
+  uint32_t initial_pipeline_jobs{4};
+  uint32_t max_pipeline_jobs{16};
+  // the latency of a pipeline round to stay under.
+  uint32_t target_latency_us{5000};
+  // the throughput to reach, in bytes/us (= MB/s). Once the average
+  // throughput reaches it, the chunk size and the pipeline stop growing.
+  // 0 grows them as long as the latency stays under the target.
+  uint32_t target_throughput{0};
+};
+
+/**
+ * The stats of one pipeline round of an io thread.
+ */
+struct RoundStats {
+  uint32_t num_jobs;
+  // the number of keys of all the jobs.
+  uint64_t num_keys;
+  // bytes sent and received, only the values are counted.
+  uint64_t num_bytes;
+  uint64_t latency_us;
+};
+
+/**
+ * ChunkController
+ *
+ * Tunes the chunk size and the pipeline depth of the redis io threads from
+ * the measured pipeline rounds, in the way of TCP congestion control:
+ *
+ * - Slow start: the chunk size doubles after every round under the target
+ *   latency, until the throughput stops growing or the target is exceeded.
+ * - Congestion avoidance: the chunk size grows by `min_chunk_size` after
+ *   every round under the target latency. Once it reaches `max_chunk_size`,
+ *   the pipeline gets one more job instead.
+ * - A round over the target latency halves the chunk size and takes one job
+ *   out of the pipeline.
+ * - While the average throughput is at the target throughput, if any, the
+ *   chunk size and the pipeline are kept, since growing them further only
+ *   adds latency.
+ *
+ * Rounds with less than one chunk of keys are the tail of a request and carry
+ * no information on the capacity, they are ignored. Thread safe.
+ */
+class ChunkController {
+ public:
+  explicit ChunkController(ChunkControllerOption opt);
+
+  void on_round(const RoundStats& stats);
+
+  [[nodiscard]] uint32_t chunk_size() const;
+  [[nodiscard]] uint32_t pipeline_jobs() const;
+  [[nodiscard]] bool in_slow_start() const;
+  // exponentially weighted moving average of the throughput, in bytes/us.
+  [[nodiscard]] double throughput() const;
+
+ private:
+  // rounds without 25% throughput growth to leave slow start.
+  static constexpr uint32_t k_num_plateau_rounds = 3;
+
+  ChunkControllerOption opt_;
+  mutable std::mutex mu_;
+  uint32_t chunk_size_;
+  uint32_t pipeline_jobs_;
+  bool slow_start_{true};
+  double throughput_{0};
+  double max_throughput_{0};
+  uint32_t num_plateau_rounds_{0};
+};
+
+} // namespace torchrec::redis
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <torchrec/csrc/dynamic_embedding/details/redis/cluster.h>
+#include <algorithm>
+#include <array>
+#include <charconv>
+
+namespace torchrec::redis {
+
+// CRC16-CCITT (XMODEM) as used by redis cluster, polynomial 0x1021.
+static constexpr std::array<uint16_t, 256> make_crc16_table() {
+  std::array<uint16_t, 256> table{};
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint16_t crc = i << 8;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+static constexpr auto k_crc16_table = make_crc16_table();
+
+static uint16_t crc16(std::string_view data) {
+  uint16_t crc = 0;
+  for (unsigned char c : data) {
+    crc = (crc << 8) ^ k_crc16_table[((crc >> 8) ^ c) & 0xff];
+  }
+  return crc;
+}
+
+uint16_t key_slot(std::string_view key) {
+  auto open = key.find('{');
+  if (open != std::string_view::npos) {
+    auto close = key.find('}', open + 1);
+    if (close != std::string_view::npos && close != open + 1) {
+      key = key.substr(open + 1, close - open - 1);
+    }
+  }
+  return crc16(key) % k_num_slots;
+}
+
+/**
+ * Parse the integer of a `*<n>\r\n` or `$<n>\r\n` line at `pos`, and move
+ * `pos` past the line.
+ */
+static std::optional<size_t> parse_header(
+    std::string_view command,
+    char type,
+    size_t& pos) {
+  if (pos >= command.size() || command[pos] != type) {
+    return std::nullopt;
+  }
+  auto end = command.find("\r\n", pos);
+  if (end == std::string_view::npos) {
+    return std::nullopt;
+  }
+  size_t value = 0;
+  auto [ptr, ec] =
+      std::from_chars(command.data() + pos + 1, command.data() + end, value);
+  if (ec != std::errc() || ptr != command.data() + end) {
+    return std::nullopt;
+  }
+  pos = end + 2;
+  return value;
+}
+
+std::string_view command_key(std::string_view command) {
+  size_t pos = 0;
+  auto num_args = parse_header(command, '*', pos);
+  if (!num_args.has_value() || *num_args < 2) {
+    return {};
+  }
+  // skip the command name.
+  auto name_len = parse_header(command, '$', pos);
+  if (!name_len.has_value()) {
+    return {};
+  }
+  pos += *name_len + 2;
+  auto key_len = parse_header(command, '$', pos);
+  if (!key_len.has_value() || pos + *key_len > command.size()) {
+    return {};
+  }
+  return command.substr(pos, *key_len);
+}
+
+void SlotMap::assign(uint16_t begin, uint16_t end, const NodeAddress& address) {
+  auto it = std::find(nodes_.begin(), nodes_.end(), address);
+  auto node = static_cast<int32_t>(it - nodes_.begin());
+  if (it == nodes_.end()) {
+    nodes_.emplace_back(address);
+  }
+  end = std::min<uint16_t>(end, k_num_slots - 1);
+  for (uint32_t slot = begin; slot <= end; ++slot) {
+    slots_[slot] = node;
+  }
+}
+
+std::optional<Redirect> parse_redirect(std::string_view error) {
+  Redirect redirect;
+  if (error.starts_with("MOVED ")) {
+    redirect.kind = RedirectKind::kMoved;
+    error.remove_prefix(6);
+  } else if (error.starts_with("ASK ")) {
+    redirect.kind = RedirectKind::kAsk;
+    error.remove_prefix(4);
+  } else {
+    return std::nullopt;
+  }
+  auto space = error.find(' ');
+  auto colon = error.rfind(':');
+  if (space == std::string_view::npos || colon == std::string_view::npos ||
+      colon < space) {
+    return std::nullopt;
+  }
+  const char* begin = error.data();
+  auto [slot_end, slot_ec] =
+      std::from_chars(begin, begin + space, redirect.slot);
+  auto [port_end, port_ec] = std::from_chars(
+      begin + colon + 1, begin + error.size(), redirect.address.port);
+  if (slot_ec != std::errc() || slot_end != begin + space ||
+      port_ec != std::errc() || port_end != begin + error.size() ||
+      redirect.slot >= k_num_slots) {
+    return std::nullopt;
+  }
+  redirect.address.host =
+      std::string(error.substr(space + 1, colon - space - 1));
+  return redirect;
+}
+
+} // namespace torchrec::redis
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <compare>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace torchrec::redis {
+
+constexpr uint32_t k_num_slots = 16384;
+
+/**
+ * The hash slot of a key in a redis cluster, the CRC16 of the key modulo
+ * 16384. If the key has a non-empty hash tag, i.e. a part between the first
+ * `{` and the next `}`, only the hash tag is hashed.
+ */
+uint16_t key_slot(std::string_view key);
+
+/**
+ * The key of a command formatted by `redisFormatCommand`, i.e. its second
+ * argument, or empty if the command has no argument.
+ */
+std::string_view command_key(std::string_view command);
+
+struct NodeAddress {
+  std::string host;
+  uint16_t port{0};
+
+  auto operator<=>(const NodeAddress& other) const = default;
+};
+
+/**
+ * The node serving each hash slot of a redis cluster.
+ */
+class SlotMap {
+ public:
+  SlotMap() : slots_(k_num_slots, -1) {}
+
+  /**
+   * Serve the slots [begin, end] by the node at `address`.
+   */
+  void assign(uint16_t begin, uint16_t end, const NodeAddress& address);
+
+  /**
+   * The index of the node serving `slot` in `nodes()`, or -1 if no node
+   * serves it.
+   */
+  [[nodiscard]] int32_t node_of(uint16_t slot) const {
+    return slots_[slot];
+  }
+
+  [[nodiscard]] const std::vector<NodeAddress>& nodes() const {
+    return nodes_;
+  }
+
+ private:
+  std::vector<NodeAddress> nodes_;
+  std::vector<int32_t> slots_;
+};
+
+enum class RedirectKind {
+  // the slot has moved, the slot map is stale.
+  kMoved,
+  // the slot is migrating, only this command goes to the new node.
+  kAsk,
+};
+
+struct Redirect {
+  RedirectKind kind;
+  uint16_t slot;
+  NodeAddress address;
+};
+
+/**
+ * Parse the error reply `MOVED <slot> <host>:<port>` or
+ * `ASK <slot> <host>:<port>`. Returns nullopt for the other errors.
+ */
+std::optional<Redirect> parse_redirect(std::string_view error);
+
+} // namespace torchrec::redis
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <c10/util/Exception.h>
+#include <lz4.h>
+#include <torchrec/csrc/dynamic_embedding/details/redis/codec.h>
+#include <cstring>
+#include <string>
+
+namespace torchrec::redis {
+
+static constexpr uint8_t k_magic[4] = {0xC7, 0xDE, 0x5A, 0x91};
+static constexpr size_t k_header_size = k_codec_header_size;
+// the bytes of the header covered by the checksum.
+static constexpr size_t k_checksum_offset = 12;
+
+Codec parse_codec(std::string_view name) {
+  if (name == "none") {
+    return Codec::kNone;
+  }
+  if (name == "lz4") {
+    return Codec::kLZ4;
+  }
+  if (name == "shuffle_lz4") {
+    return Codec::kShuffleLZ4;
+  }
+  throw std::invalid_argument(
+      "unknown codec " + std::string(name) +
+      ", should be none, lz4 or shuffle_lz4");
+}
+
+void byte_shuffle(
+    const uint8_t* src,
+    uint8_t* dst,
+    size_t size,
+    size_t element_size) {
+  size_t num_elements = size / element_size;
+  for (size_t i = 0; i < num_elements; ++i) {
+    for (size_t j = 0; j < element_size; ++j) {
+      dst[j * num_elements + i] = src[i * element_size + j];
+    }
+  }
+  size_t tail = num_elements * element_size;
+  memcpy(dst + tail, src + tail, size - tail);
+}
+
+void byte_unshuffle(
+    const uint8_t* src,
+    uint8_t* dst,
+    size_t size,
+    size_t element_size) {
+  size_t num_elements = size / element_size;
+  for (size_t i = 0; i < num_elements; ++i) {
+    for (size_t j = 0; j < element_size; ++j) {
+      dst[i * element_size + j] = src[j * num_elements + i];
+    }
+  }
+  size_t tail = num_elements * element_size;
+  memcpy(dst + tail, src + tail, size - tail);
+}
+
+static void store_u32(uint32_t value, uint8_t* dst) {
+  for (int i = 0; i < 4; ++i) {
+    dst[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+static uint32_t load_u32(const uint8_t* src) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(src[i]) << (8 * i);
+  }
+  return value;
+}
+
+/**
+ * FNV-1a of the header before the checksum and of the payload.
+ */
+static uint32_t checksum(std::span<const uint8_t> value) {
+  uint32_t hash = 2166136261U;
+  auto update = [&hash](std::span<const uint8_t> bytes) {
+    for (uint8_t byte : bytes) {
+      hash = (hash ^ byte) * 16777619U;
+    }
+  };
+  update(value.first(k_checksum_offset));
+  update(value.subspan(k_header_size));
+  return hash;
+}
+
+/**
+ * Write the header of `value`, whose payload is already written.
+ */
+static void write_header(
+    Codec codec,
+    uint8_t element_size,
+    uint32_t raw_size,
+    std::span<uint8_t> value) {
+  uint8_t* header = value.data();
+  memcpy(header, k_magic, sizeof(k_magic));
+  header[4] = static_cast<uint8_t>(codec);
+  header[5] = element_size;
+  header[6] = 0;
+  header[7] = 0;
+  store_u32(raw_size, header + 8);
+  store_u32(checksum(value), header + k_checksum_offset);
+}
+
+bool encode_value(
+    Codec codec,
+    uint8_t element_size,
+    std::span<const uint8_t> raw,
+    std::vector<uint8_t>& out) {
+  TORCH_CHECK(codec != Codec::kNone, "cannot encode by codec none");
+  TORCH_CHECK(element_size > 0, "element size must be positive");
+  TORCH_CHECK(
+      raw.size() <= static_cast<size_t>(LZ4_MAX_INPUT_SIZE),
+      "value of ",
+      raw.size(),
+      " bytes is too large to compress");
+  auto raw_size = static_cast<int>(raw.size());
+  const auto* src = raw.data();
+  // the shuffled value is put after the compressed one.
+  size_t bound = LZ4_compressBound(raw_size);
+  size_t shuffled_size = codec == Codec::kShuffleLZ4 ? raw.size() : 0;
+  out.resize(k_header_size + bound + shuffled_size);
+  if (codec == Codec::kShuffleLZ4) {
+    auto* shuffled = out.data() + k_header_size + bound;
+    byte_shuffle(src, shuffled, raw.size(), element_size);
+    src = shuffled;
+  }
+
+  int compressed_size = LZ4_compress_default(
+      reinterpret_cast<const char*>(src),
+      reinterpret_cast<char*>(out.data() + k_header_size),
+      raw_size,
+      static_cast<int>(bound));
+  if (compressed_size <= 0 ||
+      static_cast<size_t>(compressed_size) >= raw.size()) {
+    if (raw.size() < sizeof(k_magic) ||
+        memcmp(raw.data(), k_magic, sizeof(k_magic)) != 0) {
+      out.clear();
+      return false;
+    }
+    memcpy(out.data() + k_header_size, raw.data(), raw.size());
+    out.resize(k_header_size + raw.size());
+    write_header(Codec::kNone, element_size, raw_size, out);
+    return true;
+  }
+  out.resize(k_header_size + compressed_size);
+  write_header(codec, element_size, raw_size, out);
+  return true;
+}
+
+std::span<const uint8_t> decode_value(
+    std::span<const uint8_t> value,
+    std::vector<uint8_t>& scratch) {
+  // A raw value is taken as encoded only if it starts with the magic and
+  // the checksum matches, which is about one in 2^64 for random bytes.
+  if (value.size() < k_header_size ||
+      memcmp(value.data(), k_magic, sizeof(k_magic)) != 0 || value[6] != 0 ||
+      value[7] != 0 ||
+      load_u32(value.data() + k_checksum_offset) != checksum(value)) {
+    return value;
+  }
+  auto codec = static_cast<Codec>(value[4]);
+  uint8_t element_size = value[5];
+  uint32_t raw_size = load_u32(value.data() + 8);
+  auto payload = value.subspan(k_header_size);
+
+  switch (codec) {
+    case Codec::kNone:
+      return payload.size() == raw_size ? payload : value;
+    case Codec::kLZ4:
+    case Codec::kShuffleLZ4:
+      break;
+    default:
+      return value;
+  }
+  if (element_size == 0 || raw_size > LZ4_MAX_INPUT_SIZE) {
+    return value;
+  }
+
+  bool shuffled = codec == Codec::kShuffleLZ4;
+  scratch.resize(shuffled ? 2 * static_cast<size_t>(raw_size) : raw_size);
+  auto* decompressed = scratch.data() + (shuffled ? raw_size : 0);
+  int decompressed_size = LZ4_decompress_safe(
+      reinterpret_cast<const char*>(payload.data()),
+      reinterpret_cast<char*>(decompressed),
+      static_cast<int>(payload.size()),
+      static_cast<int>(raw_size));
+  if (decompressed_size != static_cast<int>(raw_size)) {
+    return value;
+  }
+  if (shuffled) {
+    byte_unshuffle(decompressed, scratch.data(), raw_size, element_size);
+  }
+  return {scratch.data(), raw_size};
+}
+
+} // namespace torchrec::redis
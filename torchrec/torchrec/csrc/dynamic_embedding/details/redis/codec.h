@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace torchrec::redis {
+
+/**
+ * The lossless codecs of the values stored in redis.
+ *
+ * - kNone: values are stored as is.
+ * - kLZ4: values are compressed by LZ4.
+ * - kShuffleLZ4: the bytes of the values are first shuffled by their position
+ *   in the element, as Blosc does, then compressed by LZ4. Rows of floats
+ *   with close values, e.g. the optimizer states of rarely updated ids,
+ *   compress much better this way.
+ */
+enum class Codec : uint8_t {
+  kNone = 0,
+  kLZ4 = 1,
+  kShuffleLZ4 = 2,
+};
+
+/**
+ * Parse `none`, `lz4` or `shuffle_lz4`.
+ */
+Codec parse_codec(std::string_view name);
+
+/**
+ * Move byte `j` of element `i` to `dst[j * num_elements + i]`, the trailing
+ * bytes that do not make a whole element are copied as is.
+ */
+void byte_shuffle(
+    const uint8_t* src,
+    uint8_t* dst,
+    size_t size,
+    size_t element_size);
+
+void byte_unshuffle(
+    const uint8_t* src,
+    uint8_t* dst,
+    size_t size,
+    size_t element_size);
+
+/**
+ * The size of the header of an encoded value: a 4 bytes magic, the codec, the
+ * element size, 2 zero bytes, the 4 bytes raw size, and the 4 bytes checksum
+ * of the rest of the header and of the payload.
+ */
+inline constexpr size_t k_codec_header_size = 16;
+
+/**
+ * Encode `raw` into `out` by `codec`, which must not be kNone.
+ *
+ * @return false if `raw` does not compress and is to be stored as is, then
+ * `out` is left empty. `decode_value` returns such a value as is, as it has
+ * no header. A raw value that could be mistaken for an encoded one, i.e. it
+ * starts with the magic, is still stored after a header.
+ */
+bool encode_value(
+    Codec codec,
+    uint8_t element_size,
+    std::span<const uint8_t> raw,
+    std::vector<uint8_t>& out);
+
+/**
+ * Decode `value` with `scratch` as the buffer. Values without a valid header,
+ * e.g. the ones pushed before the codec is enabled, are returned as is. A raw
+ * value is only mistaken for an encoded one if it starts with the magic and
+ * its checksum matches.
+ *
+ * @return the decoded value, which points into either `value` or `scratch`.
+ */
+std::span<const uint8_t> decode_value(
+    std::span<const uint8_t> value,
+    std::vector<uint8_t>& scratch);
+
+struct CodecStats {
+  uint64_t raw_bytes;
+  uint64_t encoded_bytes;
+  uint64_t encode_ns;
+  uint64_t decode_ns;
+
+  [[nodiscard]] double ratio() const {
+    if (encoded_bytes == 0) {
+      return 1.0;
+    }
+    return static_cast<double>(raw_bytes) /
+        static_cast<double>(encoded_bytes);
+  }
+};
+
+/**
+ * The counters of the compression ratio and the CPU time of a codec, updated
+ * by all io threads.
+ */
+class CodecCounters {
+ public:
+  void add_encode(uint64_t raw_bytes, uint64_t encoded_bytes, uint64_t ns) {
+    raw_bytes_.fetch_add(raw_bytes, std::memory_order_relaxed);
+    encoded_bytes_.fetch_add(encoded_bytes, std::memory_order_relaxed);
+    encode_ns_.fetch_add(ns, std::memory_order_relaxed);
+  }
+
+  void add_decode(uint64_t ns) {
+    decode_ns_.fetch_add(ns, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] CodecStats stats() const {
+    return CodecStats{
+        .raw_bytes = raw_bytes_.load(std::memory_order_relaxed),
+        .encoded_bytes = encoded_bytes_.load(std::memory_order_relaxed),
+        .encode_ns = encode_ns_.load(std::memory_order_relaxed),
+        .decode_ns = decode_ns_.load(std::memory_order_relaxed),
+    };
+  }
+
+ private:
+  std::atomic<uint64_t> raw_bytes_{0};
+  std::atomic<uint64_t> encoded_bytes_{0};
+  std::atomic<uint64_t> encode_ns_{0};
+  std::atomic<uint64_t> decode_ns_{0};
+};
+
+} // namespace torchrec::redis
@@ -8,7 +8,15 @@
 
 #include <torchrec/csrc/dynamic_embedding/details/redis/redis_io.h>
 #include <torchrec/csrc/dynamic_embedding/details/redis/url.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <numeric>
+#include <optional>
 #include <variant>
 
 namespace torchrec::redis {
@@ -17,6 +25,18 @@ int parse_integer(std::string_view param_str, std::string_view param_key) {
   return std::stoi(std::string(param_str.substr(param_key.size())));
 }
 
+bool parse_bool(std::string_view param_str, std::string_view param_key) {
+  auto param_value = param_str.substr(param_key.size());
+  if (param_value == "true" || param_value == "1") {
+    return true;
+  }
+  if (param_value == "false" || param_value == "0") {
+    return false;
+  }
+  throw std::invalid_argument(
+      "no boolean value (true, false, 1, 0) in " + std::string(param_str));
+}
+
 uint32_t parse_duration(
     std::string_view param_str,
     std::string_view param_key) {
@@ -86,6 +106,46 @@ Option parse_option(std::string_view config_str) {
         option.retry_limit = parse_integer(single_param_str, "retry_limit=");
       } else if (single_param_str.starts_with("chunk_size=")) {
         option.chunk_size = parse_integer(single_param_str, "chunk_size=");
+      } else if (single_param_str.starts_with("pipeline_jobs=")) {
+        option.pipeline_jobs =
+            parse_integer(single_param_str, "pipeline_jobs=");
+      } else if (single_param_str.starts_with("adaptive=")) {
+        option.adaptive = parse_bool(single_param_str, "adaptive=");
+      } else if (single_param_str.starts_with("min_chunk_size=")) {
+        option.min_chunk_size =
+            parse_integer(single_param_str, "min_chunk_size=");
+      } else if (single_param_str.starts_with("max_chunk_size=")) {
+        option.max_chunk_size =
+            parse_integer(single_param_str, "max_chunk_size=");
+      } else if (single_param_str.starts_with("max_pipeline_jobs=")) {
+        option.max_pipeline_jobs =
+            parse_integer(single_param_str, "max_pipeline_jobs=");
+      } else if (single_param_str.starts_with("target_latency=")) {
+        option.target_latency_ms =
+            parse_duration(single_param_str, "target_latency=");
+      } else if (single_param_str.starts_with("target_throughput=")) {
+        option.target_throughput_mbps =
+            parse_integer(single_param_str, "target_throughput=");
+      } else if (single_param_str.starts_with("codec=")) {
+        option.codec = parse_codec(single_param_str.substr(6));
+      } else if (single_param_str.starts_with("table_codec=")) {
+        // table_codec=<table_name>:<codec>
+        auto table_codec = single_param_str.substr(12);
+        auto colon_pos = table_codec.rfind(':');
+        if (colon_pos == std::string_view::npos) {
+          throw std::invalid_argument(
+              "table_codec should be table_name:codec, got " +
+              std::string(table_codec));
+        }
+        option.table_codecs[std::string(table_codec.substr(0, colon_pos))] =
+            parse_codec(table_codec.substr(colon_pos + 1));
+      } else if (single_param_str.starts_with("codec_element_size=")) {
+        option.codec_element_size =
+            parse_integer(single_param_str, "codec_element_size=");
+      } else if (single_param_str.starts_with("cluster=")) {
+        option.cluster = parse_bool(single_param_str, "cluster=");
+      } else if (single_param_str.starts_with("hash_tag=")) {
+        option.hash_tag = parse_bool(single_param_str, "hash_tag=");
       } else {
         throw std::invalid_argument(
             "unknown parameter: " + std::string(single_param_str));
@@ -96,50 +156,370 @@ Option parse_option(std::string_view config_str) {
   return option;
 }
 
+struct CommandDeleter {
+  void operator()(char* command) {
+    redisFreeCommand(command);
+  }
+};
+
+/**
+ * The connections of an io thread, to the server or to every node of the
+ * cluster. Each command is appended to the connection of the node serving its
+ * key, and the replies are read in the order of the commands.
+ *
+ * A redirected command is resent, and the slot map reloaded, on a separate
+ * connection, which has no pipelined command, so that the order of the
+ * replies is kept.
+ */
+class Redis::Connections {
+ public:
+  explicit Connections(Redis& redis) : redis_(redis) {
+    if (!redis_.opt_.cluster) {
+      single_ = redis_.connect({redis_.opt_.host, redis_.opt_.port});
+    }
+  }
+
+  void heartbeat() {
+    if (single_ != nullptr) {
+      redis_.heartbeat(single_, {redis_.opt_.host, redis_.opt_.port});
+      return;
+    }
+    for (auto* connections : {&connections_, &redirect_connections_}) {
+      for (auto& [address, connection] : *connections) {
+        redis_.heartbeat(connection, address);
+      }
+    }
+    // reconnected connections are looked up again.
+    node_connections_.clear();
+    slots_ = nullptr;
+  }
+
+  /**
+   * Use the latest slot map of the cluster. Must have no pending reply.
+   */
+  void sync_slots() {
+    if (single_ != nullptr) {
+      return;
+    }
+    auto slots = redis_.slots();
+    if (slots != slots_) {
+      slots_ = std::move(slots);
+      node_connections_.assign(slots_->nodes().size(), nullptr);
+    }
+  }
+
+  /**
+   * Reload the slot map of the cluster if a command of this round was moved.
+   * Must have no pending reply.
+   */
+  void refresh_moved_slots() {
+    if (!moved_to_.has_value()) {
+      return;
+    }
+    auto address = std::move(*moved_to_);
+    moved_to_.reset();
+    redis_.refresh_slots(connect_to(redirect_connections_, address));
+    sync_slots();
+  }
+
+  /**
+   * Append a command formatted by `redisFormatCommand`, taking its
+   * ownership.
+   */
+  void append(char* command, int len) {
+    std::unique_ptr<char, CommandDeleter> owned(command);
+    TORCH_CHECK(len >= 0, "format redis command error");
+    redisContext* connection = single_ != nullptr
+        ? single_.get()
+        : connection_of(key_slot(command_key({command, size_t(len)})));
+    TORCH_CHECK(
+        redisAppendFormattedCommand(connection, command, len) == REDIS_OK,
+        "append command error: ",
+        connection->errstr);
+    if (single_ != nullptr) {
+      // never redirected.
+      owned = nullptr;
+    }
+    pending_.push_back({connection, std::move(owned), len});
+  }
+
+  /**
+   * Write the appended commands to all the nodes, which then serve them in
+   * parallel.
+   */
+  void flush() {
+    if (single_ != nullptr) {
+      write(single_.get());
+      return;
+    }
+    for (auto& [address, connection] : connections_) {
+      write(connection.get());
+    }
+  }
+
+  /**
+   * The reply of the earliest command whose reply is not read.
+   */
+  helper::ReplyPtr get_reply() {
+    auto pending = std::move(pending_.front());
+    pending_.pop_front();
+    auto reply = read_reply(pending.connection);
+    for (uint32_t retry = 0; pending.command != nullptr &&
+         reply->type == REDIS_REPLY_ERROR && retry < redis_.opt_.retry_limit;
+         ++retry) {
+      auto redirect = parse_redirect({reply->str, reply->len});
+      if (!redirect.has_value()) {
+        break;
+      }
+      reply = resend(*redirect, pending);
+    }
+    TORCH_CHECK(
+        reply->type != REDIS_REPLY_ERROR,
+        "redis error: ",
+        std::string_view(reply->str, reply->len));
+    return reply;
+  }
+
+  /**
+   * Like `get_reply`, but returns nullptr instead of throwing on an error
+   * reply or a lost connection, so that a failed key only fails its request.
+   */
+  helper::ReplyPtr try_get_reply() {
+    try {
+      return get_reply();
+    } catch (const std::exception&) {
+      return nullptr;
+    }
+  }
+
+ private:
+  struct Pending {
+    redisContext* connection;
+    // the command, kept in the cluster mode to resend on redirects.
+    std::unique_ptr<char, CommandDeleter> command;
+    int len;
+  };
+
+  static void write(redisContext* connection) {
+    int done = 0;
+    while (!done) {
+      TORCH_CHECK(
+          redisBufferWrite(connection, &done) == REDIS_OK,
+          "write error: ",
+          connection->errstr);
+    }
+  }
+
+  static helper::ReplyPtr read_reply(redisContext* connection) {
+    void* reply;
+    int status = redisGetReply(connection, &reply);
+    TORCH_CHECK(
+        status != REDIS_ERR,
+        "get reply error: ",
+        connection->errstr,
+        ", from redis ",
+        connection->tcp.host,
+        ":",
+        connection->tcp.port);
+    return helper::ReplyPtr(reinterpret_cast<redisReply*>(reply));
+  }
+
+  redisContext* connect_to(
+      std::map<NodeAddress, helper::ContextPtr>& connections,
+      const NodeAddress& address) {
+    auto& connection = connections[address];
+    if (connection == nullptr) {
+      connection = redis_.connect(address);
+    }
+    return connection.get();
+  }
+
+  redisContext* connection_of(uint16_t slot) {
+    if (slots_ == nullptr) {
+      sync_slots();
+    }
+    int32_t node = slots_->node_of(slot);
+    if (node < 0) {
+      // the slot map is stale, e.g. a node was added. The connections of
+      // `connections_` may have commands of this round waiting for their
+      // replies, so the map is reloaded on an idle one.
+      redis_.refresh_slots(
+          connect_to(redirect_connections_, slots_->nodes().front()));
+      sync_slots();
+      node = slots_->node_of(slot);
+    }
+    TORCH_CHECK(node >= 0, "no redis cluster node serves slot ", slot);
+    auto& connection = node_connections_[node];
+    if (connection == nullptr) {
+      connection = connect_to(connections_, slots_->nodes()[node]);
+    }
+    return connection;
+  }
+
+  helper::ReplyPtr resend(const Redirect& redirect, const Pending& pending) {
+    redisContext* connection =
+        connect_to(redirect_connections_, redirect.address);
+    if (redirect.kind == RedirectKind::kAsk) {
+      redisAppendCommand(connection, "ASKING");
+    }
+    redisAppendFormattedCommand(
+        connection, pending.command.get(), pending.len);
+    if (redirect.kind == RedirectKind::kAsk) {
+      auto asking = read_reply(connection);
+      redis_.check_ok("asking error", asking);
+    }
+    auto reply = read_reply(connection);
+    if (redirect.kind == RedirectKind::kMoved) {
+      // A resharding moves many slots at once, so the map is reloaded once
+      // all the replies of the round are read, not on every redirect.
+      moved_to_ = redirect.address;
+    }
+    return reply;
+  }
+
+  Redis& redis_;
+  // only without the cluster mode.
+  helper::ContextPtr single_;
+  std::shared_ptr<const SlotMap> slots_;
+  // the connection of each node of `slots_`, connected on first use.
+  std::vector<redisContext*> node_connections_;
+  std::map<NodeAddress, helper::ContextPtr> connections_;
+  std::map<NodeAddress, helper::ContextPtr> redirect_connections_;
+  std::deque<Pending> pending_;
+  // the node of the last MOVED redirect of this round, if any.
+  std::optional<NodeAddress> moved_to_;
+};
+
 Redis::Redis(Option opt) : opt_(std::move(opt)) {
   TORCH_CHECK(opt_.num_io_threads != 0, "num_io_threads must not be empty");
   TORCH_CHECK(
       opt_.heart_beat_interval_ms != 0,
       "heart beat interval must not be zero.");
+  TORCH_CHECK(
+      opt_.codec_element_size != 0, "codec element size must not be zero");
+  TORCH_CHECK(
+      !opt_.cluster || opt_.db == 0, "redis cluster only supports db 0");
+  if (opt_.adaptive) {
+    controller_ = std::make_unique<ChunkController>(ChunkControllerOption{
+        .initial_chunk_size = opt_.chunk_size,
+        .min_chunk_size = opt_.min_chunk_size,
+        .max_chunk_size = opt_.max_chunk_size,
+        .initial_pipeline_jobs = opt_.pipeline_jobs,
+        .max_pipeline_jobs = opt_.max_pipeline_jobs,
+        .target_latency_us = opt_.target_latency_ms * 1000,
+        .target_throughput = opt_.target_throughput_mbps,
+    });
+  }
+  if (opt_.cluster) {
+    auto seed = connect({opt_.host, opt_.port});
+    refresh_slots(seed.get());
+  }
   for (size_t i = 0; i < opt_.num_io_threads; ++i) {
     start_thread();
   }
 }
 
 void Redis::start_thread() {
-  auto connection = connect();
-  heartbeat(connection);
+  auto connections = std::make_unique<Connections>(*this);
+  connections->heartbeat();
 
   io_threads_.emplace_back(
-      [connection = std::move(connection), this]() mutable {
+      [connections = std::move(connections), this]() mutable {
         std::chrono::milliseconds heart_beat(opt_.heart_beat_interval_ms);
         while (true) {
-          std::function<void(helper::ContextPtr&)> todo;
+          std::vector<Job> todo;
           bool heartbeat_timeout;
           {
             std::unique_lock<std::mutex> lock(this->jobs_mutex_);
             heartbeat_timeout = !jobs_not_empty_.wait_for(
-                lock, heart_beat, [this] { return !jobs_.empty(); });
+                lock, heart_beat, [this] {
+                  return stopped_ || !scheduled_tables_.empty();
+                });
             if (!heartbeat_timeout) {
-              todo = std::move(jobs_.front());
-              jobs_.pop_front();
+              // Coalesce jobs only when there is a backlog, so that the jobs
+              // are still spread over all io threads.
+              uint32_t pipeline_jobs = controller_ != nullptr
+                  ? controller_->pipeline_jobs()
+                  : opt_.pipeline_jobs;
+              uint32_t n = std::clamp(
+                  num_pending_jobs_ / opt_.num_io_threads,
+                  1U,
+                  std::max(pipeline_jobs, 1U));
+              todo = pop_jobs(n);
             }
           }
 
           if (heartbeat_timeout) {
-            heartbeat(connection);
+            connections->heartbeat();
             continue;
           }
 
-          if (!todo) {
+          // stopped and all jobs are done.
+          if (todo.empty()) {
             break;
           }
-          todo(connection);
+          auto begin = std::chrono::steady_clock::now();
+          RoundStats stats{.num_jobs = static_cast<uint32_t>(todo.size())};
+          connections->sync_slots();
+          for (auto& job : todo) {
+            job.append(*connections);
+            stats.num_keys += job.num_keys;
+          }
+          connections->flush();
+          for (auto& job : todo) {
+            stats.num_bytes += job.complete(*connections);
+          }
+          connections->refresh_moved_slots();
+          if (controller_ != nullptr) {
+            stats.latency_us =
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - begin)
+                    .count();
+            controller_->on_round(stats);
+          }
         }
       });
 }
 
-void Redis::heartbeat(helper::ContextPtr& connection) {
+void Redis::add_jobs(const std::string& table_name, std::vector<Job> jobs) {
+  if (jobs.empty()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(this->jobs_mutex_);
+    auto& table_jobs = jobs_[table_name];
+    if (table_jobs.empty()) {
+      scheduled_tables_.emplace_back(table_name);
+    }
+    num_pending_jobs_ += jobs.size();
+    for (auto& job : jobs) {
+      table_jobs.emplace_back(std::move(job));
+    }
+  }
+  jobs_not_empty_.notify_all();
+}
+
+std::vector<Redis::Job> Redis::pop_jobs(uint32_t n) {
+  std::vector<Job> result;
+  while (result.size() < n && !scheduled_tables_.empty()) {
+    std::string table_name = std::move(scheduled_tables_.front());
+    scheduled_tables_.pop_front();
+    auto it = jobs_.find(table_name);
+    result.emplace_back(std::move(it->second.front()));
+    it->second.pop_front();
+    --num_pending_jobs_;
+    if (it->second.empty()) {
+      jobs_.erase(it);
+    } else {
+      scheduled_tables_.emplace_back(std::move(table_name));
+    }
+  }
+  return result;
+}
+
+void Redis::heartbeat(
+    helper::ContextPtr& connection,
+    const NodeAddress& address) const {
   for (uint32_t retry = 0; retry < opt_.retry_limit; ++retry) {
     try {
       auto reply = helper::ReplyPtr(reinterpret_cast<redisReply*>(
@@ -151,27 +531,28 @@ void Redis::heartbeat(helper::ContextPtr& connection) {
       TORCH_CHECK(rsp == "PONG", "ping/pong error");
     } catch (...) {
       // reconnect if heart beat error
-      connection = connect();
+      connection = connect(address);
     }
   }
 }
 
-helper::ContextPtr Redis::connect() const {
+helper::ContextPtr Redis::connect(const NodeAddress& address) const {
   helper::ContextPtr connection;
   if (opt_.timeout_ms == 0) {
-    connection = helper::ContextPtr(redisConnect(opt_.host.c_str(), opt_.port));
+    connection =
+        helper::ContextPtr(redisConnect(address.host.c_str(), address.port));
   } else {
     struct timeval interval {};
     interval.tv_sec = opt_.timeout_ms / 1000;
     interval.tv_usec = opt_.timeout_ms % 1000 * 1000;
     connection = helper::ContextPtr(
-        redisConnectWithTimeout(opt_.host.c_str(), opt_.port, interval));
+        redisConnectWithTimeout(address.host.c_str(), address.port, interval));
   }
   TORCH_CHECK(
       !connection->err,
       "connect to %s:%d error occurred %s",
-      opt_.host,
-      opt_.port,
+      address.host,
+      address.port,
       connection->errstr);
 
   if (!opt_.password.empty()) {
@@ -198,9 +579,52 @@ helper::ContextPtr Redis::connect() const {
   return connection;
 }
 
+void Redis::refresh_slots(redisContext* connection) {
+  auto reply = helper::ReplyPtr(
+      reinterpret_cast<redisReply*>(redisCommand(connection, "CLUSTER SLOTS")));
+  TORCH_CHECK(
+      reply && reply->type == REDIS_REPLY_ARRAY,
+      "CLUSTER SLOTS error, is redis://",
+      opt_.host,
+      ":",
+      opt_.port,
+      " in cluster mode?");
+  auto slots = std::make_shared<SlotMap>();
+  for (size_t i = 0; i < reply->elements; ++i) {
+    // [begin, end, [host, port, id], replicas...]
+    const redisReply* range = reply->element[i];
+    TORCH_CHECK(
+        range->type == REDIS_REPLY_ARRAY && range->elements >= 3 &&
+            range->element[2]->type == REDIS_REPLY_ARRAY &&
+            range->element[2]->elements >= 2,
+        "unexpected CLUSTER SLOTS reply");
+    const redisReply* node = range->element[2];
+    NodeAddress address{
+        std::string(node->element[0]->str, node->element[0]->len),
+        static_cast<uint16_t>(node->element[1]->integer)};
+    if (address.host.empty()) {
+      // the node replying the command.
+      address.host = connection->tcp.host;
+    }
+    slots->assign(
+        static_cast<uint16_t>(range->element[0]->integer),
+        static_cast<uint16_t>(range->element[1]->integer),
+        address);
+  }
+  TORCH_CHECK(!slots->nodes().empty(), "redis cluster has no node");
+  std::lock_guard<std::mutex> guard(slots_mutex_);
+  slots_ = std::move(slots);
+}
+
+std::shared_ptr<const SlotMap> Redis::slots() const {
+  std::lock_guard<std::mutex> guard(slots_mutex_);
+  return slots_;
+}
+
 Redis::~Redis() {
-  for (uint32_t i = 0; i < opt_.num_io_threads; ++i) {
-    jobs_.emplace_back();
+  {
+    std::lock_guard<std::mutex> guard(this->jobs_mutex_);
+    stopped_ = true;
   }
   jobs_not_empty_.notify_all();
   for (auto& th : io_threads_) {
@@ -217,6 +641,65 @@ static uint32_t CalculateChunkSizeByGlobalIDs(
       chunk_size / std::max(num_cols, low) / std::max(num_os, low), low);
 }
 
+uint32_t Redis::chunk_size_of(
+    uint32_t num_global_ids,
+    uint32_t num_cols,
+    uint32_t num_optimizer_states) const {
+  if (controller_ == nullptr) {
+    return CalculateChunkSizeByGlobalIDs(
+        opt_.chunk_size, num_cols, num_optimizer_states);
+  }
+  uint32_t chunk_size = CalculateChunkSizeByGlobalIDs(
+      controller_->chunk_size(), num_cols, num_optimizer_states);
+  // Keep every io thread busy, a larger chunk would only serialize the
+  // request on fewer connections.
+  uint32_t per_thread =
+      (num_global_ids + opt_.num_io_threads - 1) / opt_.num_io_threads;
+  return std::clamp(per_thread, 1U, chunk_size);
+}
+
+Codec Redis::codec_of(const std::string& table_name) const {
+  auto it = opt_.table_codecs.find(table_name);
+  return it != opt_.table_codecs.end() ? it->second : opt_.codec;
+}
+
+const char* Redis::get_format() const {
+  return opt_.hash_tag ? "GET %s_table_{%s}_gid_%d_cid_%d_osid_%d"
+                       : "GET %s_table_%s_gid_%d_cid_%d_osid_%d";
+}
+
+const char* Redis::set_format() const {
+  return opt_.hash_tag ? "SET %s_table_{%s}_gid_%d_cid_%d_osid_%d %b"
+                       : "SET %s_table_%s_gid_%d_cid_%d_osid_%d %b";
+}
+
+static uint64_t elapsed_ns(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - begin)
+      .count();
+}
+
+static uint32_t num_keys_per_global_id(uint32_t num_cols, uint32_t num_os) {
+  return std::max(num_cols, 1U) * num_os;
+}
+
+std::span<const uint8_t> Redis::encode(
+    Codec codec,
+    std::span<const uint8_t> raw) const {
+  if (codec == Codec::kNone) {
+    return raw;
+  }
+  static thread_local std::vector<uint8_t> encoded;
+  auto begin = std::chrono::steady_clock::now();
+  // values that do not compress are stored as is.
+  std::span<const uint8_t> value = raw;
+  if (encode_value(codec, opt_.codec_element_size, raw, encoded)) {
+    value = encoded;
+  }
+  codec_counters_.add_encode(raw.size(), value.size(), elapsed_ns(begin));
+  return value;
+}
+
 struct RedisFetchContext {
   std::atomic<uint32_t> num_complete_ids{0};
   uint32_t chunk_size;
@@ -234,10 +717,7 @@ struct RedisFetchContext {
   void (*on_all_fetched)(void* ctx);
 
   explicit RedisFetchContext(uint32_t chunk_size, IOFetchParameter param)
-      : chunk_size(CalculateChunkSizeByGlobalIDs(
-            chunk_size,
-            param.num_cols,
-            param.num_optimizer_states)),
+      : chunk_size(chunk_size),
         table_name(param.table_name),
         global_ids(param.global_ids, param.global_ids + param.num_global_ids),
         num_optimizer_states(param.num_optimizer_states),
@@ -254,86 +734,124 @@ struct RedisFetchContext {
 };
 
 void Redis::fetch(IOFetchParameter param) {
-  auto* fetch_param = new RedisFetchContext(opt_.chunk_size, param);
-  {
-    std::lock_guard<std::mutex> guard(this->jobs_mutex_);
-    for (uint32_t i = 0; i < param.num_global_ids;
-         i += fetch_param->chunk_size) {
-      jobs_.emplace_back(
-          [i, fetch_param, this](helper::ContextPtr& connection) {
-            do_fetch(i, fetch_param, connection);
-          });
-    }
+  auto* fetch_param = new RedisFetchContext(
+      chunk_size_of(
+          param.num_global_ids, param.num_cols, param.num_optimizer_states),
+      param);
+  uint32_t keys_per_gid =
+      num_keys_per_global_id(param.num_cols, param.num_optimizer_states);
+  std::vector<Job> jobs;
+  for (uint32_t i = 0; i < param.num_global_ids; i += fetch_param->chunk_size) {
+    uint32_t num_gids =
+        std::min(fetch_param->chunk_size, param.num_global_ids - i);
+    jobs.emplace_back(Job{
+        .append =
+            [i, fetch_param, this](Connections& connections) {
+              append_fetch(i, fetch_param, connections);
+            },
+        .complete =
+            [i, fetch_param, this](Connections& connections) {
+              return complete_fetch(i, fetch_param, connections);
+            },
+        .num_keys = num_gids * keys_per_gid,
+    });
   }
-  jobs_not_empty_.notify_all();
+  add_jobs(fetch_param->table_name, std::move(jobs));
 }
 
-void Redis::do_fetch(
+template <typename Callback>
+static void for_each_fetch_key(
+    const RedisFetchContext& fetch_param,
     uint32_t gid_offset,
-    void* fetch_param_void,
-    helper::ContextPtr& connection) const {
-  auto& fetch_param = *reinterpret_cast<RedisFetchContext*>(fetch_param_void);
-
+    Callback&& callback) {
   uint32_t end = std::min(
       gid_offset + fetch_param.chunk_size,
       static_cast<uint32_t>(fetch_param.global_ids.size()));
-
-  auto loop = [&](auto&& callback) {
-    for (uint32_t i = gid_offset; i < end; ++i) {
-      int64_t gid = fetch_param.global_ids[i];
-      for (uint32_t j = 0; j < fetch_param.col_ids.size(); ++j) {
-        auto& col_id = fetch_param.col_ids[j];
-        for (uint32_t os_id = 0; os_id < fetch_param.num_optimizer_states;
-             ++os_id) {
-          callback(i * fetch_param.col_ids.size() + j, gid, col_id, os_id);
-        }
+  for (uint32_t i = gid_offset; i < end; ++i) {
+    int64_t gid = fetch_param.global_ids[i];
+    for (uint32_t j = 0; j < fetch_param.col_ids.size(); ++j) {
+      auto& col_id = fetch_param.col_ids[j];
+      for (uint32_t os_id = 0; os_id < fetch_param.num_optimizer_states;
+           ++os_id) {
+        callback(i * fetch_param.col_ids.size() + j, gid, col_id, os_id);
       }
     }
+  }
+}
+
+void Redis::append_fetch(
+    uint32_t gid_offset,
+    void* fetch_param_void,
+    Connections& connections) const {
+  auto& fetch_param = *reinterpret_cast<RedisFetchContext*>(fetch_param_void);
+  auto loop = [&](auto&& callback) {
+    for_each_fetch_key(fetch_param, gid_offset, callback);
   };
 
+  const char* format = get_format();
   loop([&](uint32_t offset, int64_t gid, uint32_t col_id, uint32_t os_id) {
-    redisAppendCommand(
-        connection.get(),
-        "GET %s_table_%s_gid_%d_cid_%d_osid_%d",
+    char* command;
+    int len = redisFormatCommand(
+        &command,
+        format,
         opt_.prefix.c_str(),
         fetch_param.table_name.c_str(),
         gid,
         col_id,
         os_id);
+    connections.append(command, len);
   });
+}
+
+uint64_t Redis::complete_fetch(
+    uint32_t gid_offset,
+    void* fetch_param_void,
+    Connections& connections) const {
+  auto& fetch_param = *reinterpret_cast<RedisFetchContext*>(fetch_param_void);
+  auto loop = [&](auto&& callback) {
+    for_each_fetch_key(fetch_param, gid_offset, callback);
+  };
 
-  void* reply;
+  // Values are decoded even if the table has no codec now, as they may be
+  // pushed when it had one. Only the decoding of the tables with a codec is
+  // counted.
+  bool has_codec = codec_of(fetch_param.table_name) != Codec::kNone;
+  static thread_local std::vector<uint8_t> scratch;
+  uint64_t num_bytes = 0;
   loop([&](uint32_t offset, int64_t gid, uint32_t col_id, uint32_t os_id) {
-    int status = redisGetReply(connection.get(), &reply);
-    TORCH_CHECK(
-        status != REDIS_ERR,
-        "get reply error: %s, from redis %s, %d",
-        connection->errstr,
-        opt_.host,
-        opt_.port);
-    auto reply_ptr = helper::ReplyPtr(reinterpret_cast<redisReply*>(reply));
+    auto reply_ptr = connections.get_reply();
 
     if (reply_ptr->type == REDIS_REPLY_NIL) {
       fetch_param.on_global_id_fetched(
           fetch_param.on_complete_context, offset, os_id, nullptr, 0);
     } else {
+      num_bytes += reply_ptr->len;
+      auto begin = std::chrono::steady_clock::now();
+      auto value = decode_value(
+          {reinterpret_cast<const uint8_t*>(reply_ptr->str), reply_ptr->len},
+          scratch);
+      if (has_codec) {
+        codec_counters_.add_decode(elapsed_ns(begin));
+      }
       fetch_param.on_global_id_fetched(
           fetch_param.on_complete_context,
           offset,
           os_id,
-          reply_ptr->str,
-          reply_ptr->len);
+          const_cast<uint8_t*>(value.data()),
+          value.size());
     }
   });
 
-  uint32_t n = end - gid_offset;
   uint32_t target = fetch_param.global_ids.size();
+  uint32_t n = std::min(gid_offset + fetch_param.chunk_size, target) -
+      gid_offset;
 
   if (fetch_param.num_complete_ids.fetch_add(n) + n ==
       target) { // last fetch complete
     fetch_param.on_all_fetched(fetch_param.on_complete_context);
     delete &fetch_param;
   }
+  return num_bytes;
 }
 
 struct RedisPushContext {
@@ -349,10 +867,7 @@ struct RedisPushContext {
   void (*on_push_complete)(void*);
 
   RedisPushContext(uint32_t chunk_size, IOPushParameter param)
-      : chunk_size(CalculateChunkSizeByGlobalIDs(
-            chunk_size,
-            param.num_cols,
-            param.num_optimizer_states)),
+      : chunk_size(chunk_size),
         table_name(param.table_name),
         global_ids(param.global_ids, param.num_global_ids),
         os_ids(param.optimizer_state_ids, param.num_optimizer_states),
@@ -370,80 +885,421 @@ struct RedisPushContext {
 };
 
 void Redis::push(IOPushParameter param) {
-  auto* ctx = new RedisPushContext(opt_.chunk_size, param);
-  {
-    std::lock_guard<std::mutex> guard(this->jobs_mutex_);
-    for (uint32_t i = 0; i < param.num_global_ids; i += ctx->chunk_size) {
-      jobs_.emplace_back([i, ctx, this](helper::ContextPtr& connection) {
-        do_push(i, ctx, connection);
-      });
-    }
+  auto* ctx = new RedisPushContext(
+      chunk_size_of(
+          param.num_global_ids, param.num_cols, param.num_optimizer_states),
+      param);
+  uint32_t keys_per_gid =
+      num_keys_per_global_id(param.num_cols, param.num_optimizer_states);
+  std::vector<Job> jobs;
+  for (uint32_t i = 0; i < param.num_global_ids; i += ctx->chunk_size) {
+    uint32_t num_gids = std::min(ctx->chunk_size, param.num_global_ids - i);
+    jobs.emplace_back(Job{
+        .append =
+            [i, ctx, this](Connections& connections) {
+              append_push(i, ctx, connections);
+            },
+        .complete =
+            [i, ctx, this](Connections& connections) {
+              return complete_push(i, ctx, connections);
+            },
+        .num_keys = num_gids * keys_per_gid,
+    });
   }
-  jobs_not_empty_.notify_all();
+  add_jobs(ctx->table_name, std::move(jobs));
 }
-void Redis::do_push(
-    uint32_t gid_offset,
-    void* push_ctx_ptr,
-    helper::ContextPtr& connection) const {
-  auto& push_ctx = *reinterpret_cast<RedisPushContext*>(push_ctx_ptr);
 
+template <typename Callback>
+static void for_each_push_key(
+    const RedisPushContext& push_ctx,
+    uint32_t gid_offset,
+    Callback&& callback) {
   uint32_t end = gid_offset + push_ctx.chunk_size;
   if (end > push_ctx.global_ids.size()) {
     end = push_ctx.global_ids.size();
   }
+  for (uint32_t i = gid_offset; i < end; ++i) {
+    int64_t gid = push_ctx.global_ids[i];
+    for (uint32_t j = 0; j < push_ctx.col_ids.size(); ++j) {
+      int64_t cid = push_ctx.col_ids[j];
+      for (uint32_t k = 0; k < push_ctx.os_ids.size(); ++k) {
+        uint32_t os_id = push_ctx.os_ids[k];
 
-  auto loop = [&](auto&& callback) {
-    for (uint32_t i = gid_offset; i < end; ++i) {
-      int64_t gid = push_ctx.global_ids[i];
-      for (uint32_t j = 0; j < push_ctx.col_ids.size(); ++j) {
-        int64_t cid = push_ctx.col_ids[j];
-        for (uint32_t k = 0; k < push_ctx.os_ids.size(); ++k) {
-          uint32_t os_id = push_ctx.os_ids[k];
-
-          uint32_t offset = k + j * push_ctx.os_ids.size() +
-              i * push_ctx.col_ids.size() * push_ctx.os_ids.size();
-          callback(offset, gid, cid, os_id);
-        }
+        uint32_t offset = k + j * push_ctx.os_ids.size() +
+            i * push_ctx.col_ids.size() * push_ctx.os_ids.size();
+        callback(offset, gid, cid, os_id);
       }
     }
+  }
+}
+
+void Redis::append_push(
+    uint32_t gid_offset,
+    void* push_ctx_ptr,
+    Connections& connections) const {
+  auto& push_ctx = *reinterpret_cast<RedisPushContext*>(push_ctx_ptr);
+  auto loop = [&](auto&& callback) {
+    for_each_push_key(push_ctx, gid_offset, callback);
   };
 
+  const char* format = set_format();
+  Codec codec = codec_of(push_ctx.table_name);
   loop([&](uint32_t o, int64_t gid, int64_t cid, uint32_t os_id) {
     uint64_t beg = push_ctx.offsets[o];
     uint64_t end = push_ctx.offsets[o + 1];
+    auto value = encode(
+        codec,
+        {reinterpret_cast<const uint8_t*>(push_ctx.data) + beg, end - beg});
 
-    redisAppendCommand(
-        connection.get(),
-        "SET %s_table_%s_gid_%d_cid_%d_osid_%d %b",
+    char* command;
+    int len = redisFormatCommand(
+        &command,
+        format,
         opt_.prefix.c_str(),
         push_ctx.table_name.c_str(),
         gid,
         cid,
         os_id,
-        reinterpret_cast<const uint8_t*>(push_ctx.data) + beg,
-        static_cast<size_t>(end - beg));
+        value.data(),
+        value.size());
+    connections.append(command, len);
   });
+}
 
-  void* replay_ptr;
-  loop([&](...) {
-    int status = redisGetReply(connection.get(), &replay_ptr);
-    TORCH_CHECK(
-        status != REDIS_ERR,
-        "get reply error: %s, from redis %s, %d",
-        connection->errstr,
-        opt_.host,
-        opt_.port);
-    helper::ReplyPtr reply(reinterpret_cast<redisReply*>(replay_ptr));
-    check_status("reply should be ok", connection, reply);
+uint64_t Redis::complete_push(
+    uint32_t gid_offset,
+    void* push_ctx_ptr,
+    Connections& connections) const {
+  auto& push_ctx = *reinterpret_cast<RedisPushContext*>(push_ctx_ptr);
+  auto loop = [&](auto&& callback) {
+    for_each_push_key(push_ctx, gid_offset, callback);
+  };
+
+  uint64_t num_bytes = 0;
+  loop([&](uint32_t o, ...) {
+    num_bytes += push_ctx.offsets[o + 1] - push_ctx.offsets[o];
+    check_ok("reply should be ok", connections.get_reply());
   });
 
-  uint32_t n = end - gid_offset;
   uint32_t target = push_ctx.global_ids.size();
+  uint32_t n = std::min(gid_offset + push_ctx.chunk_size, target) - gid_offset;
   if (push_ctx.num_complete_ids.fetch_add(n) + n == target) {
     push_ctx.on_push_complete(push_ctx.on_complete_context);
     delete &push_ctx;
   }
+  return num_bytes;
 }
+
+/**
+ * A request of a v2 fetch or push, whose ids are copied as they are only
+ * valid during the call.
+ */
+struct RedisRequestV2 {
+  std::string table_name;
+  std::vector<int64_t> global_ids;
+  // {-1} if the table is not sharded by column.
+  std::vector<int64_t> col_ids;
+  std::vector<uint32_t> optimizer_state_ids;
+  uint32_t row_bytes;
+  uint32_t chunk_size;
+  // `dst` of a fetch or `src` of a push.
+  uint8_t* rows;
+  // `found` of a fetch or `pushed` of a push, which may be nullptr.
+  uint64_t* bitmap;
+
+  RedisRequestV2(
+      const char* table_name,
+      std::span<const int64_t> global_ids,
+      std::span<const int64_t> col_ids,
+      std::vector<uint32_t> optimizer_state_ids,
+      uint32_t row_bytes,
+      void* rows,
+      uint64_t* bitmap)
+      : table_name(table_name),
+        global_ids(global_ids.begin(), global_ids.end()),
+        col_ids(col_ids.begin(), col_ids.end()),
+        optimizer_state_ids(std::move(optimizer_state_ids)),
+        row_bytes(row_bytes),
+        rows(reinterpret_cast<uint8_t*>(rows)),
+        bitmap(bitmap) {
+    if (this->col_ids.empty()) {
+      this->col_ids.emplace_back(-1);
+    }
+  }
+};
+
+struct RedisContextV2 {
+  std::vector<RedisRequestV2> requests;
+  std::atomic<uint32_t> num_pending_jobs{0};
+  std::atomic<bool> failed{false};
+  void* on_complete_context;
+  IOCompleteCallback on_complete;
+
+  /**
+   * Called when a job completes, the last one completes the whole fetch or
+   * push and deletes the context.
+   */
+  void on_job_complete() {
+    if (num_pending_jobs.fetch_sub(1) != 1) {
+      return;
+    }
+    on_complete(on_complete_context, failed ? k_io_error : k_io_ok);
+    delete this;
+  }
+};
+
+/**
+ * Call `callback(row, k, gid, cid, os_id)` for the k-th optimizer state of
+ * every row of the chunk of `request` from `gid_offset`.
+ */
+template <typename Callback>
+static void for_each_key_v2(
+    const RedisRequestV2& request,
+    uint32_t gid_offset,
+    Callback&& callback) {
+  uint32_t end = std::min(
+      gid_offset + request.chunk_size,
+      static_cast<uint32_t>(request.global_ids.size()));
+  auto num_cols = static_cast<uint32_t>(request.col_ids.size());
+  auto num_os = static_cast<uint32_t>(request.optimizer_state_ids.size());
+  for (uint32_t i = gid_offset; i < end; ++i) {
+    for (uint32_t j = 0; j < num_cols; ++j) {
+      uint32_t row = i * num_cols + j;
+      for (uint32_t k = 0; k < num_os; ++k) {
+        callback(
+            row,
+            k,
+            request.global_ids[i],
+            request.col_ids[j],
+            request.optimizer_state_ids[k]);
+      }
+    }
+  }
+}
+
+// The value of the k-th optimizer state of `row` in `request.rows`.
+static uint8_t* value_of(
+    const RedisRequestV2& request,
+    uint32_t row,
+    uint32_t k) {
+  uint64_t num_os = request.optimizer_state_ids.size();
+  return request.rows + (row * num_os + k) * request.row_bytes;
+}
+
+// Set a bit of a bitmap shared with the other io threads.
+static void set_shared_bit(uint64_t* bitmap, uint32_t bit) {
+  std::atomic_ref<uint64_t>(bitmap[bit / 64])
+      .fetch_or(uint64_t{1} << (bit % 64), std::memory_order_relaxed);
+}
+
+void Redis::add_jobs_v2(void* ctx_ptr, bool fetch) {
+  auto* ctx = reinterpret_cast<RedisContextV2*>(ctx_ptr);
+  std::vector<std::pair<std::string, std::vector<Job>>> table_jobs;
+  uint32_t num_jobs = 0;
+  for (uint32_t r = 0; r < ctx->requests.size(); ++r) {
+    auto& request = ctx->requests[r];
+    auto num_gids = static_cast<uint32_t>(request.global_ids.size());
+    auto num_cols = static_cast<uint32_t>(request.col_ids.size());
+    auto num_os = static_cast<uint32_t>(request.optimizer_state_ids.size());
+    request.chunk_size = chunk_size_of(num_gids, num_cols, num_os);
+    std::vector<Job> jobs;
+    for (uint32_t i = 0; i < num_gids; i += request.chunk_size) {
+      jobs.emplace_back(Job{
+          .append =
+              [ctx, r, i, fetch, this](Connections& connections) {
+                append_v2(ctx, r, i, fetch, connections);
+              },
+          .complete =
+              [ctx, r, i, fetch, this](Connections& connections) {
+                uint64_t num_bytes = fetch
+                    ? complete_fetch_v2(ctx, r, i, connections)
+                    : complete_push_v2(ctx, r, i, connections);
+                ctx->on_job_complete();
+                return num_bytes;
+              },
+          .num_keys = std::min(request.chunk_size, num_gids - i) * num_cols *
+              num_os,
+      });
+    }
+    num_jobs += jobs.size();
+    table_jobs.emplace_back(request.table_name, std::move(jobs));
+  }
+  if (num_jobs == 0) {
+    ctx->on_complete(ctx->on_complete_context, k_io_ok);
+    delete ctx;
+    return;
+  }
+  // All jobs are counted before any is scheduled, as the jobs of a request
+  // may complete before the next request is scheduled.
+  ctx->num_pending_jobs = num_jobs;
+  for (auto& [table_name, jobs] : table_jobs) {
+    add_jobs(table_name, std::move(jobs));
+  }
+}
+
+void Redis::fetch_v2(IOFetchParameterV2 param) {
+  auto* ctx = new RedisContextV2{
+      .on_complete_context = param.on_complete_context,
+      .on_complete = param.on_complete,
+  };
+  for (uint32_t r = 0; r < param.num_requests; ++r) {
+    auto& request = param.requests[r];
+    std::vector<uint32_t> os_ids(request.num_optimizer_states);
+    std::iota(os_ids.begin(), os_ids.end(), 0);
+    ctx->requests.emplace_back(
+        request.table_name,
+        std::span(request.global_ids, request.num_global_ids),
+        std::span(request.col_ids, request.num_cols),
+        std::move(os_ids),
+        request.row_bytes,
+        request.dst,
+        request.found);
+  }
+  add_jobs_v2(ctx, true);
+}
+
+void Redis::push_v2(IOPushParameterV2 param) {
+  auto* ctx = new RedisContextV2{
+      .on_complete_context = param.on_complete_context,
+      .on_complete = param.on_complete,
+  };
+  for (uint32_t r = 0; r < param.num_requests; ++r) {
+    auto& request = param.requests[r];
+    ctx->requests.emplace_back(
+        request.table_name,
+        std::span(request.global_ids, request.num_global_ids),
+        std::span(request.col_ids, request.num_cols),
+        std::vector<uint32_t>(
+            request.optimizer_state_ids,
+            request.optimizer_state_ids + request.num_optimizer_states),
+        request.row_bytes,
+        const_cast<void*>(request.src),
+        request.pushed);
+  }
+  add_jobs_v2(ctx, false);
+}
+
+void Redis::append_v2(
+    void* ctx_ptr,
+    uint32_t request_id,
+    uint32_t gid_offset,
+    bool fetch,
+    Connections& connections) const {
+  auto& request =
+      reinterpret_cast<RedisContextV2*>(ctx_ptr)->requests[request_id];
+  Codec codec = codec_of(request.table_name);
+  for_each_key_v2(
+      request,
+      gid_offset,
+      [&](uint32_t row,
+          uint32_t k,
+          int64_t gid,
+          int64_t cid,
+          uint32_t os_id) {
+        char* command;
+        int len;
+        if (fetch) {
+          len = redisFormatCommand(
+              &command,
+              get_format(),
+              opt_.prefix.c_str(),
+              request.table_name.c_str(),
+              gid,
+              cid,
+              os_id);
+        } else {
+          auto value =
+              encode(codec, {value_of(request, row, k), request.row_bytes});
+          len = redisFormatCommand(
+              &command,
+              set_format(),
+              opt_.prefix.c_str(),
+              request.table_name.c_str(),
+              gid,
+              cid,
+              os_id,
+              value.data(),
+              value.size());
+        }
+        connections.append(command, len);
+      });
+}
+
+uint64_t Redis::complete_fetch_v2(
+    void* ctx_ptr,
+    uint32_t request_id,
+    uint32_t gid_offset,
+    Connections& connections) const {
+  auto& ctx = *reinterpret_cast<RedisContextV2*>(ctx_ptr);
+  auto& request = ctx.requests[request_id];
+  bool has_codec = codec_of(request.table_name) != Codec::kNone;
+  static thread_local std::vector<uint8_t> scratch;
+  uint64_t num_bytes = 0;
+  uint32_t num_found = 0;
+  auto num_os = static_cast<uint32_t>(request.optimizer_state_ids.size());
+  for_each_key_v2(
+      request,
+      gid_offset,
+      [&](uint32_t row, uint32_t k, ...) {
+        if (k == 0) {
+          num_found = 0;
+        }
+        auto reply = connections.try_get_reply();
+        if (reply != nullptr && reply->type == REDIS_REPLY_NIL) {
+          return;
+        }
+        if (reply == nullptr || reply->type != REDIS_REPLY_STRING) {
+          ctx.failed = true;
+          return;
+        }
+        num_bytes += reply->len;
+        auto begin = std::chrono::steady_clock::now();
+        auto value = decode_value(
+            {reinterpret_cast<const uint8_t*>(reply->str), reply->len},
+            scratch);
+        if (has_codec) {
+          codec_counters_.add_decode(elapsed_ns(begin));
+        }
+        if (value.size() != request.row_bytes) {
+          ctx.failed = true;
+          return;
+        }
+        memcpy(value_of(request, row, k), value.data(), value.size());
+        if (++num_found == num_os) {
+          set_shared_bit(request.bitmap, row);
+        }
+      });
+  return num_bytes;
+}
+
+uint64_t Redis::complete_push_v2(
+    void* ctx_ptr,
+    uint32_t request_id,
+    uint32_t gid_offset,
+    Connections& connections) const {
+  auto& ctx = *reinterpret_cast<RedisContextV2*>(ctx_ptr);
+  auto& request = ctx.requests[request_id];
+  uint64_t num_bytes = 0;
+  uint32_t num_pushed = 0;
+  auto num_os = static_cast<uint32_t>(request.optimizer_state_ids.size());
+  for_each_key_v2(request, gid_offset, [&](uint32_t row, uint32_t k, ...) {
+    if (k == 0) {
+      num_pushed = 0;
+    }
+    auto reply = connections.try_get_reply();
+    if (reply == nullptr || reply->type != REDIS_REPLY_STATUS ||
+        std::string_view(reply->str, reply->len) != "OK") {
+      ctx.failed = true;
+      return;
+    }
+    num_bytes += request.row_bytes;
+    if (++num_pushed == num_os && request.bitmap != nullptr) {
+      set_shared_bit(request.bitmap, row);
+    }
+  });
+  return num_bytes;
+}
+
 void Redis::check_status(
     std::string_view label,
     helper::ContextPtr& connection,
@@ -454,10 +1310,14 @@ void Redis::check_status(
       " connection error: (",
       connection->errstr,
       "), from redis://",
-      opt_.host,
+      connection->tcp.host,
       ":",
-      opt_.port);
+      connection->tcp.port);
+  check_ok(label, reply);
+}
 
+void Redis::check_ok(std::string_view label, const helper::ReplyPtr& reply)
+    const {
   TORCH_CHECK(
       reply->type == REDIS_REPLY_STATUS,
       label,
@@ -500,6 +1360,24 @@ void IO_Fetch(void* instance, IOFetchParameter param) {
 void IO_Push(void* instance, IOPushParameter param) {
   reinterpret_cast<Redis*>(instance)->push(param);
 }
+
+void IO_Fetch_v2(void* instance, IOFetchParameterV2 param) {
+  reinterpret_cast<Redis*>(instance)->fetch_v2(param);
+}
+
+void IO_Push_v2(void* instance, IOPushParameterV2 param) {
+  reinterpret_cast<Redis*>(instance)->push_v2(param);
+}
+
+void IO_Stats(void* instance, void* ctx, IOStatCallback on_stat) {
+  auto stats = reinterpret_cast<Redis*>(instance)->codec_stats();
+  on_stat(ctx, "codec_raw_bytes", static_cast<double>(stats.raw_bytes));
+  on_stat(
+      ctx, "codec_encoded_bytes", static_cast<double>(stats.encoded_bytes));
+  on_stat(ctx, "codec_ratio", stats.ratio());
+  on_stat(ctx, "codec_encode_seconds", stats.encode_ns / 1e9);
+  on_stat(ctx, "codec_decode_seconds", stats.decode_ns / 1e9);
+}
 }
 
 } // namespace torchrec::redis
@@ -7,15 +7,22 @@
  */
 
 #pragma once
+#include <c10/util/flat_hash_map.h>
 #include <hiredis.h>
 #include <torchrec/csrc/dynamic_embedding/details/io_parameter.h>
+#include <torchrec/csrc/dynamic_embedding/details/redis/chunk_controller.h>
+#include <torchrec/csrc/dynamic_embedding/details/redis/cluster.h>
+#include <torchrec/csrc/dynamic_embedding/details/redis/codec.h>
 #include <condition_variable>
 #include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <span>
 #include <string>
 #include <string_view>
 #include <thread>
+#include <vector>
 
 namespace torchrec::redis {
 
@@ -32,6 +39,30 @@ struct Option {
   uint32_t heart_beat_interval_ms{100000};
   uint32_t retry_limit{3};
   uint32_t chunk_size{100};
+  // max number of chunks, possibly of different tables, sent in one pipeline.
+  uint32_t pipeline_jobs{4};
+  // Tune the chunk size and the pipeline jobs by the measured latency and
+  // throughput, within the bounds below. `chunk_size` and `pipeline_jobs` are
+  // then the initial values.
+  bool adaptive{false};
+  uint32_t min_chunk_size{10};
+  uint32_t max_chunk_size{10000};
+  uint32_t max_pipeline_jobs{16};
+  uint32_t target_latency_ms{5};
+  // in MB/s, 0 for no target.
+  uint32_t target_throughput_mbps{0};
+  // the codec of the values of all tables, unless set in `table_codecs`.
+  Codec codec{Codec::kNone};
+  ska::flat_hash_map<std::string, Codec> table_codecs;
+  // the size of the elements for the byte shuffle, 4 for float.
+  uint8_t codec_element_size{4};
+  // `host:port` is a node of a redis cluster. The commands are routed to the
+  // nodes by the slot map of the cluster, following its redirects.
+  bool cluster{false};
+  // Wrap the table name of the keys in a hash tag, so that all the keys of a
+  // table are on the same node of a cluster. Fits many small tables better,
+  // but the keys differ from the ones without hash tag.
+  bool hash_tag{false};
 };
 
 Option parse_option(std::string_view config_str);
@@ -70,29 +101,138 @@ class Redis {
 
   void push(IOPushParameter param);
 
+  /**
+   * Fetch the rows of all the requests directly into their `dst`, see
+   * `IOFetchParameterV2`. The chunks of the requests are scheduled like the
+   * v1 fetches. A key that fails, e.g. on an error reply or a value of
+   * another size than `row_bytes`, leaves its id unset in `found`, and the
+   * fetch completes with `k_io_error`.
+   */
+  void fetch_v2(IOFetchParameterV2 param);
+
+  /**
+   * Push the rows of all the requests from their `src`, see
+   * `IOPushParameterV2`. The ids whose keys are all stored are set in
+   * `pushed`. The push completes with `k_io_error` if any key failed.
+   */
+  void push_v2(IOPushParameterV2 param);
+
+  /**
+   * The compression ratio and the CPU time of the codecs of all tables.
+   */
+  [[nodiscard]] CodecStats codec_stats() const {
+    return codec_counters_.stats();
+  }
+
  private:
+  class Connections;
+
+  /**
+   * A job is sent in two steps, so that the jobs of different tables can
+   * share a pipeline: `append` appends the commands of the job, and
+   * `complete` reads the replies.
+   */
+  struct Job {
+    std::function<void(Connections&)> append;
+    // returns the number of value bytes of the job.
+    std::function<uint64_t(Connections&)> complete;
+    uint32_t num_keys;
+  };
+
   void start_thread();
-  void heartbeat(helper::ContextPtr& connection);
-  [[nodiscard]] helper::ContextPtr connect() const;
+  void heartbeat(helper::ContextPtr& connection, const NodeAddress& address)
+      const;
+  [[nodiscard]] helper::ContextPtr connect(const NodeAddress& address) const;
+  /**
+   * Reload the slot map of the cluster from the node of `connection`, which
+   * must have no pending reply.
+   */
+  void refresh_slots(redisContext* connection);
+  [[nodiscard]] std::shared_ptr<const SlotMap> slots() const;
+  [[nodiscard]] Codec codec_of(const std::string& table_name) const;
+  [[nodiscard]] const char* get_format() const;
+  [[nodiscard]] const char* set_format() const;
+  /**
+   * The value to store for `raw` by `codec`, which points into a thread
+   * local buffer until the next call, or is `raw`.
+   */
+  [[nodiscard]] std::span<const uint8_t> encode(
+      Codec codec,
+      std::span<const uint8_t> raw) const;
+  /**
+   * The number of global ids in a chunk of a request.
+   */
+  [[nodiscard]] uint32_t chunk_size_of(
+      uint32_t num_global_ids,
+      uint32_t num_cols,
+      uint32_t num_optimizer_states) const;
 
-  void do_fetch(
+  void add_jobs(const std::string& table_name, std::vector<Job> jobs);
+  /**
+   * Pop at most `n` jobs, one table after another, so that a table with many
+   * pending jobs does not starve the others. Must hold `jobs_mutex_`.
+   */
+  std::vector<Job> pop_jobs(uint32_t n);
+
+  void append_fetch(
+      uint32_t gid_offset,
+      void* fetch_param,
+      Connections& connections) const;
+  uint64_t complete_fetch(
       uint32_t gid_offset,
       void* fetch_param,
-      helper::ContextPtr& connection) const;
+      Connections& connections) const;
 
-  void do_push(
+  void append_push(
+      uint32_t gid_offset,
+      void* push_ctx,
+      Connections& connections) const;
+  uint64_t complete_push(
       uint32_t gid_offset,
       void* push_ctx,
-      helper::ContextPtr& connection) const;
+      Connections& connections) const;
+
+  /**
+   * Split the requests of a v2 fetch or push into jobs and schedule them.
+   */
+  void add_jobs_v2(void* ctx, bool fetch);
+  void append_v2(
+      void* ctx,
+      uint32_t request_id,
+      uint32_t gid_offset,
+      bool fetch,
+      Connections& connections) const;
+  uint64_t complete_fetch_v2(
+      void* ctx,
+      uint32_t request_id,
+      uint32_t gid_offset,
+      Connections& connections) const;
+  uint64_t complete_push_v2(
+      void* ctx,
+      uint32_t request_id,
+      uint32_t gid_offset,
+      Connections& connections) const;
 
   void check_status(
       std::string_view label,
       helper::ContextPtr& connection,
       helper::ReplyPtr& reply) const;
+  void check_ok(std::string_view label, const helper::ReplyPtr& reply) const;
 
   Option opt_;
+  // only in the cluster mode, replaced as a whole on refresh.
+  mutable std::mutex slots_mutex_;
+  std::shared_ptr<const SlotMap> slots_;
+  // only in the adaptive mode.
+  std::unique_ptr<ChunkController> controller_;
+  mutable CodecCounters codec_counters_;
   std::vector<std::thread> io_threads_;
-  std::deque<std::function<void(helper::ContextPtr&)>> jobs_;
+  // pending jobs of each table.
+  ska::flat_hash_map<std::string, std::deque<Job>> jobs_;
+  // tables with pending jobs, in the order to be scheduled.
+  std::deque<std::string> scheduled_tables_;
+  uint32_t num_pending_jobs_{0};
+  bool stopped_{false};
   std::condition_variable jobs_not_empty_;
   std::mutex jobs_mutex_;
 };
@@ -105,6 +245,14 @@ void* IO_Initialize(const char* cfg);
 void IO_Finalize(void* instance);
 void IO_Fetch(void* instance, IOFetchParameter param);
 void IO_Push(void* instance, IOPushParameter param);
+void IO_Fetch_v2(void* instance, IOFetchParameterV2 param);
+void IO_Push_v2(void* instance, IOPushParameterV2 param);
+/**
+ * Reports the `codec_stats` of the instance: `codec_raw_bytes`,
+ * `codec_encoded_bytes`, `codec_ratio`, `codec_encode_seconds` and
+ * `codec_decode_seconds`.
+ */
+void IO_Stats(void* instance, void* ctx, IOStatCallback on_stat);
 }
 
 } // namespace torchrec::redis
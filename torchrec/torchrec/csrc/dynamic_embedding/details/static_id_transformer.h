@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <torchrec/csrc/dynamic_embedding/details/fallback_rows.h>
+#include <limits>
+#include <memory>
+#include <span>
+
+namespace torchrec {
+
+/**
+ * StaticIDTransformer
+ *
+ * An immutable GlobalID to CacheID mapping for inference. It is built once
+ * from the global-id/cache-id pairs saved in training, and is safe to query
+ * from multiple threads without any lock.
+ *
+ * Internally it is an open addressing hash table, whose slots are grouped by
+ * cache line. A lookup compares all keys of a group at once and only moves to
+ * the next group when the current group is full.
+ */
+class StaticIDTransformer {
+ public:
+  static constexpr int64_t k_group_size = 8;
+
+  StaticIDTransformer(
+      std::span<const int64_t> global_ids,
+      std::span<const int64_t> cache_ids,
+      FallbackRows fallback = {});
+  StaticIDTransformer(const StaticIDTransformer&) = delete;
+  StaticIDTransformer(StaticIDTransformer&&) noexcept = default;
+
+  /**
+   * Returns the cache id of `global_id`, or -1 if it does not exist.
+   */
+  [[nodiscard]] int64_t find(int64_t global_id) const;
+
+  /**
+   * Transform global ids to cache ids. Unknown global ids are mapped to the
+   * fallback rows.
+   *
+   * @param global_ids Global ID vector
+   * @param cache_ids [out] Cache ID vector
+   * @return the number of global ids mapped to the fallback rows.
+   */
+  int64_t transform(
+      std::span<const int64_t> global_ids,
+      std::span<int64_t> cache_ids) const;
+
+  [[nodiscard]] int64_t size() const {
+    return size_;
+  }
+
+ private:
+  static constexpr int64_t k_empty_key = std::numeric_limits<int64_t>::min();
+
+  struct alignas(64) Group {
+    int64_t keys[k_group_size];
+  };
+
+  [[nodiscard]] int64_t group_of(int64_t global_id) const;
+  void insert(int64_t global_id, int64_t cache_id);
+
+  int64_t size_{0};
+  int64_t group_mask_{0};
+  std::unique_ptr<Group[]> groups_;
+  std::unique_ptr<int64_t[]> values_;
+  // `k_empty_key` cannot be stored in groups, keep it aside.
+  int64_t empty_key_value_{-1};
+  FallbackRows fallback_;
+};
+
+} // namespace torchrec
+
+#include <torchrec/csrc/dynamic_embedding/details/static_id_transformer_impl.h>
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <c10/util/Exception.h>
+#include <torchrec/csrc/dynamic_embedding/details/bits_op.h>
+#include <algorithm>
+
+namespace torchrec {
+
+inline StaticIDTransformer::StaticIDTransformer(
+    std::span<const int64_t> global_ids,
+    std::span<const int64_t> cache_ids,
+    FallbackRows fallback)
+    : fallback_(fallback) {
+  TORCH_CHECK(global_ids.size() == cache_ids.size());
+  TORCH_CHECK(fallback_.size > 0, "need at least one fallback row");
+  // Keep the load factor under 0.5, so that there is always an empty slot to
+  // stop the probing.
+  auto num_slots = 2 * static_cast<int64_t>(global_ids.size());
+  int64_t num_groups = 1;
+  while (num_groups * k_group_size < num_slots) {
+    num_groups *= 2;
+  }
+  group_mask_ = num_groups - 1;
+  groups_.reset(new Group[num_groups]);
+  values_.reset(new int64_t[num_groups * k_group_size]);
+  for (int64_t g = 0; g < num_groups; ++g) {
+    std::fill_n(groups_[g].keys, k_group_size, k_empty_key);
+  }
+  for (size_t i = 0; i < global_ids.size(); ++i) {
+    insert(global_ids[i], cache_ids[i]);
+  }
+}
+
+inline int64_t StaticIDTransformer::group_of(int64_t global_id) const {
+  return static_cast<int64_t>(mix_global_id(global_id)) & group_mask_;
+}
+
+inline void StaticIDTransformer::insert(int64_t global_id, int64_t cache_id) {
+  if (global_id == k_empty_key) [[unlikely]] {
+    size_ += empty_key_value_ < 0;
+    empty_key_value_ = cache_id;
+    return;
+  }
+  for (int64_t g = group_of(global_id);; g = (g + 1) & group_mask_) {
+    Group& group = groups_[g];
+    for (int64_t i = 0; i < k_group_size; ++i) {
+      if (group.keys[i] == global_id) {
+        values_[g * k_group_size + i] = cache_id;
+        return;
+      }
+      if (group.keys[i] == k_empty_key) {
+        group.keys[i] = global_id;
+        values_[g * k_group_size + i] = cache_id;
+        ++size_;
+        return;
+      }
+    }
+  }
+}
+
+inline int64_t StaticIDTransformer::find(int64_t global_id) const {
+  if (global_id == k_empty_key) [[unlikely]] {
+    return empty_key_value_;
+  }
+  for (int64_t g = group_of(global_id);; g = (g + 1) & group_mask_) {
+    const Group& group = groups_[g];
+    // Branch-free comparison of the whole group, which compilers vectorize.
+    uint32_t match = 0;
+    uint32_t empty = 0;
+    for (int64_t i = 0; i < k_group_size; ++i) {
+      match |= static_cast<uint32_t>(group.keys[i] == global_id) << i;
+      empty |= static_cast<uint32_t>(group.keys[i] == k_empty_key) << i;
+    }
+    if (match) {
+      return values_[g * k_group_size + ctz(match)];
+    }
+    if (empty) {
+      return -1;
+    }
+  }
+}
+
+inline int64_t StaticIDTransformer::transform(
+    std::span<const int64_t> global_ids,
+    std::span<int64_t> cache_ids) const {
+  int64_t num_fallback = 0;
+  for (size_t i = 0; i < global_ids.size(); ++i) {
+    int64_t cache_id = find(global_ids[i]);
+    if (cache_id < 0) [[unlikely]] {
+      cache_id = fallback_.row_of(global_ids[i]);
+      ++num_fallback;
+    }
+    cache_ids[i] = cache_id;
+  }
+  return num_fallback;
+}
+
+} // namespace torchrec
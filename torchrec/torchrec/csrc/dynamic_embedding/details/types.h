@@ -11,6 +11,7 @@
 #include <stdint.h>
 #include <functional>
 #include <optional>
+#include <span>
 
 namespace torchrec {
 
@@ -22,7 +23,24 @@ struct record_t {
   lxu_record_t lxu_record;
 };
 
+/**
+ * A chunk of records in struct-of-arrays layout. The spans are of the same
+ * size.
+ */
+struct record_chunk_t {
+  std::span<const int64_t> global_ids;
+  std::span<const int64_t> cache_ids;
+  std::span<const lxu_record_t> lxu_records;
+
+  [[nodiscard]] size_t size() const {
+    return global_ids.size();
+  }
+};
+
 using iterator_t = std::function<std::optional<record_t>()>;
+using chunk_visitor_t = std::function<void(const record_chunk_t&)>;
+// Calls the visitor on every chunk of records.
+using exporter_t = std::function<void(const chunk_visitor_t&)>;
 using update_t =
     std::function<lxu_record_t(int64_t, int64_t, std::optional<lxu_record_t>)>;
 using fetch_t = std::function<void(int64_t, int64_t)>;
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <torchrec/csrc/dynamic_embedding/fetch_coalescer.h>
+#include <algorithm>
+#include <span>
+
+namespace torchrec {
+
+FetchCoalescer::FetchCoalescer(int64_t max_ids_per_request)
+    : max_ids_per_request_(max_ids_per_request) {
+  TORCH_CHECK(
+      max_ids_per_request_ > 0, "max_ids_per_request must be positive");
+}
+
+FetchCoalescer::~FetchCoalescer() {
+  // The tables wait on the staged fetches, they must be issued.
+  flush();
+}
+
+void FetchCoalescer::release_resources() {
+  flush();
+}
+
+void FetchCoalescer::stage(StagedFetch fetch) {
+  std::lock_guard<std::mutex> lock(mu_);
+  staged_.emplace_back(std::move(fetch));
+}
+
+/**
+ * Issue the fetches as one request, completing each of them in order when
+ * the request completes.
+ */
+static c10::intrusive_ptr<Notification> issue(
+    IO& io,
+    std::span<StagedFetch*> fetches) {
+  std::vector<IOFetchRequestV2> requests;
+  using Callbacks = std::vector<std::function<void(int32_t)>>;
+  auto callbacks = std::make_shared<Callbacks>();
+  requests.reserve(fetches.size());
+  callbacks->reserve(fetches.size());
+  for (auto* fetch : fetches) {
+    requests.emplace_back(fetch->request);
+    callbacks->emplace_back(std::move(fetch->on_complete));
+  }
+  auto notification = c10::make_intrusive<Notification>();
+  io.fetch_v2(requests, [callbacks, notification](int32_t status) {
+    for (auto& callback : *callbacks) {
+      callback(status);
+    }
+    notification->done();
+  });
+  return notification;
+}
+
+c10::intrusive_ptr<StepFetchHandle> FetchCoalescer::flush() {
+  std::vector<StagedFetch> staged;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    staged.swap(staged_);
+  }
+
+  // Group the fetches by IO instance, in the order they are staged.
+  std::vector<IO*> ios;
+  std::vector<std::vector<StagedFetch*>> groups;
+  for (auto& fetch : staged) {
+    auto it = std::find(ios.begin(), ios.end(), fetch.io.get());
+    if (it == ios.end()) {
+      ios.emplace_back(fetch.io.get());
+      groups.emplace_back();
+      it = ios.end() - 1;
+    }
+    groups[it - ios.begin()].emplace_back(&fetch);
+  }
+
+  std::vector<c10::intrusive_ptr<Notification>> notifications;
+  for (size_t g = 0; g < groups.size(); ++g) {
+    auto& group = groups[g];
+    size_t begin = 0;
+    while (begin < group.size()) {
+      // A table larger than the limit still goes in its own request.
+      int64_t num_ids = group[begin]->request.num_global_ids;
+      size_t end = begin + 1;
+      while (end < group.size() &&
+             num_ids + group[end]->request.num_global_ids <=
+                 max_ids_per_request_) {
+        num_ids += group[end]->request.num_global_ids;
+        ++end;
+      }
+      notifications.emplace_back(issue(
+          *ios[g], std::span{group.data() + begin, end - begin}));
+      begin = end;
+    }
+  }
+  // `staged` owns the ids of the requests, which are copied by `fetch_v2`.
+  return c10::make_intrusive<StepFetchHandle>(std::move(notifications));
+}
+
+} // namespace torchrec
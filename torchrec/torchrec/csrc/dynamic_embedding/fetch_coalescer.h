@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <torch/custom_class.h>
+#include <torch/torch.h>
+
+#include <torchrec/csrc/dynamic_embedding/details/io.h>
+#include <torchrec/csrc/dynamic_embedding/details/notification.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace torchrec {
+
+/**
+ * @brief The fetch of one table, prepared by `PS` but not issued yet.
+ *
+ * `request` points into `global_ids` and `col_ids`, its `dst` and `found`
+ * are kept alive by `on_complete`.
+ */
+struct StagedFetch {
+  std::shared_ptr<IO> io;
+  std::vector<int64_t> global_ids;
+  std::vector<int64_t> col_ids;
+  IOFetchRequestV2 request;
+  std::function<void(int32_t)> on_complete;
+};
+
+/**
+ * @brief The handle of all the fetches flushed together by a
+ * `FetchCoalescer`.
+ */
+class StepFetchHandle : public torch::CustomClassHolder {
+ public:
+  explicit StepFetchHandle(
+      std::vector<c10::intrusive_ptr<Notification>> notifications)
+      : notifications_(std::move(notifications)) {}
+
+  void wait() {
+    for (auto& notification : notifications_) {
+      notification->wait();
+    }
+  }
+
+ private:
+  std::vector<c10::intrusive_ptr<Notification>> notifications_;
+};
+
+/**
+ * @brief Coalesces the fetches of all the tables in a step into a few
+ * vectored IO requests.
+ *
+ * Tables stage their fetches with `PS::stage_fetch`. `flush` then issues the
+ * staged fetches of the tables sharing an IO instance together, as
+ * `IO::fetch_v2` requests of at most `max_ids_per_request` ids, and
+ * completes each table when the request holding it completes. A table is
+ * never split across requests.
+ *
+ * The per-table handles still work: a table waiting on a fetch that is
+ * still staged flushes the coalescer first.
+ */
+class FetchCoalescer : public torch::CustomClassHolder {
+ public:
+  explicit FetchCoalescer(int64_t max_ids_per_request);
+  ~FetchCoalescer() override;
+
+  /**
+   * @brief Flush once the last reference is dropped. A `PS` with fetches
+   * staged here only holds a weak reference, which defers the destruction
+   * until it synchronizes, while the synchronization waits on the fetches.
+   */
+  void release_resources() override;
+
+  FetchCoalescer(const FetchCoalescer&) = delete;
+  FetchCoalescer& operator=(const FetchCoalescer&) = delete;
+
+  void stage(StagedFetch fetch);
+
+  /**
+   * @brief Issue all the staged fetches.
+   * @return The handle to wait for all of them.
+   */
+  c10::intrusive_ptr<StepFetchHandle> flush();
+
+ private:
+  int64_t max_ids_per_request_;
+  std::mutex mu_;
+  std::vector<StagedFetch> staged_;
+};
+
+} // namespace torchrec
@@ -16,12 +16,23 @@ IDTransformerWrapper::IDTransformerWrapper(
     int64_t num_embedding,
     const std::string& id_transformer_type,
     const std::string& lxu_strategy_type,
-    int64_t min_used_freq_power)
+    int64_t min_used_freq_power,
+    int64_t num_fallback_rows)
     : time_(-1), last_save_time_(-1) {
-  TORCH_CHECK(id_transformer_type == "naive");
+  // The memory policy is passed as the params of the type, e.g.
+  // "naive?hugepage=2m&&numa=interleave".
+  std::string_view type = id_transformer_type;
+  MemoryPolicy policy;
+  auto question_pos = type.find('?');
+  if (question_pos != std::string_view::npos) {
+    policy = parse_memory_policy(type.substr(question_pos + 1));
+    type = type.substr(0, question_pos);
+  }
+  TORCH_CHECK(
+      type == "naive", "unknown id transformer type ", id_transformer_type);
   TORCH_CHECK(lxu_strategy_type == "mixed_lru_lfu");
-  transformer_ =
-      std::unique_ptr<IDTransformer>(new NaiveIDTransformer(num_embedding));
+  transformer_ = std::unique_ptr<IDTransformer>(
+      new NaiveIDTransformer(num_embedding, policy, num_fallback_rows));
   strategy_ = std::unique_ptr<LXUStrategy>(
       new MixedLFULRUStrategy(min_used_freq_power));
 }
@@ -59,6 +70,7 @@ c10::intrusive_ptr<TransformResult> IDTransformerWrapper::transform(
     ids_to_fetch_[2 * offset + 1] = cache_id;
   };
 
+  int64_t num_fallback_before = transformer_->num_fallback_ids();
   bool ok = true;
   for (int64_t i = 0; i < global_id_list.size(); ++i) {
     auto& global_ids = global_id_list[i];
@@ -82,15 +94,19 @@ c10::intrusive_ptr<TransformResult> IDTransformerWrapper::transform(
       at::from_blob(
           ids_to_fetch_.data(),
           {next_fetch_offset.load(), 2},
-          torch::TensorOptions().dtype(c10::kLong).device(c10::kCPU)));
+          torch::TensorOptions().dtype(c10::kLong).device(c10::kCPU)),
+      transformer_->num_fallback_ids() - num_fallback_before);
 }
 
 torch::Tensor IDTransformerWrapper::evict(int64_t num_to_evict) {
   std::lock_guard<std::mutex> lock(mu_);
   torch::NoGradGuard no_grad;
   // get the global ids to evict.
-  std::vector<int64_t> global_ids_to_evict =
-      strategy_->evict(transformer_->iterator(), num_to_evict);
+  std::vector<int64_t> global_ids_to_evict = strategy_->evict_chunks(
+      [this](const chunk_visitor_t& visitor) {
+        transformer_->export_records(visitor);
+      },
+      num_to_evict);
   int64_t num_ids_to_evict = global_ids_to_evict.size();
   // get the cache id from transformer_
   std::vector<int64_t> cache_ids_to_evict(num_ids_to_evict);
@@ -112,17 +128,14 @@ torch::Tensor IDTransformerWrapper::save() {
   torch::NoGradGuard no_grad;
   // traverse transformer_ and get the id with new timestamp.
   std::vector<int64_t> ids;
-  iterator_t iterator = transformer_->iterator();
-  while (true) {
-    auto val = iterator();
-    if (!val.has_value()) [[unlikely]] {
-      break;
+  transformer_->export_records([&, this](const record_chunk_t& chunk) {
+    for (size_t i = 0; i < chunk.size(); ++i) {
+      if (strategy_->time(chunk.lxu_records[i]) > last_save_time_) {
+        ids.emplace_back(chunk.global_ids[i]);
+        ids.emplace_back(chunk.cache_ids[i]);
+      }
     }
-    if (strategy_->time(val->lxu_record) > last_save_time_) {
-      ids.emplace_back(val->global_id);
-      ids.emplace_back(val->cache_id);
-    }
-  }
+  });
 
   last_save_time_ = time_;
   int64_t num_ids = ids.size() / 2;
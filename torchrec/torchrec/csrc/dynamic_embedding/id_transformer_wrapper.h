@@ -15,8 +15,13 @@
 namespace torchrec {
 
 struct TransformResult : public torch::CustomClassHolder {
-  TransformResult(bool success, torch::Tensor ids_to_fetch)
-      : success(success), ids_to_fetch(ids_to_fetch) {}
+  TransformResult(
+      bool success,
+      torch::Tensor ids_to_fetch,
+      int64_t num_fallback = 0)
+      : success(success),
+        ids_to_fetch(ids_to_fetch),
+        num_fallback(num_fallback) {}
 
   // Whether the fetch succeeded (if evicted is not necessary)
   bool success;
@@ -24,6 +29,8 @@ struct TransformResult : public torch::CustomClassHolder {
   // shape of [num_to_fetch, 2], where each row is consist of
   // the global id and cache id of each ID.
   torch::Tensor ids_to_fetch;
+  // number of ids mapped to the hashed fallback rows in this transform.
+  int64_t num_fallback;
 };
 
 class IDTransformerWrapper : public torch::CustomClassHolder {
@@ -32,7 +39,8 @@ class IDTransformerWrapper : public torch::CustomClassHolder {
       int64_t num_embedding,
       const std::string& id_transformer_type,
       const std::string& lxu_strategy_type,
-      int64_t min_used_freq_power = 5);
+      int64_t min_used_freq_power = 5,
+      int64_t num_fallback_rows = 0);
 
   c10::intrusive_ptr<TransformResult> transform(
       std::vector<torch::Tensor> global_ids,
@@ -8,9 +8,120 @@
 
 #include <torchrec/csrc/dynamic_embedding/details/io.h>
 #include <torchrec/csrc/dynamic_embedding/ps.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <optional>
 
 namespace torchrec {
 
+/**
+ * A cheap 64-bit fingerprint of a row, used to tell whether the row is modified
+ * between its fetch and its eviction.
+ */
+static uint64_t fingerprint(const uint8_t* data, size_t size) {
+  constexpr uint64_t k_mul = 0x9E3779B97F4A7C15ULL;
+  uint64_t h = size * k_mul;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(uint64_t));
+    h = (h ^ word) * k_mul;
+    h ^= h >> 32;
+  }
+  for (; i < size; ++i) {
+    h = (h ^ data[i]) * k_mul;
+  }
+  return h ^ (h >> 29);
+}
+
+StagedFetch PS::prepare_fetch(
+    std::vector<int64_t> global_ids,
+    std::vector<int64_t> cache_ids,
+    bool reinit,
+    double weight_init_min,
+    double weight_init_max,
+    c10::intrusive_ptr<Notification> notification) {
+  // Does not support multiple col ids at the moment.
+  std::vector<int64_t> col_ids{0};
+  uint32_t num_os_ids = os_ids_.size();
+  uint32_t num_ids_to_fetch = global_ids.size();
+  uint32_t value_bytes = col_size_ * sizeof(float);
+  uint64_t row_bytes = num_os_ids * value_bytes;
+  // The provider writes the rows into `dst` directly, which are then copied to
+  // the local shards once the whole fetch completes.
+  auto dst = std::make_shared<std::vector<uint8_t>>(
+      static_cast<size_t>(num_ids_to_fetch) * row_bytes);
+  auto found = std::make_shared<std::vector<uint64_t>>(
+      io_num_bitmap_words(num_ids_to_fetch));
+  IOFetchRequestV2 request{
+      .table_name = table_name_.c_str(),
+      .num_global_ids = num_ids_to_fetch,
+      .global_ids = global_ids.data(),
+      .num_cols = static_cast<uint32_t>(col_ids.size()),
+      .col_ids = col_ids.data(),
+      .num_optimizer_states = num_os_ids,
+      .row_bytes = value_bytes,
+      .dst = dst->data(),
+      .found = found->data(),
+  };
+  // `unsafe_reclain_from_nonowning` is the `instrusive_ptr` version of
+  // `enable_shared_from_this`, the PS is kept alive until the fetch completes.
+  auto self = c10::intrusive_ptr<PS>::unsafe_reclaim_from_nonowning(this);
+  auto on_complete = [=, cache_ids_to_fetch = std::move(cache_ids)](
+                         int32_t status) {
+    if (status == k_io_error) {
+      TORCH_WARN(
+          "some ids of table ",
+          self->table_name_,
+          " failed to fetch, they are treated as missing");
+    }
+    // fingerprint of each fetched row, or nullopt if the row is not in PS.
+    std::vector<std::optional<uint64_t>> fingerprints(
+        cache_ids_to_fetch.size());
+    for (uint32_t i = 0; i < cache_ids_to_fetch.size(); ++i) {
+      int64_t cache_id = cache_ids_to_fetch[i];
+      std::vector<torch::Tensor> tensors = self->get_tensor_views(cache_id);
+      if (!io_test_bit(found->data(), i)) {
+        if (reinit) {
+          tensors[0].uniform_(weight_init_min, weight_init_max);
+          // optimizer states will be set to zero
+          for (uint32_t j = 1; j < num_os_ids; ++j) {
+            tensors[j].zero_();
+          }
+        }
+        continue;
+      }
+
+      uint8_t* row = dst->data() + i * row_bytes;
+      for (uint32_t j = 0; j < num_os_ids; ++j) {
+        tensors[j].copy_(torch::from_blob(
+            row + j * value_bytes, tensors[j].sizes(), torch::kF32));
+      }
+      fingerprints[i] = fingerprint(row, row_bytes);
+    }
+    {
+      std::lock_guard<std::mutex> guard(self->fingerprints_mutex_);
+      for (uint32_t i = 0; i < cache_ids_to_fetch.size(); ++i) {
+        if (fingerprints[i].has_value()) {
+          self->fingerprints_[cache_ids_to_fetch[i]] = *fingerprints[i];
+        } else {
+          self->fingerprints_.erase(cache_ids_to_fetch[i]);
+        }
+      }
+    }
+    notification->done();
+  };
+  // moving the id vectors keeps the buffers `request` points to.
+  return StagedFetch{
+      .io = io_,
+      .global_ids = std::move(global_ids),
+      .col_ids = std::move(col_ids),
+      .request = request,
+      .on_complete = std::move(on_complete),
+  };
+}
+
 c10::intrusive_ptr<FetchHandle> PS::fetch(
     torch::Tensor ids_to_fetch,
     int64_t time,
@@ -25,48 +136,58 @@ c10::intrusive_ptr<FetchHandle> PS::fetch(
     return c10::make_intrusive<FetchHandle>(time, c10::intrusive_ptr<PS>());
   }
 
-  c10::intrusive_ptr<Notification> notification;
+  auto notification = c10::make_intrusive<Notification>();
   {
     std::unique_lock<std::mutex> lock_fetch(fetch_notifications_mutex_);
-    fetch_notifications_.emplace_back(
-        time, c10::make_intrusive<Notification>());
-    notification = fetch_notifications_.back().second;
+    fetch_notifications_.emplace_back(time, notification);
   }
-  // Does not support multiple col ids at the moment.
-  std::vector<int64_t> col_ids{0};
-  uint32_t num_os_ids = os_ids_.size();
-  io_.fetch(
-      table_name_,
+  auto staged = prepare_fetch(
       std::move(local_global_ids),
-      col_ids,
-      num_os_ids,
-      torch::kF32,
-      [=, this, cache_ids_to_fetch = std::move(local_cache_ids)](auto&& val) {
-        TORCH_CHECK(val.size() == cache_ids_to_fetch.size());
-        for (uint32_t i = 0; i < cache_ids_to_fetch.size(); ++i) {
-          int64_t cache_id = cache_ids_to_fetch[i];
-          auto& fetched = val[i];
-          if (!fetched.defined()) {
-            if (reinit) {
-              std::vector<torch::Tensor> tensors = get_tensor_views(cache_id);
-              tensors[0].uniform_(weight_init_min, weight_init_max);
-              // optimizer states will be set to zero
-              for (uint32_t j = 1; j < num_os_ids; ++j) {
-                tensors[j].zero_();
-              }
-            }
-            continue;
-          }
+      std::move(local_cache_ids),
+      reinit,
+      weight_init_min,
+      weight_init_max,
+      notification);
+  io_->fetch_v2(std::span{&staged.request, 1}, std::move(staged.on_complete));
+  return c10::make_intrusive<FetchHandle>(
+      time, c10::intrusive_ptr<PS>::unsafe_reclaim_from_nonowning(this));
+}
 
-          std::vector<torch::Tensor> tensors = get_tensor_views(cache_id);
-          for (uint32_t j = 0; j < num_os_ids; ++j) {
-            tensors[j].copy_(fetched.slice(0, j, j + 1));
-          }
-        }
-        notification->done();
-      });
-  // `unsafe_reclain_from_nonowning` is the `instrusive_ptr` version of
-  // `enable_shared_from_this`
+c10::intrusive_ptr<FetchHandle> PS::stage_fetch(
+    c10::intrusive_ptr<FetchCoalescer> coalescer,
+    torch::Tensor ids_to_fetch,
+    int64_t time,
+    bool reinit,
+    double weight_init_min,
+    double weight_init_max) {
+  std::lock_guard<std::mutex> lock(mu_);
+  torch::NoGradGuard no_grad;
+
+  auto [local_global_ids, local_cache_ids] = filter_local_ids(ids_to_fetch);
+  if (local_global_ids.empty()) {
+    return c10::make_intrusive<FetchHandle>(time, c10::intrusive_ptr<PS>());
+  }
+
+  auto notification = c10::make_intrusive<Notification>();
+  auto staged = prepare_fetch(
+      std::move(local_global_ids),
+      std::move(local_cache_ids),
+      reinit,
+      weight_init_min,
+      weight_init_max,
+      notification);
+  {
+    // Staged under the lock, so that a synchronization seeing the
+    // notification also sees the coalescer to flush.
+    std::unique_lock<std::mutex> lock_fetch(fetch_notifications_mutex_);
+    fetch_notifications_.emplace_back(time, notification);
+    c10::weak_intrusive_ptr<FetchCoalescer> weak(coalescer);
+    if (std::find(coalescers_.begin(), coalescers_.end(), weak) ==
+        coalescers_.end()) {
+      coalescers_.emplace_back(std::move(weak));
+    }
+    coalescer->stage(std::move(staged));
+  }
   return c10::make_intrusive<FetchHandle>(
       time, c10::intrusive_ptr<PS>::unsafe_reclaim_from_nonowning(this));
 }
@@ -85,20 +206,24 @@ void PS::evict(torch::Tensor ids_to_evict) {
   // Does not support multiple col ids at the moment.
   std::vector<int64_t> col_ids{0};
   uint32_t num_os_ids = os_ids_.size();
-  uint32_t num_ids_to_fetch = local_global_ids.size();
+  uint32_t num_ids_to_evict = local_global_ids.size();
+  uint32_t num_values_per_id = num_os_ids * col_ids.size();
+  uint64_t value_bytes = col_size_ * sizeof(float);
+  uint64_t row_bytes = num_values_per_id * value_bytes;
 
   Notification notification;
   // Done first so that the Wait after preparing the first chunk won't stuck.
   notification.done();
-  // The shared data for all chunks.
-  std::vector<uint64_t> offsets;
-  offsets.resize(num_ids_per_chunk_ * num_os_ids * col_ids.size() + 1);
+  // The shared data for all chunks. They are only modified after the push of
+  // the last chunk finishes.
+  std::vector<int64_t> global_ids_to_push(num_ids_per_chunk_);
+  std::vector<uint64_t> pushed(io_num_bitmap_words(num_ids_per_chunk_));
+  torch::Tensor data_to_push;
+  std::atomic<uint32_t> num_failed{0};
   // Evict by chunks
-  for (uint32_t i = 0; i < num_ids_to_fetch; i += num_ids_per_chunk_) {
+  for (uint32_t i = 0; i < num_ids_to_evict; i += num_ids_per_chunk_) {
     uint32_t num_ids_in_chunk = std::min(
-        static_cast<uint32_t>(num_ids_per_chunk_), num_ids_to_fetch - i);
-    uint32_t data_size = num_ids_in_chunk * num_os_ids * col_ids.size();
-    uint32_t offsets_size = num_ids_in_chunk * num_os_ids * col_ids.size() + 1;
+        static_cast<uint32_t>(num_ids_per_chunk_), num_ids_to_evict - i);
 
     std::vector<torch::Tensor> all_tensors;
     for (uint32_t j = i; j < i + num_ids_in_chunk; ++j) {
@@ -107,34 +232,94 @@ void PS::evict(torch::Tensor ids_to_evict) {
       all_tensors.insert(all_tensors.end(), tensors.begin(), tensors.end());
     }
     torch::Tensor data = torch::cat(all_tensors, 0).cpu();
-    TORCH_CHECK(data.numel() == data_size * col_size_);
+    TORCH_CHECK(
+        data.numel() == num_ids_in_chunk * num_values_per_id * col_size_);
 
-    offsets[0] = 0;
-    for (uint32_t j = 0; j < all_tensors.size(); ++j) {
-      offsets[j + 1] =
-          offsets[j] + all_tensors[j].numel() * all_tensors[j].element_size();
-    }
     // waiting for the Push of last chunk finishes.
     notification.wait();
+
+    // Compact the modified rows to the front of the chunk, the unmodified
+    // rows are already in PS.
+    auto* bytes = reinterpret_cast<uint8_t*>(data.data_ptr<float>());
+    uint32_t num_ids_to_push = 0;
+    {
+      std::lock_guard<std::mutex> guard(fingerprints_mutex_);
+      for (uint32_t j = 0; j < num_ids_in_chunk; ++j) {
+        uint8_t* row = bytes + j * row_bytes;
+        auto it = fingerprints_.find(local_cache_ids[i + j]);
+        if (it != fingerprints_.end()) {
+          bool modified = it->second != fingerprint(row, row_bytes);
+          fingerprints_.erase(it);
+          if (!modified) {
+            continue;
+          }
+        }
+        if (num_ids_to_push != j) {
+          memmove(bytes + num_ids_to_push * row_bytes, row, row_bytes);
+        }
+        global_ids_to_push[num_ids_to_push++] = local_global_ids[i + j];
+      }
+    }
+    if (num_ids_to_push == 0) {
+      continue;
+    }
+
+    // keep the data alive until the push finishes.
+    data_to_push = std::move(data);
     notification.clear();
-    io_.push(
-        table_name_,
-        std::span{local_global_ids.data() + i, num_ids_in_chunk},
-        col_ids,
-        os_ids_,
-        std::span{
-            reinterpret_cast<uint8_t*>(data.data_ptr<float>()),
-            data_size * sizeof(float)},
-        std::span{offsets.data(), offsets_size},
-        [&notification] { notification.done(); });
+    IOPushRequestV2 request{
+        .table_name = table_name_.c_str(),
+        .num_global_ids = num_ids_to_push,
+        .global_ids = global_ids_to_push.data(),
+        .num_cols = static_cast<uint32_t>(col_ids.size()),
+        .col_ids = col_ids.data(),
+        .num_optimizer_states = num_os_ids,
+        .optimizer_state_ids = os_ids_.data(),
+        .row_bytes = static_cast<uint32_t>(value_bytes),
+        .src = bytes,
+        .pushed = pushed.data(),
+    };
+    std::fill(pushed.begin(), pushed.end(), 0);
+    io_->push_v2(
+        std::span{&request, 1},
+        [&notification, &pushed, &num_failed, num_ids_to_push](
+            int32_t status) {
+          if (status != k_io_ok) {
+            for (uint32_t j = 0; j < num_ids_to_push; ++j) {
+              if (!io_test_bit(pushed.data(), j)) {
+                ++num_failed;
+              }
+            }
+          }
+          notification.done();
+        });
   }
   notification.wait();
+  if (num_failed > 0) {
+    TORCH_WARN(
+        num_failed.load(),
+        " evicted ids of table ",
+        table_name_,
+        " failed to push, their updates are lost");
+  }
 }
 
 void PS::synchronize_fetch(int64_t time) {
   std::unique_lock<std::mutex> lock(
       fetch_notifications_mutex_, std::defer_lock);
 
+  // Issue the staged fetches first, or they would never complete.
+  std::vector<c10::weak_intrusive_ptr<FetchCoalescer>> coalescers;
+  lock.lock();
+  coalescers.swap(coalescers_);
+  lock.unlock();
+  for (auto& weak : coalescers) {
+    // A coalescer that is gone flushed its fetches when it was released.
+    if (auto coalescer = weak.lock()) {
+      coalescer->flush();
+    }
+  }
+
   while (true) {
     lock.lock();
     if (fetch_notifications_.empty() ||
@@ -10,10 +10,13 @@
 #include <torch/custom_class.h>
 #include <torch/torch.h>
 
+#include <c10/util/flat_hash_map.h>
 #include <torchrec/csrc/dynamic_embedding/details/io.h>
 #include <torchrec/csrc/dynamic_embedding/details/notification.h>
+#include <torchrec/csrc/dynamic_embedding/fetch_coalescer.h>
 #include <deque>
 #include <utility>
+#include <vector>
 
 namespace torchrec {
 
@@ -96,7 +99,7 @@ class PS : public torch::CustomClassHolder {
         shards_(std::move(shards)),
         col_size_(col_size),
         os_ids_(num_optimizer_stats),
-        io_(io_config),
+        io_(IO::get(io_config)),
         num_ids_per_chunk_(chunk_size / col_size_ / num_optimizer_stats) {
     TORCH_CHECK(num_ids_per_chunk_ > 0, "chunk size too small");
     for (int64_t i = 0; i < num_optimizer_stats; ++i) {
@@ -122,6 +125,22 @@ class PS : public torch::CustomClassHolder {
       bool reinit,
       double weight_init_min,
       double weight_init_max);
+
+  /**
+   * @brief Same as `fetch`, but the fetch is staged in `coalescer` and only
+   * issued on its next flush, together with the fetches of the other tables.
+   *
+   * @return The handle used to synchronize the fetch, waiting on it flushes
+   * `coalescer` if the fetch is still staged.
+   */
+  c10::intrusive_ptr<FetchHandle> stage_fetch(
+      c10::intrusive_ptr<FetchCoalescer> coalescer,
+      torch::Tensor ids_to_fetch,
+      int64_t time,
+      bool reinit,
+      double weight_init_min,
+      double weight_init_max);
+
   /**
    * @brief Synchronize all the fetches till timestamp `time`,
    * if `time` is -1, then synchronize all previous fetches.
@@ -132,11 +151,34 @@ class PS : public torch::CustomClassHolder {
   /**
    * @brief Evict ids back to PS synchronously.
    *
+   * Rows that are unchanged since they were fetched from PS are not pushed
+   * back, their slots are only released. A row is considered unchanged if the
+   * fingerprint of its parameter and optimizer states equals the one taken
+   * when it was fetched.
    */
   void evict(torch::Tensor ids_to_evict);
 
+  /**
+   * @brief The statistics of the IO instance of the table, which is shared
+   * with the other tables of the same io config.
+   */
+  c10::Dict<std::string, double> io_stats() const {
+    return io_->stats();
+  }
+
  private:
   std::vector<torch::Tensor> get_tensor_views(int64_t cache_id);
+  /**
+   * @brief Prepare the fetch of local ids, whose completion copies the rows
+   * into the local shards and then sets `notification`.
+   */
+  StagedFetch prepare_fetch(
+      std::vector<int64_t> global_ids,
+      std::vector<int64_t> cache_ids,
+      bool reinit,
+      double weight_init_min,
+      double weight_init_max,
+      c10::intrusive_ptr<Notification> notification);
   std::tuple<std::vector<int64_t>, std::vector<int64_t>> filter_local_ids(
       const torch::Tensor& ids);
 
@@ -148,9 +190,18 @@ class PS : public torch::CustomClassHolder {
   int64_t col_size_;
   std::vector<uint32_t> os_ids_;
   int64_t num_ids_per_chunk_;
-  IO io_;
+  // shared with other tables of the same io config.
+  std::shared_ptr<IO> io_;
   std::deque<std::pair<int64_t, c10::intrusive_ptr<Notification>>>
       fetch_notifications_;
+  // The coalescers holding the fetches staged since the last
+  // synchronization, which flushes all of them. Guarded by
+  // `fetch_notifications_mutex_`.
+  std::vector<c10::weak_intrusive_ptr<FetchCoalescer>> coalescers_;
+  // Fingerprints of the rows fetched from PS, keyed by cache id. A cache id
+  // without fingerprint is always treated as modified.
+  std::mutex fingerprints_mutex_;
+  ska::flat_hash_map<int64_t, uint64_t> fingerprints_;
 };
 
 struct FetchHandle : public torch::CustomClassHolder {
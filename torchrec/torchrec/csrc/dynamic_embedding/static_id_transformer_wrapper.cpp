@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <c10/util/flat_hash_map.h>
+#include <torchrec/csrc/dynamic_embedding/static_id_transformer_wrapper.h>
+
+namespace torchrec {
+
+// Generations are never reused, so a wrapper allocated at the address of a
+// released one never matches its snapshots.
+static std::atomic<uint64_t> next_generation{1};
+
+StaticIDTransformerWrapper::StaticIDTransformerWrapper(
+    int64_t fallback_row_begin,
+    int64_t num_fallback_rows)
+    : fallback_{.begin = fallback_row_begin, .size = num_fallback_rows},
+      generation_(std::make_shared<std::atomic<uint64_t>>(0)) {
+  TORCH_CHECK(fallback_row_begin >= 0);
+  TORCH_CHECK(num_fallback_rows > 0, "need at least one fallback row");
+  publish(std::make_shared<const StaticIDTransformer>(
+      std::span<const int64_t>{}, std::span<const int64_t>{}, fallback_));
+}
+
+void StaticIDTransformerWrapper::publish(
+    std::shared_ptr<const StaticIDTransformer> transformer) {
+  std::lock_guard<std::mutex> guard(mu_);
+  transformer_ = std::move(transformer);
+  generation_->store(next_generation.fetch_add(1), std::memory_order_release);
+}
+
+const StaticIDTransformer& StaticIDTransformerWrapper::snapshot() {
+  thread_local ska::flat_hash_map<const StaticIDTransformerWrapper*, Snapshot>
+      snapshots;
+  uint64_t generation = generation_->load(std::memory_order_acquire);
+  auto it = snapshots.find(this);
+  bool fresh = it != snapshots.end() && it->second.generation == generation;
+  if (fresh) [[likely]] {
+    return *it->second.transformer;
+  }
+
+  // Outdated, e.g. after a `load`. Drop the snapshots of released wrappers
+  // too, so that their mappings are not kept alive by this thread.
+  for (auto iter = snapshots.begin(); iter != snapshots.end();) {
+    if (iter->second.owner.expired()) {
+      iter = snapshots.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  auto& snapshot = snapshots[this];
+  std::lock_guard<std::mutex> guard(mu_);
+  snapshot = Snapshot{
+      .owner = generation_,
+      .generation = generation_->load(std::memory_order_relaxed),
+      .transformer = transformer_,
+  };
+  return *snapshot.transformer;
+}
+
+void StaticIDTransformerWrapper::load(torch::Tensor ids) {
+  TORCH_CHECK(ids.dim() == 2 && ids.size(1) == 2);
+  ids = ids.to(torch::kLong).contiguous();
+  int64_t num_ids = ids.size(0);
+  auto* ids_ptr = ids.data_ptr<int64_t>();
+  std::vector<int64_t> global_ids(num_ids);
+  std::vector<int64_t> cache_ids(num_ids);
+  for (int64_t i = 0; i < num_ids; ++i) {
+    global_ids[i] = ids_ptr[2 * i];
+    cache_ids[i] = ids_ptr[2 * i + 1];
+  }
+  publish(std::make_shared<const StaticIDTransformer>(
+      global_ids, cache_ids, fallback_));
+}
+
+int64_t StaticIDTransformerWrapper::transform(
+    std::vector<torch::Tensor> global_id_list,
+    std::vector<torch::Tensor> cache_id_list) {
+  TORCH_CHECK(global_id_list.size() == cache_id_list.size());
+  for (size_t i = 0; i < global_id_list.size(); ++i) {
+    auto& global_ids = global_id_list[i];
+    auto& cache_ids = cache_id_list[i];
+    TORCH_CHECK(
+        global_ids.scalar_type() == torch::kLong &&
+            cache_ids.scalar_type() == torch::kLong,
+        "global ids and cache ids should be int64");
+    TORCH_CHECK(
+        global_ids.is_contiguous() && cache_ids.is_contiguous(),
+        "global ids and cache ids should be contiguous");
+    TORCH_CHECK(global_ids.numel() == cache_ids.numel());
+  }
+  const StaticIDTransformer& transformer = snapshot();
+  int64_t num_fallback = 0;
+  for (size_t i = 0; i < global_id_list.size(); ++i) {
+    auto& global_ids = global_id_list[i];
+    auto& cache_ids = cache_id_list[i];
+    num_fallback += transformer.transform(
+        std::span{
+            global_ids.data_ptr<int64_t>(),
+            static_cast<size_t>(global_ids.numel())},
+        std::span{
+            cache_ids.data_ptr<int64_t>(),
+            static_cast<size_t>(cache_ids.numel())});
+  }
+  return num_fallback;
+}
+
+int64_t StaticIDTransformerWrapper::size() {
+  return snapshot().size();
+}
+
+} // namespace torchrec
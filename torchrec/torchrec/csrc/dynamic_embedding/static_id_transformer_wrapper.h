@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <torch/custom_class.h>
+#include <torch/torch.h>
+#include <torchrec/csrc/dynamic_embedding/details/static_id_transformer.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace torchrec {
+
+/**
+ * Read-only ID transformer for inference serving.
+ *
+ * `transform` can be called from many threads without taking a lock. Each
+ * thread keeps a snapshot of the mapping and checks it against a generation
+ * counter, which only `load` writes, so a lookup does not write any shared
+ * memory either. A new mapping is published by `load`, which builds the
+ * mapping aside and bumps the generation. Ongoing `transform` calls keep using
+ * the old mapping, which is released once every thread has moved on to the
+ * new one.
+ */
+class StaticIDTransformerWrapper : public torch::CustomClassHolder {
+ public:
+  /**
+   * @param fallback_row_begin the first cache row for unknown global ids.
+   * @param num_fallback_rows number of cache rows for unknown global ids,
+   * unknown global ids are hashed into them. 1 means a single default row.
+   */
+  StaticIDTransformerWrapper(
+      int64_t fallback_row_begin,
+      int64_t num_fallback_rows);
+
+  /**
+   * Replace the mapping with `ids`, a tensor of shape [num_ids, 2] whose rows
+   * are pairs of global id and cache id, e.g. the result of
+   * `IDTransformer.save`.
+   */
+  void load(torch::Tensor ids);
+
+  /**
+   * Transform global ids to cache ids, both contiguous int64 tensors.
+   *
+   * @return the number of global ids mapped to the fallback rows.
+   */
+  int64_t transform(
+      std::vector<torch::Tensor> global_ids,
+      std::vector<torch::Tensor> cache_ids);
+
+  int64_t size();
+
+ private:
+  struct Snapshot {
+    // expires with the wrapper, so that the snapshots of released wrappers
+    // can be dropped.
+    std::weak_ptr<const std::atomic<uint64_t>> owner;
+    uint64_t generation;
+    std::shared_ptr<const StaticIDTransformer> transformer;
+  };
+
+  void publish(std::shared_ptr<const StaticIDTransformer> transformer);
+  // The mapping as seen by the calling thread, valid until its next call.
+  const StaticIDTransformer& snapshot();
+
+  FallbackRows fallback_;
+  std::mutex mu_;
+  // guarded by mu_, only read by the threads whose snapshot is outdated.
+  std::shared_ptr<const StaticIDTransformer> transformer_;
+  // the generation of `transformer_`, unique across all wrappers.
+  std::shared_ptr<std::atomic<uint64_t>> generation_;
+};
+
+} // namespace torchrec
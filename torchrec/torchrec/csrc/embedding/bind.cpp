@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <torch/torch.h>
+
+#include <torchrec/csrc/embedding/qr_embedding_bag.h>
+
+namespace torchrec::embedding {
+
+TORCH_LIBRARY(compressed_embedding, m) {
+  m.def(
+      "qr_embedding_bag(Tensor weight_q, Tensor weight_r, Tensor indices, "
+      "Tensor offsets, Tensor? per_sample_weights=None, "
+      "int num_collisions=1, int operation=2, int mode=1, bool sparse=False) "
+      "-> Tensor",
+      &qr_embedding_bag);
+}
+
+} // namespace torchrec::embedding
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <torchrec/csrc/embedding/details/qr_kernels.h>
+#include <algorithm>
+
+namespace torchrec::embedding {
+
+// Number of indices ahead whose rows are prefetched while pooling.
+static constexpr int64_t k_prefetch_distance = 8;
+
+namespace {
+
+float sample_weight(const Bags& bags, PoolingMode mode, int64_t b, int64_t i) {
+  float w = bags.per_sample_weights ? bags.per_sample_weights[i] : 1.0f;
+  if (mode == PoolingMode::kMean) {
+    int64_t length = bags.offsets[b + 1] - bags.offsets[b];
+    w /= static_cast<float>(std::max<int64_t>(length, 1));
+  }
+  return w;
+}
+
+} // namespace
+
+void qr_forward(
+    const QRTables& tables,
+    const Bags& bags,
+    PoolingMode mode,
+    QROperation op,
+    int64_t begin,
+    int64_t end,
+    float* pooled_q,
+    float* pooled_r,
+    float* out) {
+  const int64_t nc = tables.num_collisions;
+  const int64_t out_dim = tables.out_dim(op);
+  for (int64_t b = begin; b < end; ++b) {
+    float* pq = pooled_q + b * tables.q_dim;
+    float* pr = pooled_r + b * tables.r_dim;
+    std::fill_n(pq, tables.q_dim, 0.0f);
+    std::fill_n(pr, tables.r_dim, 0.0f);
+    int64_t bag_end = bags.offsets[b + 1];
+    for (int64_t i = bags.offsets[b]; i < bag_end; ++i) {
+      if (i + k_prefetch_distance < bag_end) {
+        int64_t next = bags.indices[i + k_prefetch_distance];
+        __builtin_prefetch(tables.q + (next / nc) * tables.q_dim);
+        __builtin_prefetch(tables.r + (next % nc) * tables.r_dim);
+      }
+      int64_t index = bags.indices[i];
+      float w = sample_weight(bags, mode, b, i);
+      const float* q_row = tables.q + (index / nc) * tables.q_dim;
+      const float* r_row = tables.r + (index % nc) * tables.r_dim;
+      for (int64_t d = 0; d < tables.q_dim; ++d) {
+        pq[d] += w * q_row[d];
+      }
+      for (int64_t d = 0; d < tables.r_dim; ++d) {
+        pr[d] += w * r_row[d];
+      }
+    }
+
+    float* o = out + b * out_dim;
+    switch (op) {
+      case QROperation::kConcat:
+        std::copy_n(pq, tables.q_dim, o);
+        std::copy_n(pr, tables.r_dim, o + tables.q_dim);
+        break;
+      case QROperation::kAdd:
+        for (int64_t d = 0; d < out_dim; ++d) {
+          o[d] = pq[d] + pr[d];
+        }
+        break;
+      case QROperation::kMult:
+        for (int64_t d = 0; d < out_dim; ++d) {
+          o[d] = pq[d] * pr[d];
+        }
+        break;
+    }
+  }
+}
+
+void qr_backward_pooled(
+    const QRTables& tables,
+    QROperation op,
+    const float* grad_out,
+    const float* pooled_q,
+    const float* pooled_r,
+    int64_t begin,
+    int64_t end,
+    float* grad_pooled_q,
+    float* grad_pooled_r) {
+  const int64_t out_dim = tables.out_dim(op);
+  for (int64_t b = begin; b < end; ++b) {
+    const float* g = grad_out + b * out_dim;
+    float* gq = grad_pooled_q + b * tables.q_dim;
+    float* gr = grad_pooled_r + b * tables.r_dim;
+    switch (op) {
+      case QROperation::kConcat:
+        std::copy_n(g, tables.q_dim, gq);
+        std::copy_n(g + tables.q_dim, tables.r_dim, gr);
+        break;
+      case QROperation::kAdd:
+        std::copy_n(g, out_dim, gq);
+        std::copy_n(g, out_dim, gr);
+        break;
+      case QROperation::kMult: {
+        const float* pq = pooled_q + b * tables.q_dim;
+        const float* pr = pooled_r + b * tables.r_dim;
+        for (int64_t d = 0; d < out_dim; ++d) {
+          gq[d] = g[d] * pr[d];
+          gr[d] = g[d] * pq[d];
+        }
+        break;
+      }
+    }
+  }
+}
+
+void qr_backward_table(
+    const QRTables& tables,
+    const Bags& bags,
+    PoolingMode mode,
+    bool quotient,
+    const float* grad_pooled,
+    int64_t col_begin,
+    int64_t col_end,
+    float* grad_table) {
+  const int64_t nc = tables.num_collisions;
+  const int64_t dim = quotient ? tables.q_dim : tables.r_dim;
+  for (int64_t b = 0; b < bags.num_bags; ++b) {
+    const float* g = grad_pooled + b * dim;
+    for (int64_t i = bags.offsets[b]; i < bags.offsets[b + 1]; ++i) {
+      int64_t index = bags.indices[i];
+      int64_t row = quotient ? index / nc : index % nc;
+      float w = sample_weight(bags, mode, b, i);
+      float* grad_row = grad_table + row * dim;
+      for (int64_t d = col_begin; d < col_end; ++d) {
+        grad_row[d] += w * g[d];
+      }
+    }
+  }
+}
+
+void qr_backward_sparse(
+    const QRTables& tables,
+    const Bags& bags,
+    PoolingMode mode,
+    bool quotient,
+    const float* grad_pooled,
+    int64_t begin,
+    int64_t end,
+    int64_t* rows,
+    float* values) {
+  const int64_t nc = tables.num_collisions;
+  const int64_t dim = quotient ? tables.q_dim : tables.r_dim;
+  for (int64_t b = begin; b < end; ++b) {
+    const float* g = grad_pooled + b * dim;
+    for (int64_t i = bags.offsets[b]; i < bags.offsets[b + 1]; ++i) {
+      int64_t index = bags.indices[i];
+      rows[i] = quotient ? index / nc : index % nc;
+      float w = sample_weight(bags, mode, b, i);
+      float* v = values + i * dim;
+      for (int64_t d = 0; d < dim; ++d) {
+        v[d] = w * g[d];
+      }
+    }
+  }
+}
+
+void qr_backward_sample_weights(
+    const QRTables& tables,
+    const Bags& bags,
+    const float* grad_pooled_q,
+    const float* grad_pooled_r,
+    int64_t begin,
+    int64_t end,
+    float* grad_weights) {
+  const int64_t nc = tables.num_collisions;
+  for (int64_t b = begin; b < end; ++b) {
+    const float* gq = grad_pooled_q + b * tables.q_dim;
+    const float* gr = grad_pooled_r + b * tables.r_dim;
+    for (int64_t i = bags.offsets[b]; i < bags.offsets[b + 1]; ++i) {
+      int64_t index = bags.indices[i];
+      const float* q_row = tables.q + (index / nc) * tables.q_dim;
+      const float* r_row = tables.r + (index % nc) * tables.r_dim;
+      float grad = 0.0f;
+      for (int64_t d = 0; d < tables.q_dim; ++d) {
+        grad += gq[d] * q_row[d];
+      }
+      for (int64_t d = 0; d < tables.r_dim; ++d) {
+        grad += gr[d] * r_row[d];
+      }
+      grad_weights[i] = grad;
+    }
+  }
+}
+
+} // namespace torchrec::embedding
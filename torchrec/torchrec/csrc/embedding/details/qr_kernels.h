@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stdint.h>
+
+namespace torchrec::embedding {
+
+/**
+ * How the pooled quotient and remainder embeddings are combined.
+ */
+enum class QROperation : int64_t {
+  kConcat = 0,
+  kAdd = 1,
+  kMult = 2,
+};
+
+enum class PoolingMode : int64_t {
+  kSum = 0,
+  kMean = 1,
+};
+
+/**
+ * The two tables of a quotient-remainder embedding bag. An index `i` looks
+ * up row `i / num_collisions` of `q` and row `i % num_collisions` of `r`.
+ */
+struct QRTables {
+  const float* q{nullptr};
+  int64_t q_dim{0};
+  const float* r{nullptr};
+  int64_t r_dim{0};
+  int64_t num_collisions{1};
+
+  [[nodiscard]] int64_t out_dim(QROperation op) const {
+    return op == QROperation::kConcat ? q_dim + r_dim : q_dim;
+  }
+};
+
+/**
+ * The bags of a batch: bag `b` holds `indices[offsets[b]:offsets[b + 1]]`.
+ * `per_sample_weights` may be null.
+ */
+struct Bags {
+  const int64_t* indices{nullptr};
+  const int64_t* offsets{nullptr};
+  const float* per_sample_weights{nullptr};
+  int64_t num_bags{0};
+};
+
+/**
+ * Pool the bags [begin, end) from both tables in one pass over their indices
+ * and combine them into `out` of [num_bags, out_dim].
+ *
+ * The pooled quotient and remainder embeddings are kept in `pooled_q` and
+ * `pooled_r` for the backward pass.
+ */
+void qr_forward(
+    const QRTables& tables,
+    const Bags& bags,
+    PoolingMode mode,
+    QROperation op,
+    int64_t begin,
+    int64_t end,
+    float* pooled_q,
+    float* pooled_r,
+    float* out);
+
+/**
+ * Gradients of the pooled embeddings of the bags [begin, end) from the
+ * gradient of the output.
+ */
+void qr_backward_pooled(
+    const QRTables& tables,
+    QROperation op,
+    const float* grad_out,
+    const float* pooled_q,
+    const float* pooled_r,
+    int64_t begin,
+    int64_t end,
+    float* grad_pooled_q,
+    float* grad_pooled_r);
+
+/**
+ * Accumulate the gradients of the pooled embeddings into the columns
+ * [col_begin, col_end) of the quotient (`quotient == true`) or remainder
+ * table gradient. Different column ranges can run in parallel without
+ * conflicts, regardless of repeated indices.
+ */
+void qr_backward_table(
+    const QRTables& tables,
+    const Bags& bags,
+    PoolingMode mode,
+    bool quotient,
+    const float* grad_pooled,
+    int64_t col_begin,
+    int64_t col_end,
+    float* grad_table);
+
+/**
+ * Sparse gradient of the quotient or remainder table, for the indices of the
+ * bags [begin, end): the table row of each index goes to `rows` and its
+ * gradient to `values` of [num_indices, dim]. Repeated rows are not
+ * coalesced, like the sparse gradient of `torch.nn.EmbeddingBag`.
+ */
+void qr_backward_sparse(
+    const QRTables& tables,
+    const Bags& bags,
+    PoolingMode mode,
+    bool quotient,
+    const float* grad_pooled,
+    int64_t begin,
+    int64_t end,
+    int64_t* rows,
+    float* values);
+
+/**
+ * Gradient of the per-sample weights of the indices of the bags [begin, end),
+ * sum mode only: the dot product of the gradients of the pooled embeddings
+ * with the quotient and remainder rows of each index.
+ */
+void qr_backward_sample_weights(
+    const QRTables& tables,
+    const Bags& bags,
+    const float* grad_pooled_q,
+    const float* grad_pooled_r,
+    int64_t begin,
+    int64_t end,
+    float* grad_weights);
+
+} // namespace torchrec::embedding
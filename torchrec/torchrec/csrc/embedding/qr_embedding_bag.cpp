@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <ATen/Parallel.h>
+#include <torchrec/csrc/embedding/details/qr_kernels.h>
+#include <torchrec/csrc/embedding/qr_embedding_bag.h>
+
+namespace torchrec::embedding {
+
+// Columns of a table gradient accumulated by one task in the backward.
+static constexpr int64_t k_backward_cols_per_task = 16;
+
+namespace {
+
+QRTables make_tables(
+    const torch::Tensor& weight_q,
+    const torch::Tensor& weight_r,
+    int64_t num_collisions) {
+  return {
+      .q = weight_q.data_ptr<float>(),
+      .q_dim = weight_q.size(1),
+      .r = weight_r.data_ptr<float>(),
+      .r_dim = weight_r.size(1),
+      .num_collisions = num_collisions,
+  };
+}
+
+Bags make_bags(
+    const torch::Tensor& indices,
+    const torch::Tensor& offsets,
+    const std::optional<torch::Tensor>& per_sample_weights) {
+  return {
+      .indices = indices.data_ptr<int64_t>(),
+      .offsets = offsets.data_ptr<int64_t>(),
+      .per_sample_weights = per_sample_weights.has_value()
+          ? per_sample_weights->data_ptr<float>()
+          : nullptr,
+      .num_bags = offsets.numel() - 1,
+  };
+}
+
+void accumulate_table_grad(
+    const QRTables& tables,
+    const Bags& bags,
+    PoolingMode mode,
+    bool quotient,
+    const torch::Tensor& grad_pooled,
+    torch::Tensor& grad_table) {
+  int64_t dim = grad_table.size(1);
+  int64_t num_tasks =
+      (dim + k_backward_cols_per_task - 1) / k_backward_cols_per_task;
+  at::parallel_for(0, num_tasks, 1, [&](int64_t begin, int64_t end) {
+    qr_backward_table(
+        tables,
+        bags,
+        mode,
+        quotient,
+        grad_pooled.data_ptr<float>(),
+        begin * k_backward_cols_per_task,
+        std::min(end * k_backward_cols_per_task, dim),
+        grad_table.data_ptr<float>());
+  });
+}
+
+torch::Tensor sparse_table_grad(
+    const QRTables& tables,
+    const Bags& bags,
+    PoolingMode mode,
+    bool quotient,
+    const torch::Tensor& grad_pooled,
+    const torch::Tensor& table) {
+  int64_t num_indices = bags.offsets[bags.num_bags];
+  auto rows = torch::empty({1, num_indices}, torch::dtype(torch::kLong));
+  auto values = torch::empty({num_indices, table.size(1)}, table.options());
+  at::parallel_for(0, bags.num_bags, 64, [&](int64_t begin, int64_t end) {
+    qr_backward_sparse(
+        tables,
+        bags,
+        mode,
+        quotient,
+        grad_pooled.data_ptr<float>(),
+        begin,
+        end,
+        rows.data_ptr<int64_t>(),
+        values.data_ptr<float>());
+  });
+  return torch::sparse_coo_tensor(rows, values, table.sizes());
+}
+
+class QREmbeddingBagFunction
+    : public torch::autograd::Function<QREmbeddingBagFunction> {
+ public:
+  static torch::Tensor forward(
+      torch::autograd::AutogradContext* ctx,
+      const torch::Tensor& weight_q,
+      const torch::Tensor& weight_r,
+      const torch::Tensor& indices,
+      const torch::Tensor& offsets,
+      const std::optional<torch::Tensor>& per_sample_weights,
+      int64_t num_collisions,
+      int64_t operation,
+      int64_t mode,
+      bool sparse) {
+    auto tables = make_tables(weight_q, weight_r, num_collisions);
+    auto bags = make_bags(indices, offsets, per_sample_weights);
+    auto op = static_cast<QROperation>(operation);
+    auto options = weight_q.options();
+    auto pooled_q = torch::empty({bags.num_bags, tables.q_dim}, options);
+    auto pooled_r = torch::empty({bags.num_bags, tables.r_dim}, options);
+    auto out = torch::empty({bags.num_bags, tables.out_dim(op)}, options);
+    at::parallel_for(0, bags.num_bags, 64, [&](int64_t begin, int64_t end) {
+      qr_forward(
+          tables,
+          bags,
+          static_cast<PoolingMode>(mode),
+          op,
+          begin,
+          end,
+          pooled_q.data_ptr<float>(),
+          pooled_r.data_ptr<float>(),
+          out.data_ptr<float>());
+    });
+
+    ctx->save_for_backward({weight_q, weight_r, indices, offsets});
+    ctx->saved_data["pooled_q"] = pooled_q;
+    ctx->saved_data["pooled_r"] = pooled_r;
+    if (per_sample_weights.has_value()) {
+      ctx->saved_data["per_sample_weights"] = *per_sample_weights;
+    }
+    ctx->saved_data["num_collisions"] = num_collisions;
+    ctx->saved_data["operation"] = operation;
+    ctx->saved_data["mode"] = mode;
+    ctx->saved_data["sparse"] = sparse;
+    return out;
+  }
+
+  static torch::autograd::variable_list backward(
+      torch::autograd::AutogradContext* ctx,
+      torch::autograd::variable_list grad_outputs) {
+    auto saved = ctx->get_saved_variables();
+    const auto& weight_q = saved[0];
+    const auto& weight_r = saved[1];
+    const auto& indices = saved[2];
+    const auto& offsets = saved[3];
+    auto pooled_q = ctx->saved_data["pooled_q"].toTensor();
+    auto pooled_r = ctx->saved_data["pooled_r"].toTensor();
+    std::optional<torch::Tensor> per_sample_weights;
+    if (ctx->saved_data.contains("per_sample_weights")) {
+      per_sample_weights = ctx->saved_data["per_sample_weights"].toTensor();
+    }
+    auto op = static_cast<QROperation>(
+        ctx->saved_data["operation"].toInt());
+    auto mode = static_cast<PoolingMode>(ctx->saved_data["mode"].toInt());
+    auto tables = make_tables(
+        weight_q, weight_r, ctx->saved_data["num_collisions"].toInt());
+    auto bags = make_bags(indices, offsets, per_sample_weights);
+
+    auto grad_out = grad_outputs[0].contiguous();
+    auto grad_pooled_q = torch::empty_like(pooled_q);
+    auto grad_pooled_r = torch::empty_like(pooled_r);
+    at::parallel_for(0, bags.num_bags, 64, [&](int64_t begin, int64_t end) {
+      qr_backward_pooled(
+          tables,
+          op,
+          grad_out.data_ptr<float>(),
+          pooled_q.data_ptr<float>(),
+          pooled_r.data_ptr<float>(),
+          begin,
+          end,
+          grad_pooled_q.data_ptr<float>(),
+          grad_pooled_r.data_ptr<float>());
+    });
+
+    torch::Tensor grad_q;
+    torch::Tensor grad_r;
+    if (ctx->saved_data["sparse"].toBool()) {
+      grad_q =
+          sparse_table_grad(tables, bags, mode, true, grad_pooled_q, weight_q);
+      grad_r =
+          sparse_table_grad(tables, bags, mode, false, grad_pooled_r, weight_r);
+    } else {
+      grad_q = torch::zeros_like(weight_q);
+      grad_r = torch::zeros_like(weight_r);
+      accumulate_table_grad(tables, bags, mode, true, grad_pooled_q, grad_q);
+      accumulate_table_grad(tables, bags, mode, false, grad_pooled_r, grad_r);
+    }
+
+    // Per-sample weights are only supported in sum mode, where each weight
+    // scales the rows of its index in both pooled embeddings.
+    torch::Tensor grad_weights;
+    if (per_sample_weights.has_value() && ctx->needs_input_grad(4)) {
+      grad_weights = torch::empty_like(*per_sample_weights);
+      at::parallel_for(0, bags.num_bags, 64, [&](int64_t begin, int64_t end) {
+        qr_backward_sample_weights(
+            tables,
+            bags,
+            grad_pooled_q.data_ptr<float>(),
+            grad_pooled_r.data_ptr<float>(),
+            begin,
+            end,
+            grad_weights.data_ptr<float>());
+      });
+    }
+    // No gradients for the indices, offsets and the other arguments.
+    return {
+        grad_q,
+        grad_r,
+        torch::Tensor(),
+        torch::Tensor(),
+        grad_weights,
+        torch::Tensor(),
+        torch::Tensor(),
+        torch::Tensor(),
+        torch::Tensor()};
+  }
+};
+
+} // namespace
+
+torch::Tensor qr_embedding_bag(
+    const torch::Tensor& weight_q,
+    const torch::Tensor& weight_r,
+    const torch::Tensor& indices,
+    const torch::Tensor& offsets,
+    const std::optional<torch::Tensor>& per_sample_weights,
+    int64_t num_collisions,
+    int64_t operation,
+    int64_t mode,
+    bool sparse) {
+  TORCH_CHECK(
+      weight_q.device().is_cpu() && weight_r.device().is_cpu(),
+      "qr_embedding_bag only supports cpu tables");
+  TORCH_CHECK(
+      weight_q.scalar_type() == torch::kFloat &&
+          weight_r.scalar_type() == torch::kFloat,
+      "qr_embedding_bag only supports float tables");
+  TORCH_CHECK(
+      weight_q.dim() == 2 && weight_r.dim() == 2, "tables should be 2D");
+  TORCH_CHECK(num_collisions > 0, "num_collisions should be positive");
+  TORCH_CHECK(
+      weight_r.size(0) == num_collisions,
+      "the remainder table should have num_collisions rows");
+  TORCH_CHECK(
+      operation >= 0 && operation <= 2,
+      "operation should be 0 (concat), 1 (add) or 2 (mult)");
+  TORCH_CHECK(mode == 0 || mode == 1, "mode should be 0 (sum) or 1 (mean)");
+  TORCH_CHECK(
+      operation == 0 || weight_q.size(1) == weight_r.size(1),
+      "add and mult need the same dimension for both tables");
+  TORCH_CHECK(
+      !per_sample_weights.has_value() || mode == 0,
+      "per_sample_weights are only supported in sum mode");
+  TORCH_CHECK(indices.dim() == 1, "indices should be 1D");
+  TORCH_CHECK(
+      offsets.dim() == 1 && offsets.numel() > 0,
+      "offsets should be 1D with num_bags + 1 elements");
+
+  auto indices_ = indices.to(torch::kLong).contiguous();
+  auto offsets_ = offsets.to(torch::kLong).contiguous();
+  TORCH_CHECK(
+      offsets_[0].item<int64_t>() == 0 &&
+          offsets_[-1].item<int64_t>() == indices_.numel(),
+      "offsets should start at 0 and end at the number of indices");
+  // The kernels read the indices of each bag without bounds checks.
+  const int64_t* offsets_data = offsets_.data_ptr<int64_t>();
+  for (int64_t b = 1; b < offsets_.numel(); ++b) {
+    TORCH_CHECK(
+        offsets_data[b - 1] <= offsets_data[b] &&
+            offsets_data[b] <= indices_.numel(),
+        "offsets should be non-decreasing and at most the number of "
+        "indices, got ",
+        offsets_data[b],
+        " after ",
+        offsets_data[b - 1]);
+  }
+  if (indices_.numel() > 0) {
+    auto [min, max] = torch::aminmax(indices_);
+    TORCH_CHECK(
+        min.item<int64_t>() >= 0 &&
+            max.item<int64_t>() < weight_q.size(0) * num_collisions,
+        "indices out of range of the tables");
+  }
+  std::optional<torch::Tensor> weights_;
+  if (per_sample_weights.has_value()) {
+    weights_ = per_sample_weights->to(torch::kFloat).contiguous();
+    TORCH_CHECK(
+        weights_->numel() == indices_.numel(),
+        "per_sample_weights should have one weight per index");
+  }
+  return QREmbeddingBagFunction::apply(
+      weight_q.contiguous(),
+      weight_r.contiguous(),
+      indices_,
+      offsets_,
+      weights_,
+      num_collisions,
+      operation,
+      mode,
+      sparse);
+}
+
+} // namespace torchrec::embedding
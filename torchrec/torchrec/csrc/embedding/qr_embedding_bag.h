@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <torch/torch.h>
+#include <optional>
+
+namespace torchrec::embedding {
+
+/**
+ * Quotient-remainder embedding bag on CPU, the fused version of
+ * `dlrm/tricks/qr_embedding_bag.py`.
+ *
+ * Each bag is pooled from both tables in one pass over its indices, then the
+ * pooled embeddings are combined, without materializing the quotient and
+ * remainder indices. It is differentiable w.r.t. both tables and the
+ * per-sample weights.
+ *
+ * @param weight_q quotient table of [ceil(num_categories / num_collisions),
+ * q_dim], float.
+ * @param weight_r remainder table of [num_collisions, r_dim], float.
+ * @param indices 1D int64 indices in [0, num_categories).
+ * @param offsets int64 offsets of the bags, `num_bags + 1` elements.
+ * @param per_sample_weights optional weights of the indices, sum mode only.
+ * @param operation 0: concat, 1: add, 2: mult.
+ * @param mode 0: sum, 1: mean.
+ * @param sparse whether the table gradients are sparse COO tensors.
+ * @return [num_bags, q_dim + r_dim] for concat, [num_bags, q_dim] otherwise.
+ */
+torch::Tensor qr_embedding_bag(
+    const torch::Tensor& weight_q,
+    const torch::Tensor& weight_r,
+    const torch::Tensor& indices,
+    const torch::Tensor& offsets,
+    const std::optional<torch::Tensor>& per_sample_weights,
+    int64_t num_collisions,
+    int64_t operation,
+    int64_t mode,
+    bool sparse);
+
+} // namespace torchrec::embedding
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <torch/torch.h>
+
+#include <torchrec/csrc/mc/mch_ops.h>
+
+namespace torchrec::mc {
+
+TORCH_LIBRARY(torchrec_mc, m) {
+  m.def(
+      "mch_remap(Tensor values, Tensor sorted_raw_ids, Tensor remapped_ids, "
+      "int zch_index) -> Tensor");
+  m.impl("mch_remap", torch::kCPU, TORCH_FN(mch_remap));
+  m.def("mch_match(Tensor sorted_raw_ids, Tensor values) -> (Tensor, Tensor)");
+  m.impl("mch_match", torch::kCPU, TORCH_FN(mch_match));
+  m.def(
+      "mch_coalesce(Tensor ids, Tensor[] history_metadata) "
+      "-> (Tensor, Tensor, Tensor[])");
+  m.impl("mch_coalesce", torch::kCPU, TORCH_FN(mch_coalesce));
+  m.def(
+      "mch_update_and_evict(int policy, int current_iter, "
+      "float decay_exponent, Tensor argsort_mapping, Tensor sorted_counts, "
+      "Tensor matching, Tensor matched_indices, Tensor(a!)? counts, "
+      "Tensor(b!)? last_access, Tensor? history_last_access) "
+      "-> (Tensor, Tensor)");
+  m.impl("mch_update_and_evict", torch::kCPU, TORCH_FN(mch_update_and_evict));
+}
+
+} // namespace torchrec::mc
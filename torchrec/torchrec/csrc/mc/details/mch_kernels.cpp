@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <c10/util/Exception.h>
+#include <torchrec/csrc/mc/details/mch_kernels.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+namespace torchrec::mc {
+
+namespace {
+
+// number of searches in lockstep.
+constexpr size_t k_search_block = 8;
+
+inline int64_t lower_bound_one(
+    const int64_t* data,
+    int64_t size,
+    int64_t value) {
+  const int64_t* base = data;
+  for (int64_t len = size; len > 1;) {
+    int64_t half = len / 2;
+    base += half * static_cast<int64_t>(base[half - 1] < value);
+    len -= half;
+  }
+  return (base - data) + static_cast<int64_t>(*base < value);
+}
+
+} // namespace
+
+void batch_lower_bound(
+    std::span<const int64_t> sorted,
+    std::span<const int64_t> values,
+    std::span<int64_t> positions) {
+  TORCH_CHECK(values.size() == positions.size());
+  auto size = static_cast<int64_t>(sorted.size());
+  if (size == 0) {
+    std::fill(positions.begin(), positions.end(), 0);
+    return;
+  }
+  const int64_t* data = sorted.data();
+  size_t i = 0;
+  for (; i + k_search_block <= values.size(); i += k_search_block) {
+    const int64_t* base[k_search_block];
+    int64_t keys[k_search_block];
+    for (size_t j = 0; j < k_search_block; ++j) {
+      base[j] = data;
+      keys[j] = values[i + j];
+    }
+    for (int64_t len = size; len > 1;) {
+      int64_t half = len / 2;
+      for (size_t j = 0; j < k_search_block; ++j) {
+        base[j] += half * static_cast<int64_t>(base[j][half - 1] < keys[j]);
+      }
+      len -= half;
+    }
+    for (size_t j = 0; j < k_search_block; ++j) {
+      positions[i + j] =
+          (base[j] - data) + static_cast<int64_t>(*base[j] < keys[j]);
+    }
+  }
+  for (; i < values.size(); ++i) {
+    positions[i] = lower_bound_one(data, size, values[i]);
+  }
+}
+
+void remap(
+    std::span<const int64_t> sorted_raw_ids,
+    std::span<const int64_t> remapped_ids,
+    std::span<const int64_t> values,
+    int64_t zch_index,
+    std::span<int64_t> output) {
+  TORCH_CHECK(!sorted_raw_ids.empty(), "sorted_raw_ids should not be empty");
+  TORCH_CHECK(sorted_raw_ids.size() == remapped_ids.size());
+  TORCH_CHECK(values.size() == output.size());
+  // searched in blocks, so that the positions stay in cache.
+  constexpr size_t k_block = 256;
+  int64_t positions[k_block];
+  auto searched = sorted_raw_ids.first(sorted_raw_ids.size() - 1);
+  for (size_t begin = 0; begin < values.size(); begin += k_block) {
+    size_t n = std::min(k_block, values.size() - begin);
+    batch_lower_bound(searched, values.subspan(begin, n), {positions, n});
+    for (size_t i = 0; i < n; ++i) {
+      int64_t p = positions[i];
+      output[begin + i] = sorted_raw_ids[p] == values[begin + i]
+          ? remapped_ids[p]
+          : zch_index;
+    }
+  }
+}
+
+template <typename Score>
+EvictionResult select_replacements(
+    std::span<const Score> scores,
+    int64_t pivot) {
+  EvictionResult result;
+  auto size = static_cast<int64_t>(scores.size());
+  if (size <= pivot) {
+    return result;
+  }
+  auto before = [&](int64_t a, int64_t b) {
+    return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+  };
+  std::vector<int64_t> order(size);
+  std::iota(order.begin(), order.end(), 0);
+  std::nth_element(order.begin(), order.begin() + pivot, order.end(), before);
+
+  for (int64_t i = 0; i < pivot; ++i) {
+    if (order[i] >= pivot) {
+      result.selected_new_indices.emplace_back(order[i]);
+    }
+  }
+  for (int64_t i = pivot; i < size; ++i) {
+    if (order[i] < pivot) {
+      result.evicted_indices.emplace_back(order[i]);
+    }
+  }
+  std::sort(
+      result.selected_new_indices.begin(),
+      result.selected_new_indices.end(),
+      before);
+  std::sort(
+      result.evicted_indices.begin(), result.evicted_indices.end(), before);
+  for (auto& index : result.selected_new_indices) {
+    index -= pivot;
+  }
+  return result;
+}
+
+template EvictionResult select_replacements<int64_t>(
+    std::span<const int64_t> scores,
+    int64_t pivot);
+template EvictionResult select_replacements<float>(
+    std::span<const float> scores,
+    int64_t pivot);
+
+EvictionResult update_and_evict(const EvictionInput& input) {
+  bool use_counts = input.policy != EvictionPolicy::kLRU;
+  bool use_last_access = input.policy != EvictionPolicy::kLFU;
+  auto mch_size = static_cast<int64_t>(
+      use_counts ? input.counts.size() : input.last_access.size());
+  TORCH_CHECK(mch_size > 0, "the MCH table should not be empty");
+  TORCH_CHECK(
+      !use_counts || static_cast<int64_t>(input.counts.size()) == mch_size);
+  TORCH_CHECK(
+      !use_last_access ||
+      static_cast<int64_t>(input.last_access.size()) == mch_size);
+  TORCH_CHECK(input.matching.size() == input.history_counts.size());
+  TORCH_CHECK(
+      !use_last_access ||
+      input.history_last_access.size() == input.history_counts.size());
+
+  // Update the matching ids and gather the new ones, in one pass.
+  std::vector<int64_t> new_counts;
+  std::vector<int64_t> new_last_access;
+  size_t num_matched = 0;
+  for (size_t i = 0; i < input.history_counts.size(); ++i) {
+    if (input.matching[i]) {
+      TORCH_CHECK(num_matched < input.matched_indices.size());
+      int64_t index = input.matched_indices[num_matched++];
+      if (use_counts) {
+        input.counts[index] += input.history_counts[i];
+      }
+      if (use_last_access) {
+        input.last_access[index] = input.history_last_access[i];
+      }
+    } else {
+      new_counts.emplace_back(input.history_counts[i]);
+      if (use_last_access) {
+        new_last_access.emplace_back(input.history_last_access[i]);
+      }
+    }
+  }
+  TORCH_CHECK(
+      num_matched == input.matched_indices.size(),
+      "matched_indices has ",
+      input.matched_indices.size(),
+      " elements, but ",
+      num_matched,
+      " ids are matching");
+
+  // The last element of the table is reserved and never evicted.
+  if (use_counts) {
+    input.counts[mch_size - 1] = std::numeric_limits<int64_t>::max();
+  }
+  if (use_last_access) {
+    input.last_access[mch_size - 1] = input.current_iter;
+  }
+
+  auto num_new = static_cast<int64_t>(new_counts.size());
+  EvictionResult result;
+  if (input.policy == EvictionPolicy::kLFU) {
+    std::vector<int64_t> scores(mch_size + num_new);
+    std::copy(input.counts.begin(), input.counts.end(), scores.begin());
+    std::copy(new_counts.begin(), new_counts.end(), scores.begin() + mch_size);
+    result = select_replacements<int64_t>(scores, mch_size);
+  } else {
+    // Computed in float as the python policies do.
+    auto decay = static_cast<float>(input.decay_exponent);
+    auto distance = [&](int64_t last_access) {
+      return std::pow(
+          static_cast<float>(input.current_iter - last_access + 1), decay);
+    };
+    bool lru = input.policy == EvictionPolicy::kLRU;
+    auto score = [&](int64_t count, int64_t last_access) {
+      return lru ? -distance(last_access)
+                 : static_cast<float>(count) / distance(last_access);
+    };
+    std::vector<float> scores(mch_size + num_new);
+    for (int64_t i = 0; i < mch_size; ++i) {
+      scores[i] = score(use_counts ? input.counts[i] : 0, input.last_access[i]);
+    }
+    for (int64_t i = 0; i < num_new; ++i) {
+      scores[mch_size + i] = score(new_counts[i], new_last_access[i]);
+    }
+    result = select_replacements<float>(scores, mch_size);
+  }
+
+  for (size_t i = 0; i < result.evicted_indices.size(); ++i) {
+    int64_t evicted = result.evicted_indices[i];
+    int64_t selected = result.selected_new_indices[i];
+    if (use_counts) {
+      input.counts[evicted] = new_counts[selected];
+    }
+    if (use_last_access) {
+      input.last_access[evicted] = new_last_access[selected];
+    }
+  }
+  return result;
+}
+
+CoalescedHistory coalesce_history(
+    std::span<const int64_t> ids,
+    std::span<const std::span<const int64_t>> metadata) {
+  for (auto& m : metadata) {
+    TORCH_CHECK(m.size() == ids.size());
+  }
+  std::vector<std::pair<int64_t, int64_t>> sorted(ids.size());
+  for (size_t i = 0; i < ids.size(); ++i) {
+    sorted[i] = {ids[i], static_cast<int64_t>(i)};
+  }
+  std::sort(sorted.begin(), sorted.end());
+
+  CoalescedHistory result;
+  result.metadata_max.resize(metadata.size());
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    int64_t position = sorted[i].second;
+    if (i == 0 || sorted[i].first != sorted[i - 1].first) {
+      result.unique_ids.emplace_back(sorted[i].first);
+      result.counts.emplace_back(1);
+      for (size_t j = 0; j < metadata.size(); ++j) {
+        result.metadata_max[j].emplace_back(metadata[j][position]);
+      }
+      continue;
+    }
+    ++result.counts.back();
+    for (size_t j = 0; j < metadata.size(); ++j) {
+      auto& m = result.metadata_max[j].back();
+      m = std::max(m, metadata[j][position]);
+    }
+  }
+  return result;
+}
+
+} // namespace torchrec::mc
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <span>
+#include <vector>
+
+namespace torchrec::mc {
+
+/**
+ * The index of the first element of `sorted` that is not less than each
+ * `values[i]`, in [0, sorted.size()].
+ *
+ * The search is branch free, and runs on a block of values in lockstep, so
+ * that the loads of the block are independent and overlap in the memory
+ * system.
+ */
+void batch_lower_bound(
+    std::span<const int64_t> sorted,
+    std::span<const int64_t> values,
+    std::span<int64_t> positions);
+
+/**
+ * Remap `values` by the sorted raw ids of the MCH table. The id of a value
+ * found at `sorted_raw_ids[i]` is `remapped_ids[i]`, the others are mapped to
+ * `zch_index`. The last element of `sorted_raw_ids` is reserved and never
+ * matched, as in `torch.searchsorted(sorted_raw_ids[:-1], values)`.
+ */
+void remap(
+    std::span<const int64_t> sorted_raw_ids,
+    std::span<const int64_t> remapped_ids,
+    std::span<const int64_t> values,
+    int64_t zch_index,
+    std::span<int64_t> output);
+
+enum class EvictionPolicy : int64_t {
+  kLFU = 0,
+  kLRU = 1,
+  kDistanceLFU = 2,
+};
+
+/**
+ * The state of the MCH table and the coalesced history of an eviction.
+ *
+ * The history holds the unique ids sorted by their counts in descending
+ * order. `matching` tells whether each of them is already in the table, and
+ * `matched_indices` are the table indices of the matching ones, in order.
+ */
+struct EvictionInput {
+  EvictionPolicy policy;
+  int64_t current_iter;
+  double decay_exponent;
+  std::span<const int64_t> history_counts;
+  std::span<const bool> matching;
+  std::span<const int64_t> matched_indices;
+  // the last access iteration of each history id, in the order of
+  // `history_counts`. Only for kLRU and kDistanceLFU.
+  std::span<const int64_t> history_last_access;
+  // updated in place. `counts` is empty for kLRU, `last_access` is empty for
+  // kLFU.
+  std::span<int64_t> counts;
+  std::span<int64_t> last_access;
+};
+
+struct EvictionResult {
+  // indices in the table to be evicted.
+  std::vector<int64_t> evicted_indices;
+  // the indices of the new ids, i.e. the history ids not in the table, that
+  // replace `evicted_indices` one by one.
+  std::vector<int64_t> selected_new_indices;
+};
+
+/**
+ * Update the metadata of the matching ids, score the table and the new ids by
+ * the policy, and replace the lowest scored ids of the table by the higher
+ * scored new ids. The metadata of the replaced ids are updated as well.
+ *
+ * This is `MCHEvictionPolicy.update_metadata_and_generate_eviction_scores`
+ * in one pass: the table is kept whole, and only the ids crossing the pivot
+ * are sorted, instead of sorting all the scores.
+ */
+EvictionResult update_and_evict(const EvictionInput& input);
+
+/**
+ * Select the `pivot` highest of `scores`, where ties are broken by the lower
+ * index, as a stable descending argsort does. Returns the indices below
+ * `pivot` not selected, and the indices from `pivot` selected (minus
+ * `pivot`), both in the descending order of the scores.
+ */
+template <typename Score>
+EvictionResult select_replacements(
+    std::span<const Score> scores,
+    int64_t pivot);
+
+/**
+ * Unique sorted ids with their counts, and the max of each metadata over the
+ * occurrences of each unique id.
+ */
+struct CoalescedHistory {
+  std::vector<int64_t> unique_ids;
+  std::vector<int64_t> counts;
+  std::vector<std::vector<int64_t>> metadata_max;
+};
+
+CoalescedHistory coalesce_history(
+    std::span<const int64_t> ids,
+    std::span<const std::span<const int64_t>> metadata);
+
+} // namespace torchrec::mc
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <ATen/Parallel.h>
+#include <torchrec/csrc/mc/details/mch_kernels.h>
+#include <torchrec/csrc/mc/mch_ops.h>
+
+namespace torchrec::mc {
+
+namespace {
+
+// values searched by a task.
+constexpr int64_t k_grain_size = 4096;
+
+void check_ids(const torch::Tensor& t, const char* name) {
+  TORCH_CHECK(t.device().is_cpu(), name, " should be a cpu tensor");
+  TORCH_CHECK(t.dim() == 1, name, " should be 1D");
+  TORCH_CHECK(t.scalar_type() == torch::kInt64, name, " should be int64");
+  TORCH_CHECK(t.is_contiguous(), name, " should be contiguous");
+}
+
+std::span<const int64_t> as_span(const torch::Tensor& t) {
+  return {t.data_ptr<int64_t>(), static_cast<size_t>(t.numel())};
+}
+
+std::span<int64_t> as_mutable_span(torch::Tensor& t) {
+  return {t.data_ptr<int64_t>(), static_cast<size_t>(t.numel())};
+}
+
+torch::Tensor to_tensor(const std::vector<int64_t>& v) {
+  return torch::tensor(v, torch::kInt64);
+}
+
+} // namespace
+
+torch::Tensor mch_remap(
+    const torch::Tensor& values,
+    const torch::Tensor& sorted_raw_ids,
+    const torch::Tensor& remapped_ids,
+    int64_t zch_index) {
+  auto flat_values = values.contiguous();
+  check_ids(flat_values, "values");
+  check_ids(sorted_raw_ids, "sorted_raw_ids");
+  check_ids(remapped_ids, "remapped_ids");
+  auto output = torch::empty_like(flat_values);
+  auto sorted = as_span(sorted_raw_ids);
+  auto remapped = as_span(remapped_ids);
+  auto input = as_span(flat_values);
+  auto result = as_mutable_span(output);
+  at::parallel_for(
+      0, flat_values.numel(), k_grain_size, [&](int64_t begin, int64_t end) {
+        remap(
+            sorted,
+            remapped,
+            input.subspan(begin, end - begin),
+            zch_index,
+            result.subspan(begin, end - begin));
+      });
+  return output;
+}
+
+std::tuple<torch::Tensor, torch::Tensor> mch_match(
+    const torch::Tensor& sorted_raw_ids,
+    const torch::Tensor& values) {
+  auto flat_values = values.contiguous();
+  check_ids(flat_values, "values");
+  check_ids(sorted_raw_ids, "sorted_raw_ids");
+  TORCH_CHECK(sorted_raw_ids.numel() > 0, "sorted_raw_ids is empty");
+  auto sorted = as_span(sorted_raw_ids);
+  auto searched = sorted.first(sorted.size() - 1);
+  auto input = as_span(flat_values);
+  std::vector<int64_t> positions(input.size());
+  auto matching = torch::empty(
+      {flat_values.numel()}, torch::TensorOptions().dtype(torch::kBool));
+  auto* matching_ptr = matching.data_ptr<bool>();
+  at::parallel_for(
+      0, flat_values.numel(), k_grain_size, [&](int64_t begin, int64_t end) {
+        batch_lower_bound(
+            searched,
+            input.subspan(begin, end - begin),
+            std::span{positions}.subspan(begin, end - begin));
+        for (int64_t i = begin; i < end; ++i) {
+          matching_ptr[i] = sorted[positions[i]] == input[i];
+        }
+      });
+  std::vector<int64_t> matched_indices;
+  for (size_t i = 0; i < positions.size(); ++i) {
+    if (matching_ptr[i]) {
+      matched_indices.emplace_back(positions[i]);
+    }
+  }
+  return {matching, to_tensor(matched_indices)};
+}
+
+std::tuple<torch::Tensor, torch::Tensor, std::vector<torch::Tensor>>
+mch_coalesce(
+    const torch::Tensor& ids,
+    const std::vector<torch::Tensor>& history_metadata) {
+  auto flat_ids = ids.contiguous();
+  check_ids(flat_ids, "ids");
+  std::vector<torch::Tensor> flat_metadata;
+  std::vector<std::span<const int64_t>> metadata;
+  for (auto& m : history_metadata) {
+    flat_metadata.emplace_back(m.contiguous());
+    check_ids(flat_metadata.back(), "history_metadata");
+    metadata.emplace_back(as_span(flat_metadata.back()));
+  }
+  auto coalesced = coalesce_history(as_span(flat_ids), metadata);
+  std::vector<torch::Tensor> metadata_max;
+  for (auto& m : coalesced.metadata_max) {
+    metadata_max.emplace_back(to_tensor(m));
+  }
+  return {
+      to_tensor(coalesced.unique_ids),
+      to_tensor(coalesced.counts),
+      std::move(metadata_max)};
+}
+
+std::tuple<torch::Tensor, torch::Tensor> mch_update_and_evict(
+    int64_t policy,
+    int64_t current_iter,
+    double decay_exponent,
+    const torch::Tensor& argsort_mapping,
+    const torch::Tensor& sorted_counts,
+    const torch::Tensor& matching,
+    const torch::Tensor& matched_indices,
+    const std::optional<torch::Tensor>& counts,
+    const std::optional<torch::Tensor>& last_access,
+    const std::optional<torch::Tensor>& history_last_access) {
+  TORCH_CHECK(
+      policy >= 0 &&
+          policy <= static_cast<int64_t>(EvictionPolicy::kDistanceLFU),
+      "unknown eviction policy ",
+      policy);
+  auto eviction_policy = static_cast<EvictionPolicy>(policy);
+  bool use_counts = eviction_policy != EvictionPolicy::kLRU;
+  bool use_last_access = eviction_policy != EvictionPolicy::kLFU;
+  TORCH_CHECK(
+      counts.has_value() == use_counts,
+      "counts should be given only for the LFU and DistanceLFU policies");
+  TORCH_CHECK(
+      last_access.has_value() == use_last_access &&
+          history_last_access.has_value() == use_last_access,
+      "last access should be given only for the LRU and DistanceLFU policies");
+
+  auto flat_counts = sorted_counts.contiguous();
+  check_ids(flat_counts, "sorted_counts");
+  auto flat_matched = matched_indices.contiguous();
+  check_ids(flat_matched, "matched_indices");
+  auto flat_matching = matching.contiguous();
+  TORCH_CHECK(
+      flat_matching.scalar_type() == torch::kBool, "matching should be bool");
+  TORCH_CHECK(flat_matching.numel() == flat_counts.numel());
+
+  torch::Tensor counts_tensor;
+  torch::Tensor last_access_tensor;
+  torch::Tensor sorted_last_access;
+  EvictionInput input{
+      .policy = eviction_policy,
+      .current_iter = current_iter,
+      .decay_exponent = decay_exponent,
+      .history_counts = as_span(flat_counts),
+      .matching =
+          {flat_matching.data_ptr<bool>(),
+           static_cast<size_t>(flat_matching.numel())},
+      .matched_indices = as_span(flat_matched),
+  };
+  if (use_counts) {
+    counts_tensor = *counts;
+    check_ids(counts_tensor, "counts");
+    input.counts = as_mutable_span(counts_tensor);
+  }
+  if (use_last_access) {
+    last_access_tensor = *last_access;
+    check_ids(last_access_tensor, "last_access");
+    input.last_access = as_mutable_span(last_access_tensor);
+    sorted_last_access =
+        history_last_access->index_select(0, argsort_mapping).contiguous();
+    check_ids(sorted_last_access, "history_last_access");
+    input.history_last_access = as_span(sorted_last_access);
+  }
+
+  auto result = update_and_evict(input);
+  return {
+      to_tensor(result.evicted_indices),
+      to_tensor(result.selected_new_indices)};
+}
+
+} // namespace torchrec::mc
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <torch/torch.h>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+namespace torchrec::mc {
+
+/**
+ * Remap the ids of a feature by the MCH table, as `_mch_remap` does.
+ *
+ * @param values the feature ids.
+ * @param sorted_raw_ids the sorted raw ids of the table, whose last element
+ * is reserved.
+ * @param remapped_ids the output id of each raw id.
+ * @param zch_index the output id of the ids not in the table.
+ */
+torch::Tensor mch_remap(
+    const torch::Tensor& values,
+    const torch::Tensor& sorted_raw_ids,
+    const torch::Tensor& remapped_ids,
+    int64_t zch_index);
+
+/**
+ * Returns the mask of `values` found in `sorted_raw_ids[:-1]` and the indices
+ * where they are found, as `MCHManagedCollisionModule._match_indices` does.
+ */
+std::tuple<torch::Tensor, torch::Tensor> mch_match(
+    const torch::Tensor& sorted_raw_ids,
+    const torch::Tensor& values);
+
+/**
+ * Coalesce the history ids into the sorted unique ids and their counts, and
+ * reduce each history metadata by max over the occurrences of each id.
+ */
+std::tuple<torch::Tensor, torch::Tensor, std::vector<torch::Tensor>>
+mch_coalesce(
+    const torch::Tensor& ids,
+    const std::vector<torch::Tensor>& history_metadata);
+
+/**
+ * The fused `update_metadata_and_generate_eviction_scores` of the LFU, LRU
+ * and DistanceLFU policies. `counts` and `last_access` are the MCH metadata
+ * and updated in place, the ones the policy does not use are None.
+ * `history_last_access` is the coalesced last access iteration, in the order
+ * of the unique ids, i.e. before `argsort_mapping` is applied.
+ *
+ * @return evicted indices and selected new indices.
+ */
+std::tuple<torch::Tensor, torch::Tensor> mch_update_and_evict(
+    int64_t policy,
+    int64_t current_iter,
+    double decay_exponent,
+    const torch::Tensor& argsort_mapping,
+    const torch::Tensor& sorted_counts,
+    const torch::Tensor& matching,
+    const torch::Tensor& matched_indices,
+    const std::optional<torch::Tensor>& counts,
+    const std::optional<torch::Tensor>& last_access,
+    const std::optional<torch::Tensor>& history_last_access);
+
+} // namespace torchrec::mc
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <ATen/Parallel.h>
+#include <c10/util/flat_hash_map.h>
+#include <torchrec/csrc/metrics/auc_kernels.h>
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+namespace torchrec::metrics {
+
+// Examples binned by one task of `binned_histogram`.
+static constexpr int64_t k_histogram_grain_size = 1 << 15;
+
+namespace {
+
+void check_inputs(
+    const torch::Tensor& predictions,
+    const torch::Tensor& labels,
+    const torch::Tensor& weights) {
+  TORCH_CHECK(
+      predictions.device().is_cpu(), "only cpu tensors are supported");
+  TORCH_CHECK(
+      predictions.dim() == 2, "predictions should be [n_tasks, n_examples]");
+  TORCH_CHECK(
+      labels.sizes() == predictions.sizes() &&
+          weights.sizes() == predictions.sizes(),
+      "predictions, labels and weights should have the same shape");
+}
+
+struct Example {
+  float prediction;
+  float label;
+  float weight;
+};
+
+// AUC of examples sorted by descending prediction, with tied predictions in
+// their original order as `torch.argsort(stable=True)` leaves them. The ROC
+// curve goes through every example and is integrated by the trapezoidal rule
+// from the first one, as `_compute_auc_helper` in `torchrec/metrics/auc.py`
+// does, so that both give the same AUC for the same tie order.
+double sorted_auc(const std::vector<Example>& examples) {
+  double area = 0;
+  double tp = 0;
+  double fp = 0;
+  for (size_t i = 0; i < examples.size(); ++i) {
+    const auto& example = examples[i];
+    double prev_tp = tp;
+    double d_fp = example.weight * (1.0 - example.label);
+    tp += example.weight * example.label;
+    fp += d_fp;
+    if (i > 0) {
+      area += d_fp * (prev_tp + tp) / 2;
+    }
+  }
+  // 0.5 is the no-signal default value for auc.
+  return tp * fp == 0 ? 0.5 : area / tp / fp;
+}
+
+torch::Tensor check_histogram(const torch::Tensor& histogram) {
+  TORCH_CHECK(histogram.device().is_cpu(), "only cpu tensors are supported");
+  TORCH_CHECK(
+      histogram.dim() == 3 && histogram.size(1) == 2,
+      "histogram should be [n_tasks, 2, num_bins]");
+  return histogram.to(torch::kDouble).contiguous();
+}
+
+// Applies `fn(neg, pos, num_bins)` to the histogram of every task.
+template <typename Fn>
+torch::Tensor per_task(const torch::Tensor& histogram, Fn fn) {
+  auto hist = check_histogram(histogram);
+  int64_t n_tasks = hist.size(0);
+  int64_t num_bins = hist.size(2);
+  auto result = torch::empty({n_tasks}, torch::dtype(torch::kFloat));
+  for (int64_t task = 0; task < n_tasks; ++task) {
+    const double* neg = hist.data_ptr<double>() + task * 2 * num_bins;
+    result[task] = fn(neg, neg + num_bins, num_bins);
+  }
+  return result;
+}
+
+} // namespace
+
+torch::Tensor binned_histogram(
+    const torch::Tensor& predictions,
+    const torch::Tensor& labels,
+    const torch::Tensor& weights,
+    int64_t num_bins) {
+  check_inputs(predictions, labels, weights);
+  TORCH_CHECK(num_bins > 0, "num_bins should be positive");
+  auto preds = predictions.to(torch::kFloat).contiguous();
+  auto labs = labels.to(torch::kFloat).contiguous();
+  auto wts = weights.to(torch::kFloat).contiguous();
+  int64_t n_tasks = preds.size(0);
+  int64_t n = preds.size(1);
+  auto histogram =
+      torch::zeros({n_tasks, 2, num_bins}, torch::dtype(torch::kDouble));
+
+  for (int64_t task = 0; task < n_tasks; ++task) {
+    const float* p = preds.data_ptr<float>() + task * n;
+    const float* l = labs.data_ptr<float>() + task * n;
+    const float* w = wts.data_ptr<float>() + task * n;
+    double* neg = histogram.data_ptr<double>() + task * 2 * num_bins;
+    double* pos = neg + num_bins;
+    std::mutex mu;
+    at::parallel_for(0, n, k_histogram_grain_size, [&](int64_t b, int64_t e) {
+      std::vector<double> local(2 * num_bins, 0);
+      for (int64_t i = b; i < e; ++i) {
+        auto bin = static_cast<int64_t>(p[i] * num_bins);
+        bin = std::clamp<int64_t>(bin, 0, num_bins - 1);
+        local[bin] += w[i] * (1.0 - l[i]);
+        local[num_bins + bin] += w[i] * l[i];
+      }
+      std::lock_guard<std::mutex> guard(mu);
+      for (int64_t bin = 0; bin < num_bins; ++bin) {
+        neg[bin] += local[bin];
+        pos[bin] += local[num_bins + bin];
+      }
+    });
+  }
+  return histogram;
+}
+
+torch::Tensor histogram_auc(const torch::Tensor& histogram) {
+  return per_task(
+      histogram, [](const double* neg, const double* pos, int64_t num_bins) {
+        double area = 0;
+        double tp = 0;
+        double fp = 0;
+        // Walk the bins from the highest prediction down, the pairs within a
+        // bin count as half.
+        for (int64_t bin = num_bins - 1; bin >= 0; --bin) {
+          tp += pos[bin];
+          fp += neg[bin];
+          area += neg[bin] * (tp - pos[bin] / 2);
+        }
+        // 0.5 is the no-signal default value for auc.
+        return tp * fp == 0 ? 0.5 : area / (tp * fp);
+      });
+}
+
+torch::Tensor histogram_auc_error_bound(const torch::Tensor& histogram) {
+  return per_task(
+      histogram, [](const double* neg, const double* pos, int64_t num_bins) {
+        double tied = 0;
+        double tp = 0;
+        double fp = 0;
+        for (int64_t bin = 0; bin < num_bins; ++bin) {
+          tied += neg[bin] * pos[bin];
+          tp += pos[bin];
+          fp += neg[bin];
+        }
+        return tp * fp == 0 ? 0.0 : tied / 2 / (tp * fp);
+      });
+}
+
+torch::Tensor histogram_auprc(const torch::Tensor& histogram) {
+  return per_task(
+      histogram, [](const double* neg, const double* pos, int64_t num_bins) {
+        double total_tp = 0;
+        for (int64_t bin = 0; bin < num_bins; ++bin) {
+          total_tp += pos[bin];
+        }
+        if (total_tp == 0) {
+          return 0.0;
+        }
+        double area = 0;
+        double tp = 0;
+        double fp = 0;
+        double prev_recall = 0;
+        for (int64_t bin = num_bins - 1; bin >= 0; --bin) {
+          if (neg[bin] + pos[bin] == 0) {
+            continue;
+          }
+          tp += pos[bin];
+          fp += neg[bin];
+          double recall = tp / total_tp;
+          area += (recall - prev_recall) * tp / (tp + fp);
+          prev_recall = recall;
+        }
+        return area;
+      });
+}
+
+torch::Tensor grouped_auc(
+    const torch::Tensor& predictions,
+    const torch::Tensor& labels,
+    const torch::Tensor& weights,
+    const torch::Tensor& grouping_keys) {
+  check_inputs(predictions, labels, weights);
+  auto preds = predictions.to(torch::kFloat).contiguous();
+  auto labs = labels.to(torch::kFloat).contiguous();
+  auto wts = weights.to(torch::kFloat).contiguous();
+  auto keys = grouping_keys.to(torch::kLong).contiguous();
+  int64_t n_tasks = preds.size(0);
+  int64_t n = preds.size(1);
+  TORCH_CHECK(keys.numel() == n, "one grouping key per example");
+
+  // Counting sort the examples by group.
+  const int64_t* key_ptr = keys.data_ptr<int64_t>();
+  ska::flat_hash_map<int64_t, int64_t> group_ids;
+  std::vector<int64_t> example_groups(n);
+  for (int64_t i = 0; i < n; ++i) {
+    auto [it, _] = group_ids.try_emplace(key_ptr[i], group_ids.size());
+    example_groups[i] = it->second;
+  }
+  auto num_groups = static_cast<int64_t>(group_ids.size());
+  std::vector<int64_t> group_offsets(num_groups + 1, 0);
+  for (auto group : example_groups) {
+    ++group_offsets[group + 1];
+  }
+  std::partial_sum(
+      group_offsets.begin(), group_offsets.end(), group_offsets.begin());
+  std::vector<int64_t> order(n);
+  {
+    std::vector<int64_t> cursors(group_offsets.begin(), group_offsets.end());
+    for (int64_t i = 0; i < n; ++i) {
+      order[cursors[example_groups[i]]++] = i;
+    }
+  }
+
+  auto result = torch::full({n_tasks}, 0.5, torch::dtype(torch::kFloat));
+  if (num_groups == 0) {
+    return result;
+  }
+  for (int64_t task = 0; task < n_tasks; ++task) {
+    const float* p = preds.data_ptr<float>() + task * n;
+    const float* l = labs.data_ptr<float>() + task * n;
+    const float* w = wts.data_ptr<float>() + task * n;
+    std::vector<double> aucs(num_groups);
+    at::parallel_for(0, num_groups, 1, [&](int64_t b, int64_t e) {
+      std::vector<Example> examples;
+      for (int64_t g = b; g < e; ++g) {
+        examples.clear();
+        for (int64_t k = group_offsets[g]; k < group_offsets[g + 1]; ++k) {
+          int64_t i = order[k];
+          examples.push_back({p[i], l[i], w[i]});
+        }
+        // The examples of a group are in their original order.
+        std::stable_sort(
+            examples.begin(), examples.end(), [](auto& lhs, auto& rhs) {
+              return lhs.prediction > rhs.prediction;
+            });
+        aucs[g] = sorted_auc(examples);
+      }
+    });
+    result[task] = std::accumulate(aucs.begin(), aucs.end(), 0.0) /
+        static_cast<double>(num_groups);
+  }
+  return result;
+}
+
+} // namespace torchrec::metrics
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <torch/torch.h>
+
+namespace torchrec::metrics {
+
+/**
+ * Histogram of the predictions in [0, 1] by label, the mergeable state of the
+ * binned AUC and AUPRC.
+ *
+ * @param predictions, labels, weights float tensors of [n_tasks, n_examples].
+ * Labels may be soft, an example adds `weight * (1 - label)` to the negative
+ * and `weight * label` to the positive histogram.
+ * @return float64 tensor of [n_tasks, 2, num_bins], whose `[:, 0]` and
+ * `[:, 1]` are the negative and positive weights of each prediction bin.
+ */
+torch::Tensor binned_histogram(
+    const torch::Tensor& predictions,
+    const torch::Tensor& labels,
+    const torch::Tensor& weights,
+    int64_t num_bins);
+
+/**
+ * AUC of the ROC curve through the bin boundaries of `histogram`, integrated
+ * by the trapezoidal rule, the same as `auc_from_histogram` in
+ * `torchrec/metrics/binned_auc.py`.
+ *
+ * @param histogram float64 tensor of [n_tasks, 2, num_bins] from
+ * `binned_histogram`, possibly summed over batches and ranks.
+ * @return float tensor of [n_tasks], 0.5 for tasks without both labels.
+ */
+torch::Tensor histogram_auc(const torch::Tensor& histogram);
+
+/**
+ * The largest difference between `histogram_auc` and the exact AUC of the
+ * binned examples: within a bin, the exact AUC may order any negative before
+ * or after any positive, while the binned AUC counts each such pair as half.
+ *
+ * @return float tensor of [n_tasks].
+ */
+torch::Tensor histogram_auc_error_bound(const torch::Tensor& histogram);
+
+/**
+ * AUPRC of the precision-recall curve through the non-empty bin boundaries,
+ * integrated by the Riemann sum, the same as `auprc_from_histogram` in
+ * `torchrec/metrics/binned_auc.py`.
+ *
+ * @return float tensor of [n_tasks], 0 for tasks without positive weight.
+ */
+torch::Tensor histogram_auprc(const torch::Tensor& histogram);
+
+/**
+ * The average exact AUC of the groups of examples with the same grouping
+ * key, the same as `compute_auc_per_group` in `torchrec/metrics/auc.py`.
+ * Tied predictions are ordered by example index, as the stable argsort of
+ * the python version does.
+ *
+ * Examples are bucketed by group in one pass, and each group is sorted on
+ * its own, so the cost is O(n log(group size)) instead of a masked pass over
+ * all examples per group.
+ *
+ * @param grouping_keys int64 tensor of [n_examples].
+ * @return float tensor of [n_tasks].
+ */
+torch::Tensor grouped_auc(
+    const torch::Tensor& predictions,
+    const torch::Tensor& labels,
+    const torch::Tensor& weights,
+    const torch::Tensor& grouping_keys);
+
+} // namespace torchrec::metrics
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <torch/torch.h>
+
+#include <torchrec/csrc/metrics/auc_kernels.h>
+
+namespace torchrec::metrics {
+
+TORCH_LIBRARY(rec_metrics, m) {
+  m.def(
+      "binned_histogram(Tensor predictions, Tensor labels, Tensor weights, "
+      "int num_bins) -> Tensor",
+      &binned_histogram);
+  m.def("histogram_auc(Tensor histogram) -> Tensor", &histogram_auc);
+  m.def(
+      "histogram_auc_error_bound(Tensor histogram) -> Tensor",
+      &histogram_auc_error_bound);
+  m.def("histogram_auprc(Tensor histogram) -> Tensor", &histogram_auprc);
+  m.def(
+      "grouped_auc(Tensor predictions, Tensor labels, Tensor weights, "
+      "Tensor grouping_keys) -> Tensor",
+      &grouped_auc);
+}
+
+} // namespace torchrec::metrics
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <torch/torch.h>
+
+#include <torchrec/csrc/planner/plan_space_wrapper.h>
+
+namespace torchrec::planner {
+
+TORCH_LIBRARY(torchrec_planner, m) {
+  m.def(
+      "dp_propose(Tensor table_offsets, Tensor hbm_bins, Tensor perf, "
+      "int bin_count) -> Tensor");
+  m.impl("dp_propose", torch::kCPU, TORCH_FN(dp_propose));
+
+  m.class_<PlanSpaceWrapper>("PlanSpace")
+      .def(torch::init<
+           torch::Tensor,
+           torch::Tensor,
+           torch::Tensor,
+           torch::Tensor,
+           torch::Tensor,
+           torch::Tensor,
+           torch::Tensor,
+           torch::Tensor,
+           torch::Tensor,
+           int64_t,
+           bool,
+           bool>())
+      .def("partition", &PlanSpaceWrapper::partition)
+      .def("evaluate", &PlanSpaceWrapper::evaluate);
+}
+
+} // namespace torchrec::planner
@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <c10/util/Exception.h>
+#include <torchrec/csrc/planner/details/search.h>
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <tuple>
+
+namespace torchrec::planner {
+
+namespace {
+
+constexpr double k_inf = std::numeric_limits<double>::infinity();
+
+struct DPState {
+  double perf{k_inf};
+  double hbm{k_inf};
+  // the option of the table and the bin of the previous table that reach
+  // this state.
+  int32_t option{-1};
+  int32_t prev_bin{-1};
+};
+
+using DPRow = std::vector<DPState>;
+
+/**
+ * Relax the options [begin, end) of a table from `prev`, the row of the
+ * previous table, or from nothing for the first table.
+ */
+void relax(
+    const DPRow* prev,
+    std::span<const double> hbm,
+    std::span<const double> perf,
+    int64_t begin,
+    int64_t end,
+    DPRow& out) {
+  auto bin_count = static_cast<int64_t>(out.size());
+  auto bins = static_cast<double>(bin_count);
+  for (int64_t j = begin; j < end; ++j) {
+    if (prev == nullptr) {
+      if (hbm[j] < bins) {
+        auto& state = out[static_cast<int64_t>(hbm[j])];
+        if (state.perf > perf[j]) {
+          state = {perf[j], hbm[j], static_cast<int32_t>(j), -1};
+        }
+      }
+      continue;
+    }
+    for (int64_t h = 0; h < bin_count; ++h) {
+      const auto& p = (*prev)[h];
+      if (p.perf == k_inf) {
+        continue;
+      }
+      double new_hbm = p.hbm + hbm[j];
+      if (new_hbm >= bins) {
+        continue;
+      }
+      double new_perf = p.perf + perf[j];
+      auto& state = out[static_cast<int64_t>(new_hbm)];
+      if (state.perf > new_perf) {
+        state = {
+            new_perf,
+            new_hbm,
+            static_cast<int32_t>(j),
+            static_cast<int32_t>(h)};
+      }
+    }
+  }
+}
+
+// keeps the state of `into` on ties, as the earlier option wins in the
+// sequential loop.
+void merge(DPRow& into, const DPRow& from) {
+  for (size_t b = 0; b < into.size(); ++b) {
+    if (into[b].perf > from[b].perf) {
+      into[b] = from[b];
+    }
+  }
+}
+
+struct Backtrack {
+  int32_t option;
+  int32_t prev_bin;
+};
+
+using DeviceKey = std::tuple<double, int64_t, int64_t>;
+
+// the order of `OrderedDeviceHardware`, where devices are indexed by rank.
+DeviceKey device_key(
+    const std::vector<Device>& devices,
+    int64_t local_world_size,
+    int64_t d) {
+  return {devices[d].perf.total(), d % local_world_size, d};
+}
+
+} // namespace
+
+void sequential_for(
+    int64_t n,
+    const std::function<void(int64_t, int64_t)>& fn) {
+  if (n > 0) {
+    fn(0, n);
+  }
+}
+
+std::vector<std::vector<int64_t>> dp_search(
+    const DPInput& input,
+    int64_t num_chunks,
+    const ParallelFor& parallel_for) {
+  TORCH_CHECK(input.bin_count > 0, "bin_count must be positive");
+  TORCH_CHECK(input.hbm_bins.size() == input.perf.size());
+  TORCH_CHECK(
+      input.bin_count <= std::numeric_limits<int32_t>::max(),
+      "too many bins ",
+      input.bin_count);
+  auto num_tables = static_cast<int64_t>(input.table_offsets.size()) - 1;
+  if (num_tables <= 0) {
+    return {};
+  }
+  auto bin_count = input.bin_count;
+  num_chunks = std::max<int64_t>(num_chunks, 1);
+
+  std::vector<DPRow> rows(num_chunks, DPRow(bin_count));
+  DPRow prev(bin_count);
+  std::vector<Backtrack> backtrack(num_tables * bin_count);
+  for (int64_t t = 0; t < num_tables; ++t) {
+    int64_t offset = input.table_offsets[t];
+    int64_t num_options = input.table_offsets[t + 1] - offset;
+    TORCH_CHECK(num_options > 0, "table ", t, " has no option");
+    TORCH_CHECK(
+        input.table_offsets[t + 1] <=
+        static_cast<int64_t>(input.hbm_bins.size()));
+    auto hbm = input.hbm_bins.subspan(offset, num_options);
+    auto perf = input.perf.subspan(offset, num_options);
+    int64_t chunks = std::min(num_chunks, num_options);
+    int64_t chunk_size = (num_options + chunks - 1) / chunks;
+    chunks = (num_options + chunk_size - 1) / chunk_size;
+    const DPRow* from = t == 0 ? nullptr : &prev;
+    parallel_for(chunks, [&](int64_t begin, int64_t end) {
+      for (int64_t c = begin; c < end; ++c) {
+        std::fill(rows[c].begin(), rows[c].end(), DPState{});
+        relax(
+            from,
+            hbm,
+            perf,
+            c * chunk_size,
+            std::min((c + 1) * chunk_size, num_options),
+            rows[c]);
+      }
+    });
+    for (int64_t c = 1; c < chunks; ++c) {
+      merge(rows[0], rows[c]);
+    }
+    for (int64_t b = 0; b < bin_count; ++b) {
+      backtrack[t * bin_count + b] = {rows[0][b].option, rows[0][b].prev_bin};
+    }
+    std::swap(prev, rows[0]);
+  }
+
+  std::vector<std::vector<int64_t>> proposals;
+  for (int64_t c = bin_count - 1; c >= 0; --c) {
+    auto last = backtrack[(num_tables - 1) * bin_count + c];
+    if (last.option < 0) {
+      continue;
+    }
+    std::vector<int64_t> proposal(num_tables);
+    proposal[num_tables - 1] = last.option;
+    int64_t bin = last.prev_bin;
+    for (int64_t t = num_tables - 2; t >= 0; --t) {
+      auto step = backtrack[t * bin_count + bin];
+      proposal[t] = step.option;
+      bin = step.prev_bin;
+    }
+    proposals.emplace_back(std::move(proposal));
+  }
+  return proposals;
+}
+
+int64_t num_shards(const PlanSpace& space, std::span<const int64_t> proposal) {
+  auto num_options = static_cast<int64_t>(space.partition_by.size());
+  int64_t n = 0;
+  for (auto o : proposal) {
+    TORCH_CHECK(o >= 0 && o < num_options, "invalid sharding option ", o);
+    n += space.shard_offsets[o + 1] - space.shard_offsets[o];
+  }
+  return n;
+}
+
+bool greedy_partition(
+    const PlanSpace& space,
+    std::span<const int64_t> proposal,
+    std::span<int64_t> shard_devices) {
+  TORCH_CHECK(
+      static_cast<int64_t>(shard_devices.size()) ==
+      num_shards(space, proposal));
+  TORCH_CHECK(space.local_world_size > 0, "local_world_size must be positive");
+  auto num_devices = static_cast<int64_t>(space.devices.size());
+  std::vector<Device> devices = space.devices;
+  std::vector<int64_t> offsets(proposal.size() + 1, 0);
+  for (size_t i = 0; i < proposal.size(); ++i) {
+    auto o = proposal[i];
+    offsets[i + 1] =
+        offsets[i] + space.shard_offsets[o + 1] - space.shard_offsets[o];
+  }
+
+  auto place = [&](int64_t shard, int64_t slot, int64_t d) {
+    devices[d].storage -= space.shard_storage[shard];
+    devices[d].perf += space.shard_perf[shard];
+    shard_devices[slot] = d;
+  };
+
+  std::vector<size_t> others;
+  for (size_t i = 0; i < proposal.size(); ++i) {
+    auto o = proposal[i];
+    if (space.partition_by[o] != PartitionBy::kUniform) {
+      others.emplace_back(i);
+      continue;
+    }
+    if (offsets[i + 1] - offsets[i] != num_devices) {
+      return false;
+    }
+    for (int64_t d = 0; d < num_devices; ++d) {
+      int64_t shard = space.shard_offsets[o] + d;
+      if (!space.shard_storage[shard].fits_in(devices[d].storage)) {
+        return false;
+      }
+      place(shard, offsets[i] + d, d);
+    }
+  }
+
+  // stable and descending, as `list.sort(reverse=True)`.
+  std::stable_sort(others.begin(), others.end(), [&](size_t a, size_t b) {
+    auto oa = proposal[a];
+    auto ob = proposal[b];
+    const auto& param_count = space.param_count;
+    if (space.balance_modules && param_count[oa] != param_count[ob]) {
+      return param_count[oa] > param_count[ob];
+    }
+    if (space.sort_by_perf) {
+      return space.option_perf[oa] > space.option_perf[ob];
+    }
+    return space.option_storage[oa] > space.option_storage[ob];
+  });
+
+  std::set<DeviceKey> ordered;
+  for (int64_t d = 0; d < num_devices; ++d) {
+    ordered.emplace(device_key(devices, space.local_world_size, d));
+  }
+  for (auto i : others) {
+    auto o = proposal[i];
+    for (int64_t s = space.shard_offsets[o]; s < space.shard_offsets[o + 1];
+         ++s) {
+      const auto& storage = space.shard_storage[s];
+      auto it = std::find_if(
+          ordered.begin(), ordered.end(), [&](const DeviceKey& key) {
+            return storage.fits_in(devices[std::get<2>(key)].storage);
+          });
+      if (it == ordered.end()) {
+        return false;
+      }
+      int64_t d = std::get<2>(*it);
+      ordered.erase(it);
+      place(s, offsets[i] + s - space.shard_offsets[o], d);
+      ordered.emplace(device_key(devices, space.local_world_size, d));
+    }
+  }
+  return true;
+}
+
+double rate(
+    const PlanSpace& space,
+    std::span<const int64_t> proposal,
+    std::span<const int64_t> shard_devices) {
+  std::vector<double> perfs(space.devices.size(), 0);
+  size_t slot = 0;
+  for (auto o : proposal) {
+    for (int64_t s = space.shard_offsets[o]; s < space.shard_offsets[o + 1];
+         ++s) {
+      perfs[shard_devices[slot++]] += space.shard_perf[s].total();
+    }
+  }
+  if (perfs.empty()) {
+    return 0;
+  }
+  return *std::max_element(perfs.begin(), perfs.end());
+}
+
+std::vector<double> evaluate_proposals(
+    const PlanSpace& space,
+    std::span<const int64_t> proposals,
+    int64_t num_proposals,
+    const ParallelFor& parallel_for) {
+  std::vector<double> ratings(num_proposals, k_inf);
+  if (num_proposals == 0) {
+    return ratings;
+  }
+  TORCH_CHECK(proposals.size() % num_proposals == 0);
+  size_t num_tables = proposals.size() / num_proposals;
+  parallel_for(num_proposals, [&](int64_t begin, int64_t end) {
+    std::vector<int64_t> shard_devices;
+    for (int64_t p = begin; p < end; ++p) {
+      auto proposal = proposals.subspan(p * num_tables, num_tables);
+      shard_devices.resize(num_shards(space, proposal));
+      if (greedy_partition(space, proposal, shard_devices)) {
+        ratings[p] = rate(space, proposal, shard_devices);
+      }
+    }
+  });
+  return ratings;
+}
+
+} // namespace torchrec::planner
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace torchrec::planner {
+
+/**
+ * Run `fn(begin, end)` over the disjoint ranges of [0, n), possibly in
+ * parallel. The default runs `fn(0, n)` in the calling thread.
+ */
+using ParallelFor = std::function<
+    void(int64_t n, const std::function<void(int64_t, int64_t)>& fn)>;
+
+void sequential_for(
+    int64_t n,
+    const std::function<void(int64_t, int64_t)>& fn);
+
+/**
+ * The flat input of `DynamicProgrammingProposer`. The options of table `t`
+ * are [table_offsets[t], table_offsets[t + 1]), ordered by hbm.
+ */
+struct DPInput {
+  std::span<const int64_t> table_offsets;
+  // hbm of each option, in bins.
+  std::span<const double> hbm_bins;
+  std::span<const double> perf;
+  int64_t bin_count;
+};
+
+/**
+ * The proposals of `DynamicProgrammingProposer`, from the highest total hbm
+ * to the lowest. A proposal is the index of the selected option within each
+ * table.
+ *
+ * The options of a table are relaxed in chunks in parallel, each chunk into
+ * its own row. The rows are merged in the order of the chunks, so that the
+ * result is the same as the sequential loop's.
+ */
+std::vector<std::vector<int64_t>> dp_search(
+    const DPInput& input,
+    int64_t num_chunks,
+    const ParallelFor& parallel_for = sequential_for);
+
+struct Perf {
+  double fwd_compute{0};
+  double fwd_comms{0};
+  double bwd_compute{0};
+  double bwd_comms{0};
+  double prefetch_compute{0};
+
+  // summed in the same order as `Perf.total` in python.
+  [[nodiscard]] double total() const {
+    return fwd_compute + bwd_compute + fwd_comms + bwd_comms +
+        prefetch_compute;
+  }
+
+  Perf& operator+=(const Perf& other) {
+    fwd_compute += other.fwd_compute;
+    fwd_comms += other.fwd_comms;
+    bwd_compute += other.bwd_compute;
+    bwd_comms += other.bwd_comms;
+    prefetch_compute += other.prefetch_compute;
+    return *this;
+  }
+};
+
+struct Storage {
+  int64_t hbm{0};
+  int64_t ddr{0};
+
+  [[nodiscard]] bool fits_in(const Storage& other) const {
+    return hbm <= other.hbm && ddr <= other.ddr;
+  }
+
+  Storage& operator-=(const Storage& other) {
+    hbm -= other.hbm;
+    ddr -= other.ddr;
+    return *this;
+  }
+
+  auto operator<=>(const Storage& other) const = default;
+};
+
+enum class PartitionBy : int64_t {
+  kUniform = 0,
+  kDevice = 1,
+};
+
+struct Device {
+  Storage storage;
+  Perf perf;
+};
+
+/**
+ * The sharding options of a search space and the devices of the topology, as
+ * flat arrays.
+ *
+ * The shards of option `o` are [shard_offsets[o], shard_offsets[o + 1]).
+ */
+struct PlanSpace {
+  std::vector<PartitionBy> partition_by;
+  std::vector<double> option_perf;
+  std::vector<Storage> option_storage;
+  // the negative number of tables of the module of each option.
+  std::vector<int64_t> param_count;
+  std::vector<int64_t> shard_offsets;
+  std::vector<Perf> shard_perf;
+  std::vector<Storage> shard_storage;
+  std::vector<Device> devices;
+  int64_t local_world_size;
+  bool sort_by_perf;
+  bool balance_modules;
+};
+
+/**
+ * Place the options of `proposal` on the devices as `GreedyPerfPartitioner`
+ * does for uniform and device partitioned options: the uniform options
+ * first, one shard per device, then the others from the largest, each shard
+ * on the device of the lowest perf it fits in.
+ *
+ * @param shard_devices the device of each shard of the proposal, in the
+ * order of the options.
+ * @return false if a shard does not fit.
+ */
+bool greedy_partition(
+    const PlanSpace& space,
+    std::span<const int64_t> proposal,
+    std::span<int64_t> shard_devices);
+
+/**
+ * The max perf of the devices, as `NoopPerfModel.rate`.
+ */
+double rate(
+    const PlanSpace& space,
+    std::span<const int64_t> proposal,
+    std::span<const int64_t> shard_devices);
+
+int64_t num_shards(const PlanSpace& space, std::span<const int64_t> proposal);
+
+/**
+ * Partition and rate each proposal, where `proposals` holds `num_proposals`
+ * proposals of the same length. Proposals that do not fit are rated
+ * infinity.
+ */
+std::vector<double> evaluate_proposals(
+    const PlanSpace& space,
+    std::span<const int64_t> proposals,
+    int64_t num_proposals,
+    const ParallelFor& parallel_for = sequential_for);
+
+} // namespace torchrec::planner
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <ATen/Parallel.h>
+#include <torchrec/csrc/planner/plan_space_wrapper.h>
+#include <algorithm>
+#include <limits>
+
+namespace torchrec::planner {
+
+namespace {
+
+void parallel_for(
+    int64_t n,
+    const std::function<void(int64_t, int64_t)>& fn) {
+  at::parallel_for(0, n, 1, fn);
+}
+
+template <typename T>
+std::vector<T> to_vector(const torch::Tensor& t, torch::ScalarType type) {
+  auto flat = t.to(type).contiguous();
+  auto* ptr = flat.data_ptr<T>();
+  return {ptr, ptr + flat.numel()};
+}
+
+std::vector<Storage> to_storages(const torch::Tensor& t, const char* name) {
+  TORCH_CHECK(
+      t.dim() == 2 && t.size(1) == 2, name, " should be of shape [n, 2]");
+  auto v = to_vector<int64_t>(t, torch::kLong);
+  std::vector<Storage> storages(t.size(0));
+  for (size_t i = 0; i < storages.size(); ++i) {
+    storages[i] = {v[2 * i], v[2 * i + 1]};
+  }
+  return storages;
+}
+
+std::vector<Perf> to_perfs(const torch::Tensor& t, const char* name) {
+  TORCH_CHECK(
+      t.dim() == 2 && t.size(1) == 5, name, " should be of shape [n, 5]");
+  auto v = to_vector<double>(t, torch::kDouble);
+  std::vector<Perf> perfs(t.size(0));
+  for (size_t i = 0; i < perfs.size(); ++i) {
+    const double* p = &v[5 * i];
+    perfs[i] = {p[0], p[1], p[2], p[3], p[4]};
+  }
+  return perfs;
+}
+
+} // namespace
+
+PlanSpaceWrapper::PlanSpaceWrapper(
+    const torch::Tensor& partition_by,
+    const torch::Tensor& option_perf,
+    const torch::Tensor& option_storage,
+    const torch::Tensor& param_count,
+    const torch::Tensor& shard_offsets,
+    const torch::Tensor& shard_perf,
+    const torch::Tensor& shard_storage,
+    const torch::Tensor& device_storage,
+    const torch::Tensor& device_perf,
+    int64_t local_world_size,
+    bool sort_by_perf,
+    bool balance_modules) {
+  int64_t num_options = partition_by.numel();
+  for (auto p : to_vector<int64_t>(partition_by, torch::kLong)) {
+    TORCH_CHECK(
+        p == static_cast<int64_t>(PartitionBy::kUniform) ||
+            p == static_cast<int64_t>(PartitionBy::kDevice),
+        "unsupported partition_by ",
+        p);
+    space_.partition_by.emplace_back(static_cast<PartitionBy>(p));
+  }
+  space_.option_perf = to_vector<double>(option_perf, torch::kDouble);
+  space_.option_storage = to_storages(option_storage, "option_storage");
+  space_.param_count = to_vector<int64_t>(param_count, torch::kLong);
+  space_.shard_offsets = to_vector<int64_t>(shard_offsets, torch::kLong);
+  space_.shard_perf = to_perfs(shard_perf, "shard_perf");
+  space_.shard_storage = to_storages(shard_storage, "shard_storage");
+  TORCH_CHECK(static_cast<int64_t>(space_.option_perf.size()) == num_options);
+  TORCH_CHECK(
+      static_cast<int64_t>(space_.option_storage.size()) == num_options);
+  TORCH_CHECK(static_cast<int64_t>(space_.param_count.size()) == num_options);
+  TORCH_CHECK(
+      static_cast<int64_t>(space_.shard_offsets.size()) == num_options + 1);
+  TORCH_CHECK(
+      space_.shard_offsets.back() ==
+      static_cast<int64_t>(space_.shard_perf.size()));
+  TORCH_CHECK(space_.shard_perf.size() == space_.shard_storage.size());
+
+  auto storages = to_storages(device_storage, "device_storage");
+  auto perfs = to_perfs(device_perf, "device_perf");
+  TORCH_CHECK(storages.size() == perfs.size());
+  for (size_t d = 0; d < storages.size(); ++d) {
+    space_.devices.emplace_back(Device{storages[d], perfs[d]});
+  }
+  TORCH_CHECK(local_world_size > 0, "local_world_size must be positive");
+  space_.local_world_size = local_world_size;
+  space_.sort_by_perf = sort_by_perf;
+  space_.balance_modules = balance_modules;
+}
+
+std::tuple<bool, torch::Tensor, double> PlanSpaceWrapper::partition(
+    const torch::Tensor& proposal) {
+  auto options = to_vector<int64_t>(proposal, torch::kLong);
+  auto shard_devices =
+      torch::empty({num_shards(space_, options)}, torch::kLong);
+  std::span<int64_t> devices{
+      shard_devices.data_ptr<int64_t>(),
+      static_cast<size_t>(shard_devices.numel())};
+  if (!greedy_partition(space_, options, devices)) {
+    return {false, shard_devices, std::numeric_limits<double>::infinity()};
+  }
+  return {true, shard_devices, rate(space_, options, devices)};
+}
+
+torch::Tensor PlanSpaceWrapper::evaluate(const torch::Tensor& proposals) {
+  TORCH_CHECK(proposals.dim() == 2, "proposals should be 2D");
+  auto options = to_vector<int64_t>(proposals, torch::kLong);
+  auto ratings =
+      evaluate_proposals(space_, options, proposals.size(0), parallel_for);
+  return torch::tensor(ratings, torch::kDouble);
+}
+
+torch::Tensor dp_propose(
+    const torch::Tensor& table_offsets,
+    const torch::Tensor& hbm_bins,
+    const torch::Tensor& perf,
+    int64_t bin_count) {
+  auto offsets = to_vector<int64_t>(table_offsets, torch::kLong);
+  auto hbm = to_vector<double>(hbm_bins, torch::kDouble);
+  auto perfs = to_vector<double>(perf, torch::kDouble);
+  auto proposals = dp_search(
+      DPInput{offsets, hbm, perfs, bin_count},
+      at::get_num_threads(),
+      parallel_for);
+  int64_t num_tables = static_cast<int64_t>(offsets.size()) - 1;
+  auto num_proposals = static_cast<int64_t>(proposals.size());
+  auto result = torch::empty(
+      {num_proposals, std::max<int64_t>(num_tables, 0)}, torch::kLong);
+  auto* ptr = result.data_ptr<int64_t>();
+  for (auto& proposal : proposals) {
+    ptr = std::copy(proposal.begin(), proposal.end(), ptr);
+  }
+  return result;
+}
+
+} // namespace torchrec::planner
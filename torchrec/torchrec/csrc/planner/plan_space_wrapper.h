@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <torch/custom_class.h>
+#include <torch/torch.h>
+#include <torchrec/csrc/planner/details/search.h>
+#include <tuple>
+
+namespace torchrec::planner {
+
+/**
+ * The sharding options of a planner search space, built once from flat
+ * tensors and searched many times without going back to python.
+ *
+ * Devices are indexed by rank. Perfs are tensors of shape [n, 5] in the
+ * order of the fields of `Perf`, storages are tensors of shape [n, 2] of hbm
+ * and ddr.
+ */
+class PlanSpaceWrapper : public torch::CustomClassHolder {
+ public:
+  PlanSpaceWrapper(
+      const torch::Tensor& partition_by,
+      const torch::Tensor& option_perf,
+      const torch::Tensor& option_storage,
+      const torch::Tensor& param_count,
+      const torch::Tensor& shard_offsets,
+      const torch::Tensor& shard_perf,
+      const torch::Tensor& shard_storage,
+      const torch::Tensor& device_storage,
+      const torch::Tensor& device_perf,
+      int64_t local_world_size,
+      bool sort_by_perf,
+      bool balance_modules);
+
+  /**
+   * Partition a proposal, a tensor of the indices of its options.
+   *
+   * @return whether the proposal fits, the device of each of its shards, and
+   * its rating.
+   */
+  std::tuple<bool, torch::Tensor, double> partition(
+      const torch::Tensor& proposal);
+
+  /**
+   * Partition and rate the proposals of shape [num_proposals, num_tables] in
+   * parallel. Proposals that do not fit are rated infinity.
+   */
+  torch::Tensor evaluate(const torch::Tensor& proposals);
+
+ private:
+  PlanSpace space_;
+};
+
+/**
+ * The proposals of `DynamicProgrammingProposer`, as a tensor of shape
+ * [num_proposals, num_tables] of option indices within each table.
+ */
+torch::Tensor dp_propose(
+    const torch::Tensor& table_offsets,
+    const torch::Tensor& hbm_bins,
+    const torch::Tensor& perf,
+    int64_t bin_count);
+
+} // namespace torchrec::planner
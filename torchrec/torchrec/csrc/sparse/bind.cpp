@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <torch/torch.h>
+
+#include <torchrec/csrc/sparse/kjt_ops.h>
+
+namespace torchrec::sparse {
+
+TORCH_LIBRARY(torchrec_sparse, m) {
+  m.def(
+      "permute_kjt(Tensor lengths, Tensor values, Tensor? weights, "
+      "int[] stride_per_key, int[] length_per_key, int[] indices) "
+      "-> (Tensor, Tensor, Tensor?)",
+      &permute_kjt);
+}
+
+} // namespace torchrec::sparse
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <c10/util/Exception.h>
+#include <torchrec/csrc/sparse/details/segments.h>
+#include <cstring>
+
+namespace torchrec::sparse {
+
+SegmentPlan plan_segments(
+    std::span<const int64_t> sizes,
+    std::span<const int64_t> indices) {
+  std::vector<int64_t> offsets(sizes.size());
+  int64_t offset = 0;
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    TORCH_CHECK(sizes[i] >= 0, "negative segment size ", sizes[i]);
+    offsets[i] = offset;
+    offset += sizes[i];
+  }
+
+  SegmentPlan plan;
+  plan.src_offsets.reserve(indices.size());
+  plan.dst_offsets.reserve(indices.size());
+  plan.sizes.reserve(indices.size());
+  int64_t dst_offset = 0;
+  for (auto index : indices) {
+    TORCH_CHECK(
+        index >= 0 && index < static_cast<int64_t>(sizes.size()),
+        "segment index ",
+        index,
+        " out of range [0, ",
+        sizes.size(),
+        ")");
+    plan.src_offsets.push_back(offsets[index]);
+    plan.dst_offsets.push_back(dst_offset);
+    plan.sizes.push_back(sizes[index]);
+    dst_offset += sizes[index];
+  }
+  return plan;
+}
+
+void copy_segments(
+    const SegmentPlan& plan,
+    const void* src,
+    void* dst,
+    size_t elem_size,
+    int64_t begin,
+    int64_t end) {
+  auto* src_bytes = reinterpret_cast<const char*>(src);
+  auto* dst_bytes = reinterpret_cast<char*>(dst);
+  for (int64_t i = begin; i < end; ++i) {
+    if (plan.sizes[i] == 0) {
+      continue;
+    }
+    std::memcpy(
+        dst_bytes + plan.dst_offsets[i] * elem_size,
+        src_bytes + plan.src_offsets[i] * elem_size,
+        plan.sizes[i] * elem_size);
+  }
+}
+
+} // namespace torchrec::sparse
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <span>
+#include <vector>
+
+namespace torchrec::sparse {
+
+/**
+ * Where each segment of a permutation is copied from and to.
+ *
+ * A KeyedJaggedTensor stores the lengths and the values of its keys as
+ * consecutive segments, and a permute, whose keys may repeat, is a gather of
+ * the segments. The plan is computed once from the segment sizes, after which
+ * the segments are copied independently.
+ */
+struct SegmentPlan {
+  // offsets of the i-th output segment in the source and the destination.
+  std::vector<int64_t> src_offsets;
+  std::vector<int64_t> dst_offsets;
+  std::vector<int64_t> sizes;
+
+  [[nodiscard]] int64_t num_segments() const {
+    return static_cast<int64_t>(sizes.size());
+  }
+
+  [[nodiscard]] int64_t dst_size() const {
+    return dst_offsets.empty() ? 0 : dst_offsets.back() + sizes.back();
+  }
+};
+
+/**
+ * Plan to gather the segments `indices` of a source made of consecutive
+ * segments of `sizes`. Indices may repeat.
+ */
+SegmentPlan plan_segments(
+    std::span<const int64_t> sizes,
+    std::span<const int64_t> indices);
+
+/**
+ * Copy the segments [begin, end) of `plan` from `src` to `dst`, whose
+ * elements are `elem_size` bytes.
+ */
+void copy_segments(
+    const SegmentPlan& plan,
+    const void* src,
+    void* dst,
+    size_t elem_size,
+    int64_t begin,
+    int64_t end);
+
+} // namespace torchrec::sparse
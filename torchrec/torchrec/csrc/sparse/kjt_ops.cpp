@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <ATen/Parallel.h>
+#include <torchrec/csrc/sparse/details/segments.h>
+#include <torchrec/csrc/sparse/kjt_ops.h>
+#include <numeric>
+
+namespace torchrec::sparse {
+
+namespace {
+
+void check_input(const torch::Tensor& t, int64_t numel, const char* name) {
+  TORCH_CHECK(t.device().is_cpu(), name, " should be a cpu tensor");
+  TORCH_CHECK(t.dim() == 1, name, " should be 1D");
+  TORCH_CHECK(
+      t.numel() == numel,
+      name,
+      " has ",
+      t.numel(),
+      " elements, but the keys need ",
+      numel);
+}
+
+std::span<const int64_t> as_span(c10::IntArrayRef ref) {
+  return {ref.data(), ref.size()};
+}
+
+std::tuple<torch::Tensor, torch::Tensor, std::optional<torch::Tensor>>
+permute_kjt_cpu(
+    const torch::Tensor& lengths,
+    const torch::Tensor& values,
+    const std::optional<torch::Tensor>& weights,
+    c10::IntArrayRef stride_per_key,
+    c10::IntArrayRef length_per_key,
+    c10::IntArrayRef indices) {
+  TORCH_CHECK(
+      stride_per_key.size() == length_per_key.size(),
+      "stride_per_key and length_per_key should have one element per key");
+  auto num_lengths = std::accumulate(
+      stride_per_key.begin(), stride_per_key.end(), int64_t{0});
+  auto num_values = std::accumulate(
+      length_per_key.begin(), length_per_key.end(), int64_t{0});
+  // A 2D [num_keys, stride] lengths is accepted as well.
+  auto flat_lengths = lengths.reshape({-1}).contiguous();
+  check_input(flat_lengths, num_lengths, "lengths");
+  auto flat_values = values.contiguous();
+  check_input(flat_values, num_values, "values");
+  std::optional<torch::Tensor> flat_weights;
+  if (weights.has_value()) {
+    flat_weights = weights->contiguous();
+    check_input(*flat_weights, num_values, "weights");
+  }
+
+  auto lengths_plan = plan_segments(as_span(stride_per_key), as_span(indices));
+  auto values_plan = plan_segments(as_span(length_per_key), as_span(indices));
+  auto permuted_lengths =
+      torch::empty({lengths_plan.dst_size()}, flat_lengths.options());
+  auto permuted_values =
+      torch::empty({values_plan.dst_size()}, flat_values.options());
+  std::optional<torch::Tensor> permuted_weights;
+  if (flat_weights.has_value()) {
+    permuted_weights =
+        torch::empty({values_plan.dst_size()}, flat_weights->options());
+  }
+
+  at::parallel_for(
+      0, values_plan.num_segments(), 1, [&](int64_t begin, int64_t end) {
+        copy_segments(
+            lengths_plan,
+            flat_lengths.data_ptr(),
+            permuted_lengths.data_ptr(),
+            flat_lengths.element_size(),
+            begin,
+            end);
+        copy_segments(
+            values_plan,
+            flat_values.data_ptr(),
+            permuted_values.data_ptr(),
+            flat_values.element_size(),
+            begin,
+            end);
+        if (flat_weights.has_value()) {
+          copy_segments(
+              values_plan,
+              flat_weights->data_ptr(),
+              permuted_weights->data_ptr(),
+              flat_weights->element_size(),
+              begin,
+              end);
+        }
+      });
+  return {permuted_lengths, permuted_values, permuted_weights};
+}
+
+// The source element of every permuted value.
+torch::Tensor source_index(const SegmentPlan& plan) {
+  auto index = torch::empty({plan.dst_size()}, torch::kLong);
+  auto* data = index.data_ptr<int64_t>();
+  at::parallel_for(0, plan.num_segments(), 1, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      auto* dst = data + plan.dst_offsets[i];
+      std::iota(dst, dst + plan.sizes[i], plan.src_offsets[i]);
+    }
+  });
+  return index;
+}
+
+// Scatters the gradient of the permuted values back to the input keys, which
+// is the inverse permute. Keys repeated in `indices` accumulate their
+// gradients.
+class PermuteKJTFunction
+    : public torch::autograd::Function<PermuteKJTFunction> {
+ public:
+  static torch::autograd::variable_list forward(
+      torch::autograd::AutogradContext* ctx,
+      const torch::Tensor& lengths,
+      const torch::Tensor& values,
+      const std::optional<torch::Tensor>& weights,
+      c10::IntArrayRef stride_per_key,
+      c10::IntArrayRef length_per_key,
+      c10::IntArrayRef indices) {
+    auto [permuted_lengths, permuted_values, permuted_weights] =
+        permute_kjt_cpu(
+            lengths, values, weights, stride_per_key, length_per_key, indices);
+    ctx->mark_non_differentiable({permuted_lengths});
+    ctx->saved_data["num_values"] = values.numel();
+    ctx->saved_data["length_per_key"] = length_per_key.vec();
+    ctx->saved_data["indices"] = indices.vec();
+    return {
+        permuted_lengths,
+        permuted_values,
+        permuted_weights.value_or(torch::Tensor())};
+  }
+
+  static torch::autograd::variable_list backward(
+      torch::autograd::AutogradContext* ctx,
+      torch::autograd::variable_list grad_outputs) {
+    auto length_per_key = ctx->saved_data["length_per_key"].toIntVector();
+    auto indices = ctx->saved_data["indices"].toIntVector();
+    auto num_values = ctx->saved_data["num_values"].toInt();
+    auto index = source_index(plan_segments(length_per_key, indices));
+    auto unpermute = [&](const torch::Tensor& grad) {
+      if (!grad.defined()) {
+        return torch::Tensor();
+      }
+      return torch::zeros({num_values}, grad.options())
+          .index_add_(0, index, grad);
+    };
+    // No gradients for the lengths and the key sizes.
+    return {
+        torch::Tensor(),
+        unpermute(grad_outputs[1]),
+        unpermute(grad_outputs[2]),
+        torch::Tensor(),
+        torch::Tensor(),
+        torch::Tensor()};
+  }
+};
+
+} // namespace
+
+std::tuple<torch::Tensor, torch::Tensor, std::optional<torch::Tensor>>
+permute_kjt(
+    const torch::Tensor& lengths,
+    const torch::Tensor& values,
+    const std::optional<torch::Tensor>& weights,
+    c10::IntArrayRef stride_per_key,
+    c10::IntArrayRef length_per_key,
+    c10::IntArrayRef indices) {
+  auto permuted = PermuteKJTFunction::apply(
+      lengths, values, weights, stride_per_key, length_per_key, indices);
+  std::optional<torch::Tensor> permuted_weights;
+  if (weights.has_value()) {
+    permuted_weights = permuted[2];
+  }
+  return {permuted[0], permuted[1], permuted_weights};
+}
+
+} // namespace torchrec::sparse
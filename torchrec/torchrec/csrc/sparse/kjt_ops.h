@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <torch/torch.h>
+#include <optional>
+#include <tuple>
+
+namespace torchrec::sparse {
+
+/**
+ * Permute the keys of a KeyedJaggedTensor on CPU.
+ *
+ * The lengths, values and weights of each output key are copied in one
+ * parallel pass over the output keys, by the offsets computed from
+ * `stride_per_key` and `length_per_key`. Keys may be repeated in `indices`,
+ * and the strides may vary per key. The gradients of the values and the
+ * weights are permuted back to the input keys.
+ *
+ * @param lengths the lengths of all keys, `sum(stride_per_key)` elements.
+ * @param values the values of all keys, `sum(length_per_key)` elements.
+ * @param weights optional weights, with the same size as values.
+ * @param stride_per_key the batch size of each key.
+ * @param length_per_key the number of values of each key.
+ * @param indices the input key of each output key.
+ * @return permuted lengths, values and weights.
+ */
+std::tuple<torch::Tensor, torch::Tensor, std::optional<torch::Tensor>>
+permute_kjt(
+    const torch::Tensor& lengths,
+    const torch::Tensor& values,
+    const std::optional<torch::Tensor>& weights,
+    c10::IntArrayRef stride_per_key,
+    c10::IntArrayRef length_per_key,
+    c10::IntArrayRef indices);
+
+} // namespace torchrec::sparse
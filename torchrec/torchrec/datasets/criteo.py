@@ -704,6 +704,14 @@ class InMemoryBinaryCriteoIterDataPipe(IterableDataset):
             Length of this list should be CAT_FEATURE_COUNT.
         path_manager_key (str): Path manager key used to load from different
             filesystems.
+        native_prefetch (int): If positive, batches are assembled from the memory
+            mapped npy files by the native `torch.classes.criteo.BatchAssembler`,
+            which prefetches this many batches on background threads without
+            holding the GIL. The criteo ops library must be loaded with
+            `torch.ops.load_library`. Not supported with `shuffle_batches` or
+            `shuffle_training_set`.
+        native_pin_memory (bool): Whether the native batch assembler assembles
+            batches into pinned memory.
 
     Example::
 
@@ -735,7 +743,19 @@ class InMemoryBinaryCriteoIterDataPipe(IterableDataset):
         mmap_mode: bool = False,
         hashes: Optional[List[int]] = None,
         path_manager_key: str = PATH_MANAGER_KEY,
+        native_prefetch: int = 0,
+        native_pin_memory: bool = False,
     ) -> None:
+        if native_prefetch > 0:
+            assert (
+                not shuffle_batches and not shuffle_training_set
+            ), "native batch assembler does not support shuffling"
+            # The native assembler reads the files memory mapped and hashes the
+            # sparse features itself.
+            mmap_mode = True
+        self.native_prefetch = native_prefetch
+        self.native_pin_memory = native_pin_memory
+        self._hashes_list: List[int] = list(hashes) if hashes is not None else []
         self.stage = stage
         self.dense_paths = dense_paths
         self.sparse_paths = sparse_paths
@@ -769,6 +789,14 @@ class InMemoryBinaryCriteoIterDataPipe(IterableDataset):
             ]
         len_d0 = len(self.dense_arrs[0])
         second_half_start_index = int(len_d0 // 2 + len_d0 % 2)
+        # Rows of each file in use, for the native batch assembler.
+        self._file_row_ranges: List[Tuple[int, int]] = [
+            (0, len(arr)) for arr in self.dense_arrs
+        ]
+        if stage == "val":
+            self._file_row_ranges[0] = (0, second_half_start_index)
+        elif stage == "test":
+            self._file_row_ranges[0] = (second_half_start_index, len_d0)
         if stage == "val":
             self.dense_arrs[0] = self.dense_arrs[0][:second_half_start_index, :]
             self.sparse_arrs[0] = self.sparse_arrs[0][:second_half_start_index, :]
@@ -917,6 +945,16 @@ class InMemoryBinaryCriteoIterDataPipe(IterableDataset):
             sparse = sparse[shuffler]
             labels = labels[shuffler]
 
+        return self._tensors_to_batch(
+            torch.from_numpy(dense),
+            # transpose + reshape(-1) incurs an additional copy.
+            torch.from_numpy(sparse.transpose(1, 0).reshape(-1)),
+            torch.from_numpy(labels.reshape(-1)),
+        )
+
+    def _tensors_to_batch(
+        self, dense: torch.Tensor, values: torch.Tensor, labels: torch.Tensor
+    ) -> Batch:
         batch_size = len(dense)
         num_ids_in_batch = CAT_FEATURE_COUNT * batch_size
         if batch_size == self.batch_size:
@@ -928,11 +966,10 @@ class InMemoryBinaryCriteoIterDataPipe(IterableDataset):
             offset_per_key = [batch_size * i for i in range(CAT_FEATURE_COUNT + 1)]
 
         return Batch(
-            dense_features=torch.from_numpy(dense),
+            dense_features=dense,
             sparse_features=KeyedJaggedTensor(
                 keys=self.keys,
-                # transpose + reshape(-1) incurs an additional copy.
-                values=torch.from_numpy(sparse.transpose(1, 0).reshape(-1)),
+                values=values,
                 lengths=self.lengths[:num_ids_in_batch],
                 offsets=self.offsets[: num_ids_in_batch + 1],
                 stride=batch_size,
@@ -940,10 +977,46 @@ class InMemoryBinaryCriteoIterDataPipe(IterableDataset):
                 offset_per_key=offset_per_key,
                 index_per_key=self.index_per_key,
             ),
-            labels=torch.from_numpy(labels.reshape(-1)),
+            labels=labels,
+        )
+
+    def _native_iter(self) -> Iterator[Batch]:
+        # Same batches as `__iter__`: consecutive rows of all files, with the
+        # batches assigned to ranks round robin.
+        batch_sizes = [self.batch_size] * self.num_full_batches
+        if self.last_batch_sizes[0] > 0:
+            batch_sizes += [int(size) for size in self.last_batch_sizes]
+        batches = []
+        first_row = 0
+        for batch_idx, size in enumerate(batch_sizes):
+            if batch_idx % self.world_size == self.rank:
+                batches.append([first_row, size])
+            first_row += size
+
+        assembler = torch.classes.criteo.BatchAssembler(
+            self.dense_paths,
+            self.sparse_paths,
+            self.labels_paths,
+            [begin for begin, _ in self._file_row_ranges],
+            [end for _, end in self._file_row_ranges],
+            torch.tensor(batches, dtype=torch.int64).reshape(-1, 2),
+            self._hashes_list,
+            self.native_prefetch,
+            min(self.native_prefetch, os.cpu_count() or 1),
+            self.native_pin_memory,
         )
+        while True:
+            tensors = assembler.next()
+            if not tensors:
+                return
+            dense, values, labels = tensors
+            yield self._tensors_to_batch(dense, values, labels)
 
     def __iter__(self) -> Iterator[Batch]:
+        if self.native_prefetch > 0:
+            yield from self._native_iter()
+            return
+
         # Invariant: buffer never contains more than batch_size rows.
         buffer: Optional[List[np.ndarray]] = None
 
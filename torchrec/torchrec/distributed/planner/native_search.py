@@ -0,0 +1,277 @@
+#!/usr/bin/env python3
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+# All rights reserved.
+#
+# This source code is licensed under the BSD-style license found in the
+# LICENSE file in the root directory of this source tree.
+
+# pyre-strict
+
+import copy
+from typing import Dict, List, Optional, Sequence, Set, Tuple
+
+import torch
+from torchrec.distributed.planner.types import (
+    PartitionByType,
+    Perf,
+    PlannerError,
+    PlannerErrorType,
+    ShardingOption,
+    Storage,
+    Topology,
+)
+
+_PARTITION_FAILED = "Native partition failed, a shard does not fit on any rank."
+
+# the partition types of the native partitioner, by their code.
+_PARTITION_BY_CODES: Dict[str, int] = {
+    PartitionByType.UNIFORM.value: 0,
+    PartitionByType.DEVICE.value: 1,
+}
+
+
+def is_native_planner_available() -> bool:
+    """
+    Whether the torchrec_planner ops are loaded, e.g. by `torch.ops.load_library`.
+    """
+    try:
+        return hasattr(torch.ops.torchrec_planner, "dp_propose")
+    except RuntimeError:
+        return False
+
+
+def native_dp_proposals(
+    hbm_bins_by_table: Sequence[Sequence[float]],
+    perf_by_table: Sequence[Sequence[float]],
+    bin_count: int,
+) -> List[List[int]]:
+    """
+    The proposals of `DynamicProgrammingProposer` computed by the native planner,
+    from the highest total hbm to the lowest. Each proposal is the index of the
+    selected option within each table.
+    """
+    table_offsets = [0]
+    for hbm_bins in hbm_bins_by_table:
+        table_offsets.append(table_offsets[-1] + len(hbm_bins))
+    proposals = torch.ops.torchrec_planner.dp_propose(
+        torch.tensor(table_offsets, dtype=torch.int64),
+        torch.tensor(
+            [hbm for hbm_bins in hbm_bins_by_table for hbm in hbm_bins],
+            dtype=torch.float64,
+        ),
+        torch.tensor(
+            [perf for perfs in perf_by_table for perf in perfs], dtype=torch.float64
+        ),
+        bin_count,
+    )
+    return proposals.tolist()
+
+
+def _perf_fields(perf: Perf) -> List[float]:
+    return [
+        perf.fwd_compute,
+        perf.fwd_comms,
+        perf.bwd_compute,
+        perf.bwd_comms,
+        perf.prefetch_compute,
+    ]
+
+
+def _is_native_option(sharding_option: ShardingOption) -> bool:
+    if sharding_option.partition_by not in _PARTITION_BY_CODES:
+        return False
+    # options grouped by dependency are placed together in python.
+    if sharding_option.dependency is not None:
+        return False
+    return all(
+        isinstance(shard.perf, Perf)
+        and isinstance(shard.storage, Storage)
+        and isinstance(shard.storage.hbm, int)
+        and isinstance(shard.storage.ddr, int)
+        for shard in sharding_option.shards
+    )
+
+
+def _proposal_key(proposal: List[ShardingOption]) -> Tuple[int, ...]:
+    return tuple(sorted(map(hash, proposal)))
+
+
+class NativePlanSpace:
+    """
+    The search space of a plan as flat arrays in the native planner, which
+    partitions and rates proposals as `GreedyPerfPartitioner` and `NoopPerfModel`
+    do for uniform and device partitioned options.
+
+    Args:
+        search_space (List[ShardingOption]): the enumerated sharding options.
+        storage_constraint (Topology): the topology after storage reservation.
+        sort_by_perf (bool): sort the options by perf instead of storage.
+        balance_modules (bool): place the options of smaller modules first.
+    """
+
+    def __init__(
+        self,
+        search_space: List[ShardingOption],
+        storage_constraint: Topology,
+        sort_by_perf: bool,
+        balance_modules: bool,
+    ) -> None:
+        options = [
+            sharding_option
+            for sharding_option in search_space
+            if _is_native_option(sharding_option)
+        ]
+        self._index: Dict[int, int] = {
+            id(sharding_option): i for i, sharding_option in enumerate(options)
+        }
+        self._ranks: List[int] = [device.rank for device in storage_constraint.devices]
+
+        tables_by_path: Dict[str, Set[str]] = {}
+        for sharding_option in search_space:
+            tables_by_path.setdefault(sharding_option.path, set()).add(
+                sharding_option.fqn
+            )
+
+        shard_offsets = [0]
+        shard_perf: List[List[float]] = []
+        shard_storage: List[List[int]] = []
+        for sharding_option in options:
+            for shard in sharding_option.shards:
+                shard_perf.append(_perf_fields(shard.perf))  # pyre-ignore[6]
+                shard_storage.append(
+                    [shard.storage.hbm, shard.storage.ddr]  # pyre-ignore[16]
+                )
+            shard_offsets.append(len(shard_perf))
+
+        def _storages(rows: List[List[int]]) -> torch.Tensor:
+            return torch.tensor(rows, dtype=torch.int64).reshape(-1, 2)
+
+        def _perfs(rows: List[List[float]]) -> torch.Tensor:
+            return torch.tensor(rows, dtype=torch.float64).reshape(-1, 5)
+
+        self._space: torch.ScriptObject = torch.classes.torchrec_planner.PlanSpace(
+            torch.tensor(
+                [_PARTITION_BY_CODES[o.partition_by] for o in options],
+                dtype=torch.int64,
+            ),
+            torch.tensor([o.total_perf for o in options], dtype=torch.float64),
+            _storages(
+                [[o.total_storage.hbm, o.total_storage.ddr] for o in options]
+            ),
+            torch.tensor(
+                [-len(tables_by_path[o.path]) for o in options], dtype=torch.int64
+            ),
+            torch.tensor(shard_offsets, dtype=torch.int64),
+            _perfs(shard_perf),
+            _storages(shard_storage),
+            _storages(
+                [
+                    [device.storage.hbm, device.storage.ddr]
+                    for device in storage_constraint.devices
+                ]
+            ),
+            _perfs(
+                [_perf_fields(device.perf) for device in storage_constraint.devices]
+            ),
+            storage_constraint.local_world_size,
+            sort_by_perf,
+            balance_modules,
+        )
+
+    @staticmethod
+    def supports(storage_constraint: Topology) -> bool:
+        """
+        Whether the native planner can place on the topology, whose devices must
+        be indexed by rank.
+        """
+        return is_native_planner_available() and all(
+            device.rank == i
+            and isinstance(device.storage.hbm, int)
+            and isinstance(device.storage.ddr, int)
+            for i, device in enumerate(storage_constraint.devices)
+        )
+
+    def covers(self, proposal: List[ShardingOption]) -> bool:
+        """
+        Whether all options of the proposal are in the native search space.
+        Proposers like `EmbeddingOffloadScaleupProposer` propose new options.
+        """
+        return all(
+            id(sharding_option) in self._index for sharding_option in proposal
+        )
+
+    def _indices(self, proposal: List[ShardingOption]) -> torch.Tensor:
+        return torch.tensor(
+            [self._index[id(sharding_option)] for sharding_option in proposal],
+            dtype=torch.int64,
+        )
+
+    def evaluate(
+        self, proposals: List[List[ShardingOption]]
+    ) -> Dict[Tuple[int, ...], float]:
+        """
+        Partition and rate the covered proposals in parallel.
+
+        Returns:
+            Dict[Tuple[int, ...], float]: the rating of each proposal by its key in
+            the planner's proposal cache, infinity if it does not fit.
+        """
+        proposals = [proposal for proposal in proposals if self.covers(proposal)]
+        if not proposals or not proposals[0]:
+            return {}
+        by_length: Dict[int, List[List[ShardingOption]]] = {}
+        for proposal in proposals:
+            by_length.setdefault(len(proposal), []).append(proposal)
+        ratings: Dict[Tuple[int, ...], float] = {}
+        for same_length in by_length.values():
+            evaluated = self._space.evaluate(
+                torch.stack([self._indices(proposal) for proposal in same_length])
+            ).tolist()
+            for proposal, rating in zip(same_length, evaluated):
+                ratings[_proposal_key(proposal)] = rating
+        return ratings
+
+    def partition(
+        self,
+        proposal: List[ShardingOption],
+        known_rating: Optional[float] = None,
+        best_rating: float = float("inf"),
+    ) -> Tuple[Optional[List[ShardingOption]], float]:
+        """
+        Place a copy of the proposal, i.e. set the rank of its shards, and rate it.
+        The options of the proposal are shared with the search space, so they are
+        left untouched.
+
+        Args:
+            proposal (List[ShardingOption]): a covered proposal.
+            known_rating (Optional[float]): the rating from `evaluate`. The shards
+                are not placed if it is no better than `best_rating`, as the plan
+                would not be kept.
+            best_rating (float): the rating of the best plan so far.
+
+        Returns:
+            Tuple[Optional[List[ShardingOption]], float]: the placed plan, None if
+            it was not placed, and its rating.
+        """
+        if known_rating is not None:
+            if known_rating == float("inf"):
+                raise PlannerError(
+                    error_type=PlannerErrorType.PARTITION,
+                    message=_PARTITION_FAILED,
+                )
+            if known_rating >= best_rating:
+                return None, known_rating
+        partitionable, shard_devices, rating = self._space.partition(
+            self._indices(proposal)
+        )
+        if not partitionable:
+            raise PlannerError(
+                error_type=PlannerErrorType.PARTITION,
+                message=_PARTITION_FAILED,
+            )
+        plan = copy.deepcopy(proposal)
+        devices = iter(shard_devices.tolist())
+        for sharding_option in plan:
+            for shard in sharding_option.shards:
+                shard.rank = self._ranks[next(devices)]
+        return plan, rating
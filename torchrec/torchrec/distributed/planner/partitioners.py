@@ -190,6 +190,14 @@ class GreedyPerfPartitioner(Partitioner):
         self._sort_by = sort_by
         self._balance_modules = balance_modules
 
+    @property
+    def sort_by(self) -> SortBy:
+        return self._sort_by
+
+    @property
+    def balance_modules(self) -> bool:
+        return self._balance_modules
+
     def partition(
         self,
         proposal: List[ShardingOption],
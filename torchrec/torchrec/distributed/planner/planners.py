@@ -22,9 +22,11 @@ from torchrec.distributed.collective_utils import invoke_on_rank_and_broadcast_r
 from torchrec.distributed.comm import get_local_size
 from torchrec.distributed.planner.constants import BATCH_SIZE, MAX_SIZE
 from torchrec.distributed.planner.enumerators import EmbeddingEnumerator
+from torchrec.distributed.planner.native_search import NativePlanSpace
 from torchrec.distributed.planner.partitioners import (
     GreedyPerfPartitioner,
     MemoryBalancedPartitioner,
+    SortBy,
 )
 from torchrec.distributed.planner.perf_models import NoopPerfModel
 from torchrec.distributed.planner.proposers import (
@@ -351,6 +353,30 @@ class EmbeddingShardingPlanner(EmbeddingPlannerBase):
         self._num_plans: int = 0
         self._best_plan: Optional[List[ShardingOption]] = None
 
+    def _native_plan_space(
+        self,
+        search_space: List[ShardingOption],
+        storage_constraint: Topology,
+    ) -> Optional[NativePlanSpace]:
+        """
+        The search space in the native planner, when the torchrec_planner ops are
+        loaded and the default partitioner and perf model are used. Otherwise the
+        proposals are placed by the python partitioner.
+        """
+        if (
+            type(self._partitioner) is not GreedyPerfPartitioner
+            or type(self._perf_model) is not NoopPerfModel
+            or not NativePlanSpace.supports(storage_constraint)
+        ):
+            return None
+        partitioner = cast(GreedyPerfPartitioner, self._partitioner)
+        return NativePlanSpace(
+            search_space,
+            storage_constraint,
+            sort_by_perf=partitioner.sort_by == SortBy.PERF,
+            balance_modules=partitioner.balance_modules,
+        )
+
     def collective_plan(
         self,
         module: nn.Module,
@@ -435,8 +461,15 @@ class EmbeddingShardingPlanner(EmbeddingPlannerBase):
         for proposer in self._proposers:
             proposer.load(search_space=search_space, enumerator=self._enumerator)
 
+        native_space = self._native_plan_space(search_space, storage_constraint)
+
         start = time.time()
         for proposer in self._proposers:
+            # the grid is static, so its proposals are partitioned in parallel
+            # upfront, and only the better ones are placed again in the loop.
+            native_ratings: Dict[Tuple[int, ...], float] = {}
+            if native_space is not None and isinstance(proposer, GridSearchProposer):
+                native_ratings = native_space.evaluate(proposer.all_proposals())
             proposal = proposer.propose()
 
             while proposal:
@@ -462,13 +495,24 @@ class EmbeddingShardingPlanner(EmbeddingPlannerBase):
 
                 self._num_proposals += 1
                 try:
-                    # plan is just proposal where shard.rank is populated
-                    plan = self._partitioner.partition(
-                        proposal=proposal,
-                        storage_constraint=storage_constraint,
-                    )
-                    self._num_plans += 1
-                    perf_rating = self._perf_model.rate(plan=plan)
+                    if native_space is not None and native_space.covers(proposal):
+                        # plan is None if the proposal cannot beat the best plan
+                        # and was not placed.
+                        plan, perf_rating = native_space.partition(
+                            proposal,
+                            known_rating=native_ratings.get(proposal_key),
+                            best_rating=best_perf_rating,
+                        )
+                        if plan is not None:
+                            self._num_plans += 1
+                    else:
+                        # plan is just proposal where shard.rank is populated
+                        plan = self._partitioner.partition(
+                            proposal=proposal,
+                            storage_constraint=storage_constraint,
+                        )
+                        self._num_plans += 1
+                        perf_rating = self._perf_model.rate(plan=plan)
                     if perf_rating < best_perf_rating:
                         best_perf_rating = perf_rating
                         best_plan = copy.deepcopy(plan)
@@ -18,6 +18,10 @@ import torch
 
 from torchrec.distributed.embedding_types import EmbeddingComputeKernel
 
+from torchrec.distributed.planner.native_search import (
+    is_native_planner_available,
+    native_dp_proposals,
+)
 from torchrec.distributed.planner.types import (
     Enumerator,
     Perf,
@@ -260,6 +264,19 @@ class GridSearchProposer(Proposer):
         self._proposal_index = 0
         self._proposals = []
 
+    def all_proposals(self) -> List[List[ShardingOption]]:
+        """All proposals of the grid, in the order they are proposed."""
+        sharding_options_by_fqn = list(self._sharding_options_by_fqn.values())
+        return [
+            [
+                sharding_options[index]
+                for index, sharding_options in zip(
+                    proposal_indices, sharding_options_by_fqn
+                )
+            ]
+            for proposal_indices in self._proposals
+        ]
+
     def propose(self) -> Optional[List[ShardingOption]]:
         if self._proposals and self._proposal_index < len(self._proposals):
             proposal_indices = self._proposals[self._proposal_index]
@@ -393,6 +410,26 @@ class DynamicProgrammingProposer(Proposer):
             bin_count = self._hbm_bins_per_device * len(storage_constraint.devices)
             bin_size = float(hbm_total) / bin_count
 
+            if is_native_planner_available():
+                sharding_options_by_table = self._sharding_options_by_fqn.values()
+                self._proposal_list = native_dp_proposals(
+                    [
+                        [
+                            _bytes_to_float_bin(x.total_storage.hbm, bin_size)
+                            for x in sharding_options
+                        ]
+                        for sharding_options in sharding_options_by_table
+                    ],
+                    [
+                        [x.total_perf for x in sharding_options]
+                        for sharding_options in sharding_options_by_table
+                    ],
+                    bin_count,
+                )
+                if len(self._proposal_list) > 0:
+                    self._current_proposal = 0
+                return
+
             dp = [
                 [(float("inf"), float("inf"))] * bin_count for _ in range(table_count)
             ]  # [table_id][hbm_bin][perf, hbm]
@@ -8,7 +8,7 @@
 # pyre-strict
 
 import unittest
-from typing import cast, List, Optional
+from typing import cast, List, Optional, Tuple
 
 import torch
 from torch import nn
@@ -17,9 +17,13 @@ from torchrec.distributed.embedding import EmbeddingCollectionSharder
 from torchrec.distributed.embedding_types import EmbeddingComputeKernel
 from torchrec.distributed.embeddingbag import EmbeddingBagCollectionSharder
 from torchrec.distributed.planner.enumerators import EmbeddingEnumerator
+from torchrec.distributed.planner.native_search import is_native_planner_available
 from torchrec.distributed.planner.perf_models import NoopPerfModel
 from torchrec.distributed.planner.planners import EmbeddingShardingPlanner
-from torchrec.distributed.planner.proposers import EmbeddingOffloadScaleupProposer
+from torchrec.distributed.planner.proposers import (
+    EmbeddingOffloadScaleupProposer,
+    GridSearchProposer,
+)
 from torchrec.distributed.planner.stats import EmbeddingStats
 from torchrec.distributed.planner.storage_reservations import (
     HeuristicalStorageReservation,
@@ -842,3 +846,72 @@ class TestAutoPlannerWithScaleupProposer(unittest.TestCase):
         self.assertTrue(
             any("Min HBM: 0.016 GB on ranks [0, 1]" in line for line in stats)
         )
+
+
+class RecordingGridSearchProposer(GridSearchProposer):
+    def __init__(self) -> None:
+        super().__init__()
+        self.feedbacks: List[
+            Tuple[bool, Optional[List[ShardingOption]], Optional[float]]
+        ] = []
+
+    def feedback(
+        self,
+        partitionable: bool,
+        plan: Optional[List[ShardingOption]] = None,
+        perf_rating: Optional[float] = None,
+        storage_constraint: Optional[Topology] = None,
+    ) -> None:
+        self.feedbacks.append((partitionable, plan, perf_rating))
+        super().feedback(partitionable, plan, perf_rating, storage_constraint)
+
+
+@unittest.skipIf(
+    not is_native_planner_available(), "torchrec_planner ops are not loaded"
+)
+class TestNativePlanSpacePlanner(unittest.TestCase):
+    def test_skipped_grid_proposal(self) -> None:
+        topology = Topology(
+            world_size=2, hbm_cap=1024 * 1024 * 2, compute_device="cuda"
+        )
+        proposer = RecordingGridSearchProposer()
+        planner = EmbeddingShardingPlanner(topology=topology, proposer=proposer)
+        tables = [
+            EmbeddingBagConfig(
+                num_embeddings=100 * (i + 1),
+                embedding_dim=64,
+                name="table_" + str(i),
+                feature_names=["feature_" + str(i)],
+            )
+            for i in range(4)
+        ]
+        model = TestSparseNN(tables=tables, sparse_device=torch.device("meta"))
+        planner.plan(module=model, sharders=[TWvsRWSharder()])
+
+        search_space = {
+            id(sharding_option)
+            for sharding_options in proposer._sharding_options_by_fqn.values()
+            for sharding_option in sharding_options
+        }
+        placed = [
+            (plan, rating)
+            for partitionable, plan, rating in proposer.feedbacks
+            if partitionable and plan is not None
+        ]
+        skipped = [
+            rating
+            for partitionable, plan, rating in proposer.feedbacks
+            if partitionable and plan is None
+        ]
+        self.assertTrue(placed)
+        # the grid proposals that cannot beat the best plan are not placed.
+        self.assertTrue(skipped)
+        best_rating = min(cast(float, rating) for _, rating in placed)
+        for rating in skipped:
+            self.assertGreaterEqual(cast(float, rating), best_rating)
+        for plan, _ in placed:
+            for sharding_option in plan:
+                # placed into a copy, not into the search space.
+                self.assertNotIn(id(sharding_option), search_space)
+                for shard in sharding_option.shards:
+                    self.assertIsNotNone(shard.rank)
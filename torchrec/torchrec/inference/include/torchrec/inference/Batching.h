@@ -52,14 +52,53 @@ C10_DECLARE_REGISTRY(TorchRecBatchingFuncRegistry, BatchingFunc);
   REGISTER_TORCHREC_BATCHING_FUNC_WITH_PIORITY(    \
       name, c10::REGISTRY_DEFAULT, __VA_ARGS__);
 
+// Combine the float features of the requests into a tensor of `dtype`, one of
+// kFloat, kBFloat16 or kHalf. The values are rounded to nearest while copied.
 std::unordered_map<std::string, c10::IValue> combineFloat(
     const std::string& featureName,
-    const std::vector<std::shared_ptr<PredictionRequest>>& requests);
+    const std::vector<std::shared_ptr<PredictionRequest>>& requests,
+    at::ScalarType dtype = at::kFloat);
+
+// The dtypes of the sparse features, in the requests and in the batch.
+struct SparseTypes {
+  // of the ids in the requests, kInt or kLong
+  at::ScalarType requestValues = at::kInt;
+  // of the batched ids, kInt or kLong. Narrowing throws on overflow.
+  at::ScalarType values = at::kInt;
+  // of the batched weights, kFloat, kBFloat16 or kHalf
+  at::ScalarType weights = at::kFloat;
+};
 
+// Combine the sparse features of the requests, converting the ids and the
+// weights to `types` while copied. The weights are dropped if not
+// `isWeighted`.
 std::unordered_map<std::string, c10::IValue> combineSparse(
     const std::string& featureName,
     const std::vector<std::shared_ptr<PredictionRequest>>& requests,
-    bool isWeighted);
+    bool isWeighted,
+    const SparseTypes& types = {});
+
+// A KeyedJaggedTensor whose lengths, values, weights and offsets are views of
+// one buffer, so that it is moved to a device with a single copy. The keys
+// are not in the requests, they are left empty.
+struct FusedKeyedJaggedTensor {
+  at::Tensor buffer;
+  KeyedJaggedTensor kjt;
+  at::Tensor offsets;
+  int64_t stride = 0;
+};
+
+// Combine the sparse features of the requests like combineSparse, into the
+// buffer of a FusedKeyedJaggedTensor, pinned if possible.
+FusedKeyedJaggedTensor combineSparseKJT(
+    const std::string& featureName,
+    const std::vector<std::shared_ptr<PredictionRequest>>& requests,
+    bool isWeighted,
+    const SparseTypes& types = {});
+
+FusedKeyedJaggedTensor moveToDevice(
+    const FusedKeyedJaggedTensor& fused,
+    const c10::Device& device);
 
 std::unordered_map<std::string, c10::IValue> combineEmbedding(
     const std::string& featureName,
@@ -30,6 +30,7 @@
 #include <folly/synchronization/Baton.h>
 #include "torchrec/inference/Batching.h"
 #include "torchrec/inference/Observer.h"
+#include "torchrec/inference/RequestCapture.h"
 #include "torchrec/inference/ResourceManager.h"
 #include "torchrec/inference/Types.h"
 
@@ -49,6 +50,8 @@ class BatchingQueue {
     const std::unordered_map<std::string, BatchingMetadata> batchingMetadata;
     std::function<Event(at::DeviceIndex)> eventCreationFn;
     std::function<void()> warmupFn;
+    // If set, samples the added requests for offline replay.
+    std::shared_ptr<RequestCapture> requestCapture;
   };
 
   BatchingQueue(const BatchingQueue&) = delete;
@@ -10,11 +10,14 @@
 
 #include <atomic>
 #include <chrono>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <vector>
 
+#include <folly/futures/Future.h>
+#include <folly/futures/Promise.h>
 #include <folly/small_vector.h>
 #include <glog/logging.h>
 
@@ -35,16 +38,47 @@ class ResourceManager {
       std::unique_ptr<IResourceManagerObserver> observer =
           std::make_unique<EmptyResourceManagerObserver>());
 
+  // Fails the batches still waiting for a device.
+  ~ResourceManager();
+
   // Returns whether batches can be allocated onto a device based on
-  // slack provided (ms) and maxOutstandingBatches_).
+  // slack provided (ms) and maxOutstandingBatches_). Blocks until
+  // occupyDeviceAsync completes.
   bool occupyDevice(int gpuIdx, std::chrono::milliseconds slack);
 
+  // Completes with true once a slot of the device is occupied, or with false
+  // if none frees up within the slack. The waiting batches are queued per
+  // device, release() hands the freed slot to the earliest one.
+  folly::SemiFuture<bool> occupyDeviceAsync(
+      int gpuIdx,
+      std::chrono::milliseconds slack);
+
+  // Occupies a slot of the least loaded device with a free one, without
+  // waiting. Returns the device, or nullopt if all are full.
+  std::optional<int> tryOccupyAnyDevice();
+
   void release(int gpuIdx);
 
  private:
+  struct Waiter {
+    folly::Promise<bool> promise;
+    std::chrono::steady_clock::time_point enqueueTime;
+    // Set by the first of the hand-off and the timeout.
+    std::atomic<bool> claimed{false};
+    // Fails the waiter after the slack. Cancelled by the hand-off, so that
+    // the timer does not stay armed. Set with mu_ held.
+    folly::Future<folly::Unit> timeout = folly::makeFuture();
+  };
+
+  // With mu_ held.
+  void occupyLocked(int gpuIdx, std::chrono::milliseconds waitedFor);
+
   folly::small_vector<int> gpuToOutstandingBatches_;
   // Helpful for tuning
   folly::small_vector<int> allTimeHigh_;
+  // Per device, the batches waiting for a slot in arrival order. Entries
+  // claimed by their timeout are dropped lazily.
+  std::vector<std::deque<std::shared_ptr<Waiter>>> waiters_;
   const size_t maxOutstandingBatches_;
   const int logFrequency_;
   // Align as 64B to avoid false sharing
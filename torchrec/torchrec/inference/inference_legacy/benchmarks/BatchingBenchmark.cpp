@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Benchmarks of the batching pipeline on CPU: the combine functions, the
+// assembly of a batch from the registered batching functions and the split of
+// the results. Every benchmark reports, per request,
+//  - time/request: the wall time,
+//  - allocs/request: the heap allocations through operator new, which
+//    excludes the tensor storages,
+// and bytes_per_second, the request bytes consumed.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <ATen/ATen.h>
+#include <benchmark/benchmark.h>
+#include <c10/util/irange.h>
+#include <folly/Lazy.h>
+#include <folly/io/IOBuf.h>
+
+#include "torchrec/inference/Batching.h"
+#include "torchrec/inference/ResultSplit.h"
+#include "torchrec/inference/Types.h"
+
+namespace torchrec {
+namespace {
+
+std::atomic<uint64_t> numAllocations{0};
+
+} // namespace
+} // namespace torchrec
+
+void* operator new(std::size_t size) {
+  torchrec::numAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /* size */) noexcept {
+  std::free(ptr);
+}
+
+namespace torchrec {
+namespace {
+
+constexpr const char* kFloatFeatures = "float_features";
+constexpr const char* kSparseFeatures = "id_score_list_features";
+constexpr const char* kEmbeddingFeatures = "embedding_features";
+constexpr uint32_t kEmbeddingDim = 32;
+constexpr uint32_t kNumTasks = 4;
+
+struct RequestShape {
+  uint32_t numRequests;
+  // batch size of each request
+  uint32_t batchSize;
+  uint32_t numFeatures;
+  // mean of the geometric distribution of the id list lengths
+  uint32_t meanLength;
+  // number of IOBufs in the chain of each feature buffer
+  uint32_t numFragments;
+};
+
+void requestShapes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"requests", "batch", "features", "mean_len", "fragments"});
+  for (int64_t numRequests : {1, 16, 64}) {
+    for (int64_t numFragments : {1, 8}) {
+      b->Args({numRequests, 32, 64, 20, numFragments});
+    }
+  }
+  // ranking: few candidates with many features
+  b->Args({16, 1, 512, 20, 1});
+  // retrieval: many candidates with long id lists
+  b->Args({16, 512, 16, 100, 4});
+}
+
+RequestShape shapeOf(const benchmark::State& state) {
+  return RequestShape{
+      .numRequests = static_cast<uint32_t>(state.range(0)),
+      .batchSize = static_cast<uint32_t>(state.range(1)),
+      .numFeatures = static_cast<uint32_t>(state.range(2)),
+      .meanLength = static_cast<uint32_t>(state.range(3)),
+      .numFragments = static_cast<uint32_t>(state.range(4)),
+  };
+}
+
+// Copy `size` bytes of `data` into a chain of `numFragments` IOBufs, as
+// received from the network.
+folly::IOBuf
+fragmentedBuffer(const void* data, size_t size, uint32_t numFragments) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  const size_t fragment =
+      std::max<size_t>((size + numFragments - 1) / numFragments, 1);
+  folly::IOBuf head(
+      folly::IOBuf::COPY_BUFFER, bytes, std::min(size, fragment));
+  for (size_t offset = fragment; offset < size; offset += fragment) {
+    head.prependChain(folly::IOBuf::copyBuffer(
+        bytes + offset, std::min(fragment, size - offset)));
+  }
+  return head;
+}
+
+template <typename T>
+folly::IOBuf fragmentedBuffer(const std::vector<T>& data, uint32_t frags) {
+  return fragmentedBuffer(data.data(), data.size() * sizeof(T), frags);
+}
+
+// Requests with dense, weighted sparse and embedding features of `shape`.
+class RequestGenerator {
+ public:
+  explicit RequestGenerator(RequestShape shape, uint64_t seed = 0)
+      : shape_(shape), rng_(seed) {}
+
+  std::shared_ptr<PredictionRequest> next() {
+    auto request = std::make_shared<PredictionRequest>();
+    request->batch_size = shape_.batchSize;
+    const size_t rows = shape_.numFeatures * shape_.batchSize;
+    std::uniform_real_distribution<float> uniform;
+
+    std::vector<float> dense(rows);
+    for (auto& value : dense) {
+      value = uniform(rng_);
+    }
+    request->features[kFloatFeatures] = FloatFeatures{
+        .num_features = shape_.numFeatures,
+        .values = fragmentedBuffer(dense, shape_.numFragments),
+    };
+
+    std::geometric_distribution<int32_t> length(
+        1.0 / (1.0 + shape_.meanLength));
+    std::vector<int32_t> lengths(rows);
+    for (auto& value : lengths) {
+      value = length(rng_);
+    }
+    const auto totalLength =
+        std::accumulate(lengths.begin(), lengths.end(), size_t(0));
+    std::uniform_int_distribution<int32_t> id;
+    std::vector<int32_t> ids(totalLength);
+    for (auto& value : ids) {
+      value = id(rng_);
+    }
+    std::vector<float> weights(totalLength);
+    for (auto& value : weights) {
+      value = uniform(rng_);
+    }
+    request->features[kSparseFeatures] = SparseFeatures{
+        .num_features = shape_.numFeatures,
+        .lengths = fragmentedBuffer(lengths, shape_.numFragments),
+        .values = fragmentedBuffer(ids, shape_.numFragments),
+        .weights = fragmentedBuffer(weights, shape_.numFragments),
+    };
+
+    std::vector<float> embeddings(rows * kEmbeddingDim);
+    for (auto& value : embeddings) {
+      value = uniform(rng_);
+    }
+    request->features[kEmbeddingFeatures] = FloatFeatures{
+        .num_features = shape_.numFeatures,
+        .values = fragmentedBuffer(embeddings, shape_.numFragments),
+    };
+    return request;
+  }
+
+  std::vector<std::shared_ptr<PredictionRequest>> batch() {
+    std::vector<std::shared_ptr<PredictionRequest>> requests;
+    for (uint32_t i = 0; i < shape_.numRequests; ++i) {
+      requests.push_back(next());
+    }
+    return requests;
+  }
+
+ private:
+  RequestShape shape_;
+  std::mt19937_64 rng_;
+};
+
+size_t numBytes(
+    const std::vector<std::shared_ptr<PredictionRequest>>& requests,
+    const std::string& featureName) {
+  size_t bytes = 0;
+  for (const auto& request : requests) {
+    const auto& feature = request->features.at(featureName);
+    if (const auto* sparse = std::get_if<SparseFeatures>(&feature)) {
+      bytes += sparse->lengths.computeChainDataLength() +
+          sparse->values.computeChainDataLength() +
+          sparse->weights.computeChainDataLength();
+    } else {
+      bytes +=
+          std::get<FloatFeatures>(feature).values.computeChainDataLength();
+    }
+  }
+  return bytes;
+}
+
+// Measures the allocations of the benchmark loop and sets the counters.
+class PerRequestCounters {
+ public:
+  PerRequestCounters(benchmark::State& state, size_t numRequests, size_t bytes)
+      : state_(state),
+        numRequests_(numRequests),
+        bytes_(bytes),
+        allocations_(numAllocations.load()) {}
+
+  ~PerRequestCounters() {
+    const auto allocations = numAllocations.load() - allocations_;
+    const double requests =
+        static_cast<double>(numRequests_) * state_.iterations();
+    state_.SetItemsProcessed(state_.iterations() * numRequests_);
+    state_.SetBytesProcessed(state_.iterations() * bytes_);
+    state_.counters["time/request"] = benchmark::Counter(
+        numRequests_,
+        benchmark::Counter::kIsIterationInvariantRate |
+            benchmark::Counter::kInvert);
+    state_.counters["allocs/request"] =
+        requests > 0 ? allocations / requests : 0;
+  }
+
+ private:
+  benchmark::State& state_;
+  size_t numRequests_;
+  size_t bytes_;
+  uint64_t allocations_;
+};
+
+void BM_CombineFloat(benchmark::State& state) {
+  auto requests = RequestGenerator(shapeOf(state)).batch();
+  PerRequestCounters counters(
+      state, requests.size(), numBytes(requests, kFloatFeatures));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(combineFloat(kFloatFeatures, requests));
+  }
+}
+
+void BM_CombineSparse(benchmark::State& state) {
+  auto requests = RequestGenerator(shapeOf(state)).batch();
+  PerRequestCounters counters(
+      state, requests.size(), numBytes(requests, kSparseFeatures));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        combineSparse(kSparseFeatures, requests, /* isWeighted */ true));
+  }
+}
+
+void BM_CombineSparseKJT(benchmark::State& state) {
+  auto requests = RequestGenerator(shapeOf(state)).batch();
+  PerRequestCounters counters(
+      state, requests.size(), numBytes(requests, kSparseFeatures));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        combineSparseKJT(kSparseFeatures, requests, /* isWeighted */ true));
+  }
+}
+
+void BM_CombineEmbedding(benchmark::State& state) {
+  auto requests = RequestGenerator(shapeOf(state)).batch();
+  PerRequestCounters counters(
+      state, requests.size(), numBytes(requests, kEmbeddingFeatures));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(combineEmbedding(kEmbeddingFeatures, requests));
+  }
+}
+
+// The batch assembly of BatchingQueue::pinMemory, from the registered
+// batching functions, with the CPU as the device of every feature.
+void BM_AssembleBatch(benchmark::State& state) {
+  auto requests = RequestGenerator(shapeOf(state)).batch();
+  const std::vector<std::pair<std::string, std::string>> metadata = {
+      {kFloatFeatures, "dense"},
+      {kSparseFeatures, "weighted_sparse"},
+      {kEmbeddingFeatures, "embedding"},
+  };
+  std::unordered_map<std::string, std::unique_ptr<BatchingFunc>> funcs;
+  size_t bytes = 0;
+  for (const auto& [featureName, type] : metadata) {
+    funcs[type] = TorchRecBatchingFuncRegistry()->Create(type);
+    bytes += numBytes(requests, featureName);
+  }
+  const c10::Device device(c10::kCPU);
+
+  PerRequestCounters counters(state, requests.size(), bytes);
+  for (auto _ : state) {
+    size_t combinedBatchSize = 0;
+    for (const auto& request : requests) {
+      combinedBatchSize += request->batch_size;
+    }
+
+    auto batchOffsetsLazy =
+        folly::lazy<std::function<at::Tensor()>>([&]() -> at::Tensor {
+          auto batchOffsets = at::empty(
+              {static_cast<long>(requests.size() + 1)},
+              at::TensorOptions().dtype(at::kInt));
+          auto batchOffsetsAcc = batchOffsets.accessor<int32_t, 1>();
+          batchOffsetsAcc[0] = 0;
+          for (auto i : c10::irange(requests.size())) {
+            batchOffsetsAcc[i + 1] =
+                batchOffsetsAcc[i] + requests[i]->batch_size;
+          }
+          return batchOffsets;
+        });
+    auto batchItemsLazy =
+        folly::lazy<std::function<at::Tensor()>>([&]() -> at::Tensor {
+          auto batchItems = at::empty(
+              {static_cast<int64_t>(combinedBatchSize)},
+              at::TensorOptions().dtype(at::kInt));
+          auto batchItemsAcc = batchItems.accessor<int32_t, 1>();
+          auto batchOffsetsAcc = batchOffsetsLazy().accessor<int32_t, 1>();
+          for (auto i : c10::irange(requests.size())) {
+            for (auto j = batchOffsetsAcc[i]; j < batchOffsetsAcc[i + 1];
+                 ++j) {
+              batchItemsAcc[j] = i;
+            }
+          }
+          return batchItems;
+        });
+
+    c10::impl::GenericDict forwardArgs(
+        at::StringType::get(), at::AnyType::get());
+    for (const auto& [featureName, type] : metadata) {
+      for (auto& [key, value] : funcs[type]->batch(
+               featureName,
+               requests,
+               combinedBatchSize,
+               batchOffsetsLazy,
+               device,
+               batchItemsLazy)) {
+        forwardArgs.insert(key, std::move(value));
+      }
+    }
+    auto batch = std::make_shared<PredictionBatch>(
+        combinedBatchSize,
+        std::move(forwardArgs),
+        std::vector<RequestContext>());
+    benchmark::DoNotOptimize(batch);
+  }
+}
+
+// The split of the predictions of a batch back to its requests.
+void BM_SplitResult(benchmark::State& state, const std::string& name) {
+  const auto shape = shapeOf(state);
+  const size_t totalBatchSize = shape.numRequests * shape.batchSize;
+  c10::impl::GenericDict result(
+      c10::StringType::get(), c10::TensorType::get());
+  for (uint32_t task = 0; task < kNumTasks; ++task) {
+    result.insert(
+        "task_" + std::to_string(task),
+        at::rand({static_cast<int64_t>(totalBatchSize)}));
+  }
+  auto func = TorchRecResultSplitFuncRegistry()->Create(name);
+  c10::IValue resultValue(result);
+
+  PerRequestCounters counters(
+      state, shape.numRequests, totalBatchSize * kNumTasks * sizeof(float));
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < shape.numRequests; ++i) {
+      benchmark::DoNotOptimize(func->splitResult(
+          resultValue, i * shape.batchSize, shape.batchSize, totalBatchSize));
+    }
+  }
+}
+
+BENCHMARK(BM_CombineFloat)->Apply(requestShapes);
+BENCHMARK(BM_CombineSparse)->Apply(requestShapes);
+BENCHMARK(BM_CombineSparseKJT)->Apply(requestShapes);
+BENCHMARK(BM_CombineEmbedding)->Apply(requestShapes);
+BENCHMARK(BM_AssembleBatch)->Apply(requestShapes);
+BENCHMARK_CAPTURE(BM_SplitResult, dict_of_tensor, "dict_of_tensor")
+    ->Apply(requestShapes);
+
+} // namespace
+} // namespace torchrec
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// remove this after we switch over to multipy externally for torchrec
+#ifdef FBCODE_CAFFE2
+#include <multipy/runtime/deploy.h> // @manual
+#else
+#include <torch/csrc/deploy/deploy.h> // @manual
+#endif
+
+#include "torchrec/inference/BatchingQueue.h"
+#include "torchrec/inference/GPUExecutor.h"
+#include "torchrec/inference/Observer.h"
+#include "torchrec/inference/Types.h"
+
+namespace torchrec {
+
+struct ModelPackageConfig {
+  std::string packagePath;
+  // Used to load the packages that you 'extern' with torch.package.
+  std::string pythonPackagesPath;
+  int nGpu = 1;
+  int nInterpPerGpu = 1;
+  std::chrono::milliseconds gpuExecutorQueueTimeout{50};
+  std::shared_ptr<IGPUExecutorObserver> observer =
+      std::make_shared<EmptyGPUExecutorObserver>();
+};
+
+// A model sharded onto the GPUs, ready to be fed by a BatchingQueue.
+struct ModelPackage {
+  std::shared_ptr<torch::deploy::InterpreterManager> manager;
+  std::unordered_map<std::string, BatchingMetadata> batchingMetadata;
+  std::vector<std::unique_ptr<GPUExecutor>> executors;
+  // One per GPU, hands the batches to its executor. Only valid while the
+  // executors are alive.
+  std::vector<BatchQueueCb> batchQueueCbs;
+};
+
+// Loads the MODULE_FACTORY of the `__module_loader` module of a torch.package,
+// reads its batching and result metadata, and creates the predict module of
+// every GPU with its GPUExecutor.
+ModelPackage loadModelPackage(const ModelPackageConfig& config);
+
+} // namespace torchrec
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/MPMCQueue.h>
+
+#include "torchrec/inference/Types.h"
+
+namespace torchrec {
+
+// Samples the requests entering a BatchingQueue into a binary log, so that
+// production traffic can be replayed offline (see replay.cpp).
+//
+// The caller only pays for a random draw and, for sampled requests, a
+// non-blocking queue write that keeps a reference to the request. A writer
+// thread serializes the requests. When it falls behind, sampled requests are
+// dropped instead of slowing down the caller.
+//
+// Log layout, in host byte order:
+//   header: "TRCAPLOG" uint32 version
+//   record: uint64 arrival ns since capture start, uint32 batch_size,
+//           uint32 num entries, then per entry:
+//             uint16 name size, name, uint8 kind,
+//             kind 0 (sparse): uint32 num_features, lengths, values, weights
+//             kind 1 (float):  uint32 num_features, values
+//             kind 2 (ivalue): pickled value
+//   where every buffer is a uint64 size followed by the bytes.
+class RequestCapture {
+ public:
+  struct Config {
+    std::string path;
+    // Fraction of the requests to record, in [0, 1].
+    double sampleRate = 1.0;
+    // Sampled requests waiting for the writer thread.
+    size_t queueCapacity = 4096;
+    // How often the writer thread flushes the log to the file.
+    std::chrono::milliseconds flushInterval = std::chrono::seconds(1);
+  };
+
+  explicit RequestCapture(Config config);
+  ~RequestCapture();
+
+  RequestCapture(const RequestCapture&) = delete;
+  RequestCapture& operator=(const RequestCapture&) = delete;
+
+  void maybeRecord(
+      const std::shared_ptr<PredictionRequest>& request,
+      std::chrono::steady_clock::time_point addedTime);
+
+  // Writes the queued requests and closes the log.
+  void stop();
+
+  uint64_t recordedCount() const {
+    return recorded_;
+  }
+
+  uint64_t droppedCount() const {
+    return dropped_;
+  }
+
+ private:
+  struct Entry {
+    std::shared_ptr<PredictionRequest> request;
+    std::chrono::steady_clock::time_point addedTime;
+  };
+
+  void write();
+
+  void writeRequest(const Entry& entry);
+
+  const Config config_;
+  const std::chrono::steady_clock::time_point startTime_;
+  std::ofstream out_;
+  std::vector<char> outBuffer_;
+  folly::MPMCQueue<Entry> queue_;
+  std::thread writerThread_;
+  std::atomic<bool> stopping_;
+  std::atomic<uint64_t> recorded_;
+  std::atomic<uint64_t> dropped_;
+};
+
+struct CapturedRequest {
+  // Arrival time relative to the start of the capture.
+  std::chrono::nanoseconds arrival;
+  std::shared_ptr<PredictionRequest> request;
+};
+
+// Reads a whole capture log, in arrival order. A truncated last record, left
+// by a server that was killed while capturing, is skipped with a warning.
+// Throws std::runtime_error if the file can not be read or is not a capture
+// log.
+std::vector<CapturedRequest> readRequestCapture(const std::string& path);
+
+} // namespace torchrec
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Replays a request capture written by the server (--request_capture_path)
+// against a local BatchingQueue and GPUExecutor, and reports the throughput
+// and the latency percentiles.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+#include <folly/futures/Future.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "torchrec/inference/BatchingQueue.h"
+#include "torchrec/inference/ModelPackage.h"
+#include "torchrec/inference/Observer.h"
+#include "torchrec/inference/RequestCapture.h"
+
+DEFINE_string(capture_path, "", "Request capture written by the server");
+DEFINE_double(
+    replay_speed,
+    1.0,
+    "Divides the captured inter-arrival times: 1 replays at the original "
+    "speed, 2 twice as fast, 0 as fast as the queue completes requests");
+DEFINE_int32(
+    replay_concurrency,
+    256,
+    "Requests in flight when replaying with --replay_speed=0");
+
+DEFINE_int32(n_interp_per_gpu, 1, "");
+DEFINE_int32(n_gpu, 1, "");
+DEFINE_string(package_path, "", "");
+
+DEFINE_int32(batching_interval, 10, "");
+DEFINE_int32(queue_timeout, 500, "");
+
+DEFINE_int32(num_exception_threads, 4, "");
+DEFINE_int32(num_mem_pinner_threads, 4, "");
+DEFINE_int32(max_batch_size, 2048, "");
+DEFINE_int32(gpu_executor_queue_timeout, 50, "");
+
+DEFINE_string(
+    python_packages_path,
+    "",
+    "Used to load the packages that you 'extern' with torch.package");
+
+namespace {
+
+double percentileMS(
+    const std::vector<std::chrono::nanoseconds>& sorted,
+    double percentile) {
+  auto idx = std::min(
+      sorted.size() - 1, static_cast<size_t>(percentile * sorted.size()));
+  return std::chrono::duration<double, std::milli>(sorted[idx]).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  CHECK_GE(FLAGS_replay_speed, 0.0);
+  CHECK_GT(FLAGS_replay_concurrency, 0);
+
+  // Load the whole capture first so reading it does not skew the replay.
+  auto captured = torchrec::readRequestCapture(FLAGS_capture_path);
+  CHECK(!captured.empty()) << "No request in " << FLAGS_capture_path;
+  LOG(INFO) << "Loaded " << captured.size() << " requests";
+
+  auto model = torchrec::loadModelPackage(torchrec::ModelPackageConfig{
+      .packagePath = FLAGS_package_path,
+      .pythonPackagesPath = FLAGS_python_packages_path,
+      .nGpu = FLAGS_n_gpu,
+      .nInterpPerGpu = FLAGS_n_interp_per_gpu,
+      .gpuExecutorQueueTimeout =
+          std::chrono::milliseconds(FLAGS_gpu_executor_queue_timeout),
+  });
+
+  torchrec::BatchingQueue queue(
+      model.batchQueueCbs,
+      torchrec::BatchingQueue::Config{
+          .batchingInterval =
+              std::chrono::milliseconds(FLAGS_batching_interval),
+          .queueTimeout = std::chrono::milliseconds(FLAGS_queue_timeout),
+          .numExceptionThreads = FLAGS_num_exception_threads,
+          .numMemPinnerThreads = FLAGS_num_mem_pinner_threads,
+          .maxBatchSize = FLAGS_max_batch_size,
+          .batchingMetadata = std::move(model.batchingMetadata),
+      },
+      FLAGS_n_gpu,
+      std::make_unique<torchrec::EmptyBatchingQueueObserver>());
+
+  // Each completion writes its own slot, so latencies needs no lock.
+  std::vector<std::chrono::nanoseconds> latencies(captured.size());
+  std::atomic<size_t> numErrors{0};
+  std::vector<folly::Future<folly::Unit>> futures;
+  futures.reserve(captured.size());
+
+  // Bounds the requests in flight with --replay_speed=0.
+  std::mutex mutex;
+  std::condition_variable inFlightCv;
+  int inFlight = 0;
+  const bool maxSpeed = FLAGS_replay_speed == 0.0;
+
+  size_t numSamples = 0;
+  std::chrono::nanoseconds maxSendLag(0);
+  const auto firstArrival = captured.front().arrival;
+  const auto replayStart = std::chrono::steady_clock::now();
+
+  for (size_t i = 0; i < captured.size(); ++i) {
+    const auto& entry = captured[i];
+    if (maxSpeed) {
+      std::unique_lock<std::mutex> lock(mutex);
+      inFlightCv.wait(
+          lock, [&] { return inFlight < FLAGS_replay_concurrency; });
+      ++inFlight;
+    } else {
+      const auto offset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          (entry.arrival - firstArrival) / FLAGS_replay_speed);
+      const auto due = replayStart + offset;
+      /* sleep override */
+      std::this_thread::sleep_until(due);
+      maxSendLag = std::max(
+          maxSendLag,
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - due));
+    }
+
+    folly::Promise<std::unique_ptr<torchrec::PredictionResponse>> promise;
+    const auto start = std::chrono::steady_clock::now();
+    futures.push_back(
+        promise.getSemiFuture().toUnsafeFuture().thenTry(
+            [&, i, start](
+                folly::Try<std::unique_ptr<torchrec::PredictionResponse>>&&
+                    response) {
+              latencies[i] = std::chrono::steady_clock::now() - start;
+              if (response.hasException() || (*response)->exception) {
+                ++numErrors;
+              }
+              if (maxSpeed) {
+                {
+                  std::lock_guard<std::mutex> lock(mutex);
+                  --inFlight;
+                }
+                inFlightCv.notify_one();
+              }
+            }));
+    numSamples += entry.request->batch_size;
+    queue.add(entry.request, std::move(promise));
+  }
+
+  folly::collectAll(std::move(futures)).wait();
+  const auto elapsed = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - replayStart)
+                           .count();
+
+  std::sort(latencies.begin(), latencies.end());
+  LOG(INFO) << fmt::format(
+      "Replayed {} requests, {} samples in {:.2f}s: {:.1f} requests/s, "
+      "{:.1f} samples/s, {} errors",
+      captured.size(),
+      numSamples,
+      elapsed,
+      captured.size() / elapsed,
+      numSamples / elapsed,
+      numErrors.load());
+  LOG(INFO) << fmt::format(
+      "Latency ms: p50 {:.2f} p90 {:.2f} p99 {:.2f} p99.9 {:.2f} max {:.2f}",
+      percentileMS(latencies, 0.5),
+      percentileMS(latencies, 0.9),
+      percentileMS(latencies, 0.99),
+      percentileMS(latencies, 0.999),
+      percentileMS(latencies, 1.0));
+  if (!maxSpeed) {
+    // A large lag means the replay could not keep up with the capture, so
+    // the arrival pattern was not reproduced.
+    LOG(INFO) << fmt::format(
+        "Max send lag ms: {:.2f}",
+        std::chrono::duration<double, std::milli>(maxSendLag).count());
+  }
+
+  return 0;
+}
@@ -6,31 +6,26 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <pthread.h>
+#include <csignal>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <thread>
 
 #include <folly/futures/Future.h>
 #include <folly/io/IOBuf.h>
-#include <folly/json/json.h>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <grpc++/grpc++.h>
 #include <grpcpp/ext/proto_server_reflection_plugin.h>
 #include <grpcpp/grpcpp.h>
 
-// remove this after we switch over to multipy externally for torchrec
-#ifdef FBCODE_CAFFE2
-#include <multipy/runtime/deploy.h> // @manual
-#include <multipy/runtime/path_environment.h>
-#else
-#include <torch/csrc/deploy/deploy.h>
-#include <torch/csrc/deploy/path_environment.h>
-#endif
-
 #include <torch/torch.h>
 
-#include "torchrec/inference/GPUExecutor.h"
+#include "torchrec/inference/BatchingQueue.h"
+#include "torchrec/inference/ModelPackage.h"
+#include "torchrec/inference/RequestCapture.h"
 #include "torchrec/inference/predictor.grpc.pb.h"
 #include "torchrec/inference/predictor.pb.h"
 
@@ -54,6 +49,12 @@ DEFINE_int32(num_mem_pinner_threads, 4, "");
 DEFINE_int32(max_batch_size, 2048, "");
 DEFINE_int32(gpu_executor_queue_timeout, 50, "");
 
+DEFINE_string(
+    request_capture_path,
+    "",
+    "If set, sample the incoming requests to this file. See replay.cpp");
+DEFINE_double(request_capture_sample_rate, 0.01, "");
+
 DEFINE_string(server_address, "0.0.0.0", "");
 DEFINE_string(server_port, "50051", "");
 
@@ -211,92 +212,36 @@ int main(int argc, char* argv[]) {
   google::InitGoogleLogging(argv[0]);
   gflags::ParseCommandLineFlags(&argc, &argv, true);
 
-  LOG(INFO) << "Creating GPU executors";
-
-  // store the executors and interpreter managers
-  std::vector<std::unique_ptr<torchrec::GPUExecutor>> executors;
-  std::vector<torch::deploy::ReplicatedObj> models;
-  std::vector<torchrec::BatchQueueCb> batchQueueCbs;
-  std::unordered_map<std::string, BatchingMetadata> batchingMetadataMap;
+  // SIGINT and SIGTERM shut the server down. They are blocked before any
+  // thread is started, so that only the thread waiting for them gets them.
+  sigset_t shutdownSignals;
+  sigemptyset(&shutdownSignals);
+  sigaddset(&shutdownSignals, SIGINT);
+  sigaddset(&shutdownSignals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &shutdownSignals, nullptr);
 
-  std::shared_ptr<torch::deploy::Environment> env =
-      std::make_shared<torch::deploy::PathEnvironment>(
-          FLAGS_python_packages_path);
-
-  auto manager = std::make_shared<torch::deploy::InterpreterManager>(
-      FLAGS_n_gpu * FLAGS_n_interp_per_gpu, env);
-  {
-    torch::deploy::Package package = manager->loadPackage(FLAGS_package_path);
-    auto I = package.acquireSession();
-    auto imported = I.self.attr("import_module")({"__module_loader"});
-    auto factoryType = imported.attr("MODULE_FACTORY");
-    auto factory = factoryType.attr("__new__")({factoryType});
-    factoryType.attr("__init__")({factory});
-
-    // Process forward metadata.
-    try {
-      auto batchingMetadataJsonStr =
-          factory.attr("batching_metadata_json")(at::ArrayRef<at::IValue>())
-              .toIValue()
-              .toString()
-              ->string();
-      auto dynamic = folly::parseJson(batchingMetadataJsonStr);
-      CHECK(dynamic.isObject());
-      for (auto it : dynamic.items()) {
-        torchrec::BatchingMetadata metadata;
-        metadata.type = it.second["type"].asString();
-        metadata.device = it.second["device"].asString();
-        batchingMetadataMap[it.first.asString()] = std::move(metadata);
-      }
-    } catch (...) {
-      auto batchingMetadata =
-          factory.attr("batching_metadata")(at::ArrayRef<at::IValue>())
-              .toIValue();
-      for (const auto& iter : batchingMetadata.toGenericDict()) {
-        torchrec::BatchingMetadata metadata;
-        metadata.type = iter.value().toStringRef();
-        metadata.device = "cuda";
-        batchingMetadataMap[iter.key().toStringRef()] = std::move(metadata);
-      }
-    }
-
-    // Process result metadata.
-    auto resultMetadata =
-        factory.attr("result_metadata")(at::ArrayRef<at::IValue>())
-            .toIValue()
-            .toStringRef();
-    std::shared_ptr<torchrec::ResultSplitFunc> resultSplitFunc =
-        torchrec::TorchRecResultSplitFuncRegistry()->Create(resultMetadata);
-
-    LOG(INFO) << "Creating Model Shard for " << FLAGS_n_gpu << " GPUs.";
-    auto dmp = factory.attr("create_predict_module")
-                   .callKwargs({{"world_size", FLAGS_n_gpu}});
-
-    for (int rank = 0; rank < FLAGS_n_gpu; rank++) {
-      auto device = I.self.attr("import_module")({"torch"}).attr("device")(
-          {"cuda", rank});
-      auto m = dmp.attr("copy")({device.toIValue()});
-      models.push_back(I.createMovable(m));
-    }
+  LOG(INFO) << "Creating GPU executors";
 
-    for (int rank = 0; rank < FLAGS_n_gpu; rank++) {
-      auto executor = std::make_unique<torchrec::GPUExecutor>(
-          manager,
-          std::move(models[rank]),
-          rank,
-          FLAGS_n_gpu,
-          resultSplitFunc,
-          std::chrono::milliseconds(FLAGS_gpu_executor_queue_timeout));
-      executors.push_back(std::move(executor));
-      batchQueueCbs.push_back(
-          [&, rank](std::shared_ptr<torchrec::PredictionBatch> batch) {
-            executors[rank]->callback(std::move(batch));
-          });
-    }
+  auto model = torchrec::loadModelPackage(torchrec::ModelPackageConfig{
+      .packagePath = FLAGS_package_path,
+      .pythonPackagesPath = FLAGS_python_packages_path,
+      .nGpu = FLAGS_n_gpu,
+      .nInterpPerGpu = FLAGS_n_interp_per_gpu,
+      .gpuExecutorQueueTimeout =
+          std::chrono::milliseconds(FLAGS_gpu_executor_queue_timeout),
+  });
+
+  std::shared_ptr<torchrec::RequestCapture> requestCapture;
+  if (!FLAGS_request_capture_path.empty()) {
+    requestCapture = std::make_shared<torchrec::RequestCapture>(
+        torchrec::RequestCapture::Config{
+            .path = FLAGS_request_capture_path,
+            .sampleRate = FLAGS_request_capture_sample_rate,
+        });
   }
 
   torchrec::BatchingQueue queue(
-      batchQueueCbs,
+      model.batchQueueCbs,
       torchrec::BatchingQueue::Config{
           .batchingInterval =
               std::chrono::milliseconds(FLAGS_batching_interval),
@@ -304,7 +249,8 @@ int main(int argc, char* argv[]) {
           .numExceptionThreads = FLAGS_num_exception_threads,
           .numMemPinnerThreads = FLAGS_num_mem_pinner_threads,
           .maxBatchSize = FLAGS_max_batch_size,
-          .batchingMetadata = std::move(batchingMetadataMap),
+          .batchingMetadata = std::move(model.batchingMetadata),
+          .requestCapture = requestCapture,
       },
       FLAGS_n_gpu);
 
@@ -327,10 +273,20 @@ int main(int argc, char* argv[]) {
   std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
   LOG(INFO) << "Server listening on " << server_address;
 
-  // Wait for the server to shutdown. Note that some other thread must be
-  // responsible for shutting down the server for this call to ever return.
+  std::thread([&server, shutdownSignals] {
+    int sig = 0;
+    sigwait(&shutdownSignals, &sig);
+    LOG(INFO) << "Received signal " << sig;
+    server->Shutdown();
+  }).detach();
+
+  // Wait for the server to shutdown, which the thread above does on a signal.
   server->Wait();
 
   LOG(INFO) << "Shutting down server";
+  if (requestCapture) {
+    // Writes out the sampled requests that are still queued.
+    requestCapture->stop();
+  }
   return 0;
 }
@@ -8,7 +8,12 @@
 
 #include "torchrec/inference/Batching.h" // @manual
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 #include <c10/core/ScalarType.h>
+#include <fmt/format.h>
 #include <folly/Range.h>
 #include <folly/container/Enumerate.h>
 #include <folly/io/Cursor.h>
@@ -20,6 +25,89 @@
 
 namespace torchrec {
 
+namespace {
+
+// Pinned memory needs a CUDA device, the combined tensors stay pageable on
+// hosts without one, e.g. when benchmarking the batching functions.
+bool pinCombined() {
+  static const bool pin = at::hasCUDA();
+  return pin;
+}
+
+// Convert the `n` values of type Src at `cursor` to `out`, an IOBuf of the
+// chain at a time, so that each value is converted while in cache.
+template <typename Src, typename Dst, typename Convert>
+void pullConverted(
+    folly::io::Cursor& cursor,
+    Dst* out,
+    size_t n,
+    Convert&& convert) {
+  while (n > 0) {
+    const auto bytes = cursor.peekBytes();
+    const size_t m = std::min(n, bytes.size() / sizeof(Src));
+    if (m == 0) {
+      // The value straddles two IOBufs of the chain.
+      *out++ = convert(cursor.read<Src>());
+      --n;
+      continue;
+    }
+    for (size_t i = 0; i < m; ++i) {
+      Src value;
+      std::memcpy(&value, bytes.data() + i * sizeof(Src), sizeof(Src));
+      out[i] = convert(value);
+    }
+    cursor.skip(m * sizeof(Src));
+    out += m;
+    n -= m;
+  }
+}
+
+// Pull `n` values of dtype `from` at `cursor` to `out` of dtype `to`.
+void pullAs(
+    folly::io::Cursor& cursor,
+    at::ScalarType from,
+    void* out,
+    at::ScalarType to,
+    size_t n) {
+  if (from == to) {
+    cursor.pull(out, n * c10::elementSize(from));
+  } else if (from == at::kFloat && to == at::kBFloat16) {
+    pullConverted<float>(
+        cursor, static_cast<c10::BFloat16*>(out), n, [](float value) {
+          return c10::BFloat16(value);
+        });
+  } else if (from == at::kFloat && to == at::kHalf) {
+    pullConverted<float>(
+        cursor, static_cast<c10::Half*>(out), n, [](float value) {
+          return c10::Half(value);
+        });
+  } else if (from == at::kInt && to == at::kLong) {
+    pullConverted<int32_t>(
+        cursor, static_cast<int64_t*>(out), n, [](int32_t value) {
+          return static_cast<int64_t>(value);
+        });
+  } else if (from == at::kLong && to == at::kInt) {
+    // Checked once per call, so that the loop has no branch.
+    bool overflow = false;
+    pullConverted<int64_t>(
+        cursor, static_cast<int32_t*>(out), n, [&](int64_t value) {
+          const auto narrowed = static_cast<int32_t>(value);
+          overflow |= narrowed != value;
+          return narrowed;
+        });
+    if (overflow) {
+      throw std::invalid_argument("Sparse ids overflow int32");
+    }
+  } else {
+    throw std::invalid_argument(fmt::format(
+        "Unsupported conversion from {} to {}",
+        c10::toString(from),
+        c10::toString(to)));
+  }
+}
+
+} // namespace
+
 void moveIValueToDevice(c10::IValue& val, const c10::Device& device) {
   if (val.isTensor()) {
     if (val.toTensor().device() != device) {
@@ -49,7 +137,8 @@ C10_DEFINE_REGISTRY(TorchRecBatchingFuncRegistry, BatchingFunc);
 
 std::unordered_map<std::string, c10::IValue> combineFloat(
     const std::string& featureName,
-    const std::vector<std::shared_ptr<PredictionRequest>>& requests) {
+    const std::vector<std::shared_ptr<PredictionRequest>>& requests,
+    at::ScalarType dtype) {
   // Compute combined batch size.
   long combinedBatchSize = 0;
   long numFeatures = 0;
@@ -89,18 +178,33 @@ std::unordered_map<std::string, c10::IValue> combineFloat(
   }
 
   if (numFeatures == 0) {
-    return {{featureName, at::empty({combinedBatchSize, 0})}};
+    return {{featureName, at::empty({combinedBatchSize, 0}, dtype)}};
   }
 
   if (maybeIValuePtr != nullptr) {
     combined = at::empty(
         {combinedBatchSize, numFeatures},
-        maybeIValuePtr->toTensor().options().pinned_memory(true));
+        maybeIValuePtr->toTensor().options().dtype(dtype).pinned_memory(
+            pinCombined()));
     at::cat_out(combined, tensors);
+  } else if (dtype != at::kFloat) {
+    combined = at::empty(
+        {combinedBatchSize, numFeatures},
+        at::TensorOptions(at::kCPU).dtype(dtype).pinned_memory(pinCombined()));
+    auto* out = static_cast<uint8_t*>(combined.data_ptr());
+    for (const auto& request : requests) {
+      const auto& feature =
+          std::get<torchrec::FloatFeatures>(request->features[featureName]);
+      const size_t n = feature.num_features * request->batch_size;
+      folly::io::Cursor cursor(&feature.values);
+      pullAs(cursor, at::kFloat, out, dtype, n);
+      out += n * combined.element_size();
+    }
   } else {
     // Create output tensor.
-    const auto options =
-        at::TensorOptions(at::kCPU).dtype(at::kFloat).pinned_memory(true);
+    const auto options = at::TensorOptions(at::kCPU)
+                             .dtype(at::kFloat)
+                             .pinned_memory(pinCombined());
     combined = at::empty({combinedBatchSize, numFeatures}, options);
 
     // Copy tensor data.
@@ -123,16 +227,21 @@ std::unordered_map<std::string, c10::IValue> combineFloat(
   return {{featureName, std::move(combined)}};
 }
 
-std::unordered_map<std::string, c10::IValue> combineSparse(
-    const std::string& featureName,
-    const std::vector<std::shared_ptr<PredictionRequest>>& requests,
-    bool isWeighted) {
-  // Compute combined batch size.
+namespace {
+
+// The sizes of the sparse features of a batch.
+struct SparseSizes {
   long combinedBatchSize = 0;
   long numFeatures = 0;
   long totalLength = 0;
   // request -> feature -> length of the feature
   std::vector<std::vector<long>> featureLengths;
+};
+
+SparseSizes sizeSparse(
+    const std::string& featureName,
+    const std::vector<std::shared_ptr<PredictionRequest>>& requests) {
+  SparseSizes sizes;
   for (const auto& request : requests) {
     const auto& features =
         std::get<torchrec::SparseFeatures>(request->features[featureName]);
@@ -140,16 +249,16 @@ std::unordered_map<std::string, c10::IValue> combineSparse(
     // validate num_features
     const auto nf = features.num_features;
     if (nf > 0) {
-      combinedBatchSize += request->batch_size;
-      if (numFeatures > 0) {
-        if (numFeatures != nf) {
+      sizes.combinedBatchSize += request->batch_size;
+      if (sizes.numFeatures > 0) {
+        if (sizes.numFeatures != nf) {
           throw std::invalid_argument("Different number of float features");
         }
       }
-      numFeatures = nf;
+      sizes.numFeatures = nf;
     }
 
-    featureLengths.emplace_back().reserve(nf);
+    sizes.featureLengths.emplace_back().reserve(nf);
     size_t requestLength = 0;
     folly::io::Cursor lengthsCursor(&features.lengths);
     for (int i = 0; i < features.num_features; ++i) {
@@ -157,21 +266,26 @@ std::unordered_map<std::string, c10::IValue> combineSparse(
       for (int j = 0; j < request->batch_size; ++j) {
         featureLength += lengthsCursor.read<int32_t>();
       }
-      featureLengths.back().push_back(featureLength);
+      sizes.featureLengths.back().push_back(featureLength);
       requestLength += featureLength;
     }
     CHECK(lengthsCursor.isAtEnd());
-    totalLength += requestLength;
+    sizes.totalLength += requestLength;
   }
+  return sizes;
+}
 
-  // Create output tensor.
-  const auto options = at::TensorOptions(at::kCPU).pinned_memory(true);
-  auto lengths =
-      at::empty({numFeatures * combinedBatchSize}, options.dtype(at::kInt));
-  auto values = at::empty({totalLength}, options.dtype(at::kInt));
-  auto weights =
-      at::empty({isWeighted ? totalLength : 0}, options.dtype(at::kFloat));
-
+// Copy the sparse features of the requests to the contiguous `lengths`,
+// `values` and, if `isWeighted`, `weights` of the batch.
+void copySparse(
+    const std::string& featureName,
+    const std::vector<std::shared_ptr<PredictionRequest>>& requests,
+    const SparseSizes& sizes,
+    bool isWeighted,
+    const SparseTypes& types,
+    at::Tensor& lengths,
+    at::Tensor& values,
+    at::Tensor& weights) {
   std::vector<folly::io::Cursor> lengthsCursors;
   std::vector<folly::io::Cursor> valuesCursor;
   std::vector<folly::io::Cursor> weightsCursor;
@@ -193,29 +307,67 @@ std::unordered_map<std::string, c10::IValue> combineSparse(
       reinterpret_cast<uint8_t*>(values.data_ptr()),
       values.numel() * values.dtype().itemsize());
   auto weightsRange = folly::MutableByteRange(
-      reinterpret_cast<uint8_t*>(weights.data_ptr()),
+      reinterpret_cast<uint8_t*>(isWeighted ? weights.data_ptr() : nullptr),
       isWeighted ? weights.numel() * weights.dtype().itemsize() : 0);
 
-  for (int i = 0; i < numFeatures; ++i) {
+  const auto& featureLengths = sizes.featureLengths;
+  for (int i = 0; i < sizes.numFeatures; ++i) {
     for (int j = 0; j < requests.size(); ++j) {
       const auto& request = requests[j];
 
-      // TODO: determine values elem size by value_type.
       size_t len = request->batch_size * sizeof(int32_t);
       lengthsCursors[j].pull(lengthsRange.data(), len);
       lengthsRange.advance(len);
 
-      len = featureLengths[j][i] * sizeof(int32_t);
-      valuesCursor[j].pull(valuesRange.data(), len);
-      valuesRange.advance(len);
+      pullAs(
+          valuesCursor[j],
+          types.requestValues,
+          valuesRange.data(),
+          types.values,
+          featureLengths[j][i]);
+      valuesRange.advance(featureLengths[j][i] * values.element_size());
 
       if (isWeighted) {
-        len = featureLengths[j][i] * sizeof(float);
-        weightsCursor[j].pull(weightsRange.data(), len);
-        weightsRange.advance(len);
+        pullAs(
+            weightsCursor[j],
+            at::kFloat,
+            weightsRange.data(),
+            types.weights,
+            featureLengths[j][i]);
+        weightsRange.advance(featureLengths[j][i] * weights.element_size());
       }
     }
   }
+}
+
+} // namespace
+
+std::unordered_map<std::string, c10::IValue> combineSparse(
+    const std::string& featureName,
+    const std::vector<std::shared_ptr<PredictionRequest>>& requests,
+    bool isWeighted,
+    const SparseTypes& types) {
+  // Compute combined batch size.
+  const auto sizes = sizeSparse(featureName, requests);
+
+  // Create output tensor.
+  const auto options =
+      at::TensorOptions(at::kCPU).pinned_memory(pinCombined());
+  auto lengths = at::empty(
+      {sizes.numFeatures * sizes.combinedBatchSize}, options.dtype(at::kInt));
+  auto values = at::empty({sizes.totalLength}, options.dtype(types.values));
+  auto weights = at::empty(
+      {isWeighted ? sizes.totalLength : 0}, options.dtype(types.weights));
+
+  copySparse(
+      featureName,
+      requests,
+      sizes,
+      isWeighted,
+      types,
+      lengths,
+      values,
+      weights);
 
   std::unordered_map<std::string, c10::IValue> ret = {
       {featureName + ".values", std::move(values)},
@@ -227,6 +379,94 @@ std::unordered_map<std::string, c10::IValue> combineSparse(
   return ret;
 }
 
+FusedKeyedJaggedTensor combineSparseKJT(
+    const std::string& featureName,
+    const std::vector<std::shared_ptr<PredictionRequest>>& requests,
+    bool isWeighted,
+    const SparseTypes& types) {
+  const auto sizes = sizeSparse(featureName, requests);
+  const long numLengths = sizes.numFeatures * sizes.combinedBatchSize;
+  if (sizes.totalLength > std::numeric_limits<int32_t>::max()) {
+    throw std::invalid_argument("Too many sparse ids for int32 offsets");
+  }
+
+  // Lay the tensors out in the buffer, each aligned for any dtype.
+  constexpr size_t kAlignment = 64;
+  size_t bufferSize = 0;
+  auto place = [&](size_t numel, at::ScalarType dtype) {
+    const auto offset = bufferSize;
+    const auto nbytes = numel * c10::elementSize(dtype);
+    bufferSize += (nbytes + kAlignment - 1) / kAlignment * kAlignment;
+    return std::make_pair(offset, nbytes);
+  };
+  const auto lengthsPlace = place(numLengths, at::kInt);
+  const auto offsetsPlace = place(numLengths + 1, at::kInt);
+  const auto valuesPlace = place(sizes.totalLength, types.values);
+  const auto weightsPlace =
+      place(isWeighted ? sizes.totalLength : 0, types.weights);
+
+  FusedKeyedJaggedTensor fused;
+  fused.buffer = at::empty(
+      {static_cast<int64_t>(bufferSize)},
+      at::TensorOptions(at::kCPU).dtype(at::kByte).pinned_memory(
+          pinCombined()));
+  auto view = [&](std::pair<size_t, size_t> span, at::ScalarType dtype) {
+    return fused.buffer.slice(0, span.first, span.first + span.second)
+        .view(dtype);
+  };
+  fused.kjt.lengths = view(lengthsPlace, at::kInt);
+  fused.kjt.values = view(valuesPlace, types.values);
+  if (isWeighted) {
+    fused.kjt.weights = view(weightsPlace, types.weights);
+  }
+  fused.offsets = view(offsetsPlace, at::kInt);
+  fused.stride = sizes.combinedBatchSize;
+
+  copySparse(
+      featureName,
+      requests,
+      sizes,
+      isWeighted,
+      types,
+      fused.kjt.lengths,
+      fused.kjt.values,
+      fused.kjt.weights);
+
+  const auto* lengths = fused.kjt.lengths.data_ptr<int32_t>();
+  auto* offsets = fused.offsets.data_ptr<int32_t>();
+  offsets[0] = 0;
+  for (long i = 0; i < numLengths; ++i) {
+    offsets[i + 1] = offsets[i] + lengths[i];
+  }
+  return fused;
+}
+
+FusedKeyedJaggedTensor moveToDevice(
+    const FusedKeyedJaggedTensor& fused,
+    const c10::Device& device) {
+  if (fused.buffer.device() == device) {
+    return fused;
+  }
+  FusedKeyedJaggedTensor moved;
+  moved.buffer = fused.buffer.to(device, /* non_blocking */ true);
+  // The same view of the moved buffer.
+  auto rebase = [&](const at::Tensor& view) {
+    if (!view.defined()) {
+      return at::Tensor();
+    }
+    const auto offset = view.storage_offset() * view.element_size();
+    return moved.buffer.slice(0, offset, offset + view.nbytes())
+        .view(view.scalar_type());
+  };
+  moved.kjt.keys = fused.kjt.keys;
+  moved.kjt.lengths = rebase(fused.kjt.lengths);
+  moved.kjt.values = rebase(fused.kjt.values);
+  moved.kjt.weights = rebase(fused.kjt.weights);
+  moved.offsets = rebase(fused.offsets);
+  moved.stride = fused.stride;
+  return moved;
+}
+
 std::unordered_map<std::string, c10::IValue> combineEmbedding(
     const std::string& featureName,
     const std::vector<std::shared_ptr<PredictionRequest>>& requests) {
@@ -314,8 +554,9 @@ std::unordered_map<std::string, c10::IValue> combineEmbedding(
   }
 
   // Create output tensor.
-  const auto options =
-      at::TensorOptions(at::kCPU).dtype(at::kFloat).pinned_memory(true);
+  const auto options = at::TensorOptions(at::kCPU)
+                           .dtype(at::kFloat)
+                           .pinned_memory(pinCombined());
   auto combined =
       at::empty({combinedBatchSize, numFeatures, dimension}, options);
 
@@ -392,9 +633,112 @@ class EmbeddingBatchingFunc : public BatchingFunc {
   }
 };
 
+// Batches the float features as `kDtype`, halving the bytes to transfer for
+// the models consuming bf16 or fp16.
+template <at::ScalarType kDtype>
+class ConvertingFloatBatchingFunc : public BatchingFunc {
+ public:
+  std::unordered_map<std::string, c10::IValue> batch(
+      const std::string& featureName,
+      const std::vector<std::shared_ptr<PredictionRequest>>& requests,
+      const int64_t& /* totalNumBatch */,
+      LazyTensorRef /* batchOffsets */,
+      const c10::Device& device,
+      LazyTensorRef /* batchItems */) override {
+    return moveToDevice(combineFloat(featureName, requests, kDtype), device);
+  }
+};
+
+// Batches the sparse features of requests with `kRequestValues` ids into
+// `kValues` ids and, if `kIsWeighted`, `kWeights` weights.
+template <
+    bool kIsWeighted,
+    at::ScalarType kRequestValues,
+    at::ScalarType kValues,
+    at::ScalarType kWeights = at::kFloat>
+class ConvertingSparseBatchingFunc : public BatchingFunc {
+ public:
+  std::unordered_map<std::string, c10::IValue> batch(
+      const std::string& featureName,
+      const std::vector<std::shared_ptr<PredictionRequest>>& requests,
+      const int64_t& /* totalNumBatch */,
+      LazyTensorRef /* batchOffsets */,
+      const c10::Device& device,
+      LazyTensorRef /* batchItems */) override {
+    return moveToDevice(
+        combineSparse(
+            featureName,
+            requests,
+            kIsWeighted,
+            SparseTypes{
+                .requestValues = kRequestValues,
+                .values = kValues,
+                .weights = kWeights,
+            }),
+        device);
+  }
+};
+
+// Batches the sparse features as the tensors of a KeyedJaggedTensor in one
+// buffer, moved to the device with a single copy. The model builds the
+// KeyedJaggedTensor from `.values`, `.lengths`, `.weights`, `.offsets` and
+// `.stride` with its own keys.
+template <bool kIsWeighted>
+class KJTBatchingFunc : public BatchingFunc {
+ public:
+  std::unordered_map<std::string, c10::IValue> batch(
+      const std::string& featureName,
+      const std::vector<std::shared_ptr<PredictionRequest>>& requests,
+      const int64_t& /* totalNumBatch */,
+      LazyTensorRef /* batchOffsets */,
+      const c10::Device& device,
+      LazyTensorRef /* batchItems */) override {
+    auto fused = moveToDevice(
+        combineSparseKJT(featureName, requests, kIsWeighted), device);
+    std::unordered_map<std::string, c10::IValue> ret = {
+        {featureName + ".values", std::move(fused.kjt.values)},
+        {featureName + ".lengths", std::move(fused.kjt.lengths)},
+        {featureName + ".offsets", std::move(fused.offsets)},
+        {featureName + ".stride", fused.stride},
+    };
+    if (kIsWeighted) {
+      ret[featureName + ".weights"] = std::move(fused.kjt.weights);
+    }
+    return ret;
+  }
+};
+
 REGISTER_TORCHREC_BATCHING_FUNC(dense, FloatBatchingFunc);
 REGISTER_TORCHREC_BATCHING_FUNC(sparse, SparseBatchingFunc);
 REGISTER_TORCHREC_BATCHING_FUNC(weighted_sparse, WeightedSparseBatchingFunc);
 REGISTER_TORCHREC_BATCHING_FUNC(embedding, EmbeddingBatchingFunc);
 
+REGISTER_TORCHREC_BATCHING_FUNC(
+    dense_bf16,
+    ConvertingFloatBatchingFunc<at::kBFloat16>);
+REGISTER_TORCHREC_BATCHING_FUNC(
+    dense_fp16,
+    ConvertingFloatBatchingFunc<at::kHalf>);
+// int32 ids widened to int64.
+REGISTER_TORCHREC_BATCHING_FUNC(
+    sparse_int64,
+    ConvertingSparseBatchingFunc<false, at::kInt, at::kLong>);
+REGISTER_TORCHREC_BATCHING_FUNC(
+    weighted_sparse_int64,
+    ConvertingSparseBatchingFunc<true, at::kInt, at::kLong>);
+// int32 ids with bf16 weights.
+REGISTER_TORCHREC_BATCHING_FUNC(
+    weighted_sparse_bf16,
+    ConvertingSparseBatchingFunc<true, at::kInt, at::kInt, at::kBFloat16>);
+// int64 ids in the requests, narrowed to int32.
+REGISTER_TORCHREC_BATCHING_FUNC(
+    int64_sparse,
+    ConvertingSparseBatchingFunc<false, at::kLong, at::kInt>);
+REGISTER_TORCHREC_BATCHING_FUNC(
+    int64_weighted_sparse,
+    ConvertingSparseBatchingFunc<true, at::kLong, at::kInt>);
+
+REGISTER_TORCHREC_BATCHING_FUNC(kjt, KJTBatchingFunc<false>);
+REGISTER_TORCHREC_BATCHING_FUNC(weighted_kjt, KJTBatchingFunc<true>);
+
 } // namespace torchrec
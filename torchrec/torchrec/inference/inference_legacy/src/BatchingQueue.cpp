@@ -93,6 +93,9 @@ void BatchingQueue::add(
     folly::Promise<std::unique_ptr<PredictionResponse>> promise) {
   CHECK_GT(request->batch_size, 0);
   const auto addedTime = std::chrono::steady_clock::now();
+  if (config_.requestCapture != nullptr) {
+    config_.requestCapture->maybeRecord(request, addedTime);
+  }
   requestQueue_.withWLock([request = std::move(request),
                            promise = std::move(promise),
                            addedTime = addedTime](auto& queue) mutable {
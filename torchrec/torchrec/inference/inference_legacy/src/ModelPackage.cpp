@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "torchrec/inference/ModelPackage.h"
+
+#include <folly/json/json.h>
+#include <glog/logging.h>
+
+// remove this after we switch over to multipy externally for torchrec
+#ifdef FBCODE_CAFFE2
+#include <multipy/runtime/path_environment.h>
+#else
+#include <torch/csrc/deploy/path_environment.h>
+#endif
+
+#include <torch/torch.h>
+
+#include "torchrec/inference/ResultSplit.h"
+
+namespace torchrec {
+
+ModelPackage loadModelPackage(const ModelPackageConfig& config) {
+  ModelPackage model;
+
+  std::shared_ptr<torch::deploy::Environment> env =
+      std::make_shared<torch::deploy::PathEnvironment>(
+          config.pythonPackagesPath);
+
+  model.manager = std::make_shared<torch::deploy::InterpreterManager>(
+      config.nGpu * config.nInterpPerGpu, env);
+
+  torch::deploy::Package package =
+      model.manager->loadPackage(config.packagePath);
+  auto I = package.acquireSession();
+  auto imported = I.self.attr("import_module")({"__module_loader"});
+  auto factoryType = imported.attr("MODULE_FACTORY");
+  auto factory = factoryType.attr("__new__")({factoryType});
+  factoryType.attr("__init__")({factory});
+
+  // Process forward metadata.
+  try {
+    auto batchingMetadataJsonStr =
+        factory.attr("batching_metadata_json")(at::ArrayRef<at::IValue>())
+            .toIValue()
+            .toString()
+            ->string();
+    auto dynamic = folly::parseJson(batchingMetadataJsonStr);
+    CHECK(dynamic.isObject());
+    for (auto it : dynamic.items()) {
+      BatchingMetadata metadata;
+      metadata.type = it.second["type"].asString();
+      metadata.device = it.second["device"].asString();
+      model.batchingMetadata[it.first.asString()] = std::move(metadata);
+    }
+  } catch (...) {
+    auto batchingMetadata =
+        factory.attr("batching_metadata")(at::ArrayRef<at::IValue>())
+            .toIValue();
+    for (const auto& iter : batchingMetadata.toGenericDict()) {
+      BatchingMetadata metadata;
+      metadata.type = iter.value().toStringRef();
+      metadata.device = "cuda";
+      model.batchingMetadata[iter.key().toStringRef()] = std::move(metadata);
+    }
+  }
+
+  // Process result metadata.
+  auto resultMetadata =
+      factory.attr("result_metadata")(at::ArrayRef<at::IValue>())
+          .toIValue()
+          .toStringRef();
+  std::shared_ptr<ResultSplitFunc> resultSplitFunc =
+      TorchRecResultSplitFuncRegistry()->Create(resultMetadata);
+
+  LOG(INFO) << "Creating Model Shard for " << config.nGpu << " GPUs.";
+  auto dmp = factory.attr("create_predict_module")
+                 .callKwargs({{"world_size", config.nGpu}});
+
+  for (int rank = 0; rank < config.nGpu; rank++) {
+    auto device = I.self.attr("import_module")({"torch"}).attr("device")(
+        {"cuda", rank});
+    auto m = dmp.attr("copy")({device.toIValue()});
+    model.executors.push_back(std::make_unique<GPUExecutor>(
+        model.manager,
+        I.createMovable(m),
+        rank,
+        config.nGpu,
+        resultSplitFunc,
+        config.gpuExecutorQueueTimeout,
+        config.observer));
+    // The executor does not move when the model does.
+    model.batchQueueCbs.push_back(
+        [executor = model.executors.back().get()](
+            std::shared_ptr<PredictionBatch> batch) {
+          executor->callback(std::move(batch));
+        });
+  }
+  return model;
+}
+
+} // namespace torchrec
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "torchrec/inference/RequestCapture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <folly/Random.h>
+#include <folly/system/ThreadName.h>
+#include <glog/logging.h>
+#include <torch/csrc/jit/serialization/pickle.h> // @manual
+
+using namespace std::chrono_literals;
+
+namespace torchrec {
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'R', 'C', 'A', 'P', 'L', 'O', 'G'};
+constexpr uint32_t kVersion = 1;
+
+enum class FeatureKind : uint8_t {
+  kSparse = 0,
+  kFloat = 1,
+  kIValue = 2,
+};
+
+template <typename T>
+void writePod(std::ostream& out, T value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void writeBuffer(std::ostream& out, const folly::IOBuf& buf) {
+  writePod<uint64_t>(out, buf.computeChainDataLength());
+  for (auto range : buf) {
+    out.write(reinterpret_cast<const char*>(range.data()), range.size());
+  }
+}
+
+void writeBuffer(std::ostream& out, const std::vector<char>& buf) {
+  writePod<uint64_t>(out, buf.size());
+  out.write(buf.data(), buf.size());
+}
+
+// The log ended in the middle of a record.
+class TruncatedCapture : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+class Reader {
+ public:
+  explicit Reader(const std::string& path)
+      : path_(path), in_(path, std::ios::binary) {
+    if (!in_) {
+      throw std::runtime_error(
+          fmt::format("Can not open request capture {}", path_));
+    }
+  }
+
+  // Only expected between two records.
+  bool atEnd() {
+    return in_.peek() == std::char_traits<char>::eof();
+  }
+
+  template <typename T>
+  T readPod() {
+    T value;
+    readBytes(reinterpret_cast<char*>(&value), sizeof(T));
+    return value;
+  }
+
+  void readBytes(char* data, size_t size) {
+    if (!in_.read(data, size)) {
+      throw TruncatedCapture(
+          fmt::format("Truncated request capture {}", path_));
+    }
+  }
+
+  folly::IOBuf readIOBuf() {
+    auto size = readPod<uint64_t>();
+    folly::IOBuf buf(folly::IOBuf::CREATE, size);
+    readBytes(reinterpret_cast<char*>(buf.writableData()), size);
+    buf.append(size);
+    return buf;
+  }
+
+  std::vector<char> readVector() {
+    std::vector<char> buf(readPod<uint64_t>());
+    readBytes(buf.data(), buf.size());
+    return buf;
+  }
+
+  const std::string& path() const {
+    return path_;
+  }
+
+ private:
+  const std::string path_;
+  std::ifstream in_;
+};
+
+CapturedRequest readRecord(Reader& reader) {
+  CapturedRequest entry;
+  entry.arrival = std::chrono::nanoseconds(reader.readPod<uint64_t>());
+  entry.request = std::make_shared<PredictionRequest>();
+  entry.request->batch_size = reader.readPod<uint32_t>();
+  const auto numEntries = reader.readPod<uint32_t>();
+  for (uint32_t i = 0; i < numEntries; ++i) {
+    std::string name(reader.readPod<uint16_t>(), '\0');
+    reader.readBytes(name.data(), name.size());
+    switch (reader.readPod<FeatureKind>()) {
+      case FeatureKind::kSparse: {
+        SparseFeatures sparse;
+        sparse.num_features = reader.readPod<uint32_t>();
+        sparse.lengths = reader.readIOBuf();
+        sparse.values = reader.readIOBuf();
+        sparse.weights = reader.readIOBuf();
+        entry.request->features[name] = std::move(sparse);
+        break;
+      }
+      case FeatureKind::kFloat: {
+        FloatFeatures dense;
+        dense.num_features = reader.readPod<uint32_t>();
+        dense.values = reader.readIOBuf();
+        entry.request->features[name] = std::move(dense);
+        break;
+      }
+      case FeatureKind::kIValue:
+        entry.request->features[name] =
+            torch::jit::pickle_load(reader.readVector());
+        break;
+      default:
+        throw std::runtime_error(fmt::format(
+            "Unknown feature kind for {} in {}", name, reader.path()));
+    }
+  }
+  return entry;
+}
+
+} // namespace
+
+RequestCapture::RequestCapture(Config config)
+    : config_(std::move(config)),
+      startTime_(std::chrono::steady_clock::now()),
+      outBuffer_(1 << 20),
+      queue_(config_.queueCapacity),
+      stopping_(false),
+      recorded_(0),
+      dropped_(0) {
+  CHECK(config_.sampleRate >= 0.0 && config_.sampleRate <= 1.0);
+  out_.rdbuf()->pubsetbuf(outBuffer_.data(), outBuffer_.size());
+  out_.open(config_.path, std::ios::binary | std::ios::trunc);
+  if (!out_) {
+    throw std::runtime_error(
+        fmt::format("Can not open request capture {}", config_.path));
+  }
+  out_.write(kMagic, sizeof(kMagic));
+  writePod(out_, kVersion);
+  out_.flush();
+  writerThread_ = std::thread([&] {
+    folly::setThreadName("RequestCapture");
+    write();
+  });
+}
+
+void RequestCapture::maybeRecord(
+    const std::shared_ptr<PredictionRequest>& request,
+    std::chrono::steady_clock::time_point addedTime) {
+  if (stopping_) {
+    return;
+  }
+  if (config_.sampleRate < 1.0 &&
+      folly::Random::randDouble01() >= config_.sampleRate) {
+    return;
+  }
+  // The batching functions only read the request, so it is shared with the
+  // writer thread instead of copied.
+  if (!queue_.write(Entry{request, addedTime})) {
+    ++dropped_;
+  }
+}
+
+void RequestCapture::stop() {
+  if (stopping_.exchange(true)) {
+    return;
+  }
+  writerThread_.join();
+  out_.close();
+  LOG(INFO) << "Captured " << recorded_.load() << " requests to "
+            << config_.path << ", dropped " << dropped_.load();
+}
+
+void RequestCapture::write() {
+  Entry entry;
+  auto lastFlush = std::chrono::steady_clock::now();
+  while (!stopping_ || !queue_.isEmpty()) {
+    if (queue_.tryReadUntil(std::chrono::steady_clock::now() + 10ms, entry)) {
+      writeRequest(entry);
+      entry.request.reset();
+      ++recorded_;
+    }
+    // Bounds what is lost, and what a reader sees cut, if the server is
+    // killed without stopping the capture.
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastFlush >= config_.flushInterval) {
+      out_.flush();
+      lastFlush = now;
+    }
+  }
+  out_.flush();
+}
+
+void RequestCapture::writeRequest(const Entry& entry) {
+  const auto arrival = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      entry.addedTime - startTime_);
+  const auto& request = *entry.request;
+  writePod<uint64_t>(out_, std::max<int64_t>(arrival.count(), 0));
+  writePod<uint32_t>(out_, request.batch_size);
+  writePod<uint32_t>(out_, request.features.size());
+  for (const auto& [name, feature] : request.features) {
+    writePod<uint16_t>(out_, name.size());
+    out_.write(name.data(), name.size());
+    if (const auto* sparse = std::get_if<SparseFeatures>(&feature)) {
+      writePod(out_, FeatureKind::kSparse);
+      writePod<uint32_t>(out_, sparse->num_features);
+      writeBuffer(out_, sparse->lengths);
+      writeBuffer(out_, sparse->values);
+      writeBuffer(out_, sparse->weights);
+    } else if (const auto* dense = std::get_if<FloatFeatures>(&feature)) {
+      writePod(out_, FeatureKind::kFloat);
+      writePod<uint32_t>(out_, dense->num_features);
+      writeBuffer(out_, dense->values);
+    } else {
+      writePod(out_, FeatureKind::kIValue);
+      writeBuffer(
+          out_, torch::jit::pickle_save(std::get<c10::IValue>(feature)));
+    }
+  }
+}
+
+RequestCapture::~RequestCapture() {
+  stop();
+}
+
+std::vector<CapturedRequest> readRequestCapture(const std::string& path) {
+  Reader reader(path);
+  char magic[sizeof(kMagic)];
+  reader.readBytes(magic, sizeof(magic));
+  if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+    throw std::runtime_error(
+        fmt::format("{} is not a request capture", reader.path()));
+  }
+  const auto version = reader.readPod<uint32_t>();
+  if (version != kVersion) {
+    throw std::runtime_error(fmt::format(
+        "Unsupported request capture version {} in {}",
+        version,
+        reader.path()));
+  }
+
+  std::vector<CapturedRequest> captured;
+  while (!reader.atEnd()) {
+    try {
+      captured.push_back(readRecord(reader));
+    } catch (const TruncatedCapture&) {
+      // Expected when the server was killed while writing a record.
+      LOG(WARNING) << "Ignoring the truncated last record of "
+                   << reader.path();
+      break;
+    }
+  }
+
+  // Requests added concurrently can reach the writer slightly out of order.
+  std::stable_sort(
+      captured.begin(),
+      captured.end(),
+      [](const CapturedRequest& lhs, const CapturedRequest& rhs) {
+        return lhs.arrival < rhs.arrival;
+      });
+  return captured;
+}
+
+} // namespace torchrec
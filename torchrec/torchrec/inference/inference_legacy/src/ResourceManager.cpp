@@ -13,6 +13,7 @@
 
 #include <folly/Random.h>
 #include <folly/String.h>
+#include <folly/futures/Future.h>
 #include <folly/small_vector.h>
 #include <glog/logging.h>
 
@@ -27,82 +28,160 @@ ResourceManager::ResourceManager(
     std::unique_ptr<IResourceManagerObserver> observer)
     : gpuToOutstandingBatches_(worldSize),
       allTimeHigh_(worldSize),
+      waiters_(worldSize),
       maxOutstandingBatches_(maxOutstandingBatches),
       logFrequency_(logFrequency),
       observer_(std::move(observer)) {
   CHECK(observer_ != nullptr);
 }
 
+ResourceManager::~ResourceManager() {
+  std::vector<std::shared_ptr<Waiter>> waiters;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (auto& queue : waiters_) {
+      waiters.insert(waiters.end(), queue.begin(), queue.end());
+      queue.clear();
+    }
+  }
+  for (auto& waiter : waiters) {
+    if (!waiter->claimed.exchange(true)) {
+      waiter->timeout.cancel();
+      waiter->promise.setValue(false);
+    }
+  }
+}
+
 bool ResourceManager::occupyDevice(
     int gpuIdx,
     std::chrono::milliseconds slack) {
   const auto startTime = std::chrono::steady_clock::now();
-  std::chrono::milliseconds waitedFor = std::chrono::milliseconds(0);
-
-  // Exit loop once time expires or device selected.
-  while (true) {
-    {
-      // With lock, try to get device.
-      std::lock_guard<std::mutex> lock(mu_);
-      if (gpuToOutstandingBatches_[gpuIdx] < maxOutstandingBatches_) {
-        // Pick GPU and update stats.
-        LOG_EVERY_N(INFO, logFrequency_)
-            << "Picked device " << gpuIdx << ", with load "
-            << gpuToOutstandingBatches_[gpuIdx]
-            << " -- gpuToOutstandingBatches_ list <"
-            << folly::join(",", gpuToOutstandingBatches_) << ">. "
-            << " -- all time highs: <" << folly::join(",", allTimeHigh_)
-            << ">. " << "Waited: " << waitedFor.count()
-            << " ms. Slack: " << slack.count() << " ms.";
-
-        gpuToOutstandingBatches_[gpuIdx] += 1;
-        observer_->recordAllStats(
-            gpuToOutstandingBatches_[gpuIdx],
-            allTimeHigh_[gpuIdx],
-            waitedFor.count(),
-            gpuIdx);
-
-        if (gpuToOutstandingBatches_[gpuIdx] > allTimeHigh_[gpuIdx]) {
-          allTimeHigh_[gpuIdx] = gpuToOutstandingBatches_[gpuIdx];
-        }
-
-        // Successfully grabbed a GPU slot.
-        return true;
-      }
+  if (std::move(occupyDeviceAsync(gpuIdx, slack)).get()) {
+    return true;
+  }
+  const auto waitedFor = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  std::lock_guard<std::mutex> lock(mu_);
+  observer_->recordAllStats(
+      gpuToOutstandingBatches_[gpuIdx],
+      allTimeHigh_[gpuIdx],
+      waitedFor.count(),
+      gpuIdx);
+  return false;
+}
+
+void ResourceManager::occupyLocked(
+    int gpuIdx,
+    std::chrono::milliseconds waitedFor) {
+  LOG_EVERY_N(INFO, logFrequency_)
+      << "Picked device " << gpuIdx << ", with load "
+      << gpuToOutstandingBatches_[gpuIdx]
+      << " -- gpuToOutstandingBatches_ list <"
+      << folly::join(",", gpuToOutstandingBatches_) << ">. "
+      << " -- all time highs: <" << folly::join(",", allTimeHigh_) << ">. "
+      << "Waited: " << waitedFor.count() << " ms.";
+
+  gpuToOutstandingBatches_[gpuIdx] += 1;
+  observer_->recordAllStats(
+      gpuToOutstandingBatches_[gpuIdx],
+      allTimeHigh_[gpuIdx],
+      waitedFor.count(),
+      gpuIdx);
+
+  if (gpuToOutstandingBatches_[gpuIdx] > allTimeHigh_[gpuIdx]) {
+    allTimeHigh_[gpuIdx] = gpuToOutstandingBatches_[gpuIdx];
+  }
+}
+
+folly::SemiFuture<bool> ResourceManager::occupyDeviceAsync(
+    int gpuIdx,
+    std::chrono::milliseconds slack) {
+  auto waiter = std::make_shared<Waiter>();
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    // Slots are handed to the waiters on release, so a free slot means that
+    // none is waiting.
+    if (gpuToOutstandingBatches_[gpuIdx] < maxOutstandingBatches_) {
+      occupyLocked(gpuIdx, std::chrono::milliseconds(0));
+      return folly::makeSemiFuture(true);
     }
-    // GPU has too many outstanding batches;
-    // Sleep & wait before retrying to get a slot in GPU.
+    if (slack.count() <= 0) {
+      return folly::makeSemiFuture(false);
+    }
+
     LOG_EVERY_N(WARNING, logFrequency_)
         << "maxOutstandingBatches_ reached for device " << gpuIdx
-        << "! Waiting for " << waitedFor.count() << " ms... "
+        << "! Waiting up to " << slack.count() << " ms... "
         << "Current gpuToOutstandingBatches <"
         << folly::join(",", gpuToOutstandingBatches_) << ">.";
 
-    // Sleep to avoid busy waiting
-    /* sleep override */
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
-
-    waitedFor = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::steady_clock::now() - startTime);
-    if (waitedFor >= slack) {
-      observer_->recordAllStats(
-          gpuToOutstandingBatches_[gpuIdx],
-          allTimeHigh_[gpuIdx],
-          waitedFor.count(),
-          gpuIdx);
-      // We have used up all the slack -- requests should time out.
-      LOG(WARNING) << "Timing out a batch of requests after slack of "
-                   << slack.count() << " ms was exceeded!";
-      return false;
+    auto& queue = waiters_[gpuIdx];
+    while (!queue.empty() && queue.front()->claimed.load()) {
+      queue.pop_front();
     }
+    waiter->enqueueTime = std::chrono::steady_clock::now();
+    queue.push_back(waiter);
+    // The timeout only touches the waiter, which may outlive this. It keeps
+    // the waiter alive until it fires or is cancelled.
+    waiter->timeout = folly::futures::sleep(slack).toUnsafeFuture().thenValue(
+        [waiter, slack](folly::Unit) {
+          if (!waiter->claimed.exchange(true)) {
+            // We have used up all the slack -- requests should time out.
+            LOG(WARNING) << "Timing out a batch of requests after slack of "
+                         << slack.count() << " ms was exceeded!";
+            waiter->promise.setValue(false);
+          }
+        });
   }
+  return waiter->promise.getSemiFuture();
 }
 
-void ResourceManager::release(int gpuIdx) {
+std::optional<int> ResourceManager::tryOccupyAnyDevice() {
   std::lock_guard<std::mutex> lock(mu_);
-  gpuToOutstandingBatches_[gpuIdx] -= 1;
-  observer_->addOutstandingRequestsCount(
-      gpuToOutstandingBatches_[gpuIdx], gpuIdx);
+  std::optional<int> picked;
+  for (int gpuIdx = 0; gpuIdx < gpuToOutstandingBatches_.size(); ++gpuIdx) {
+    if (gpuToOutstandingBatches_[gpuIdx] < maxOutstandingBatches_ &&
+        (!picked.has_value() ||
+         gpuToOutstandingBatches_[gpuIdx] <
+             gpuToOutstandingBatches_[*picked])) {
+      picked = gpuIdx;
+    }
+  }
+  if (picked.has_value()) {
+    occupyLocked(*picked, std::chrono::milliseconds(0));
+  }
+  return picked;
+}
+
+void ResourceManager::release(int gpuIdx) {
+  std::shared_ptr<Waiter> next;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto& queue = waiters_[gpuIdx];
+    while (!queue.empty()) {
+      auto waiter = std::move(queue.front());
+      queue.pop_front();
+      if (!waiter->claimed.exchange(true)) {
+        next = std::move(waiter);
+        break;
+      }
+    }
+    gpuToOutstandingBatches_[gpuIdx] -= 1;
+    if (next != nullptr) {
+      // Hand the slot over to the earliest waiter.
+      occupyLocked(
+          gpuIdx,
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::steady_clock::now() - next->enqueueTime));
+    } else {
+      observer_->addOutstandingRequestsCount(
+          gpuToOutstandingBatches_[gpuIdx], gpuIdx);
+    }
+  }
+  if (next != nullptr) {
+    next->timeout.cancel();
+    next->promise.setValue(true);
+  }
 }
 
 } // namespace torchrec
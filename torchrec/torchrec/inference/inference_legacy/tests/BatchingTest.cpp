@@ -111,4 +111,108 @@ TEST(BatchingTest, DenseCombineTest) {
   checkTensor<float>(flatten, expectResult);
 }
 
+TEST(BatchingTest, SparseCombineConvertTest) {
+  const auto jagged0 = createJaggedTensor({{0, 1}, {2}});
+  const auto jagged1 = createJaggedTensor({{}, {3}});
+
+  auto request0 = createRequest(1, 2, jagged0);
+  auto request1 = createRequest(1, 2, jagged1);
+
+  auto batched = combineSparse(
+      "id_score_list_features",
+      {request0, request1},
+      true,
+      SparseTypes{.values = at::kLong, .weights = at::kBFloat16});
+
+  auto values = batched["id_score_list_features.values"].toTensor();
+  auto weights = batched["id_score_list_features.weights"].toTensor();
+  EXPECT_EQ(values.scalar_type(), at::kLong);
+  EXPECT_EQ(weights.scalar_type(), at::kBFloat16);
+  checkTensor<int64_t>(values, {0, 1, 2, 3});
+  checkTensor<float>(weights.to(at::kFloat), {1.0f, 1.0f, 1.0f, 1.0f});
+  checkTensor<int32_t>(
+      batched["id_score_list_features.lengths"].toTensor(), {2, 0, 1, 1});
+
+  // Unweighted batching drops the weights.
+  batched = combineSparse(
+      "id_score_list_features",
+      {request0, request1},
+      false,
+      SparseTypes{.values = at::kLong});
+  EXPECT_EQ(batched.count("id_score_list_features.weights"), 0);
+}
+
+TEST(BatchingTest, SparseCombineNarrowTest) {
+  auto jagged = createJaggedTensor({{0, 1}, {2}});
+  jagged.values = at::tensor({0L, 1L, 2L}, at::kLong);
+  auto request = createRequest(1, 2, jagged);
+
+  auto batched = combineSparse(
+      "id_score_list_features",
+      {request},
+      false,
+      SparseTypes{.requestValues = at::kLong});
+  checkTensor<int32_t>(
+      batched["id_score_list_features.values"].toTensor(), {0, 1, 2});
+
+  jagged.values = at::tensor({0L, 1L, int64_t(1) << 40}, at::kLong);
+  request = createRequest(1, 2, jagged);
+  EXPECT_THROW(
+      combineSparse(
+          "id_score_list_features",
+          {request},
+          false,
+          SparseTypes{.requestValues = at::kLong}),
+      std::invalid_argument);
+}
+
+TEST(BatchingTest, DenseCombineConvertTest) {
+  auto tensor0 =
+      at::tensor({1.1, 2.0, 0.3, 1.2}, at::TensorOptions().dtype(c10::kFloat))
+          .reshape({2, 2});
+  auto tensor1 = at::tensor({0.9, 2.3}, at::TensorOptions().dtype(c10::kFloat))
+                     .reshape({1, 2});
+
+  auto request0 = createRequest(tensor0);
+  auto request1 = createRequest(tensor1);
+
+  for (auto dtype : {at::kBFloat16, at::kHalf}) {
+    auto expected = at::cat({tensor0, tensor1}).to(dtype);
+    for (const auto* name : {"io_buf", "ivalue"}) {
+      auto batched = combineFloat(name, {request0, request1}, dtype)[name];
+      EXPECT_EQ(batched.toTensor().scalar_type(), dtype);
+      EXPECT_TRUE(at::equal(batched.toTensor(), expected));
+    }
+  }
+}
+
+TEST(BatchingTest, SparseCombineKJTTest) {
+  const auto jagged0 = createJaggedTensor({{0, 1}, {2}});
+  const auto jagged1 = createJaggedTensor({{}, {3}});
+
+  auto request0 = createRequest(1, 2, jagged0);
+  auto request1 = createRequest(1, 2, jagged1);
+
+  auto fused =
+      combineSparseKJT("id_score_list_features", {request0, request1}, true);
+
+  checkTensor<int32_t>(fused.kjt.lengths, {2, 0, 1, 1});
+  checkTensor<int32_t>(fused.kjt.values, {0, 1, 2, 3});
+  checkTensor<float>(fused.kjt.weights, {1.0f, 1.0f, 1.0f, 1.0f});
+  checkTensor<int32_t>(fused.offsets, {0, 2, 2, 3, 4});
+  EXPECT_EQ(fused.stride, 2);
+  for (const auto& tensor :
+       {fused.kjt.lengths,
+        fused.kjt.values,
+        fused.kjt.weights,
+        fused.offsets}) {
+    EXPECT_TRUE(tensor.storage().is_alias_of(fused.buffer.storage()));
+  }
+
+  auto unweighted =
+      combineSparseKJT("id_score_list_features", {request0, request1}, false);
+  EXPECT_FALSE(unweighted.kjt.weights.defined());
+  checkTensor<int32_t>(unweighted.offsets, {0, 2, 2, 3, 4});
+}
+
 } // namespace torchrec
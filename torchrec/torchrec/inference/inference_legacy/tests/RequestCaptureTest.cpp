@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "torchrec/inference/RequestCapture.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <ATen/ATen.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/io/IOBuf.h>
+#include <gtest/gtest.h>
+
+namespace torchrec {
+
+namespace {
+
+std::string toString(const folly::IOBuf& buf) {
+  return buf.cloneCoalescedAsValue().moveToFbString().toStdString();
+}
+
+std::shared_ptr<PredictionRequest> createRequest(uint32_t batchSize) {
+  auto request = std::make_shared<PredictionRequest>();
+  request->batch_size = batchSize;
+
+  SparseFeatures sparse;
+  sparse.num_features = 2;
+  sparse.lengths = *folly::IOBuf::copyBuffer(std::string("len"));
+  // Chained buffers are written out contiguous.
+  auto values = folly::IOBuf::copyBuffer(std::string("val"));
+  values->prependChain(folly::IOBuf::copyBuffer(std::string("ues")));
+  sparse.values = std::move(*values);
+  request->features["id_list_features"] = std::move(sparse);
+
+  FloatFeatures dense;
+  dense.num_features = 3;
+  dense.values = *folly::IOBuf::copyBuffer(std::string("floats"));
+  request->features["float_features"] = std::move(dense);
+
+  request->features["ivalue_features"] =
+      c10::IValue(at::arange(batchSize, at::kFloat));
+  return request;
+}
+
+} // namespace
+
+TEST(RequestCaptureTest, RoundTrip) {
+  folly::test::TemporaryDirectory dir;
+  const auto path = (dir.path() / "requests.cap").string();
+
+  const auto start = std::chrono::steady_clock::now();
+  {
+    RequestCapture capture(RequestCapture::Config{.path = path});
+    capture.maybeRecord(createRequest(2), start + std::chrono::seconds(1));
+    capture.maybeRecord(createRequest(4), start + std::chrono::seconds(2));
+    capture.stop();
+    EXPECT_EQ(capture.recordedCount(), 2);
+    EXPECT_EQ(capture.droppedCount(), 0);
+  }
+
+  auto captured = readRequestCapture(path);
+  ASSERT_EQ(captured.size(), 2);
+  EXPECT_LT(captured[0].arrival, captured[1].arrival);
+  EXPECT_EQ(captured[1].arrival - captured[0].arrival, std::chrono::seconds(1));
+
+  const auto& request = *captured[1].request;
+  EXPECT_EQ(request.batch_size, 4);
+  ASSERT_EQ(request.features.size(), 3);
+
+  const auto& sparse =
+      std::get<SparseFeatures>(request.features.at("id_list_features"));
+  EXPECT_EQ(sparse.num_features, 2);
+  EXPECT_EQ(toString(sparse.lengths), "len");
+  EXPECT_EQ(toString(sparse.values), "values");
+  EXPECT_TRUE(sparse.weights.empty());
+
+  const auto& dense =
+      std::get<FloatFeatures>(request.features.at("float_features"));
+  EXPECT_EQ(dense.num_features, 3);
+  EXPECT_EQ(toString(dense.values), "floats");
+
+  const auto& ivalue =
+      std::get<c10::IValue>(request.features.at("ivalue_features"));
+  EXPECT_TRUE(ivalue.toTensor().equal(at::arange(4, at::kFloat)));
+}
+
+TEST(RequestCaptureTest, Sampling) {
+  folly::test::TemporaryDirectory dir;
+  const auto path = (dir.path() / "requests.cap").string();
+
+  RequestCapture capture(
+      RequestCapture::Config{.path = path, .sampleRate = 0.0});
+  capture.maybeRecord(createRequest(1), std::chrono::steady_clock::now());
+  capture.stop();
+  EXPECT_EQ(capture.recordedCount(), 0);
+  EXPECT_TRUE(readRequestCapture(path).empty());
+}
+
+TEST(RequestCaptureTest, TruncatedLastRecord) {
+  folly::test::TemporaryDirectory dir;
+  const auto path = (dir.path() / "requests.cap").string();
+
+  const auto start = std::chrono::steady_clock::now();
+  {
+    RequestCapture capture(RequestCapture::Config{.path = path});
+    capture.maybeRecord(createRequest(2), start);
+    capture.maybeRecord(createRequest(4), start + std::chrono::seconds(1));
+  }
+  // As if the server was killed while writing the second record.
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+
+  auto captured = readRequestCapture(path);
+  ASSERT_EQ(captured.size(), 1);
+  EXPECT_EQ(captured[0].request->batch_size, 2);
+}
+
+TEST(RequestCaptureTest, FlushesWhileCapturing) {
+  folly::test::TemporaryDirectory dir;
+  const auto path = (dir.path() / "requests.cap").string();
+
+  RequestCapture capture(RequestCapture::Config{
+      .path = path, .flushInterval = std::chrono::milliseconds(0)});
+  capture.maybeRecord(createRequest(2), std::chrono::steady_clock::now());
+  // The record is readable before the capture is stopped.
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (readRequestCapture(path).empty() &&
+         std::chrono::steady_clock::now() < deadline) {
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(readRequestCapture(path).size(), 1);
+}
+
+TEST(RequestCaptureTest, NotACapture) {
+  folly::test::TemporaryDirectory dir;
+  const auto path = (dir.path() / "requests.cap").string();
+  std::ofstream(path) << "not a request capture";
+
+  EXPECT_THROW(readRequestCapture(path), std::runtime_error);
+}
+
+} // namespace torchrec
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "torchrec/inference/ResourceManager.h"
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+namespace torchrec {
+
+TEST(ResourceManagerTest, OccupyAndRelease) {
+  ResourceManager resourceManager(
+      /* worldSize */ 2, /* maxOutstandingBatches */ 1);
+
+  EXPECT_TRUE(resourceManager.occupyDevice(0, std::chrono::milliseconds(0)));
+  EXPECT_FALSE(resourceManager.occupyDevice(0, std::chrono::milliseconds(0)));
+  EXPECT_EQ(resourceManager.tryOccupyAnyDevice(), 1);
+  EXPECT_EQ(resourceManager.tryOccupyAnyDevice(), std::nullopt);
+
+  resourceManager.release(1);
+  EXPECT_EQ(resourceManager.tryOccupyAnyDevice(), 1);
+}
+
+TEST(ResourceManagerTest, HandOffOnRelease) {
+  ResourceManager resourceManager(
+      /* worldSize */ 1, /* maxOutstandingBatches */ 1);
+  ASSERT_TRUE(resourceManager.occupyDevice(0, std::chrono::milliseconds(0)));
+
+  auto first = resourceManager.occupyDeviceAsync(0, std::chrono::seconds(60));
+  auto second = resourceManager.occupyDeviceAsync(0, std::chrono::seconds(60));
+  EXPECT_FALSE(first.isReady());
+
+  // The slot goes to the earliest waiter and stays occupied.
+  resourceManager.release(0);
+  EXPECT_TRUE(std::move(first).get(std::chrono::seconds(1)));
+  EXPECT_FALSE(second.isReady());
+  EXPECT_EQ(resourceManager.tryOccupyAnyDevice(), std::nullopt);
+
+  resourceManager.release(0);
+  EXPECT_TRUE(std::move(second).get(std::chrono::seconds(1)));
+}
+
+TEST(ResourceManagerTest, Timeout) {
+  ResourceManager resourceManager(
+      /* worldSize */ 1, /* maxOutstandingBatches */ 1);
+  ASSERT_TRUE(resourceManager.occupyDevice(0, std::chrono::milliseconds(0)));
+
+  EXPECT_FALSE(resourceManager.occupyDevice(0, std::chrono::milliseconds(10)));
+
+  // The timed out batch does not take the released slot.
+  resourceManager.release(0);
+  EXPECT_EQ(resourceManager.tryOccupyAnyDevice(), 0);
+}
+
+} // namespace torchrec
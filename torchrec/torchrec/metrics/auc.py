@@ -14,6 +14,12 @@ from typing import Any, Callable, cast, Dict, List, Optional, Tuple, Type
 import torch
 import torch.distributed as dist
 from torchmetrics.utilities.distributed import gather_all_tensors
+from torchrec.metrics.binned_auc import (
+    auc_from_histogram,
+    compute_histogram,
+    native_grouped_auc,
+    native_grouped_auc_available,
+)
 from torchrec.metrics.metrics_config import RecComputeMode, RecTaskInfo
 from torchrec.metrics.metrics_namespace import MetricName, MetricNamespace, MetricPrefix
 from torchrec.metrics.rec_metric import (
@@ -29,6 +35,7 @@ logger: logging.Logger = logging.getLogger(__name__)
 PREDICTIONS = "predictions"
 LABELS = "labels"
 WEIGHTS = "weights"
+HISTOGRAM = "histogram"
 GROUPING_KEYS = "grouping_keys"
 REQUIRED_INPUTS = "required_inputs"
 
@@ -62,7 +69,9 @@ def _compute_auc_helper(
     weights: torch.Tensor,
     apply_bin: bool = False,
 ) -> torch.Tensor:
-    sorted_indices = torch.argsort(predictions, descending=True, dim=-1)
+    # Stable, so that tied predictions are in the same order on every device
+    # and in the native grouped AUC.
+    sorted_indices = torch.argsort(predictions, descending=True, dim=-1, stable=True)
     sorted_labels = torch.index_select(labels, dim=0, index=sorted_indices)
     if apply_bin:
         # TODO - [add flag to set bining dyamically] for use with soft labels, >=0.039 --> 1, <0.039 --> 0
@@ -132,6 +141,9 @@ def compute_auc_per_group(
         # removing the paddings to avoid numerical errors.
         grouping_keys = grouping_keys[1:]
 
+    if native_grouped_auc_available(preds_t, grouping_keys):
+        return native_grouped_auc(preds_t, labels_t, weights_t, grouping_keys)
+
     # get unique group indices
     group_indices = torch.unique(grouping_keys)
 
@@ -177,6 +189,12 @@ class AUCMetricComputation(RecMetricComputation):
         grouped_auc (bool): If True, computes AUC per group and returns average AUC across all groups.
             The `grouping_keys` is provided during state updates along with predictions, labels, weights.
             This feature is currently not enabled for `fused_update_limit`.
+        num_bins (int): If positive, keeps a histogram of the predictions with
+            `num_bins` bins instead of all examples of the window, and computes
+            both the window and the lifetime AUC from the histograms in
+            O(num_bins). See `torchrec.metrics.binned_auc` for the error bound.
+            This feature is currently not enabled for `grouped_auc` and
+            `apply_bin`.
     """
 
     def __init__(
@@ -185,6 +203,7 @@ class AUCMetricComputation(RecMetricComputation):
         grouped_auc: bool = False,
         apply_bin: bool = False,
         fused_update_limit: int = 0,
+        num_bins: int = 0,
         **kwargs: Any,
     ) -> None:
         super().__init__(*args, **kwargs)
@@ -192,10 +211,24 @@ class AUCMetricComputation(RecMetricComputation):
             raise RecMetricException(
                 "Grouped AUC and Fused Update Limit cannot be enabled together yet."
             )
+        if num_bins > 0 and (grouped_auc or apply_bin):
+            raise RecMetricException(
+                "Binned AUC cannot be enabled together with grouped AUC or apply_bin yet."
+            )
 
         self._grouped_auc: bool = grouped_auc
         self._apply_bin: bool = apply_bin
+        self._num_bins: int = num_bins
         self._num_samples: int = 0
+        if self._num_bins > 0:
+            self._add_state(
+                HISTOGRAM,
+                torch.zeros((self._n_tasks, 2, self._num_bins), dtype=torch.double),
+                add_window_state=True,
+                dist_reduce_fx="sum",
+                persistent=True,
+            )
+            return
         self._add_state(
             PREDICTIONS,
             [],
@@ -236,7 +269,7 @@ class AUCMetricComputation(RecMetricComputation):
     # The reason for using non-empty tensors as the first elements is to avoid the
     # floating point exception thrown in sync() for aggregating empty tensors
     def _init_states(self) -> None:
-        if len(getattr(self, PREDICTIONS)) > 0:
+        if self._num_bins > 0 or len(getattr(self, PREDICTIONS)) > 0:
             return
         self._num_samples = 0
         getattr(self, PREDICTIONS).append(
@@ -276,6 +309,11 @@ class AUCMetricComputation(RecMetricComputation):
         labels = labels.float()
         weights = weights.float()
         batch_size = predictions.size(-1)
+        if self._num_bins > 0:
+            histogram = compute_histogram(predictions, labels, weights, self._num_bins)
+            getattr(self, HISTOGRAM).add_(histogram)
+            self._aggregate_window_state(HISTOGRAM, histogram, batch_size)
+            return
         start_index = max(self._num_samples + batch_size - self._window_size, 0)
 
         # Using `self.predictions =` will cause Pyre errors.
@@ -327,6 +365,19 @@ class AUCMetricComputation(RecMetricComputation):
             )
 
     def _compute(self) -> List[MetricComputationReport]:
+        if self._num_bins > 0:
+            return [
+                MetricComputationReport(
+                    name=MetricName.AUC,
+                    metric_prefix=MetricPrefix.LIFETIME,
+                    value=auc_from_histogram(getattr(self, HISTOGRAM)),
+                ),
+                MetricComputationReport(
+                    name=MetricName.AUC,
+                    metric_prefix=MetricPrefix.WINDOW,
+                    value=auc_from_histogram(self.get_window_state(HISTOGRAM)),
+                ),
+            ]
         reports = []
         reports.append(
             MetricComputationReport(
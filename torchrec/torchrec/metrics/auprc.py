@@ -14,6 +14,7 @@ from typing import Any, cast, Dict, List, Optional, Type
 import torch
 import torch.distributed as dist
 import torch.nn.functional as F
+from torchrec.metrics.binned_auc import auprc_from_histogram, compute_histogram
 from torchrec.metrics.metrics_config import RecComputeMode, RecTaskInfo
 from torchrec.metrics.metrics_namespace import MetricName, MetricNamespace, MetricPrefix
 from torchrec.metrics.rec_metric import (
@@ -29,6 +30,7 @@ logger: logging.Logger = logging.getLogger(__name__)
 PREDICTIONS = "predictions"
 LABELS = "labels"
 WEIGHTS = "weights"
+HISTOGRAM = "histogram"
 GROUPING_KEYS = "grouping_keys"
 REQUIRED_INPUTS = "required_inputs"
 
@@ -168,6 +170,10 @@ class AUPRCMetricComputation(RecMetricComputation):
         grouped_auprc (bool): If True, computes AUPRC per group and returns average AUPRC across all groups.
             The `grouping_keys` is provided during state updates along with predictions, labels, weights.
             This feature is currently not enabled for `fused_update_limit`.
+        num_bins (int): If positive, keeps a histogram of the predictions with
+            `num_bins` bins instead of all examples of the window, and computes
+            both the window and the lifetime AUPRC from the histograms.
+            This feature is currently not enabled for `grouped_auprc`.
     """
 
     def __init__(
@@ -175,6 +181,7 @@ class AUPRCMetricComputation(RecMetricComputation):
         *args: Any,
         grouped_auprc: bool = False,
         fused_update_limit: int = 0,
+        num_bins: int = 0,
         **kwargs: Any,
     ) -> None:
         super().__init__(*args, **kwargs)
@@ -182,8 +189,22 @@ class AUPRCMetricComputation(RecMetricComputation):
             raise RecMetricException(
                 "Grouped AUPRC and Fused Update Limit cannot be enabled together yet."
             )
+        if grouped_auprc and num_bins > 0:
+            raise RecMetricException(
+                "Grouped AUPRC and binned AUPRC cannot be enabled together yet."
+            )
 
         self._grouped_auprc: bool = grouped_auprc
+        self._num_bins: int = num_bins
+        if self._num_bins > 0:
+            self._add_state(
+                HISTOGRAM,
+                torch.zeros((self._n_tasks, 2, self._num_bins), dtype=torch.double),
+                add_window_state=True,
+                dist_reduce_fx="sum",
+                persistent=True,
+            )
+            return
         self._add_state(
             PREDICTIONS,
             [],
@@ -224,7 +245,7 @@ class AUPRCMetricComputation(RecMetricComputation):
     # The reason for using non-empty tensors as the first elements is to avoid the
     # floating point exception thrown in sync() for aggregating empty tensors
     def _init_states(self) -> None:
-        if len(getattr(self, PREDICTIONS)) > 0:
+        if self._num_bins > 0 or len(getattr(self, PREDICTIONS)) > 0:
             return
 
         getattr(self, PREDICTIONS).append(
@@ -263,6 +284,11 @@ class AUPRCMetricComputation(RecMetricComputation):
         predictions = predictions.float()
         labels = labels.float()
         weights = weights.float()
+        if self._num_bins > 0:
+            histogram = compute_histogram(predictions, labels, weights, self._num_bins)
+            getattr(self, HISTOGRAM).add_(histogram)
+            self._aggregate_window_state(HISTOGRAM, histogram, predictions.size(-1))
+            return
         num_samples = getattr(self, PREDICTIONS)[0].size(-1)
         batch_size = predictions.size(-1)
         start_index = max(num_samples + batch_size - self._window_size, 0)
@@ -298,6 +324,19 @@ class AUPRCMetricComputation(RecMetricComputation):
             )
 
     def _compute(self) -> List[MetricComputationReport]:
+        if self._num_bins > 0:
+            return [
+                MetricComputationReport(
+                    name=MetricName.AUPRC,
+                    metric_prefix=MetricPrefix.LIFETIME,
+                    value=auprc_from_histogram(getattr(self, HISTOGRAM)),
+                ),
+                MetricComputationReport(
+                    name=MetricName.AUPRC,
+                    metric_prefix=MetricPrefix.WINDOW,
+                    value=auprc_from_histogram(self.get_window_state(HISTOGRAM)),
+                ),
+            ]
         reports = [
             MetricComputationReport(
                 name=MetricName.AUPRC,
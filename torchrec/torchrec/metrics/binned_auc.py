@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+# All rights reserved.
+#
+# This source code is licensed under the BSD-style license found in the
+# LICENSE file in the root directory of this source tree.
+
+# pyre-strict
+
+"""
+Streaming AUC and AUPRC from histograms of the predictions.
+
+Instead of keeping every example of the window and sorting them at compute
+time, the binned metrics keep a `(n_tasks, 2, num_bins)` histogram of the
+negative and positive weights per prediction bin. The histograms are summed
+across batches and ranks, and the curves are integrated in O(num_bins).
+
+Examples that fall into the same bin are treated as tied, so the binned AUC
+differs from the exact AUC by at most `auc_error_bound(histogram)`.
+
+The histograms, the curves integrated from them and the grouped AUC are
+computed by the `rec_metrics` C++ ops when they are loaded with
+`torch.ops.load_library`, and by torch ops otherwise.
+"""
+
+import torch
+
+
+NEGATIVE = 0
+POSITIVE = 1
+
+
+def _has_native_op(name: str, *tensors: torch.Tensor) -> bool:
+    if any(t.device.type != "cpu" for t in tensors):
+        return False
+    try:
+        return hasattr(torch.ops.rec_metrics, name)
+    except RuntimeError:
+        return False
+
+
+def compute_histogram(
+    predictions: torch.Tensor,
+    labels: torch.Tensor,
+    weights: torch.Tensor,
+    num_bins: int,
+) -> torch.Tensor:
+    """
+    Args:
+        predictions (torch.Tensor): tensor of size (n_tasks, n_examples) in [0, 1].
+        labels (torch.Tensor): tensor of size (n_tasks, n_examples).
+        weights (torch.Tensor): tensor of size (n_tasks, n_examples).
+        num_bins (int): number of equal width prediction bins.
+
+    Returns:
+        torch.Tensor: float64 tensor of size (n_tasks, 2, num_bins), the
+            negative and positive weights of each prediction bin.
+    """
+    if _has_native_op("binned_histogram", predictions):
+        return torch.ops.rec_metrics.binned_histogram(
+            predictions, labels, weights, num_bins
+        )
+    n_tasks = predictions.size(0)
+    bins = (predictions.double() * num_bins).long().clamp(0, num_bins - 1)
+    labels = labels.double()
+    weights = weights.double()
+    histogram = torch.zeros(
+        (n_tasks, 2, num_bins), dtype=torch.double, device=predictions.device
+    )
+    histogram[:, NEGATIVE].scatter_add_(1, bins, weights * (1.0 - labels))
+    histogram[:, POSITIVE].scatter_add_(1, bins, weights * labels)
+    return histogram
+
+
+def auc_from_histogram(histogram: torch.Tensor) -> torch.Tensor:
+    """
+    AUC of the ROC curve through the bin boundaries, integrated by the
+    trapezoidal rule.
+
+    Args:
+        histogram (torch.Tensor): tensor of size (n_tasks, 2, num_bins).
+
+    Returns:
+        torch.Tensor: tensor of size (n_tasks,).
+    """
+    if _has_native_op("histogram_auc", histogram):
+        return torch.ops.rec_metrics.histogram_auc(histogram)
+    # Walk the bins from the highest prediction down.
+    neg = histogram[:, NEGATIVE].flip(-1)
+    pos = histogram[:, POSITIVE].flip(-1)
+    cum_tp = torch.cumsum(pos, dim=-1)
+    area = torch.sum(neg * (cum_tp - pos / 2), dim=-1)
+    fp = neg.sum(dim=-1)
+    tp = cum_tp[:, -1]
+    # 0.5 is the no-signal default value for auc.
+    return torch.where(fp * tp == 0, 0.5, area / (fp * tp).clamp(min=1e-30)).float()
+
+
+def auc_error_bound(histogram: torch.Tensor) -> torch.Tensor:
+    """
+    The largest difference between `auc_from_histogram` and the exact AUC of
+    the binned examples. Within a bin the exact AUC may order any negative
+    before or after any positive, while the binned AUC counts each such pair
+    as half.
+
+    Returns:
+        torch.Tensor: tensor of size (n_tasks,).
+    """
+    if _has_native_op("histogram_auc_error_bound", histogram):
+        return torch.ops.rec_metrics.histogram_auc_error_bound(histogram)
+    neg = histogram[:, NEGATIVE]
+    pos = histogram[:, POSITIVE]
+    fp_tp = neg.sum(dim=-1) * pos.sum(dim=-1)
+    bound = torch.sum(neg * pos, dim=-1) / 2
+    return torch.where(fp_tp == 0, 0.0, bound / fp_tp.clamp(min=1e-30)).float()
+
+
+def auprc_from_histogram(histogram: torch.Tensor) -> torch.Tensor:
+    """
+    AUPRC of the precision-recall curve through the non-empty bin boundaries,
+    integrated by the Riemann sum like `torchrec.metrics.auprc`.
+
+    Args:
+        histogram (torch.Tensor): tensor of size (n_tasks, 2, num_bins).
+
+    Returns:
+        torch.Tensor: tensor of size (n_tasks,).
+    """
+    if _has_native_op("histogram_auprc", histogram):
+        return torch.ops.rec_metrics.histogram_auprc(histogram)
+    auprcs = []
+    for neg, pos in zip(histogram[:, NEGATIVE], histogram[:, POSITIVE]):
+        mask = (neg + pos).flip(0) != 0
+        num_tp = torch.cumsum(pos.flip(0), dim=0)[mask]
+        num_fp = torch.cumsum(neg.flip(0), dim=0)[mask]
+        if num_tp.numel() == 0 or num_tp[-1] == 0:
+            auprcs.append(histogram.new_zeros(1))
+            continue
+        precision = (num_tp / (num_tp + num_fp)).flip(0)
+        recall = (num_tp / num_tp[-1]).flip(0)
+        precision = torch.cat([precision, precision.new_ones(1)])
+        recall = torch.cat([recall, recall.new_zeros(1)])
+        auprcs.append(-torch.sum((recall[1:] - recall[:-1]) * precision[:-1]).view(1))
+    return torch.cat(auprcs).float()
+
+
+def native_grouped_auc_available(*tensors: torch.Tensor) -> bool:
+    return _has_native_op("grouped_auc", *tensors)
+
+
+def native_grouped_auc(
+    predictions: torch.Tensor,
+    labels: torch.Tensor,
+    weights: torch.Tensor,
+    grouping_keys: torch.Tensor,
+) -> torch.Tensor:
+    """
+    Average exact AUC of the groups of examples, see `compute_auc_per_group`.
+    The C++ kernel buckets the examples by group in one pass rather than
+    masking all examples for every group.
+    """
+    return torch.ops.rec_metrics.grouped_auc(
+        predictions, labels, weights, grouping_keys
+    )
@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+# All rights reserved.
+#
+# This source code is licensed under the BSD-style license found in the
+# LICENSE file in the root directory of this source tree.
+
+# pyre-strict
+
+import unittest
+from unittest.mock import patch
+
+import torch
+from torchrec.metrics.auc import AUCMetric, compute_auc, compute_auc_per_group
+from torchrec.metrics.auprc import compute_auprc
+from torchrec.metrics.binned_auc import (
+    auc_error_bound,
+    auc_from_histogram,
+    auprc_from_histogram,
+    compute_histogram,
+    native_grouped_auc_available,
+    POSITIVE,
+)
+from torchrec.metrics.metrics_config import DefaultTaskInfo
+
+
+class BinnedAUCTest(unittest.TestCase):
+    def setUp(self) -> None:
+        torch.manual_seed(0)
+        n_tasks, n_examples = 3, 5000
+        self.labels = torch.randint(0, 2, (n_tasks, n_examples)).float()
+        self.predictions = torch.clamp(
+            0.5 + 0.2 * (self.labels - 0.5) + 0.2 * torch.randn(n_tasks, n_examples),
+            0.0,
+            1.0,
+        )
+        self.weights = torch.rand(n_tasks, n_examples)
+
+    def test_auc_within_error_bound(self) -> None:
+        exact = compute_auc(3, [self.predictions], [self.labels], [self.weights])
+        for num_bins in [16, 256, 4096]:
+            histogram = compute_histogram(
+                self.predictions, self.labels, self.weights, num_bins
+            )
+            binned = auc_from_histogram(histogram)
+            bound = auc_error_bound(histogram)
+            self.assertTrue(torch.all((binned - exact).abs() <= bound + 1e-5))
+        self.assertTrue(torch.all(bound < 1e-3))
+
+    def test_histogram_is_mergeable(self) -> None:
+        full = compute_histogram(self.predictions, self.labels, self.weights, 64)
+        halves = [
+            compute_histogram(p, l, w, 64)
+            for p, l, w in zip(
+                self.predictions.chunk(2, dim=-1),
+                self.labels.chunk(2, dim=-1),
+                self.weights.chunk(2, dim=-1),
+            )
+        ]
+        torch.testing.assert_close(full, halves[0] + halves[1])
+
+    def test_auprc(self) -> None:
+        exact = compute_auprc(3, self.predictions, self.labels, self.weights)
+        histogram = compute_histogram(
+            self.predictions, self.labels, self.weights, 4096
+        )
+        torch.testing.assert_close(
+            auprc_from_histogram(histogram), exact, atol=5e-3, rtol=0
+        )
+
+    def test_no_signal(self) -> None:
+        histogram = compute_histogram(
+            self.predictions, torch.ones_like(self.labels), self.weights, 16
+        )
+        torch.testing.assert_close(auc_from_histogram(histogram), torch.full((3,), 0.5))
+
+    def test_metric(self) -> None:
+        auc = AUCMetric(
+            world_size=1,
+            my_rank=0,
+            batch_size=1000,
+            tasks=[DefaultTaskInfo],
+            window_size=2000,
+            num_bins=1024,
+        )
+        for i in range(5):
+            batch = slice(i * 1000, (i + 1) * 1000)
+            auc.update(
+                predictions={"DefaultTask": self.predictions[0:1, batch]},
+                labels={"DefaultTask": self.labels[0:1, batch]},
+                weights={"DefaultTask": self.weights[0:1, batch]},
+            )
+        results = auc.compute()
+        lifetime = compute_auc(
+            1, [self.predictions[0:1]], [self.labels[0:1]], [self.weights[0:1]]
+        )
+        window = compute_auc(
+            1,
+            [self.predictions[0:1, 3000:]],
+            [self.labels[0:1, 3000:]],
+            [self.weights[0:1, 3000:]],
+        )
+        torch.testing.assert_close(
+            results["auc-DefaultTask|lifetime_auc"], lifetime, atol=1e-3, rtol=0
+        )
+        torch.testing.assert_close(
+            results["auc-DefaultTask|window_auc"], window, atol=1e-3, rtol=0
+        )
+
+
+@unittest.skipIf(
+    not native_grouped_auc_available(torch.empty(0)),
+    "rec_metrics is not loaded",
+)
+class NativeOpsParityTest(unittest.TestCase):
+    def setUp(self) -> None:
+        torch.manual_seed(0)
+        n_tasks, n_examples = 2, 3000
+        self.labels = torch.randint(0, 2, (n_tasks, n_examples)).float()
+        # Few distinct predictions, so that most of them are tied.
+        self.predictions = torch.randint(0, 8, (n_tasks, n_examples)).float() / 8
+        self.weights = torch.rand(n_tasks, n_examples)
+        self.grouping_keys = torch.randint(0, 20, (n_examples,))
+
+    def test_histogram(self) -> None:
+        native = compute_histogram(self.predictions, self.labels, self.weights, 64)
+        with patch(
+            "torchrec.metrics.binned_auc._has_native_op", return_value=False
+        ):
+            reference = compute_histogram(
+                self.predictions, self.labels, self.weights, 64
+            )
+        torch.testing.assert_close(native, reference)
+
+    def test_curves(self) -> None:
+        histogram = compute_histogram(self.predictions, self.labels, self.weights, 64)
+        # One task without positives.
+        histogram[1, POSITIVE] = 0
+        for fn in [auc_from_histogram, auc_error_bound, auprc_from_histogram]:
+            native = fn(histogram)
+            with patch(
+                "torchrec.metrics.binned_auc._has_native_op", return_value=False
+            ):
+                reference = fn(histogram)
+            torch.testing.assert_close(native, reference)
+
+    def test_grouped_auc_with_ties(self) -> None:
+        for labels in [self.labels, torch.rand_like(self.labels)]:
+            args = (
+                2,
+                [self.predictions],
+                [labels],
+                [self.weights],
+                self.grouping_keys,
+            )
+            native = compute_auc_per_group(*args)
+            with patch(
+                "torchrec.metrics.auc.native_grouped_auc_available",
+                return_value=False,
+            ):
+                reference = compute_auc_per_group(*args)
+            torch.testing.assert_close(native, reference)
+
+    def test_grouped_auc_single_group(self) -> None:
+        # With one group, the grouped AUC is the AUC of all the examples.
+        native = compute_auc_per_group(
+            2,
+            [self.predictions],
+            [self.labels],
+            [self.weights],
+            torch.zeros_like(self.grouping_keys),
+        )
+        exact = compute_auc(2, [self.predictions], [self.labels], [self.weights])
+        torch.testing.assert_close(native, exact)
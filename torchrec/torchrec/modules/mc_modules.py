@@ -17,6 +17,7 @@ import torch
 
 from torch import nn
 from torchrec.modules.embedding_configs import BaseEmbeddingConfig
+from torchrec.pt2.checks import is_torchdynamo_compiling
 from torchrec.sparse.jagged_tensor import JaggedTensor, KeyedJaggedTensor
 
 
@@ -444,6 +445,55 @@ class ManagedCollisionCollection(nn.Module):
         return open_slots
 
 
+@torch.jit.ignore
+def _use_native_mch(device: torch.device) -> bool:
+    """
+    Whether the native CPU kernels of torchrec_mc are loaded, e.g. by
+    `torch.ops.load_library`, and can run on `device`.
+    """
+    if device.type != "cpu":
+        return False
+    try:
+        return hasattr(torch.ops.torchrec_mc, "mch_remap")
+    except RuntimeError:
+        return False
+
+
+def _can_use_native_mch(device: torch.device) -> bool:
+    return (
+        not torch.jit.is_scripting()
+        and not is_torchdynamo_compiling()
+        and _use_native_mch(device)
+    )
+
+
+@torch.jit.ignore
+def _native_mch_update_and_evict(
+    policy: int,
+    current_iter: int,
+    decay_exponent: float,
+    coalesced_history_argsort_mapping: torch.Tensor,
+    coalesced_history_sorted_unique_ids_counts: torch.Tensor,
+    coalesced_history_mch_matching_elements_mask: torch.Tensor,
+    coalesced_history_mch_matching_indices: torch.Tensor,
+    mch_counts: Optional[torch.Tensor],
+    mch_last_access_iter: Optional[torch.Tensor],
+    coalesced_history_last_access_iter: Optional[torch.Tensor],
+) -> Tuple[torch.Tensor, torch.Tensor]:
+    return torch.ops.torchrec_mc.mch_update_and_evict(
+        policy,
+        current_iter,
+        decay_exponent,
+        coalesced_history_argsort_mapping,
+        coalesced_history_sorted_unique_ids_counts,
+        coalesced_history_mch_matching_elements_mask,
+        coalesced_history_mch_matching_indices,
+        mch_counts,
+        mch_last_access_iter,
+        coalesced_history_last_access_iter,
+    )
+
+
 class MCHEvictionPolicyMetadataInfo(NamedTuple):
     metadata_name: str
     is_mch_metadata: bool
@@ -615,6 +665,19 @@ class LFU_EvictionPolicy(MCHEvictionPolicy):
         coalesced_history_metadata: Dict[str, torch.Tensor],
     ) -> Tuple[torch.Tensor, torch.Tensor]:
         mch_counts = mch_metadata["counts"]
+        if _can_use_native_mch(mch_counts.device):
+            return _native_mch_update_and_evict(
+                0,
+                current_iter,
+                1.0,
+                coalesced_history_argsort_mapping,
+                coalesced_history_sorted_unique_ids_counts,
+                coalesced_history_mch_matching_elements_mask,
+                coalesced_history_mch_matching_indices,
+                mch_counts,
+                None,
+                None,
+            )
         # update metadata for matching ids
         mch_counts[
             coalesced_history_mch_matching_indices
@@ -731,6 +794,19 @@ class LRU_EvictionPolicy(MCHEvictionPolicy):
         coalesced_history_metadata: Dict[str, torch.Tensor],
     ) -> Tuple[torch.Tensor, torch.Tensor]:
         mch_last_access_iter = mch_metadata["last_access_iter"]
+        if _can_use_native_mch(mch_last_access_iter.device):
+            return _native_mch_update_and_evict(
+                1,
+                current_iter,
+                self._decay_exponent,
+                coalesced_history_argsort_mapping,
+                coalesced_history_sorted_unique_ids_counts,
+                coalesced_history_mch_matching_elements_mask,
+                coalesced_history_mch_matching_indices,
+                None,
+                mch_last_access_iter,
+                coalesced_history_metadata["last_access_iter"],
+            )
 
         # sort coalesced history metadata
         coalesced_history_metadata["last_access_iter"].copy_(
@@ -872,6 +948,19 @@ class DistanceLFU_EvictionPolicy(MCHEvictionPolicy):
     ) -> Tuple[torch.Tensor, torch.Tensor]:
         mch_counts = mch_metadata["counts"]
         mch_last_access_iter = mch_metadata["last_access_iter"]
+        if _can_use_native_mch(mch_last_access_iter.device):
+            return _native_mch_update_and_evict(
+                2,
+                current_iter,
+                self._decay_exponent,
+                coalesced_history_argsort_mapping,
+                coalesced_history_sorted_unique_ids_counts,
+                coalesced_history_mch_matching_elements_mask,
+                coalesced_history_mch_matching_indices,
+                mch_counts,
+                mch_last_access_iter,
+                coalesced_history_metadata["last_access_iter"],
+            )
 
         # sort coalesced history metadata
         coalesced_history_metadata["last_access_iter"].copy_(
@@ -949,6 +1038,18 @@ class DistanceLFU_EvictionPolicy(MCHEvictionPolicy):
         return evicted_indices, selected_new_indices
 
 
+@torch.jit.ignore
+def _native_mch_remap(
+    values: torch.Tensor,
+    mch_sorted_raw_ids: torch.Tensor,
+    mch_remapped_ids_mapping: torch.Tensor,
+    zch_index: int,
+) -> torch.Tensor:
+    return torch.ops.torchrec_mc.mch_remap(
+        values, mch_sorted_raw_ids, mch_remapped_ids_mapping, zch_index
+    )
+
+
 @torch.fx.wrap
 def _mch_remap(
     features: Dict[str, JaggedTensor],
@@ -956,10 +1057,20 @@ def _mch_remap(
     mch_remapped_ids_mapping: torch.Tensor,
     zch_index: int,
 ) -> Dict[str, JaggedTensor]:
-    """Remap feature ids to zch ids, TODO: create a custom kernel"""
+    """Remap feature ids to zch ids, by the native kernel on CPU if loaded"""
     remapped_features: Dict[str, JaggedTensor] = {}
     for name, feature in features.items():
         values = feature.values()
+        if _can_use_native_mch(values.device):
+            remapped_features[name] = JaggedTensor(
+                values=_native_mch_remap(
+                    values, mch_sorted_raw_ids, mch_remapped_ids_mapping, zch_index
+                ),
+                lengths=feature.lengths(),
+                offsets=feature.offsets(),
+                weights=feature.weights_or_none(),
+            )
+            continue
         remapped_ids = torch.empty_like(values)
 
         # compute overlap between incoming IDs and remapping table
@@ -1158,6 +1269,8 @@ class MCHManagedCollisionModule(ManagedCollisionModule):
     def _match_indices(
         self, sorted_sequence: torch.Tensor, search_values: torch.Tensor
     ) -> Tuple[torch.Tensor, torch.Tensor]:
+        if _can_use_native_mch(search_values.device):
+            return torch.ops.torchrec_mc.mch_match(sorted_sequence, search_values)
         searched_indices = torch.searchsorted(sorted_sequence[:-1], search_values)
         retrieved_ids = sorted_sequence[searched_indices]
         matching_eles = retrieved_ids == search_values
@@ -1254,6 +1367,13 @@ class MCHManagedCollisionModule(ManagedCollisionModule):
         current_history_accumulator = self._history_accumulator[
             : self._current_history_buffer_offset
         ]
+        if type(self._eviction_policy) in (
+            LFU_EvictionPolicy,
+            LRU_EvictionPolicy,
+            DistanceLFU_EvictionPolicy,
+        ) and _can_use_native_mch(current_history_accumulator.device):
+            self._coalesce_history_native(current_history_accumulator)
+            return
         uniq_ids, uniq_inverse_mapping, uniq_ids_counts = torch.unique(
             current_history_accumulator,
             return_inverse=True,
@@ -1289,6 +1409,43 @@ class MCHManagedCollisionModule(ManagedCollisionModule):
         # reset buffer offset
         self._current_history_buffer_offset = 0
 
+    @torch.no_grad()
+    def _coalesce_history_native(
+        self, current_history_accumulator: torch.Tensor
+    ) -> None:
+        # the built-in policies reduce each history metadata by max, which
+        #   the native kernel does along with the unique ids in one sort.
+        history_metadata_names = list(self._history_metadata.keys())
+        uniq_ids, uniq_ids_counts, coalesced_metadata = (
+            torch.ops.torchrec_mc.mch_coalesce(
+                current_history_accumulator,
+                [
+                    self._history_metadata[metadata_name][
+                        : self._current_history_buffer_offset
+                    ]
+                    for metadata_name in history_metadata_names
+                ],
+            )
+        )
+        coalesced_eviction_history_metadata: Dict[str, torch.Tensor] = dict(
+            zip(history_metadata_names, coalesced_metadata)
+        )
+        if self._eviction_policy._threshold_filtering_func is not None:
+            threshold_mask, threshold = self._eviction_policy._threshold_filtering_func(
+                uniq_ids_counts
+            )
+            uniq_ids = uniq_ids[threshold_mask]
+            uniq_ids_counts = uniq_ids_counts[threshold_mask]
+            for metadata_name, metadata in coalesced_eviction_history_metadata.items():
+                coalesced_eviction_history_metadata[metadata_name] = metadata[
+                    threshold_mask
+                ]
+        self._update_and_evict(
+            uniq_ids, uniq_ids_counts, coalesced_eviction_history_metadata
+        )
+        # reset buffer offset
+        self._current_history_buffer_offset = 0
+
     def profile(
         self,
         features: Dict[str, JaggedTensor],
@@ -478,6 +478,39 @@ def _permute_tensor_by_segments(
     return permuted_tensor, permuted_weights
 
 
+@torch.jit.ignore
+def _use_native_permute_kjt(device: torch.device) -> bool:
+    """
+    Whether to permute a CPU KeyedJaggedTensor by the fused kernel in
+    `torchrec/csrc/sparse`, which is available once the library is loaded with
+    `torch.ops.load_library`.
+    """
+    if device.type != "cpu":
+        return False
+    try:
+        return hasattr(torch.ops.torchrec_sparse, "permute_kjt")
+    except RuntimeError:
+        return False
+
+
+@torch.jit.ignore
+def _native_permute_kjt(
+    lengths: torch.Tensor,
+    values: torch.Tensor,
+    weights: Optional[torch.Tensor],
+    stride_per_key: List[int],
+    length_per_key: List[int],
+    indices: List[int],
+) -> Tuple[torch.Tensor, torch.Tensor, Optional[torch.Tensor]]:
+    """
+    Copies the lengths, values and weights of every permuted key in one
+    parallel pass, instead of computing the offsets with separate ops.
+    """
+    return torch.ops.torchrec_sparse.permute_kjt(
+        lengths, values, weights, stride_per_key, length_per_key, indices
+    )
+
+
 @torch.fx.wrap
 def _kjt_concat(
     kjt_list: List["KeyedJaggedTensor"],
@@ -2537,7 +2570,24 @@ class KeyedJaggedTensor(Pipelineable, metaclass=JaggedTensorMeta):
             torch._check(permuted_length_per_key_sum != -1)
             torch._check(permuted_length_per_key_sum != 0)
 
-        if self.variable_stride_per_key():
+        if (
+            not torch.jit.is_scripting()
+            and not is_torchdynamo_compiling()
+            and _use_native_permute_kjt(self.device())
+        ):
+            (
+                permuted_lengths,
+                permuted_values,
+                permuted_weights,
+            ) = _native_permute_kjt(
+                self.lengths(),
+                self.values(),
+                self.weights_or_none(),
+                self.stride_per_key(),
+                length_per_key,
+                indices,
+            )
+        elif self.variable_stride_per_key():
             length_per_key_tensor = _pin_and_move(
                 torch.tensor(self.length_per_key()), self.device()
             )
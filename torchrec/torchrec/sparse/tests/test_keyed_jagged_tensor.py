@@ -10,12 +10,14 @@
 
 import unittest
 from typing import List, Tuple
+from unittest.mock import patch
 
 import torch
 import torch.utils._pytree as pytree
 from torch.testing import FileCheck
 from torchrec.fx import symbolic_trace
 from torchrec.sparse.jagged_tensor import (
+    _use_native_permute_kjt,
     ComputeKJTToJTDict,
     JaggedTensor,
     KeyedJaggedTensor,
@@ -1065,6 +1067,57 @@ class TestKeyedJaggedTensor(unittest.TestCase):
         self.assertEqual(kjt.stride(), inverse_indices.shape[-1])
 
 
+@unittest.skipIf(
+    not _use_native_permute_kjt(torch.device("cpu")),
+    "torchrec_sparse is not loaded",
+)
+class TestNativePermuteKeyedJaggedTensor(unittest.TestCase):
+    def _check_parity(
+        self, kjt: KeyedJaggedTensor, weights: torch.Tensor, indices: List[int]
+    ) -> None:
+        native = kjt.permute(indices)
+        with patch(
+            "torchrec.sparse.jagged_tensor._use_native_permute_kjt",
+            return_value=False,
+        ):
+            reference = kjt.permute(indices)
+
+        self.assertEqual(native.keys(), reference.keys())
+        self.assertTrue(torch.equal(native.lengths(), reference.lengths()))
+        self.assertTrue(torch.equal(native.values(), reference.values()))
+        self.assertTrue(torch.equal(native.weights(), reference.weights()))
+        self.assertEqual(native.stride_per_key(), reference.stride_per_key())
+
+        grad = torch.rand_like(native.weights())
+        (native_grad,) = torch.autograd.grad(native.weights(), weights, grad)
+        (reference_grad,) = torch.autograd.grad(reference.weights(), weights, grad)
+        torch.testing.assert_close(native_grad, reference_grad)
+
+    def test_permute_w_weights_grad(self) -> None:
+        weights = torch.rand(8, requires_grad=True)
+        kjt = KeyedJaggedTensor.from_lengths_sync(
+            values=torch.arange(8),
+            keys=["index_0", "index_1", "index_2"],
+            lengths=torch.IntTensor([0, 2, 0, 1, 1, 1, 0, 3, 0]),
+            weights=weights,
+        )
+        self._check_parity(kjt, weights, [1, 0, 2])
+        # Repeated keys accumulate their gradients.
+        self._check_parity(kjt, weights, [2, 0, 2, 1, 0])
+
+    def test_permute_vb_w_weights_grad(self) -> None:
+        weights = torch.rand(10, requires_grad=True)
+        kjt = KeyedJaggedTensor(
+            values=torch.arange(10),
+            keys=["index_0", "index_1", "index_2", "index_3"],
+            lengths=torch.IntTensor([1, 0, 1, 3, 0, 1, 0, 2, 0, 2]),
+            weights=weights,
+            stride_per_key_per_rank=[[2], [4], [3], [1]],
+        )
+        self._check_parity(kjt, weights, [1, 3, 0, 2])
+        self._check_parity(kjt, weights, [3, 1, 1, 0])
+
+
 class TestKeyedJaggedTensorScripting(unittest.TestCase):
     def test_scriptable_forward(self) -> None:
         class MyModule(torch.nn.Module):